@@ -0,0 +1,113 @@
+#ifndef APP_TIMESERIES_H
+#define APP_TIMESERIES_H
+
+#include "types.h"
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <cstddef>
+#include <vector>
+
+namespace DPI {
+
+// ============================================================================
+// App Time Series - traffic per application over time, in fixed memory
+// ============================================================================
+//
+// Totals at exit hide when an application was busy. Each FP counts the
+// bytes and packets it handles per application into a ring of time buckets
+// indexed [bucket][app]. Buckets are cut from the packets' own timestamps,
+// not the wall clock, so a capture replayed at any speed still gives its
+// per-second (or per-minute) rates.
+//
+// The ring keeps the last TIMESERIES_BUCKETS buckets and reuses older ones,
+// so memory is fixed for any run length (~57 KB per FP). Packets older than
+// the ring (badly reordered captures) are counted as late and dropped.
+//
+// Only the owning FP writes its ring. Readers merge all FPs on demand by
+// absolute bucket number (timestamp / bucket length); a slot that is being
+// reused while it is read is skipped, its epoch having changed.
+//
+// A packet counts towards the application its flow had when the packet was
+// handled: packets before classification land in Unknown.
+// ============================================================================
+
+constexpr size_t TIMESERIES_BUCKETS = 120;
+constexpr size_t TIMESERIES_APPS = static_cast<size_t>(AppType::APP_COUNT);
+
+// One merged bucket
+struct AppTimeBucket {
+    uint64_t start_sec = 0;                         // Packet time the bucket starts at
+    std::array<uint64_t, TIMESERIES_APPS> bytes{};  // Wire bytes per app
+    std::array<uint64_t, TIMESERIES_APPS> packets{};
+};
+
+// Merged view of every FP's ring, oldest bucket first (gaps included)
+struct AppTimeSeriesSnapshot {
+    uint32_t bucket_seconds = 0;
+    std::vector<AppTimeBucket> buckets;
+    uint64_t late_packets = 0;
+
+    // Mbit/s of a bucket's bytes
+    double mbps(uint64_t bytes) const {
+        return bucket_seconds ? bytes * 8.0 / bucket_seconds / 1e6 : 0.0;
+    }
+};
+
+class AppTimeSeries {
+public:
+    // bucket_seconds: bucket length (0 = off)
+    explicit AppTimeSeries(uint32_t bucket_seconds = 1) : bucket_seconds_(bucket_seconds) {}
+
+    AppTimeSeries(const AppTimeSeries&) = delete;
+    AppTimeSeries& operator=(const AppTimeSeries&) = delete;
+
+    // Bucket length (call before the first record)
+    void setBucketSeconds(uint32_t seconds) { bucket_seconds_ = seconds; }
+    uint32_t getBucketSeconds() const { return bucket_seconds_; }
+    bool isEnabled() const { return bucket_seconds_ > 0; }
+
+    // Owning thread only
+    void record(uint32_t ts_sec, AppType app, uint32_t bytes) {
+        uint64_t bucket = ts_sec / bucket_seconds_;
+        uint64_t current = current_.load(std::memory_order_relaxed);
+        if (bucket > current || current == NO_BUCKET) {
+            advance(bucket, current);
+        } else if (current - bucket >= TIMESERIES_BUCKETS) {
+            late_.store(late_.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+            return;
+        }
+
+        // Single writer: plain load + store, no locked read-modify-write
+        Slot& slot = slots_[bucket % TIMESERIES_BUCKETS];
+        size_t index = static_cast<size_t>(app) < TIMESERIES_APPS ? static_cast<size_t>(app) : 0;
+        slot.bytes[index].store(slot.bytes[index].load(std::memory_order_relaxed) + bytes,
+                                std::memory_order_relaxed);
+        slot.packets[index].store(slot.packets[index].load(std::memory_order_relaxed) + 1,
+                                  std::memory_order_relaxed);
+    }
+
+    // Merge several rings (any thread, any time)
+    static AppTimeSeriesSnapshot merge(const std::vector<const AppTimeSeries*>& series);
+
+private:
+    static constexpr uint64_t NO_BUCKET = ~0ULL;
+
+    struct Slot {
+        std::atomic<uint64_t> epoch{NO_BUCKET};     // Absolute bucket held (NO_BUCKET = being reset)
+        std::array<std::atomic<uint64_t>, TIMESERIES_APPS> bytes{};
+        std::array<std::atomic<uint64_t>, TIMESERIES_APPS> packets{};
+    };
+
+    uint32_t bucket_seconds_;
+    std::atomic<uint64_t> current_{NO_BUCKET};      // Newest bucket
+    std::atomic<uint64_t> late_{0};
+    Slot slots_[TIMESERIES_BUCKETS];
+
+    // Move the head to `bucket`, resetting the slots it passes
+    void advance(uint64_t bucket, uint64_t current);
+};
+
+} // namespace DPI
+
+#endif // APP_TIMESERIES_H
@@ -0,0 +1,115 @@
+#ifndef AUTOTUNER_H
+#define AUTOTUNER_H
+
+#include "dpi_engine.h"
+#include <cstdint>
+#include <cstddef>
+#include <string>
+#include <vector>
+
+namespace DPI {
+
+// ============================================================================
+// Autotuner - picks thread topology, burst and queue depth for this machine
+// ============================================================================
+//
+// The right LB x FP layout, queue burst and queue depth depend on the core
+// count, caches and traffic mix, so the defaults are only a guess. The
+// tuner runs short calibration passes of the whole engine over a sample
+// (the start of the input capture, or synthetic TLS/DNS traffic) and
+// measures each candidate's throughput (Mpps, reader start to last packet
+// written) and reader -> output p99 latency:
+//
+//   1. topology   LB x FP layouts that fit the core count
+//   2. burst      packets a thread takes per queue lock: 1, 8, 32, 64
+//   3. queue      packets per queue: 256 .. 16384
+//
+// Every pass enforces the run's blocking rules (setRules) and writes its
+// drop capture, if any, to a temporary file, so rule, drop and response
+// costs are part of what is measured.
+//
+// Each phase starts from the best candidate so far (coordinate descent: a
+// dozen passes instead of the full cross product). Best is the highest
+// Mpps; candidates within 5% of it count as a tie and the lowest p99 wins,
+// so a deep queue that buys 1% throughput for 10x the latency loses.
+//
+// The result is saved as a "key = value" tuning file that later runs load
+// with --tuning (options on the command line still win).
+// ============================================================================
+
+struct TuningCandidate {
+    int num_load_balancers;
+    int fps_per_lb;
+    size_t burst_size;
+    size_t queue_size;
+
+    // Measured
+    bool ok = false;
+    double mpps = 0;
+    uint64_t latency_p99_ns = 0;
+};
+
+class Autotuner {
+public:
+    static constexpr size_t DEFAULT_SAMPLE_PACKETS = 100000;
+
+    // base: settings every pass runs with (profile, block responses, ...)
+    explicit Autotuner(const DPIEngine::Config& base);
+    ~Autotuner();
+
+    // Blocking rules the real run will load; every pass applies them too
+    void setRules(const std::string& rules_file,
+                  const std::vector<std::string>& block_ips,
+                  const std::vector<std::string>& block_apps,
+                  const std::vector<std::string>& block_domains);
+
+    // Calibration traffic: the first max_packets of a capture...
+    bool sampleCapture(const std::string& input_file, size_t max_packets = DEFAULT_SAMPLE_PACKETS);
+
+    // ...or synthetic flows (TLS handshakes with SNI, bulk data, DNS)
+    bool generateSynthetic(size_t packets = DEFAULT_SAMPLE_PACKETS);
+
+    // The synthetic traffic as a capture of its own (flows: how many it holds)
+    static bool writeSynthetic(const std::string& path, size_t packets, uint32_t* flows = nullptr);
+
+    // Run all phases; returns base with the best candidate applied
+    DPIEngine::Config run();
+
+    const std::vector<TuningCandidate>& results() const { return results_; }
+    const TuningCandidate& best() const { return best_; }
+
+    // Tuning file: write the tuned settings / apply a file to a config
+    static bool save(const std::string& path, const DPIEngine::Config& config,
+                     const TuningCandidate& measured, const std::string& source);
+    static bool load(const std::string& path, DPIEngine::Config& config);
+
+private:
+    DPIEngine::Config base_;
+    std::string sample_path_;       // Calibration capture (temporary)
+    std::string output_path_;       // Discarded output of each pass
+    std::string drops_path_;        // Discarded drop capture of each pass
+    size_t sample_packets_ = 0;
+
+    std::string rules_file_;
+    std::vector<std::string> block_ips_;
+    std::vector<std::string> block_apps_;
+    std::vector<std::string> block_domains_;
+
+    std::vector<TuningCandidate> results_;
+    TuningCandidate best_ = {};
+
+    // One calibration pass (engine output silenced)
+    TuningCandidate measure(TuningCandidate candidate);
+
+    // Pass every candidate, keep the best (the current best stays in the running)
+    void sweep(const char* phase, const std::vector<TuningCandidate>& candidates);
+
+    // a is better than b (see the tie rule above)
+    static bool better(const TuningCandidate& a, const TuningCandidate& b);
+
+    static void apply(const TuningCandidate& candidate, DPIEngine::Config& config);
+};
+
+} // namespace DPI
+
+#endif // AUTOTUNER_H
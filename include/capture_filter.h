@@ -0,0 +1,88 @@
+#ifndef CAPTURE_FILTER_H
+#define CAPTURE_FILTER_H
+
+#include <cstdint>
+#include <cstddef>
+#include <string>
+#include <vector>
+
+namespace DPI {
+
+// ============================================================================
+// Capture Filter - tcpdump-style expression, compiled to jump code
+// ============================================================================
+//
+// Restricts processing to part of a capture. The reader evaluates the filter
+// on the raw frame before parsing it, so a rejected packet costs a header
+// decode and a few compares instead of a parse, a PacketJob and a queue trip.
+//
+// Supported subset (IPv4 over Ethernet, like the packet parser):
+//
+//   tcp | udp | icmp | ip | proto <n>
+//   [src|dst] host <a.b.c.d>
+//   [src|dst] net <a.b.c.d>/<len>        (or a partial address: net 10.1)
+//   [tcp|udp] [src|dst] port <n>
+//   [tcp|udp] [src|dst] portrange <n>-<m>
+//   less <n> | greater <n>                (frame length, inclusive)
+//   not | ! , and | && , or | || , ( )    (not > and > or)
+//
+//   e.g.  tcp port 443 and net 10.0.0.0/8
+//         udp and not (port 53 or port 123)
+//
+// The expression compiles into a flat program like classic BPF: every
+// instruction tests one header field and jumps forward to the next
+// instruction, ACCEPT or REJECT. "and"/"or" short-circuit through the jump
+// targets, so there is no stack and no recursion at match time.
+// ============================================================================
+class CaptureFilter {
+public:
+    // Compile an expression; on a syntax error the filter is left unchanged
+    bool compile(const std::string& expression, std::string& error);
+
+    // A filter was compiled (otherwise everything matches)
+    bool isEnabled() const { return !program_.empty(); }
+
+    // Evaluate on an Ethernet frame
+    bool matches(const uint8_t* frame, size_t length) const;
+
+    const std::string& expression() const { return expression_; }
+    size_t programSize() const { return program_.size(); }
+
+private:
+    // Header fields an instruction can test
+    enum Field : uint8_t {
+        FIELD_IP_PROTO = 0,
+        FIELD_SRC_IP,
+        FIELD_DST_IP,
+        FIELD_SRC_PORT,
+        FIELD_DST_PORT,
+        FIELD_LENGTH,
+        FIELD_COUNT
+    };
+
+    // EQUAL: (value & b) == a      RANGE: a <= value <= b
+    enum Op : uint8_t { OP_EQUAL, OP_RANGE };
+
+    // A test on a field the frame does not have (ports of an ICMP packet,
+    // anything of an ARP frame) takes the false branch.
+    struct Instruction {
+        Field field;
+        Op op;
+        uint16_t jump_true;
+        uint16_t jump_false;
+        uint32_t a;
+        uint32_t b;
+    };
+
+    static constexpr uint16_t ACCEPT = 0xFFFE;
+    static constexpr uint16_t REJECT = 0xFFFF;
+
+    std::vector<Instruction> program_;
+    std::string expression_;
+
+    class Compiler;
+};
+
+} // namespace DPI
+
+#endif // CAPTURE_FILTER_H
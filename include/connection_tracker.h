@@ -2,14 +2,34 @@
 #define CONNECTION_TRACKER_H
 
 #include "types.h"
+#include "memory_accountant.h"
+#include "lock_profiler.h"
 #include <unordered_map>
-#include <shared_mutex>
+#include <array>
 #include <vector>
 #include <chrono>
 #include <functional>
+#include <atomic>
 
 namespace DPI {
 
+// Charges are batched per tracker and flushed in steps of this many bytes
+constexpr int64_t MEMORY_CHARGE_BATCH = 64 * 1024;
+
+// Flows idle this long are evicted early when flow memory is ELEVATED
+constexpr std::chrono::seconds MEMORY_PRESSURE_IDLE_TIMEOUT{30};
+
+// Idle time after which a TCP flow is reclaimed, by state. ESTABLISHED and
+// non-TCP flows use the idle timeout given to cleanupStale.
+constexpr std::chrono::seconds TCP_HANDSHAKE_TIMEOUT{30};      // SYN_SENT, SYN_RECEIVED
+constexpr std::chrono::seconds TCP_HALF_CLOSED_TIMEOUT{60};    // FIN_WAIT
+constexpr std::chrono::seconds TCP_CLOSING_TIMEOUT{10};        // CLOSING
+constexpr std::chrono::seconds TCP_TIME_WAIT_TIMEOUT{5};       // TIME_WAIT
+constexpr std::chrono::seconds TCP_RESET_TIMEOUT{2};           // CLOSED (RST)
+
+// A busy FP sweeps its table this often (an idle one whenever it waits)
+constexpr std::chrono::seconds FLOW_SWEEP_INTERVAL{1};
+
 // ============================================================================
 // Connection Tracker - Maintains flow table for all active connections
 // ============================================================================
@@ -21,7 +41,15 @@ namespace DPI {
 // - Track connection state (NEW -> ESTABLISHED -> CLASSIFIED -> CLOSED)
 // - Store classification results (app type, SNI)
 // - Maintain per-flow statistics
-// - Timeout inactive connections
+// - Timeout inactive connections, closed TCP flows within seconds
+//   (per-state timers above; the FP updates Connection::tcp)
+// - Charge entry bytes to the memory accountant; evict early under pressure
+//
+// Flows live in a slab of max_connections entries reserved up front and an
+// open-addressing index over it, so opening or closing a flow never touches
+// the heap (the allocation check runs the FPs against that). Slots are
+// recycled through a free list and never move: Connection* stay valid until
+// the flow is removed.
 // ============================================================================
 
 class ConnectionTracker {
@@ -38,8 +66,11 @@ public:
     // Update connection with new packet
     void updateConnection(Connection* conn, size_t packet_size, bool is_outbound);
     
-    // Mark connection as classified
-    void classifyConnection(Connection* conn, AppType app, const std::string& sni);
+    // Mark connection as classified (the name is copied into the flow here)
+    void classifyConnection(Connection* conn, AppType app, std::string_view sni);
+    
+    // Replace a provisional classification (port/ALPN guess) with a better one
+    void refineClassification(Connection* conn, AppType app, std::string_view sni);
     
     // Mark connection as blocked
     void blockConnection(Connection* conn);
@@ -47,6 +78,9 @@ public:
     // Mark connection as closed
     void closeConnection(const FiveTuple& tuple);
     
+    // Remove a connection now (a closed flow's ports reused by a new SYN)
+    void removeConnection(Connection* conn);
+    
     // Remove timed-out connections
     // Returns number of connections removed
     size_t cleanupStale(std::chrono::seconds timeout = std::chrono::seconds(300));
@@ -57,12 +91,18 @@ public:
     // Get active connection count
     size_t getActiveCount() const;
     
+    // Account flow memory and react to its pressure (call before the FP starts)
+    void setMemoryAccountant(MemoryAccountant* memory);
+    
     // Get statistics
     struct TrackerStats {
         size_t active_connections;
         size_t total_connections_seen;
         size_t classified_connections;
         size_t blocked_connections;
+        size_t pressure_evictions;      // Evicted early for memory
+        size_t closed_reclaimed;        // TCP flows removed after FIN/RST
+        size_t retired_connections;     // Left the table for any reason
     };
     
     TrackerStats getStats() const;
@@ -72,6 +112,11 @@ public:
     
     // Iteration callback for all connections
     void forEach(std::function<void(const Connection&)> callback) const;
+    
+    // Flows no longer in the table, by app (they still count in reports)
+    const std::array<uint64_t, static_cast<size_t>(AppType::APP_COUNT)>& getRetiredApps() const {
+        return retired_apps_;
+    }
 
 private:
     int fp_id_;
@@ -80,15 +125,58 @@ private:
     // Connection table
     // Note: FiveTuple hash ensures consistent mapping, so we don't need
     // to handle bidirectional flows specially here
-    std::unordered_map<FiveTuple, Connection, FiveTupleHash> connections_;
+    static constexpr uint32_t EMPTY_SLOT = UINT32_MAX;
+    std::vector<Connection> slab_;        // Capacity max_connections_, never grows past it
+    std::vector<uint8_t> live_;           // Per slab slot: holds a flow
+    std::vector<uint32_t> free_slots_;    // Recycled slab slots
+    std::vector<uint32_t> index_;         // Slab slot per bucket (linear probing)
+    size_t index_mask_ = 0;
+    size_t active_ = 0;
     
     // Statistics
     size_t total_seen_ = 0;
     size_t classified_count_ = 0;
     size_t blocked_count_ = 0;
+    size_t closed_reclaimed_ = 0;
+    size_t retired_count_ = 0;
+    std::array<uint64_t, static_cast<size_t>(AppType::APP_COUNT)> retired_apps_{};
+    
+    // Memory accounting (charges batched, see MEMORY_CHARGE_BATCH)
+    MemoryAccountant* memory_ = nullptr;
+    int64_t pending_charge_ = 0;
+    std::atomic<uint8_t> pressure_request_{0};  // Set by the pressure callback
+    size_t pressure_evictions_ = 0;
+    
+    // Index operations (EMPTY_SLOT if the tuple has no flow)
+    size_t bucketOf(const FiveTuple& tuple) const;
+    uint32_t findSlot(const FiveTuple& tuple) const;
+    Connection* insert(const FiveTuple& tuple);
+    
+    // Unlink a flow and recycle its slot (release() it first)
+    void erase(uint32_t slot);
     
     // For LRU eviction if table gets full
     void evictOldest();
+    
+    // Remove idle (and closed) connections, traced with the given reason
+    size_t removeStale(std::chrono::seconds timeout, uint32_t reason);
+    
+    // Idle time allowed in the flow's TCP state (idle_timeout for the rest)
+    static std::chrono::seconds stateTimeout(const Connection& conn, std::chrono::seconds idle_timeout);
+    
+    // Remove the count least recently seen connections in one pass
+    size_t evictLeastRecent(size_t count);
+    
+    // Make room after the accountant reported pressure (FP thread)
+    void relievePressure();
+    
+    // Approximate bytes held by one table entry
+    static size_t entryBytes(const Connection& conn);
+    
+    // Bring conn's charge up to date / drop it (and tally the flow) before erasing
+    void recharge(Connection* conn);
+    void release(const Connection& conn);
+    void flushCharge();
 };
 
 // ============================================================================
@@ -116,7 +204,7 @@ public:
 
 private:
     std::vector<ConnectionTracker*> trackers_;
-    mutable std::shared_mutex mutex_;
+    mutable ProfiledSharedMutex mutex_{"ConnectionTable"};
 };
 
 } // namespace DPI
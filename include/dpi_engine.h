@@ -7,7 +7,24 @@
 #include "load_balancer.h"
 #include "fast_path.h"
 #include "rule_manager.h"
+#include "signature_engine.h"
+#include "flow_classifier.h"
+#include "hint_cache.h"
+#include "slow_path.h"
+#include "overload_controller.h"
+#include "flow_sampler.h"
+#include "drop_sink.h"
+#include "packet_pool.h"
+#include "capture_filter.h"
+#include "alloc_tracker.h"
+#include "lock_profiler.h"
+#include "response_synthesizer.h"
+#include "latency_histogram.h"
+#include "memory_accountant.h"
 #include "connection_tracker.h"
+#include "perf_counters.h"
+#include "flight_recorder.h"
+#include "app_timeseries.h"
 #include <memory>
 #include <thread>
 #include <atomic>
@@ -50,15 +67,91 @@ namespace DPI {
 //
 // ============================================================================
 
+// What the output PCAP keeps of each forwarded packet
+enum class OutputMode {
+    FULL,                   // Whole packet
+    HEADERS,                // Through the L4 header
+    UNCLASSIFIED_PAYLOAD    // Whole packet for unclassified flows, headers otherwise
+};
+
+bool parseOutputMode(const std::string& name, OutputMode& mode);
+
 class DPIEngine {
 public:
     // Configuration
     struct Config {
         int num_load_balancers = 2;
         int fps_per_lb = 2;
-        size_t queue_size = 10000;
+        size_t queue_size = 10000;              // Packets per LB / FP / output queue
+        size_t burst_size = 1;                  // Packets a thread takes per queue lock
         std::string rules_file;
+        std::string signatures_file;  // Empty = built-in signatures
+        std::string flow_model_file;  // Empty = no statistical classification
+        std::string capture_filter;   // tcpdump-style expression; empty = every packet
         bool verbose = false;
+        bool perf_counters = false;  // Per-thread hardware counters (Linux perf)
+        
+        // Shared (dst_ip, dst_port) -> app hints for new flows
+        bool hint_cache = true;
+        size_t hint_cache_entries = 65536;
+        uint32_t hint_merge_ms = 100;           // Write buffer merge interval
+        
+        // Certificate / QUIC Initial inspection off the FPs (0 = inline)
+        int slow_path_workers = 2;
+        size_t slow_path_queue = 1024;          // Outstanding requests before FPs go inline
+        
+        // Staged load shedding when the FPs fall behind (off = plain backpressure)
+        bool overload_control = false;
+        OverloadPolicy overload_policy = OverloadPolicy::FORWARD;  // For packets the FPs can't take
+        uint32_t overload_sample_rate = 16;     // 1 in N flows inspected when sampling
+        
+        // Analytics-only: inspect 1 in N flows, report scaled estimates (1 = all)
+        uint32_t flow_sample_rate = 1;
+        
+        // Output PCAP contents (snaplen caps every mode; 0 = no cap)
+        OutputMode output_mode = OutputMode::FULL;
+        uint32_t snaplen = 0;
+        
+        // Frame buffers recycled from the output back to the reader (0 = allocate each)
+        size_t packet_pool_buffers = 8192;
+        
+        // Audit capture of dropped packets (pcapng with verdicts; empty = off)
+        std::string drop_capture_file;
+        size_t drop_capture_queue = 4096;       // Packets buffered before the audit loses some
+        
+        // Answer blocked flows: TCP RST both ways, NXDOMAIN (or sinkhole A) for DNS
+        bool block_responses = false;
+        std::string dns_sinkhole;               // Empty = NXDOMAIN
+        uint32_t block_response_rate = 2;       // Per flow per second
+        
+        // Inspection stages compiled into the FP pipeline
+        FastPathProfile fast_path_profile = FastPathProfile::FULL_DPI;
+        
+        // Memory budgets in bytes (0 = unlimited)
+        size_t flow_memory_budget = 0;          // All flow tables; evicts early under pressure
+        size_t queue_memory_budget = 0;         // All packet queues, split evenly; pushes wait
+        
+        // TCP flows wait outside the flow table until their handshake completes,
+        // so SYN floods and scans cannot evict established flows (0 = off)
+        size_t embryonic_entries = EMBRYONIC_DEFAULT_ENTRIES;  // Per FP
+        uint32_t embryonic_timeout_sec = 10;    // Handshake must complete within this
+        
+        // Steady-state allocation check (builds with -DDPI_ALLOC_CHECK):
+        // packets each thread handles before it must stop allocating (0 = off)
+        uint64_t alloc_check_warmup = 0;
+        
+        // Time every packet from the reader to the output (see getRunMetrics)
+        bool measure_latency = false;
+        
+        // Per-app traffic over time: bucket length in packet-time seconds
+        // (0 = off) and an optional CSV export written at the end
+        uint32_t timeseries_bucket_seconds = 1;
+        std::string timeseries_file;
+        
+        // Flight recorder (dumped on SIGUSR2 or dumpTrace())
+        size_t trace_events_per_thread = 4096;  // 0 disables recording
+        uint32_t trace_stall_us = 1000;         // Record work stalls longer than this
+        std::string trace_file = "dpi_trace.json";
     };
     
     DPIEngine(const Config& config);
@@ -110,6 +203,12 @@ public:
     // Save rules to file
     bool saveRules(const std::string& filename);
     
+    // Replace payload signatures at runtime (FPs pick them up immediately)
+    bool loadSignatures(const std::string& filename);
+    
+    // Replace the flow feature model at runtime
+    bool loadFlowModel(const std::string& filename);
+    
     // ========== Reporting ==========
     
     // Generate full statistics report
@@ -118,48 +217,122 @@ public:
     // Generate classification report (app distribution)
     std::string generateClassificationReport() const;
     
+    // Per-app bandwidth per time bucket (empty when the time series is off)
+    std::string generateTimeSeriesReport() const;
+    
+    // Per-app time series merged across FPs (any time, while running too)
+    AppTimeSeriesSnapshot getAppTimeSeries() const;
+    
+    // Write the time series as CSV: time,app,packets,bytes,mbps
+    bool exportTimeSeries(const std::string& path) const;
+    
     // Get real-time statistics
     const DPIStats& getStats() const;
     
     // Print live status
     void printStatus() const;
     
+    // Write the flight recorder rings as Chrome trace JSON
+    bool dumpTrace(const std::string& path) const;
+    
     // ========== Accessors ==========
     
     RuleManager& getRuleManager() { return *rule_manager_; }
     const Config& getConfig() const { return config_; }
     bool isRunning() const { return running_; }
+    
+    // No LB/FP thread allocated after warm-up (alloc_check_warmup runs only)
+    bool allocationCheckPassed() const { return alloc_check_passed_; }
+    
+    // Throughput and latency of the last processFile() (latency needs measure_latency)
+    struct RunMetrics {
+        uint64_t packets;           // Written to the output
+        double seconds;             // Reader start to last packet written
+        double mpps;
+        uint64_t latency_p50_ns;    // Reader -> output, per packet
+        uint64_t latency_p99_ns;
+        uint64_t latency_max_ns;
+    };
+    RunMetrics getRunMetrics() const;
 
 private:
     Config config_;
     
     // Shared components
     std::unique_ptr<RuleManager> rule_manager_;
+    std::unique_ptr<SignatureEngine> signature_engine_;
+    std::unique_ptr<FlowClassifier> flow_classifier_;
+    std::unique_ptr<HintCache> hint_cache_;  // Must outlive the FPs
+    MemoryAccountant memory_;                // Must outlive the FPs
+    std::unique_ptr<SlowPathPool> slow_path_;  // Must outlive the FPs
+    std::unique_ptr<ResponseSynthesizer> responder_;  // Must outlive the FPs
     std::unique_ptr<GlobalConnectionTable> global_conn_table_;
     
     // Thread pools
     std::unique_ptr<FPManager> fp_manager_;
     std::unique_ptr<LBManager> lb_manager_;
+    std::unique_ptr<OverloadController> overload_;
     
     // Output handling
     ThreadSafeQueue<PacketJob> output_queue_;
     std::thread output_thread_;
     std::ofstream output_file_;
-    std::mutex output_mutex_;
+    ProfiledMutex output_mutex_{"DPIEngine::output"};
+    std::unique_ptr<DropSink> drop_sink_;
+    PacketBufferPool buffer_pool_;
     
     // Statistics
     DPIStats stats_;
     
+    // Ingress counters, one per LB on its own cache line (ingestPacket runs
+    // on every LB; summed for reports, folded into stats_ at stop)
+    struct alignas(64) IngestCounters {
+        std::atomic<uint64_t> packets{0};
+        std::atomic<uint64_t> bytes{0};
+        std::atomic<uint64_t> tcp_packets{0};
+        std::atomic<uint64_t> udp_packets{0};
+    };
+    std::unique_ptr<IngestCounters[]> ingest_counters_;
+    
+    struct IngestTotals {
+        uint64_t packets;
+        uint64_t bytes;
+        uint64_t tcp_packets;
+        uint64_t udp_packets;
+    };
+    IngestTotals ingestTotals() const;
+    
+    // Hardware counters for the reader and output threads
+    // (LB/FP threads own theirs)
+    PerfCounterGroup reader_perf_;
+    PerfCounterGroup output_perf_;
+    
+    // Per-thread trace rings
+    FlightRecorder recorder_;
+    
+    // Which flows the ingress stage passes on for inspection
+    FlowSampler sampler_;
+    
+    // Which packets the reader processes at all (before parsing)
+    CaptureFilter capture_filter_;
+    
     // Control
     std::atomic<bool> running_{false};
     std::atomic<bool> processing_complete_{false};
+    bool alloc_check_passed_ = true;
+    
+    // Run metrics (reader start, output thread progress)
+    uint64_t run_start_ticks_ = 0;
+    std::atomic<uint64_t> last_output_ticks_{0};
+    std::atomic<uint64_t> packets_written_{0};
+    LatencyHistogram pipeline_latency_;
     
     // Reader thread (separate for PCAP input)
     std::thread reader_thread_;
     
     // Output handling
     void outputThreadFunc();
-    void handleOutput(const PacketJob& job, PacketAction action);
+    void handleOutput(PacketJob& job, PacketAction action);
     
     // Write PCAP header to output file
     bool writeOutputHeader(const PacketAnalyzer::PcapGlobalHeader& header);
@@ -167,13 +340,20 @@ private:
     // Write a packet to output file
     void writeOutputPacket(const PacketJob& job);
     
+    // Bytes of a packet the output keeps (output mode + snaplen)
+    size_t captureLength(const PacketJob& job) const;
+    
     // Reader function
     void readerThreadFunc(const std::string& input_file);
     
-    // Convert ParsedPacket to PacketJob
-    PacketJob createPacketJob(const PacketAnalyzer::RawPacket& raw,
-                               const PacketAnalyzer::ParsedPacket& parsed,
-                               uint32_t packet_id);
+    // Ingress stage, run on the LB threads: parse a framed packet, count it
+    // (in the calling LB's counters) and apply flow sampling. False = not
+    // dispatched to an FP.
+    bool ingestPacket(PacketJob& job, IngestCounters& counters);
+    
+    // L2-L4 decode of job.data into tuple, flags and offsets (false = not
+    // IPv4 TCP/UDP or truncated)
+    static bool decodeFrame(PacketJob& job);
 };
 
 } // namespace DPI
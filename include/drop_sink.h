@@ -0,0 +1,88 @@
+#ifndef DROP_SINK_H
+#define DROP_SINK_H
+
+#include "types.h"
+#include "thread_safe_queue.h"
+#include <cstdint>
+#include <string>
+#include <vector>
+#include <fstream>
+#include <thread>
+#include <atomic>
+
+namespace DPI {
+
+// ============================================================================
+// Drop Sink - audit capture of dropped packets (pcapng with verdicts)
+// ============================================================================
+//
+// Every packet the engine drops can be written to a second capture so
+// blocks can be audited without re-running. The file is pcapng:
+//
+//   Section Header Block   (once, on open)
+//   Interface Description  (once, link type from the input capture)
+//   Enhanced Packet Block  per dropped packet, with an opt_comment:
+//                          "rule=domain:*.tiktok.com flow=... packet=..."
+//
+// The forwarding path must never wait for audit I/O: submit() moves the
+// dropped packet's buffer and raw flow/verdict fields into a bounded queue
+// and gives up (counting the loss) when the queue is full. A single writer
+// thread drains it at idle scheduling priority where the OS supports it,
+// and formats the comments there.
+// ============================================================================
+class DropSink {
+public:
+    // queue_capacity: dropped packets buffered before the sink loses some
+    explicit DropSink(size_t queue_capacity = 4096);
+    ~DropSink();
+
+    // Create the file and write the section header
+    bool open(const std::string& path);
+
+    // Describe the capture interface (call once, before any packet)
+    void writeInterface(uint16_t link_type, uint32_t snaplen);
+
+    // Start/stop the writer thread (stop drains what is queued)
+    void start();
+    void stop();
+
+    // Queue a dropped packet, taking its buffer; never blocks (false = lost,
+    // queue full)
+    bool submit(PacketJob&& job);
+
+    struct Stats {
+        uint64_t written;
+        uint64_t lost;              // Queue full, not recorded
+        uint64_t bytes;             // File bytes written
+    };
+    Stats getStats() const;
+
+private:
+    struct Record {
+        uint32_t ts_sec = 0;
+        uint32_t ts_usec = 0;
+        uint32_t orig_len = 0;
+        std::vector<uint8_t> data;
+        FiveTuple tuple;
+        uint32_t packet_id = 0;
+        const std::string* verdict = nullptr;   // Interned rule ID (see PacketJob)
+    };
+
+    ThreadSafeQueue<Record> queue_;
+    std::ofstream file_;
+
+    std::thread thread_;
+    std::atomic<bool> running_{false};
+
+    std::atomic<uint64_t> written_{0};
+    std::atomic<uint64_t> lost_{0};
+    std::atomic<uint64_t> bytes_{0};
+
+    void run();
+    void writeEnhancedPacket(const Record& record);
+    void writeBlock(uint32_t type, const std::vector<uint8_t>& body);
+};
+
+} // namespace DPI
+
+#endif // DROP_SINK_H
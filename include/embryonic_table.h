@@ -0,0 +1,119 @@
+#ifndef EMBRYONIC_TABLE_H
+#define EMBRYONIC_TABLE_H
+
+#include "types.h"
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstddef>
+#include <vector>
+
+namespace DPI {
+
+// ============================================================================
+// Embryonic Table - TCP flows that have not finished their handshake
+// ============================================================================
+//
+// Creating a full Connection for every SYN lets a scan or a SYN flood fill
+// the flow table and evict real, established flows. Instead, a TCP flow
+// that opens with a bare SYN waits here with a few counters until it proves
+// itself, and only then gets a Connection:
+//
+//   SYN (no payload)          admitted; retransmits stay here
+//   SYN-ACK from the server   stays here
+//   RST                       entry freed, nothing ever allocated
+//   anything else             promoted: the initiator's handshake ACK,
+//                             payload in either direction, FIN, ...
+//
+// A SYN-ACK with no SYN before it (capture started mid-handshake, or
+// backscatter from spoofed SYNs) is admitted too, stored the client's way
+// round, and promoted by the same ACK or payload. A RST for a flow nobody
+// knows is ignored: no entry, no Connection. Other packets that do not start
+// with a SYN (midstream pickup) and non-TCP flows go straight to the
+// connection tracker as before.
+//
+// The table is a fixed array allocated once (no allocation per packet),
+// indexed by the direction-independent tuple hash with a short probe
+// window. When the window is full the oldest entry there is recycled:
+// counted as expired if it outlived the handshake timeout, as overflowed
+// otherwise. A flood therefore only churns this table; the main table and
+// its established flows are untouched.
+//
+// One per FP, used by the FP thread only; the counters may be read by
+// any thread.
+// ============================================================================
+
+constexpr size_t EMBRYONIC_DEFAULT_ENTRIES = 4096;
+constexpr std::chrono::seconds EMBRYONIC_DEFAULT_TIMEOUT{10};
+
+// Handshake state carried over to the Connection on promotion
+struct EmbryonicFlow {
+    FiveTuple tuple;                                // As opened (client -> server)
+    std::chrono::steady_clock::time_point first_seen;
+    std::chrono::steady_clock::time_point last_seen;
+    uint32_t bytes_out = 0;
+    uint32_t bytes_in = 0;
+    uint16_t packets_out = 0;
+    uint16_t packets_in = 0;
+    bool syn_ack_seen = false;
+    bool used = false;
+};
+
+class EmbryonicTable {
+public:
+    // Packets compared per lookup / insert
+    static constexpr size_t PROBE_WINDOW = 8;
+
+    enum class Verdict {
+        NOT_EMBRYONIC,      // Not a handshake flow: use the connection tracker
+        HELD,               // Packet belongs to a flow kept here
+        IGNORED,            // Stray RST: no flow to create
+        PROMOTED            // Handshake done: create the Connection from `flow`
+    };
+
+    EmbryonicTable() = default;
+
+    // entries: table size (0 = off); call before the FP starts
+    void configure(size_t entries, std::chrono::seconds timeout = EMBRYONIC_DEFAULT_TIMEOUT);
+
+    bool isEnabled() const { return !entries_.empty(); }
+
+    // A TCP packet whose flow is not in the connection tracker. On PROMOTED,
+    // `flow` holds the handshake's counters and the entry is gone.
+    Verdict track(const FiveTuple& tuple, uint8_t tcp_flags, size_t payload_length,
+                  size_t packet_size, EmbryonicFlow& flow);
+
+    // Free entries older than the timeout (idle FP)
+    size_t expireStale();
+
+    struct Stats {
+        uint64_t admitted;          // Flows opened by a SYN (or a lone SYN-ACK)
+        uint64_t promoted;          // Moved to the connection tracker
+        uint64_t expired;           // Handshake never completed
+        uint64_t reset;             // Ended by a RST before completing
+        uint64_t overflowed;        // Recycled before the timeout (table full)
+        uint64_t stray_resets;      // RSTs for no known flow, ignored
+        uint64_t held;              // Waiting now
+    };
+
+    Stats getStats() const;
+
+private:
+    std::vector<EmbryonicFlow> entries_;
+    size_t mask_ = 0;
+    std::chrono::seconds timeout_ = EMBRYONIC_DEFAULT_TIMEOUT;
+
+    std::atomic<uint64_t> admitted_{0};
+    std::atomic<uint64_t> promoted_{0};
+    std::atomic<uint64_t> expired_{0};
+    std::atomic<uint64_t> reset_{0};
+    std::atomic<uint64_t> overflowed_{0};
+    std::atomic<uint64_t> stray_resets_{0};
+    std::atomic<uint64_t> held_{0};
+
+    void release(EmbryonicFlow& entry, std::atomic<uint64_t>& reason);
+};
+
+} // namespace DPI
+
+#endif // EMBRYONIC_TABLE_H
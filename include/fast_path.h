@@ -6,20 +6,88 @@
 #include "connection_tracker.h"
 #include "rule_manager.h"
 #include "sni_extractor.h"
+#include "signature_engine.h"
+#include "flow_classifier.h"
+#include "hint_cache.h"
+#include "slow_path.h"
+#include "overload_controller.h"
+#include "flow_sampler.h"
+#include "response_synthesizer.h"
+#include "perf_counters.h"
+#include "alloc_tracker.h"
+#include "flight_recorder.h"
+#include "app_timeseries.h"
+#include "embryonic_table.h"
 #include <thread>
 #include <atomic>
 #include <memory>
 #include <functional>
+#include <string>
 
 namespace DPI {
 
+// ============================================================================
+// Fast Path Profiles - inspection stages fixed at compile time
+// ============================================================================
+//
+// A profile is a set of inspection stages. The FP loop is instantiated once
+// per profile, so the stages a profile leaves out are not skipped per packet,
+// they are not in its code at all. The FP picks its instantiation once, when
+// its thread starts.
+//
+//   FULL_DPI   every stage (default)
+//   SNI_ONLY   TLS ClientHello / QUIC Initial SNI, then hint or port
+//   L4_ONLY    no payload inspection: hint or port only
+//
+// Rules apply in every profile; app and domain rules can only match what
+// the profile is able to classify. An endpoint hint names a flow but never
+// blocks it: other flows to a shared endpoint may have been something else.
+// ============================================================================
+
+namespace InspectStage {
+    constexpr uint32_t TLS_SERVER = 1u << 0;   // ServerHello / Certificate names
+    constexpr uint32_t TLS_SNI    = 1u << 1;   // ClientHello SNI
+    constexpr uint32_t QUIC       = 1u << 2;   // QUIC Initial SNI
+    constexpr uint32_t HTTP       = 1u << 3;   // Host header
+    constexpr uint32_t DNS        = 1u << 4;   // Query name
+    constexpr uint32_t SIGNATURES = 1u << 5;   // Payload signatures
+    constexpr uint32_t FLOW_MODEL = 1u << 6;   // Early-flow feature classifier
+    constexpr uint32_t PAYLOAD    = (1u << 7) - 1;   // Any of the above
+}
+
+enum class FastPathProfile : uint8_t {
+    FULL_DPI,
+    SNI_ONLY,
+    L4_ONLY
+};
+
+constexpr uint32_t profileStages(FastPathProfile profile) {
+    switch (profile) {
+        case FastPathProfile::SNI_ONLY: return InspectStage::TLS_SNI | InspectStage::QUIC;
+        case FastPathProfile::L4_ONLY:  return 0;
+        default:                        return InspectStage::PAYLOAD;
+    }
+}
+
+const char* fastPathProfileToString(FastPathProfile profile);
+bool parseFastPathProfile(const std::string& name, FastPathProfile& profile);
+
+// TCP state machine counters (per FP, summed by FPManager)
+struct TcpStateStats {
+    uint64_t midstream;             // Flows picked up without their handshake
+    uint64_t fin_closes;            // Both FINs acknowledged (TIME_WAIT)
+    uint64_t resets;                // Ended by an in-window RST
+    uint64_t invalid_resets;        // RSTs far outside the window, ignored
+    uint64_t reclaimed;             // Closed flows removed by their short timers
+};
+
 // ============================================================================
 // Fast Path Processor Thread
 // ============================================================================
 //
 // Each FP thread is responsible for:
 // 1. Receiving packets from its input queue (fed by LB)
-// 2. Connection tracking (maintaining flow state)
+// 2. Connection tracking (maintaining flow state, the TCP state machine)
 // 3. Deep Packet Inspection (SNI extraction, protocol detection)
 // 4. Rule matching (blocking decisions)
 // 5. Forwarding or dropping packets
@@ -29,18 +97,21 @@ namespace DPI {
 //
 // ============================================================================
 
-// Callback type for packet output (forwarding)
-using PacketOutputCallback = std::function<void(const PacketJob&, PacketAction)>;
-
 class FastPathProcessor {
 public:
     // Constructor
     // fp_id: ID of this FP (0, 1, 2, ...)
     // rule_manager: Shared rule manager (read-only from FP perspective)
+    // signatures: Shared payload signature engine (may be null)
+    // flow_classifier: Shared flow feature classifier (may be null)
     // output_callback: Called when packet should be forwarded
+    // queue_size: Capacity of the input queue (packets)
     FastPathProcessor(int fp_id,
                       RuleManager* rule_manager,
-                      PacketOutputCallback output_callback);
+                      SignatureEngine* signatures,
+                      FlowClassifier* flow_classifier,
+                      PacketOutputCallback output_callback,
+                      size_t queue_size = 10000);
     
     ~FastPathProcessor();
     
@@ -64,10 +135,64 @@ public:
         uint64_t connections_tracked;
         uint64_t sni_extractions;
         uint64_t classification_hits;
+        uint64_t signature_matches;
+        uint64_t certificate_extractions;
+        uint64_t hint_hits;
+        uint64_t hint_confirmed;
+        uint64_t hint_mismatched;
+        uint64_t flow_model_evaluations;
+        uint64_t flow_model_matches;
+        uint64_t pressure_evictions;
+        EmbryonicTable::Stats embryonic;
+        TcpStateStats tcp;
     };
     
     FPStats getStats() const;
     
+    // Enable hardware counters (call before start)
+    void enablePerfCounters(bool enable) { perf_enabled_ = enable; }
+    
+    // Attach a flight recorder (call before start)
+    void setFlightRecorder(FlightRecorder* recorder) { recorder_ = recorder; }
+    
+    // Attach the shared classification hint cache (call before start)
+    void setHintCache(HintCache* cache) {
+        hint_cache_ = cache;
+        hint_reader_ = HintReader(cache);
+    }
+    
+    // Attach the slow-path worker pool (call before start)
+    void setSlowPath(SlowPathPool* slow_path) { slow_path_ = slow_path; }
+    
+    // Attach the overload controller (call before start)
+    void setOverloadController(OverloadController* overload) { overload_ = overload; }
+    
+    // Answer dropped packets with TCP RST / DNS responses (call before start)
+    void setResponseSynthesizer(ResponseSynthesizer* responder) { responder_ = responder; }
+    
+    // Inspection stages this FP runs (call before start)
+    void setProfile(FastPathProfile profile) { profile_ = profile; }
+    
+    // Packets taken from the input queue per lock (call before start)
+    void setBurstSize(size_t burst) { burst_size_ = burst > 0 ? burst : 1; }
+    
+    // Charge the flow table to the memory accountant (call before start)
+    void setMemoryAccountant(MemoryAccountant* memory) { conn_tracker_.setMemoryAccountant(memory); }
+    
+    // Hold handshaking TCP flows outside the flow table (call before start; 0 = off)
+    void setEmbryonicTable(size_t entries, std::chrono::seconds timeout) {
+        embryonic_.configure(entries, timeout);
+    }
+    
+    // Per-app time series bucket length in seconds (call before start; 0 = off)
+    void setTimeSeriesBucket(uint32_t seconds) { time_series_.setBucketSeconds(seconds); }
+    
+    // Per-app traffic over time (merged by FPManager::getAppTimeSeries)
+    const AppTimeSeries& getTimeSeries() const { return time_series_; }
+    
+    // Get hardware counter sample for this FP thread
+    PerfSample getPerfSample() const { return perf_.snapshot(); }
+    
     // Get FP ID
     int getId() const { return fp_id_; }
     
@@ -77,15 +202,38 @@ public:
 private:
     int fp_id_;
     
-    // Input queue from LB
+    // Input queue from LB, drained burst_size_ packets at a time
     ThreadSafeQueue<PacketJob> input_queue_;
+    size_t burst_size_ = 1;
+    std::vector<PacketJob> burst_;
     
     // Connection tracker (per-FP, no sharing needed)
     ConnectionTracker conn_tracker_;
     
+    // Flows still in their TCP handshake (SYN floods and scans stay here)
+    EmbryonicTable embryonic_;
+    
     // Rule manager (shared, read-only)
     RuleManager* rule_manager_;
     
+    // Payload signatures for non-TLS protocols (shared, read-only)
+    SignatureEngine* signatures_;
+    
+    // Names extracted from a packet that had to be lowercased or assembled
+    HostnameScratch name_scratch_;
+    
+    // The flow's name as the rule manager takes it (reserved once, reused)
+    std::string rule_domain_;
+    
+    // Set in use, refreshed when the engine reloads (no shared_ptr load per packet)
+    std::shared_ptr<const SignatureSet> signature_set_;
+    uint64_t signature_version_ = 0;
+    
+    // Early-flow statistical classifier (shared, read-only)
+    FlowClassifier* flow_classifier_;
+    std::shared_ptr<const FlowModel> flow_model_;      // Cached by version like the signature set
+    uint64_t flow_model_version_ = 0;
+    
     // Output callback
     PacketOutputCallback output_callback_;
     
@@ -95,19 +243,94 @@ private:
     std::atomic<uint64_t> packets_dropped_{0};
     std::atomic<uint64_t> sni_extractions_{0};
     std::atomic<uint64_t> classification_hits_{0};
+    std::atomic<uint64_t> signature_matches_{0};
+    std::atomic<uint64_t> certificate_extractions_{0};
+    std::atomic<uint64_t> hint_hits_{0};
+    std::atomic<uint64_t> hint_confirmed_{0};
+    std::atomic<uint64_t> hint_mismatched_{0};
+    std::atomic<uint64_t> flow_model_evaluations_{0};
+    std::atomic<uint64_t> flow_model_matches_{0};
+    std::atomic<uint64_t> tcp_midstream_{0};
+    std::atomic<uint64_t> tcp_fin_closes_{0};
+    std::atomic<uint64_t> tcp_resets_{0};
+    std::atomic<uint64_t> tcp_invalid_resets_{0};
+    
+    // Next sweep of the flow table while busy (short TCP close timers)
+    std::chrono::steady_clock::time_point next_sweep_;
+    
+    // Per-app bytes/packets in time buckets (this FP writes, reports merge)
+    AppTimeSeries time_series_;
+    
+    // Hardware counters (opened by the FP thread itself)
+    bool perf_enabled_ = false;
+    PerfCounterGroup perf_;
+    
+    // Flight recorder (shared, each thread attaches its own ring)
+    FlightRecorder* recorder_ = nullptr;
+    
+    // Endpoint hints (shared cache, private lock-free view)
+    HintCache* hint_cache_ = nullptr;
+    HintReader hint_reader_{nullptr};
+    
+    // Offloaded inspection (shared pool, results in this FP's mailboxes)
+    SlowPathPool* slow_path_ = nullptr;
+    
+    // Decides whether new flows are inspected (null = always)
+    OverloadController* overload_ = nullptr;
+    
+    // Compile-time pipeline selected when the thread starts
+    FastPathProfile profile_ = FastPathProfile::FULL_DPI;
+    
+    // Builds responses for blocked flows (shared, null = silent drop)
+    ResponseSynthesizer* responder_ = nullptr;
+    std::vector<PacketJob> responses_;      // Emitted after the current packet
     
     // Thread control
     std::atomic<bool> running_{false};
     std::thread thread_;
     
-    // Main processing loop
+    // Main processing loop (dispatches once to the profile's runLoop)
     void run();
+    template<uint32_t Stages> void runLoop(uint64_t& processed);
     
     // Process a single packet
-    PacketAction processPacket(PacketJob& job);
+    template<uint32_t Stages> PacketAction processPacket(PacketJob& job);
+    
+    // Drop a packet of a blocked flow (verdict, synthesized responses)
+    PacketAction dropPacket(PacketJob& job, Connection* conn);
+    
+    // Find the packet's flow, creating it unless it is still handshaking
+    // (nullptr: held in the embryonic table, or a stray RST)
+    Connection* lookupFlow(const PacketJob& job, bool& created);
+    
+    // The IP/port rules would drop a flow opened with this tuple
+    bool blockedAtOpen(const FiveTuple& tuple);
+    
+    // Pre-classify a new flow from its server endpoint's hint
+    void applyHint(Connection* conn);
+    
+    // Share a final classification with the other FPs
+    void publishHint(Connection* conn);
+    
+    // Hand expensive work for a flow to the slow path (marks it INSPECT)
+    bool offloadToSlowPath(SlowPathTask task, Connection* conn,
+                           const uint8_t* data, size_t length);
+    
+    // Apply finished slow-path results to their flows
+    void drainSlowPath();
+    void applySlowPathResult(const SlowPathResult& result);
+    
+    // Classify from the endpoint hint or the server port alone
+    void classifyWithoutPayload(Connection* conn);
+    
+    // Current signature set (signatures_ must be set)
+    const SignatureSet& signatureSet();
+    
+    // Port guesses: the signature set's table, or the defaults without one
+    const PortHintTable& portHints();
     
-    // Inspect packet payload for classification
-    void inspectPayload(PacketJob& job, Connection* conn);
+    // Inspect packet payload for classification (only the profile's stages)
+    template<uint32_t Stages> void inspectPayload(PacketJob& job, Connection* conn);
     
     // Extract SNI from TLS Client Hello
     bool tryExtractSNI(const PacketJob& job, Connection* conn);
@@ -115,11 +338,27 @@ private:
     // Extract Host from HTTP request
     bool tryExtractHTTPHost(const PacketJob& job, Connection* conn);
     
+    // Find the SNI in a QUIC Initial (first client datagrams only)
+    bool tryExtractQUICSNI(const PacketJob& job, Connection* conn);
+    
+    // Parse the server's ServerHello / Certificate (first few server packets)
+    bool tryParseServerHandshake(const PacketJob& job, Connection* conn);
+    
+    // Match payload against protocol signatures (first few packets only)
+    bool tryMatchSignatures(const PacketJob& job, Connection* conn);
+    
+    // Current flow model (null while none is loaded)
+    const FlowModel* flowModel();
+    
+    // Collect early-flow features; runs the flow model once at packet N
+    // (also on flows holding a provisional port/hint verdict)
+    bool tryClassifyFlowFeatures(const PacketJob& job, Connection* conn);
+    
     // Check if packet matches any blocking rules
-    PacketAction checkRules(const PacketJob& job, Connection* conn);
+    PacketAction checkRules(Connection* conn);
     
-    // Update TCP connection state
-    void updateTCPState(Connection* conn, uint8_t tcp_flags);
+    // Advance the flow's TCP state machine (both directions, FIN/RST/TIME_WAIT)
+    void updateTCPState(Connection* conn, const PacketJob& job, bool is_outbound);
 };
 
 // ============================================================================
@@ -130,10 +369,16 @@ public:
     // Create FP manager
     // num_fps: Number of FP threads
     // rule_manager: Shared rule manager
+    // signatures: Shared payload signature engine
+    // flow_classifier: Shared flow feature classifier
     // output_callback: Shared output callback
+    // queue_size: Capacity of each FP input queue (packets)
     FPManager(int num_fps,
               RuleManager* rule_manager,
-              PacketOutputCallback output_callback);
+              SignatureEngine* signatures,
+              FlowClassifier* flow_classifier,
+              PacketOutputCallback output_callback,
+              size_t queue_size = 10000);
     
     ~FPManager();
     
@@ -167,12 +412,58 @@ public:
         uint64_t total_forwarded;
         uint64_t total_dropped;
         uint64_t total_connections;
+        uint64_t total_hint_hits;
+        uint64_t total_hint_confirmed;
+        uint64_t total_hint_mismatched;
+        uint64_t total_pressure_evictions;
+        EmbryonicTable::Stats embryonic;
+        TcpStateStats tcp;
     };
     
     AggregatedStats getAggregatedStats() const;
     
+    // Enable hardware counters on all FPs (call before startAll)
+    void enablePerfCounters(bool enable);
+    
+    // Attach a flight recorder to all FPs (call before startAll)
+    void setFlightRecorder(FlightRecorder* recorder);
+    
+    // Attach the classification hint cache to all FPs (call before startAll)
+    void setHintCache(HintCache* cache);
+    
+    // Attach the slow-path worker pool to all FPs (call before startAll)
+    void setSlowPath(SlowPathPool* slow_path);
+    
+    // Attach the overload controller to all FPs (call before startAll)
+    void setOverloadController(OverloadController* overload);
+    
+    // Attach the response synthesizer to all FPs (call before startAll)
+    void setResponseSynthesizer(ResponseSynthesizer* responder);
+    
+    // Inspection profile for all FPs (call before startAll)
+    void setProfile(FastPathProfile profile);
+    
+    // Input queue burst size for all FPs (call before startAll)
+    void setBurstSize(size_t burst);
+    
+    // Charge all flow tables to the memory accountant (call before startAll)
+    void setMemoryAccountant(MemoryAccountant* memory);
+    
+    // Embryonic table size per FP and handshake timeout (call before startAll)
+    void setEmbryonicTable(size_t entries, std::chrono::seconds timeout);
+    
+    // Per-app time series bucket length for all FPs (call before startAll)
+    void setTimeSeriesBucket(uint32_t seconds);
+    
+    // Merge every FP's per-app time series (any time, while running too)
+    AppTimeSeriesSnapshot getAppTimeSeries() const;
+    
+    // Sum of hardware counters across all FP threads
+    PerfSample getPerfSample() const;
+    
     // Generate classification report
-    std::string generateClassificationReport() const;
+    // sampler: when flows were sampled, counts are scaled with 95% bounds
+    std::string generateClassificationReport(const FlowSampler* sampler = nullptr) const;
 
 private:
     std::vector<std::unique_ptr<FastPathProcessor>> fps_;
@@ -0,0 +1,172 @@
+#ifndef FLIGHT_RECORDER_H
+#define FLIGHT_RECORDER_H
+
+#include <cstdint>
+#include <atomic>
+#include <string>
+#include <vector>
+#include <memory>
+#include <mutex>
+
+namespace DPI {
+
+// ============================================================================
+// Flight Recorder - Per-thread trace rings for post-mortem pipeline analysis
+// ============================================================================
+//
+// Every pipeline thread attaches one fixed-size ring. Events are 16 bytes:
+//
+//   word 0: timestamp (TSC ticks on x86, steady_clock ns elsewhere)
+//   word 1: type (8 bits) | arg0 (24 bits) | arg1 (32 bits)
+//
+// Each ring has exactly one writer (its thread), so recording is two relaxed
+// stores plus a release store of the head index - a few nanoseconds, no
+// locks, no allocation. The ring silently overwrites the oldest events.
+//
+// The rings are dumped as Chrome trace / Perfetto JSON (chrome://tracing or
+// ui.perfetto.dev) on SIGUSR2 or through DPIEngine::dumpTrace().
+//
+// Threads find their ring through a thread_local pointer, so components deep
+// in the pipeline (e.g. ConnectionTracker) can record without plumbing.
+// Threads that never attached record nothing.
+// ============================================================================
+
+enum class TraceEvent : uint8_t {
+    QUEUE_FULL = 0,   // arg0 = queue index (LB or FP), arg1 = queue depth
+    FLOW_EVICTED,     // arg0 = reason (0 = table full, 1 = timeout, 2 = memory), arg1 = count
+    CLASSIFIED,       // arg0 = AppType, arg1 = packet id
+    RULE_RELOAD,      // arg1 = number of rules after reload
+    STALL,            // arg0 = stage-specific id, arg1 = duration in us
+    OVERLOAD,         // arg0 = new OverloadLevel, arg1 = FP queue occupancy %
+    COUNT             // Keep this last for counting
+};
+
+const char* traceEventToString(TraceEvent type);
+
+// Reasons carried in FLOW_EVICTED arg0
+constexpr uint32_t EVICT_REASON_TABLE_FULL = 0;
+constexpr uint32_t EVICT_REASON_TIMEOUT = 1;
+constexpr uint32_t EVICT_REASON_MEMORY = 2;
+
+// Decoded event (used when dumping)
+struct TraceRecord {
+    uint64_t ticks;
+    TraceEvent type;
+    uint32_t arg0;
+    uint32_t arg1;
+};
+
+// ============================================================================
+// Trace Ring - single-writer ring owned by one thread
+// ============================================================================
+class TraceRing {
+public:
+    // capacity is rounded up to a power of two
+    TraceRing(const std::string& name, size_t capacity, uint64_t stall_ticks);
+
+    const std::string& getName() const { return name_; }
+
+    // Record an event (owning thread only)
+    void record(TraceEvent type, uint32_t arg0, uint32_t arg1, uint64_t ticks) {
+        uint64_t head = head_.load(std::memory_order_relaxed);
+        Slot& slot = slots_[head & mask_];
+        slot.ticks.store(ticks, std::memory_order_relaxed);
+        slot.word.store((static_cast<uint64_t>(type) << 56) |
+                        (static_cast<uint64_t>(arg0 & 0xFFFFFF) << 32) |
+                        arg1,
+                        std::memory_order_relaxed);
+        head_.store(head + 1, std::memory_order_release);
+    }
+
+    uint64_t getStallTicks() const { return stall_ticks_; }
+
+    // Total events ever recorded (including overwritten ones)
+    uint64_t getTotalRecorded() const { return head_.load(std::memory_order_acquire); }
+
+    // Copy the surviving events, oldest first (safe from any thread)
+    std::vector<TraceRecord> snapshot() const;
+
+private:
+    struct Slot {
+        std::atomic<uint64_t> ticks{0};
+        std::atomic<uint64_t> word{0};
+    };
+
+    std::string name_;
+    std::unique_ptr<Slot[]> slots_;
+    uint64_t mask_;
+    uint64_t stall_ticks_;
+    std::atomic<uint64_t> head_{0};
+};
+
+// ============================================================================
+// Flight Recorder - owns all rings and writes the trace file
+// ============================================================================
+class FlightRecorder {
+public:
+    // events_per_thread: ring capacity (0 disables recording entirely)
+    // stall_threshold_us: STALL events are emitted for work longer than this
+    FlightRecorder(size_t events_per_thread = 4096, uint64_t stall_threshold_us = 1000);
+    
+    // Detaches the destroying thread if it still records into one of our rings
+    ~FlightRecorder();
+
+    bool isEnabled() const { return events_per_thread_ > 0; }
+
+    // Create a ring for the calling thread and make it current
+    void attachThread(const std::string& name);
+
+    // Stop recording on the calling thread (ring is kept for dumping)
+    static void detachThread() { current_ = nullptr; }
+
+    // Record on the calling thread's ring (no-op if not attached)
+    static void record(TraceEvent type, uint32_t arg0 = 0, uint32_t arg1 = 0) {
+        if (current_) {
+            current_->record(type, arg0, arg1, now());
+        }
+    }
+
+    // Emit a STALL event if more than the threshold elapsed since start_ticks
+    static void recordIfStall(uint64_t start_ticks, uint32_t arg0) {
+        if (!current_) return;
+        uint64_t end = now();
+        if (end - start_ticks > current_->getStallTicks()) {
+            current_->record(TraceEvent::STALL, arg0,
+                             static_cast<uint32_t>(ticksToNs(end - start_ticks) / 1000),
+                             start_ticks);
+        }
+    }
+
+    // Cheap monotonic timestamp in ticks
+    static uint64_t now();
+
+    // Convert tick deltas to nanoseconds (calibrated at startup)
+    static uint64_t ticksToNs(uint64_t ticks);
+
+    // Write all rings as Chrome trace JSON
+    bool dumpChromeTrace(const std::string& path) const;
+
+    // ========== SIGUSR2 support ==========
+
+    // Install a SIGUSR2 handler that requests a dump
+    static void installSignalHandler();
+
+    // Returns true once per pending dump request
+    static bool consumeDumpRequest();
+
+private:
+    size_t events_per_thread_;
+    uint64_t stall_ticks_;
+
+    mutable std::mutex rings_mutex_;
+    std::vector<std::unique_ptr<TraceRing>> rings_;
+
+    // Trace timestamps are relative to recorder creation
+    uint64_t start_ticks_;
+
+    static inline thread_local TraceRing* current_ = nullptr;
+};
+
+} // namespace DPI
+
+#endif // FLIGHT_RECORDER_H
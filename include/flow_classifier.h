@@ -0,0 +1,133 @@
+#ifndef FLOW_CLASSIFIER_H
+#define FLOW_CLASSIFIER_H
+
+#include "types.h"
+#include <cstdint>
+#include <string>
+#include <vector>
+#include <memory>
+#include <atomic>
+
+namespace DPI {
+
+// ============================================================================
+// Flow Feature Classifier - Statistical classification of encrypted flows
+// ============================================================================
+//
+// Flows without SNI (ECH, VPN tunnels, raw IP) carry nothing to match on,
+// but their first few packets still have a recognisable shape. Each FP keeps
+// a small fixed-size feature record per flow (FlowFeatureState in types.h,
+// part of Connection) and updates it on every payload packet:
+//
+//   - payload size and direction of the first FLOW_FEATURE_PACKETS packets
+//   - inter-arrival time between them (from the capture timestamps)
+//
+// When the flow reaches FLOW_FEATURE_PACKETS payload packets, the feature
+// vector is built once and run through a decision forest. Nothing is
+// evaluated afterwards, so the per-flow cost is bounded.
+//
+// The forest is compiled into one flat array of 12-byte nodes in pre-order:
+// the left child of a split is the next node, the right child is stored as
+// an index. Evaluation is a tight loop over that array per tree.
+//
+// Model file format ('#' starts a comment):
+//
+//   min_confidence 0.6          # votes needed to classify (default 0.5)
+//   tree
+//     split size0 <= 120        # go left when feature <= threshold
+//       leaf WireGuard 1.0      # leaf <App> [weight]
+//       split iat1 <= 5000
+//         leaf Zoom
+//         leaf Unknown
+//   tree
+//     ...
+//
+// Children follow their split in pre-order (left subtree, then right).
+// Indentation is ignored. Feature names are listed in flowFeatureName().
+// ============================================================================
+
+// Feature vector layout (see flowFeatureName())
+enum FlowFeature : uint16_t {
+    FEAT_SIZE0 = 0,                                  // size0..size7: signed payload size
+                                                     //   (negative = server to client)
+    FEAT_IAT1 = FEAT_SIZE0 + FLOW_FEATURE_PACKETS,   // iat1..iat7: microseconds since
+                                                     //   previous payload packet
+    FEAT_OUT_PACKETS = FEAT_IAT1 + FLOW_FEATURE_PACKETS - 1,
+    FEAT_IN_PACKETS,
+    FEAT_OUT_MEAN,
+    FEAT_IN_MEAN,
+    FEAT_MAX_SIZE,
+    FEAT_MIN_SIZE,
+    FEAT_PROTOCOL,
+    FEAT_DST_PORT,
+    FLOW_FEATURE_COUNT                               // Keep this last for counting
+};
+
+// Name used in model files (e.g. "size3", "iat1", "dport")
+std::string flowFeatureName(uint16_t feature);
+
+// Materialize the feature vector of a completed record
+// (out must hold FLOW_FEATURE_COUNT floats)
+void extractFlowFeatures(const FlowFeatureState& state, const FiveTuple& tuple, float* out);
+
+// ============================================================================
+// Compiled decision forest (immutable, shared by all FPs)
+// ============================================================================
+struct FlowModelNode {
+    float value;        // Split threshold, or vote weight for leaves
+    int16_t feature;    // Feature index, -1 = leaf
+    uint16_t app;       // Leaf: AppType voted for
+    uint32_t right;     // Split: index of the right child
+};
+
+class FlowModel {
+public:
+    // Parse a model; returns nullptr (with error set) on failure
+    static std::shared_ptr<const FlowModel> parse(const std::string& text, std::string& error);
+
+    // Evaluate all trees; returns UNKNOWN unless the winning app reaches
+    // min_confidence of the total vote weight
+    AppType predict(const float* features, float* confidence = nullptr) const;
+
+    size_t numTrees() const { return roots_.size(); }
+    size_t numNodes() const { return nodes_.size(); }
+    size_t maxDepth() const { return max_depth_; }
+    float minConfidence() const { return min_confidence_; }
+    size_t memoryBytes() const;
+
+private:
+    FlowModel() = default;
+
+    std::vector<FlowModelNode> nodes_;
+    std::vector<uint32_t> roots_;
+    float min_confidence_ = 0.5f;
+    size_t max_depth_ = 0;
+};
+
+// ============================================================================
+// Flow Classifier - runtime-reloadable holder of the current model
+// ============================================================================
+class FlowClassifier {
+public:
+    FlowClassifier() = default;
+
+    // Replace the current model (FPs pick it up on their next evaluation)
+    bool loadFromFile(const std::string& filename);
+    bool loadFromString(const std::string& text, const std::string& source);
+
+    // Current model (null until one is loaded)
+    std::shared_ptr<const FlowModel> get() const;
+
+    bool hasModel() const { return get() != nullptr; }
+
+    // Bumped on every successful load (readers cache get() until it changes)
+    uint64_t version() const { return version_.load(std::memory_order_acquire); }
+
+private:
+    std::shared_ptr<const FlowModel> model_;
+    std::atomic<uint64_t> version_{0};
+};
+
+} // namespace DPI
+
+#endif // FLOW_CLASSIFIER_H
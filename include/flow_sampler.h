@@ -0,0 +1,74 @@
+#ifndef FLOW_SAMPLER_H
+#define FLOW_SAMPLER_H
+
+#include "types.h"
+#include <cstdint>
+#include <atomic>
+
+namespace DPI {
+
+// ============================================================================
+// Flow Sampler - deterministic 1-in-N flow selection for analytics links
+// ============================================================================
+//
+// When only the application mix is needed, inspecting every flow is wasted
+// work. The LB ingress stage keeps a flow when its direction-independent
+// tuple hash falls in 1 of N buckets, so every packet of a kept flow (both
+// directions) is inspected and every packet of the others skips the FPs:
+//
+//   LB: L2-L4 parse -> hash -> sampled?  yes -> FP (full DPI)
+//                                        no  -> output, uninspected
+//
+// Unsampled flows are never classified, so rules cannot block them; use
+// sampling on analytics-only deployments.
+//
+// Estimates: with k sampled flows of an application, the population is
+// estimated as N*k. Flow selection behaves like independent Bernoulli(1/N)
+// trials, so Var(N*k) ~= N*(N-1)*k and the 95% bound is 1.96*sqrt(N*(N-1)*k).
+// Packet and byte totals are counted exactly by the ingress stage.
+// ============================================================================
+class FlowSampler {
+public:
+    // rate: keep 1 in `rate` flows (1 = keep everything)
+    explicit FlowSampler(uint32_t rate = 1) : rate_(rate < 1 ? 1 : rate) {}
+
+    bool isEnabled() const { return rate_ > 1; }
+    uint32_t getRate() const { return rate_; }
+
+    // Keep this flow? (hash = SymmetricTupleHash of either direction)
+    bool isSampled(size_t flow_hash) const {
+        if (rate_ <= 1) return true;
+
+        // Remix so the choice is independent of LB/FP selection (hash % n)
+        uint64_t h = flow_hash;
+        h ^= h >> 33;
+        h *= 0xc4ceb9fe1a85ec53ull;
+        h ^= h >> 33;
+        return h % rate_ == 0;
+    }
+
+    // LB threads (ingress stage): a packet of an unsampled flow went past the FPs
+    void recordSkipped(size_t bytes) {
+        skipped_packets_.fetch_add(1, std::memory_order_relaxed);
+        skipped_bytes_.fetch_add(bytes, std::memory_order_relaxed);
+    }
+
+    uint64_t getSkippedPackets() const { return skipped_packets_.load(); }
+    uint64_t getSkippedBytes() const { return skipped_bytes_.load(); }
+
+    // Population estimate for a count of sampled flows, with 95% bound
+    struct Estimate {
+        double value;
+        double error;
+    };
+    Estimate estimateFlows(uint64_t sampled_flows) const;
+
+private:
+    uint32_t rate_;
+    std::atomic<uint64_t> skipped_packets_{0};
+    std::atomic<uint64_t> skipped_bytes_{0};
+};
+
+} // namespace DPI
+
+#endif // FLOW_SAMPLER_H
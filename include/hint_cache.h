@@ -0,0 +1,235 @@
+#ifndef HINT_CACHE_H
+#define HINT_CACHE_H
+
+#include "types.h"
+#include "lock_profiler.h"
+#include <cstdint>
+#include <string>
+#include <vector>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <atomic>
+#include <condition_variable>
+#include <chrono>
+#include <unordered_map>
+
+namespace DPI {
+
+// ============================================================================
+// Classification Hint Cache - what runs on a server endpoint, shared by FPs
+// ============================================================================
+//
+// Thousands of flows go to the same dst_ip:443 and each FP used to classify
+// every one of them from scratch. The hint cache remembers, per server
+// endpoint (dst_ip, dst_port), the application and SNI last seen there:
+//
+//   FP classifies a flow --> publish() into the FP's own write buffer
+//                                   |
+//                      merger thread (every merge_interval_ms)
+//                                   v
+//   master map (merger only) --> immutable snapshot (open addressing)
+//                                   |
+//   FP sees a new flow  <--  HintReader::lookup() (no locks)
+//
+// Readers never lock: each FP holds the current snapshot and only swaps it
+// when the cache version changes. Writers only touch their own buffer, so
+// the buffer lock is uncontended except when the merger swaps it out.
+//
+// Confidence counts agreeing observations. A conflicting app halves it
+// (and replaces the entry when it reaches 0). A different SNI for the same
+// app keeps the app but drops the name, so shared endpoints (CDNs) never
+// give domain hints. Hints below HINT_MIN_CONFIDENCE are not applied.
+//
+// Hints age: every HINT_DECAY_INTERVAL all confidences are halved and
+// entries reaching 0 are forgotten. Endpoints still seen keep being
+// re-published (confidence is below the maximum again); an endpoint that
+// changed hands stops being hinted after a few intervals even if no flow
+// contradicts it.
+//
+// A hint only pre-classifies a flow; it never blocks one (see checkRules).
+// ============================================================================
+
+// Observations needed before a hint is applied to new flows
+constexpr uint8_t HINT_MIN_CONFIDENCE = 2;
+
+// Confidence stops growing here (FPs stop re-publishing agreeing results)
+constexpr uint8_t HINT_MAX_CONFIDENCE = 16;
+
+// Pending updates per FP between merges (extra updates are dropped)
+constexpr size_t HINT_WRITE_BUFFER_SIZE = 4096;
+
+// Confidence of every entry halves this often
+constexpr std::chrono::seconds HINT_DECAY_INTERVAL{30};
+
+struct EndpointHint {
+    AppType app = AppType::UNKNOWN;
+    uint8_t confidence = 0;
+    uint32_t sni_id = 0;            // 0 = no SNI, see HintSnapshot::name()
+};
+
+// ============================================================================
+// Immutable snapshot published by the merger
+// ============================================================================
+class HintSnapshot {
+public:
+    // Build from the master map (merger thread only)
+    struct Source {
+        AppType app;
+        uint8_t confidence;
+        std::string sni;
+    };
+    explicit HintSnapshot(const std::unordered_map<uint64_t, Source>& master);
+    HintSnapshot() : HintSnapshot(std::unordered_map<uint64_t, Source>()) {}
+
+    // Lookup by server endpoint; nullptr if unknown
+    const EndpointHint* lookup(uint32_t ip, uint16_t port) const {
+        uint64_t key = makeKey(ip, port);
+        for (size_t i = hash(key) & mask_;; i = (i + 1) & mask_) {
+            const Slot& slot = slots_[i];
+            if (slot.key == key) return &slot.hint;
+            if (slot.key == 0) return nullptr;
+        }
+    }
+
+    // SNI for a hint's sni_id
+    const std::string& name(uint32_t sni_id) const { return names_[sni_id]; }
+
+    size_t size() const { return size_; }
+    size_t memoryBytes() const;
+
+    // Key with a marker bit, so 0 can mean "empty slot"
+    static uint64_t makeKey(uint32_t ip, uint16_t port) {
+        return (1ull << 48) | (static_cast<uint64_t>(ip) << 16) | port;
+    }
+
+private:
+    struct Slot {
+        uint64_t key = 0;
+        EndpointHint hint;
+    };
+
+    static size_t hash(uint64_t key) {
+        key ^= key >> 33;
+        key *= 0xff51afd7ed558ccdull;
+        key ^= key >> 33;
+        return static_cast<size_t>(key);
+    }
+
+    std::vector<Slot> slots_;       // Power-of-two size, at most half full
+    size_t mask_ = 0;
+    size_t size_ = 0;
+    std::vector<std::string> names_;  // names_[0] is the empty name
+};
+
+// ============================================================================
+// Hint Cache - per-FP write buffers, merger thread, published snapshot
+// ============================================================================
+class HintCache {
+public:
+    // num_writers: one write buffer per FP
+    // capacity: maximum endpoints remembered
+    HintCache(int num_writers, size_t capacity = 65536, uint32_t merge_interval_ms = 100);
+    ~HintCache();
+
+    // Start/stop the merger thread
+    void start();
+    void stop();
+
+    // Record a classification result (writer_id = FP id)
+    void publish(int writer_id, uint32_t ip, uint16_t port,
+                 AppType app, std::string_view sni);
+
+    // Fold all write buffers into the master map and publish a new snapshot
+    // (called by the merger thread; safe to call directly)
+    void merge();
+
+    // Current snapshot (never null) and its version
+    std::shared_ptr<const HintSnapshot> snapshot() const;
+    uint64_t version() const { return version_.load(std::memory_order_acquire); }
+
+    struct Stats {
+        uint64_t entries;
+        uint64_t updates;
+        uint64_t dropped_updates;
+        uint64_t merges;
+        uint64_t expired;               // Forgotten by decay
+        size_t snapshot_bytes;
+    };
+    Stats getStats() const;
+
+private:
+    struct Update {
+        uint64_t key;
+        AppType app;
+        FlowName sni;   // Inline: publishing never allocates
+    };
+
+    // One per FP, on its own cache line
+    struct alignas(64) WriteBuffer {
+        ProfiledMutex mutex{"HintCache::write"};
+        std::vector<Update> pending;
+    };
+
+    std::vector<std::unique_ptr<WriteBuffer>> buffers_;
+    size_t capacity_;
+    uint32_t merge_interval_ms_;
+
+    // Merger-owned state
+    ProfiledMutex merge_mutex_{"HintCache::merge"};
+    std::vector<Update> merge_batch_;   // Swapped with each writer's pending
+    std::unordered_map<uint64_t, HintSnapshot::Source> master_;
+    std::chrono::steady_clock::time_point next_decay_;
+
+    std::shared_ptr<const HintSnapshot> snapshot_;
+    std::atomic<uint64_t> version_{0};
+
+    std::atomic<uint64_t> updates_{0};
+    std::atomic<uint64_t> dropped_updates_{0};
+    std::atomic<uint64_t> merges_{0};
+    std::atomic<uint64_t> expired_{0};
+
+    // Merger thread
+    std::thread thread_;
+    std::mutex wake_mutex_;
+    std::condition_variable wake_cv_;
+    bool stopping_ = false;
+    bool running_ = false;
+
+    void run();
+    void apply(const Update& update);
+    
+    // Halve every confidence and drop the entries that reach 0 (true if
+    // there were entries)
+    bool decay();
+};
+
+// ============================================================================
+// Hint Reader - per-FP view that refreshes its snapshot on version change
+// ============================================================================
+class HintReader {
+public:
+    explicit HintReader(const HintCache* cache) : cache_(cache) {}
+
+    const EndpointHint* lookup(uint32_t ip, uint16_t port) {
+        if (!cache_) return nullptr;
+        uint64_t version = cache_->version();
+        if (version != version_ || !snapshot_) {
+            snapshot_ = cache_->snapshot();
+            version_ = version;
+        }
+        return snapshot_->lookup(ip, port);
+    }
+
+    // Name for a hint returned by the last lookup()
+    const std::string& name(uint32_t sni_id) const { return snapshot_->name(sni_id); }
+
+private:
+    const HintCache* cache_;
+    std::shared_ptr<const HintSnapshot> snapshot_;
+    uint64_t version_ = 0;
+};
+
+} // namespace DPI
+
+#endif // HINT_CACHE_H
@@ -0,0 +1,81 @@
+#ifndef LATENCY_HISTOGRAM_H
+#define LATENCY_HISTOGRAM_H
+
+#include <atomic>
+#include <cstdint>
+
+namespace DPI {
+
+// ============================================================================
+// Latency Histogram - power-of-two buckets, safe to update from any thread
+// ============================================================================
+//
+// Bucket i counts samples in [2^i, 2^(i+1)) ns (bucket 0 also takes 0).
+// Percentiles are reported as the upper bound of the bucket they fall in,
+// so they are accurate to within a factor of two - plenty for spotting a
+// p99 that is 100x the median.
+// ============================================================================
+class LatencyHistogram {
+public:
+    static constexpr int BUCKETS = 48;  // Up to ~3 days in ns
+
+    void record(uint64_t ns) {
+        int bucket = ns == 0 ? 0 : 63 - __builtin_clzll(ns);
+        if (bucket >= BUCKETS) bucket = BUCKETS - 1;
+        buckets_[bucket].fetch_add(1, std::memory_order_relaxed);
+        count_.fetch_add(1, std::memory_order_relaxed);
+        sum_ns_.fetch_add(ns, std::memory_order_relaxed);
+
+        uint64_t max = max_ns_.load(std::memory_order_relaxed);
+        while (ns > max && !max_ns_.compare_exchange_weak(max, ns, std::memory_order_relaxed)) {
+        }
+    }
+
+    // Fold another histogram's samples into this one
+    void merge(const LatencyHistogram& other) {
+        for (int i = 0; i < BUCKETS; i++) {
+            buckets_[i].fetch_add(other.buckets_[i].load(std::memory_order_relaxed),
+                                  std::memory_order_relaxed);
+        }
+        count_.fetch_add(other.count(), std::memory_order_relaxed);
+        sum_ns_.fetch_add(other.sumNs(), std::memory_order_relaxed);
+
+        uint64_t ns = other.maxNs();
+        uint64_t max = max_ns_.load(std::memory_order_relaxed);
+        while (ns > max && !max_ns_.compare_exchange_weak(max, ns, std::memory_order_relaxed)) {
+        }
+    }
+
+    uint64_t count() const { return count_.load(std::memory_order_relaxed); }
+    uint64_t sumNs() const { return sum_ns_.load(std::memory_order_relaxed); }
+    uint64_t maxNs() const { return max_ns_.load(std::memory_order_relaxed); }
+
+    uint64_t meanNs() const {
+        uint64_t n = count();
+        return n ? sum_ns_.load(std::memory_order_relaxed) / n : 0;
+    }
+
+    // Upper bound of the bucket holding the given percentile (0-100)
+    uint64_t percentileNs(double pct) const {
+        uint64_t n = count();
+        if (n == 0) return 0;
+
+        uint64_t target = static_cast<uint64_t>(n * pct / 100.0);
+        uint64_t seen = 0;
+        for (int i = 0; i < BUCKETS; i++) {
+            seen += buckets_[i].load(std::memory_order_relaxed);
+            if (seen > target) return 2ull << i;
+        }
+        return maxNs();
+    }
+
+private:
+    std::atomic<uint64_t> buckets_[BUCKETS] = {};
+    std::atomic<uint64_t> count_{0};
+    std::atomic<uint64_t> sum_ns_{0};
+    std::atomic<uint64_t> max_ns_{0};
+};
+
+} // namespace DPI
+
+#endif // LATENCY_HISTOGRAM_H
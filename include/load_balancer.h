@@ -3,6 +3,10 @@
 
 #include "types.h"
 #include "thread_safe_queue.h"
+#include "perf_counters.h"
+#include "alloc_tracker.h"
+#include "flight_recorder.h"
+#include "overload_controller.h"
 #include <thread>
 #include <vector>
 #include <atomic>
@@ -18,15 +22,25 @@ namespace DPI {
 //   Reader Thread -> LB Queues -> LB Threads -> FP Queues -> FP Threads
 //
 // Each LB thread:
-// 1. Receives packets from its input queue (fed by reader)
-// 2. Extracts five-tuple from packet
+// 1. Receives framed packets from its input queue (fed by reader)
+// 2. Parses L2-L4 and extracts the five-tuple (ingress callback)
 // 3. Hashes the tuple to determine target FP
 // 4. Forwards packet to appropriate FP queue
 //
+// The reader does no parsing: it steers each frame by its IPv4 address
+// pair alone (fixed offsets, order-independent), so every packet of a flow,
+// both directions, reaches the same LB in capture order and the LB's
+// five-tuple hash then picks the same FP for all of them.
+//
 // Load Balancing Strategy:
 // - Consistent hashing ensures same flow always goes to same FP
+// - The hash is direction-independent, so both directions meet on one FP
 // - This is critical for proper connection tracking and DPI
 //
+// Under overload (see overload_controller.h) packets of unsampled flows, or
+// packets whose FP queue is full, are handed to the overload policy instead
+// of blocking the LB.
+//
 // Example with 2 LBs and 4 FPs:
 //   LB0 handles FP0, FP1 (hash % 2 == 0 or 1)
 //   LB1 handles FP2, FP3 (hash % 2 == 0 or 1, but offset by 2)
@@ -39,9 +53,11 @@ public:
     // lb_id: ID of this load balancer (0, 1, ...)
     // fp_queues: Pointers to FP input queues that this LB serves
     // fp_start_id: Starting FP ID for this LB's pool
+    // queue_size: Capacity of the input queue (packets)
     LoadBalancer(int lb_id, 
                  std::vector<ThreadSafeQueue<PacketJob>*> fp_queues,
-                 int fp_start_id);
+                 int fp_start_id,
+                 size_t queue_size = 10000);
     
     ~LoadBalancer();
     
@@ -58,11 +74,32 @@ public:
     struct LBStats {
         uint64_t packets_received;
         uint64_t packets_dispatched;
+        uint64_t packets_bypassed;             // Handled by the overload policy
+        uint64_t packets_not_ingested;         // Kept by the ingress stage (not TCP/UDP, unsampled)
         std::vector<uint64_t> per_fp_packets;  // Packets sent to each FP
     };
     
     LBStats getStats() const;
     
+    // Enable hardware counters (call before start)
+    void enablePerfCounters(bool enable) { perf_enabled_ = enable; }
+    
+    // Attach a flight recorder (call before start)
+    void setFlightRecorder(FlightRecorder* recorder) { recorder_ = recorder; }
+    
+    // Attach the overload controller (call before start)
+    void setOverloadController(OverloadController* overload) { overload_ = overload; }
+    
+    // Packets taken from the input queue per lock (call before start)
+    void setBurstSize(size_t burst) { burst_size_ = burst > 0 ? burst : 1; }
+    
+    // Parse stage run on each packet before dispatch (call before start;
+    // none = packets arrive parsed)
+    void setIngressCallback(PacketIngressCallback callback) { ingress_ = std::move(callback); }
+    
+    // Get hardware counter sample for this LB thread
+    PerfSample getPerfSample() const { return perf_.snapshot(); }
+    
     // Get LB ID
     int getId() const { return lb_id_; }
     
@@ -74,8 +111,10 @@ private:
     int fp_start_id_;
     int num_fps_;
     
-    // Input queue from reader
+    // Input queue from reader, drained burst_size_ packets at a time
     ThreadSafeQueue<PacketJob> input_queue_;
+    size_t burst_size_ = 1;
+    std::vector<PacketJob> burst_;
     
     // Output queues to FP threads
     std::vector<ThreadSafeQueue<PacketJob>*> fp_queues_;
@@ -83,8 +122,23 @@ private:
     // Statistics
     std::atomic<uint64_t> packets_received_{0};
     std::atomic<uint64_t> packets_dispatched_{0};
+    std::atomic<uint64_t> packets_bypassed_{0};
+    std::atomic<uint64_t> packets_not_ingested_{0};
     std::vector<uint64_t> per_fp_counts_;  // Not shared, so no atomics needed
     
+    // Hardware counters (opened by the LB thread itself)
+    bool perf_enabled_ = false;
+    PerfCounterGroup perf_;
+    
+    // Flight recorder (shared, each thread attaches its own ring)
+    FlightRecorder* recorder_ = nullptr;
+    
+    // Admission under overload (null = always push to the FP)
+    OverloadController* overload_ = nullptr;
+    
+    // Parse stage (see setIngressCallback)
+    PacketIngressCallback ingress_;
+    
     // Thread control
     std::atomic<bool> running_{false};
     std::thread thread_;
@@ -92,8 +146,8 @@ private:
     // Main processing loop
     void run();
     
-    // Determine target FP for a packet based on five-tuple hash
-    int selectFP(const FiveTuple& tuple);
+    // Determine target FP for a packet from its symmetric five-tuple hash
+    int selectFP(size_t flow_hash);
 };
 
 // ============================================================================
@@ -105,8 +159,10 @@ public:
     // num_lbs: Number of load balancer threads
     // fps_per_lb: Number of FP threads per LB
     // fp_queues: Raw pointers to FP input queues
+    // queue_size: Capacity of each LB input queue (packets)
     LBManager(int num_lbs, int fps_per_lb,
-              std::vector<ThreadSafeQueue<PacketJob>*> fp_queues);
+              std::vector<ThreadSafeQueue<PacketJob>*> fp_queues,
+              size_t queue_size = 10000);
     
     ~LBManager();
     
@@ -119,6 +175,9 @@ public:
     // Get LB for a given packet (based on hash)
     LoadBalancer& getLBForPacket(const FiveTuple& tuple);
     
+    // Get LB for an unparsed frame (IPv4 address pair; anything else -> LB0)
+    LoadBalancer& getLBForFrame(const uint8_t* data, size_t len);
+    
     // Get specific LB
     LoadBalancer& getLB(int id) { return *lbs_[id]; }
     
@@ -129,9 +188,29 @@ public:
     struct AggregatedStats {
         uint64_t total_received;
         uint64_t total_dispatched;
+        uint64_t total_bypassed;
+        uint64_t total_not_ingested;
     };
     
     AggregatedStats getAggregatedStats() const;
+    
+    // Enable hardware counters on all LBs (call before startAll)
+    void enablePerfCounters(bool enable);
+    
+    // Attach a flight recorder to all LBs (call before startAll)
+    void setFlightRecorder(FlightRecorder* recorder);
+    
+    // Attach the overload controller to all LBs (call before startAll)
+    void setOverloadController(OverloadController* overload);
+    
+    // Input queue burst size for all LBs (call before startAll)
+    void setBurstSize(size_t burst);
+    
+    // Parse stage for all LBs (call before startAll)
+    void setIngressCallback(const PacketIngressCallback& callback);
+    
+    // Sum of hardware counters across all LB threads
+    PerfSample getPerfSample() const;
 
 private:
     std::vector<std::unique_ptr<LoadBalancer>> lbs_;
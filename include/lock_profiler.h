@@ -0,0 +1,316 @@
+#ifndef LOCK_PROFILER_H
+#define LOCK_PROFILER_H
+
+#include <mutex>
+#include <shared_mutex>
+#include <condition_variable>
+#include <cstdint>
+#include <cstddef>
+#include <ostream>
+
+#ifdef DPI_LOCK_PROFILE
+#include "latency_histogram.h"
+#include <atomic>
+#include <chrono>
+#include <csignal>
+#include <cstring>
+#include <iomanip>
+#include <memory>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <algorithm>
+#endif
+
+namespace DPI {
+
+// ============================================================================
+// Lock Profiler - which locks are contended, and for how long
+// ============================================================================
+//
+// Build with -DDPI_LOCK_PROFILE and every ProfiledMutex / ProfiledSharedMutex
+// counts, under the name it was constructed with:
+//
+//   acquired    lock(), lock_shared() and successful try_lock()s
+//   contended   acquisitions that found the lock held and had to wait
+//   wait        histogram of those waits (power-of-two ns buckets)
+//
+// An uncontended acquisition is a try_lock plus one relaxed increment; only
+// a caller that actually has to wait reads the clock. Instances sharing a
+// name (one input queue per FP) are merged in the report, which ranks locks
+// by total wait time. It is printed at shutdown and on SIGUSR1.
+//
+// In normal builds ProfiledMutex is a std::mutex with a constructor that
+// drops the name, so the wrapper costs nothing. Code waiting on a condition
+// variable uses Mutex::Lock and Mutex::Condition, which are unique_lock<
+// std::mutex> / std::condition_variable normally and the _any variants
+// (waiting through the profiled lock()) when profiling.
+//
+// Header-only: dpi_mt builds from a fixed source list (see README).
+// ============================================================================
+
+#ifdef DPI_LOCK_PROFILE
+
+// Lock instances tracked separately; later ones share one "(other)" entry
+constexpr size_t LOCK_PROFILE_MAX_LOCKS = 512;
+
+// Counters of one lock instance
+struct LockSite {
+    std::atomic<const char*> name{nullptr};
+    std::atomic<uint64_t> acquired{0};
+    std::atomic<uint64_t> contended{0};
+    LatencyHistogram wait;
+
+    void uncontended() { acquired.fetch_add(1, std::memory_order_relaxed); }
+
+    void waited(std::chrono::steady_clock::time_point start) {
+        auto ns = std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::steady_clock::now() - start).count();
+        acquired.fetch_add(1, std::memory_order_relaxed);
+        contended.fetch_add(1, std::memory_order_relaxed);
+        wait.record(static_cast<uint64_t>(ns));
+    }
+};
+
+#endif // DPI_LOCK_PROFILE
+
+class LockProfiler {
+public:
+    // Built with -DDPI_LOCK_PROFILE
+    static constexpr bool isCompiledIn() {
+#ifdef DPI_LOCK_PROFILE
+        return true;
+#else
+        return false;
+#endif
+    }
+
+#ifdef DPI_LOCK_PROFILE
+    // Counter block for a new lock instance (never released)
+    static LockSite* registerLock(const char* name) {
+        size_t index = num_sites_.fetch_add(1, std::memory_order_relaxed);
+        if (index >= LOCK_PROFILE_MAX_LOCKS) return &overflow_;
+
+        sites_[index].name.store(name, std::memory_order_release);
+        return &sites_[index];
+    }
+
+    // Worst `top` locks by total wait time
+    static void report(std::ostream& out, size_t top = 10);
+
+    // SIGUSR1 asks for a report; the output thread prints it
+    static void installSignalHandler() {
+#ifdef SIGUSR1
+        std::signal(SIGUSR1, [](int) { report_requested_.store(true, std::memory_order_relaxed); });
+#endif
+    }
+
+    static bool consumeReportRequest() {
+        return report_requested_.exchange(false, std::memory_order_relaxed);
+    }
+
+private:
+    static inline LockSite sites_[LOCK_PROFILE_MAX_LOCKS];
+    static inline LockSite overflow_;
+    static inline std::atomic<size_t> num_sites_{0};
+    static inline std::atomic<bool> report_requested_{false};
+#else
+    static void report(std::ostream& out, size_t = 10) {
+        out << "[LockProfile] Not compiled in (rebuild with -DDPI_LOCK_PROFILE)\n";
+    }
+    static void installSignalHandler() {}
+    static bool consumeReportRequest() { return false; }
+#endif
+};
+
+#ifdef DPI_LOCK_PROFILE
+
+// ============================================================================
+// Profiled Mutex / Shared Mutex - std::mutex / std::shared_mutex drop-ins
+// ============================================================================
+class ProfiledMutex {
+public:
+    using Lock = std::unique_lock<ProfiledMutex>;
+    using Condition = std::condition_variable_any;
+
+    explicit ProfiledMutex(const char* name) : site_(LockProfiler::registerLock(name)) {}
+    ProfiledMutex(const ProfiledMutex&) = delete;
+    ProfiledMutex& operator=(const ProfiledMutex&) = delete;
+
+    void lock() {
+        if (mutex_.try_lock()) {
+            site_->uncontended();
+            return;
+        }
+        auto start = std::chrono::steady_clock::now();
+        mutex_.lock();
+        site_->waited(start);
+    }
+
+    bool try_lock() {
+        if (!mutex_.try_lock()) return false;
+        site_->uncontended();
+        return true;
+    }
+
+    void unlock() { mutex_.unlock(); }
+
+private:
+    std::mutex mutex_;
+    LockSite* site_;
+};
+
+class ProfiledSharedMutex {
+public:
+    explicit ProfiledSharedMutex(const char* name) : site_(LockProfiler::registerLock(name)) {}
+    ProfiledSharedMutex(const ProfiledSharedMutex&) = delete;
+    ProfiledSharedMutex& operator=(const ProfiledSharedMutex&) = delete;
+
+    void lock() {
+        if (mutex_.try_lock()) {
+            site_->uncontended();
+            return;
+        }
+        auto start = std::chrono::steady_clock::now();
+        mutex_.lock();
+        site_->waited(start);
+    }
+
+    bool try_lock() {
+        if (!mutex_.try_lock()) return false;
+        site_->uncontended();
+        return true;
+    }
+
+    void unlock() { mutex_.unlock(); }
+
+    void lock_shared() {
+        if (mutex_.try_lock_shared()) {
+            site_->uncontended();
+            return;
+        }
+        auto start = std::chrono::steady_clock::now();
+        mutex_.lock_shared();
+        site_->waited(start);
+    }
+
+    bool try_lock_shared() {
+        if (!mutex_.try_lock_shared()) return false;
+        site_->uncontended();
+        return true;
+    }
+
+    void unlock_shared() { mutex_.unlock_shared(); }
+
+private:
+    std::shared_mutex mutex_;
+    LockSite* site_;
+};
+
+inline void LockProfiler::report(std::ostream& out, size_t top) {
+    struct Entry {
+        std::string name;
+        size_t instances = 0;
+        uint64_t acquired = 0;
+        uint64_t contended = 0;
+        LatencyHistogram wait;
+    };
+
+    // Merge instances by name
+    std::vector<std::unique_ptr<Entry>> entries;
+    auto add = [&](const LockSite& site, const char* name) {
+        auto it = std::find_if(entries.begin(), entries.end(),
+                               [&](const auto& e) { return e->name == name; });
+        if (it == entries.end()) {
+            entries.push_back(std::make_unique<Entry>());
+            entries.back()->name = name;
+            it = entries.end() - 1;
+        }
+        Entry& entry = **it;
+        entry.instances++;
+        entry.acquired += site.acquired.load(std::memory_order_relaxed);
+        entry.contended += site.contended.load(std::memory_order_relaxed);
+        entry.wait.merge(site.wait);
+    };
+
+    size_t num_sites = std::min(num_sites_.load(), LOCK_PROFILE_MAX_LOCKS);
+    for (size_t i = 0; i < num_sites; i++) {
+        const char* name = sites_[i].name.load(std::memory_order_acquire);
+        add(sites_[i], name ? name : "(unnamed)");
+    }
+    if (overflow_.acquired.load() > 0) add(overflow_, "(other)");
+
+    std::sort(entries.begin(), entries.end(), [](const auto& a, const auto& b) {
+        if (a->wait.sumNs() != b->wait.sumNs()) return a->wait.sumNs() > b->wait.sumNs();
+        return a->acquired > b->acquired;
+    });
+
+    uint64_t total_acquired = 0, total_contended = 0;
+    for (const auto& e : entries) {
+        total_acquired += e->acquired;
+        total_contended += e->contended;
+    }
+
+    auto row = [&](const std::string& text) {
+        out << "║ " << std::left << std::setw(62) << text << std::right << "║\n";
+    };
+
+    out << "\n╔══════════════════════════════════════════════════════════════╗\n";
+    out << "║                    LOCK CONTENTION                            ║\n";
+    out << "╠══════════════════════════════════════════════════════════════╣\n";
+    {
+        std::ostringstream header;
+        header << std::left << std::setw(20) << "Lock" << std::right << std::setw(10) << "Acquired"
+               << std::setw(8) << "Waited" << std::setw(8) << "p99 us"
+               << std::setw(8) << "max us" << std::setw(8) << "wait ms";
+        row(header.str());
+    }
+
+    for (size_t i = 0; i < entries.size() && i < top; i++) {
+        const Entry& e = *entries[i];
+        std::string name = e.instances > 1 ? e.name + " x" + std::to_string(e.instances) : e.name;
+        if (name.size() > 19) name = name.substr(0, 18) + "~";
+
+        // Percentiles are bucket upper bounds; never report one above the max
+        uint64_t p99 = std::min(e.wait.percentileNs(99), e.wait.maxNs());
+
+        std::ostringstream line;
+        line << std::left << std::setw(20) << name << std::right << std::setw(10) << e.acquired
+             << std::setw(8) << e.contended << std::fixed << std::setprecision(1)
+             << std::setw(8) << p99 / 1000.0
+             << std::setw(8) << e.wait.maxNs() / 1000.0
+             << std::setw(8) << e.wait.sumNs() / 1e6;
+        row(line.str());
+    }
+
+    out << "╠══════════════════════════════════════════════════════════════╣\n";
+    {
+        std::ostringstream summary;
+        summary << entries.size() << " locks, " << total_acquired << " acquisitions, "
+                << std::fixed << std::setprecision(2)
+                << (total_acquired ? 100.0 * total_contended / total_acquired : 0.0) << "% contended";
+        row(summary.str());
+    }
+    out << "╚══════════════════════════════════════════════════════════════╝\n";
+}
+
+#else
+
+class ProfiledMutex : public std::mutex {
+public:
+    using Lock = std::unique_lock<std::mutex>;
+    using Condition = std::condition_variable;
+
+    explicit constexpr ProfiledMutex(const char*) noexcept {}
+};
+
+class ProfiledSharedMutex : public std::shared_mutex {
+public:
+    explicit ProfiledSharedMutex(const char*) {}
+};
+
+#endif // DPI_LOCK_PROFILE
+
+} // namespace DPI
+
+#endif // LOCK_PROFILER_H
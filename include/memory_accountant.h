@@ -0,0 +1,130 @@
+#ifndef MEMORY_ACCOUNTANT_H
+#define MEMORY_ACCOUNTANT_H
+
+#include <cstdint>
+#include <cstddef>
+#include <string>
+#include <vector>
+#include <functional>
+#include <atomic>
+#include <chrono>
+
+namespace DPI {
+
+// ============================================================================
+// Memory Accountant - per-component byte usage, budgets and pressure
+// ============================================================================
+//
+// Table sizes were counted in entries and queue sizes in items, so a burst
+// of new flows or a backlog of large packets grew the process until the
+// OOM killer stepped in. The accountant gives each component a byte figure
+// and (optionally) a budget:
+//
+//   FLOW_TABLES    charged by the connection trackers as flows come and go
+//   PACKET_QUEUES  measured from the queues (each is byte-capped instead)
+//   RULE_SETS      measured from the rule manager
+//   HINT_CACHE     measured from the current hint snapshot
+//
+// Measured components are sampled every MEMORY_SAMPLE_INTERVAL by the
+// output thread (sampleProbes), so their peaks reflect the run and not
+// just the moment of the report.
+//
+// Charged components have a pressure level derived from their budget:
+//
+//   NORMAL    below MEMORY_ELEVATED_PCT
+//   ELEVATED  tracker evicts idle flows early (one sweep per transition)
+//   CRITICAL  at or over budget: tracker evicts its least recent flows
+//
+// Pressure callbacks run on the thread whose charge crossed a threshold,
+// so they only set flags; the owner of the data does the eviction.
+// ============================================================================
+
+enum class MemoryComponent : uint8_t {
+    FLOW_TABLES = 0,
+    PACKET_QUEUES,
+    RULE_SETS,
+    HINT_CACHE,
+    COMPONENT_COUNT      // Keep this last for counting
+};
+
+enum class MemoryPressure : uint8_t {
+    NORMAL = 0,
+    ELEVATED,
+    CRITICAL
+};
+
+const char* memoryComponentToString(MemoryComponent component);
+const char* memoryPressureToString(MemoryPressure pressure);
+
+// Usage (% of budget) at which a component becomes ELEVATED
+constexpr uint32_t MEMORY_ELEVATED_PCT = 80;
+
+// A level is left only once usage is this far (% of budget) below its threshold
+constexpr uint32_t MEMORY_HYSTERESIS_PCT = 5;
+
+// How often measured components are sampled for their peaks
+constexpr std::chrono::milliseconds MEMORY_SAMPLE_INTERVAL{10};
+
+using PressureCallback = std::function<void(MemoryPressure)>;
+
+class MemoryAccountant {
+public:
+    MemoryAccountant() = default;
+
+    // Byte budget for a component (0 = unlimited; call before start)
+    void setBudget(MemoryComponent component, size_t bytes);
+    size_t getBudget(MemoryComponent component) const { return slot(component).budget; }
+
+    // Called when the component's pressure level changes (call before start)
+    void addPressureCallback(MemoryComponent component, PressureCallback callback);
+
+    // Usage is read on demand instead of charged (call before start)
+    void setProbe(MemoryComponent component, std::function<size_t()> probe);
+
+    // Add (or with a negative delta, remove) bytes; any thread
+    void charge(MemoryComponent component, int64_t delta);
+
+    // Current usage: charged bytes, or the probe's answer
+    size_t usage(MemoryComponent component) const;
+    
+    // Run every probe once to update the peaks (one thread, periodically)
+    void sampleProbes() const;
+
+    MemoryPressure pressure(MemoryComponent component) const {
+        return static_cast<MemoryPressure>(slot(component).pressure.load(std::memory_order_relaxed));
+    }
+
+    struct ComponentStats {
+        size_t usage;
+        size_t peak;
+        size_t budget;                  // 0 = unlimited
+        MemoryPressure pressure;
+        uint64_t pressure_events;       // Transitions into ELEVATED or CRITICAL
+    };
+    ComponentStats getStats(MemoryComponent component) const;
+
+    // Sum over all components
+    size_t totalUsage() const;
+
+private:
+    struct alignas(64) Slot {
+        std::atomic<int64_t> charged{0};
+        mutable std::atomic<size_t> peak{0};
+        std::atomic<uint8_t> pressure{0};
+        std::atomic<uint64_t> pressure_events{0};
+        size_t budget = 0;
+        std::function<size_t()> probe;
+        std::vector<PressureCallback> callbacks;
+    };
+
+    Slot slots_[static_cast<int>(MemoryComponent::COMPONENT_COUNT)];
+
+    Slot& slot(MemoryComponent component) { return slots_[static_cast<int>(component)]; }
+    const Slot& slot(MemoryComponent component) const { return slots_[static_cast<int>(component)]; }
+
+    void updatePressure(Slot& s, size_t usage);
+};
+
+} // namespace DPI
+
+#endif // MEMORY_ACCOUNTANT_H
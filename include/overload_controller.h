@@ -0,0 +1,188 @@
+#ifndef OVERLOAD_CONTROLLER_H
+#define OVERLOAD_CONTROLLER_H
+
+#include "types.h"
+#include "thread_safe_queue.h"
+#include "flight_recorder.h"
+#include <cstdint>
+#include <string>
+#include <vector>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <atomic>
+#include <condition_variable>
+
+namespace DPI {
+
+// ============================================================================
+// Overload Controller - sheds DPI work in stages instead of stalling
+// ============================================================================
+//
+// Without it, a slow FP fills its queue, the LB blocks in push(), the LB
+// queue fills, and the reader blocks: on a live link the kernel then drops
+// packets at random. The controller samples every interval:
+//
+//   - FP queue occupancy (deepest queue, % of capacity)
+//   - FP queue delay (longest time a packet waited for its FP)
+//
+// and moves between levels, each shedding more than the last:
+//
+//   NORMAL             everything inspected
+//   SHED_LOW_PRIORITY  new flows off ports 80/443/53 skip inspection
+//   VERDICT_ONLY       no new flow is inspected; they get the endpoint hint
+//                      (verdict cache) or the port guess, and rules still apply
+//   SAMPLING           only 1 in sample_rate flows reach the FPs at all
+//
+// Levels go up as soon as a threshold is crossed and come down one step at
+// a time after OVERLOAD_CALM_INTERVALS quiet samples, so the engine does not
+// flap. Packets that cannot go to an FP (not sampled, or FP queue full) are
+// handled by the policy: FORWARD them uninspected (fail-open), DROP them
+// (fail-closed), or BLOCK as before (backpressure, nothing uninspected).
+// ============================================================================
+
+enum class OverloadLevel : uint8_t {
+    NORMAL = 0,
+    SHED_LOW_PRIORITY,
+    VERDICT_ONLY,
+    SAMPLING,
+    LEVEL_COUNT      // Keep this last for counting
+};
+
+enum class OverloadPolicy : uint8_t {
+    BLOCK,           // Wait for the FP (no uninspected packets)
+    FORWARD,         // Forward uninspected packets (fail-open)
+    DROP             // Drop uninspected packets (fail-closed)
+};
+
+const char* overloadLevelToString(OverloadLevel level);
+const char* overloadPolicyToString(OverloadPolicy policy);
+bool parseOverloadPolicy(const std::string& name, OverloadPolicy& policy);
+
+// Thresholds to enter SHED_LOW_PRIORITY, VERDICT_ONLY, SAMPLING
+constexpr double OVERLOAD_OCCUPANCY_PCT[] = {50.0, 75.0, 90.0};
+constexpr uint64_t OVERLOAD_DELAY_US[] = {2000, 10000, 50000};
+
+// Samples below the current level's thresholds before stepping down
+constexpr uint32_t OVERLOAD_CALM_INTERVALS = 20;
+
+class OverloadController {
+public:
+    // fp_queues: the queues whose occupancy is watched (index = FP id)
+    // sample_rate: flows admitted to the FPs in SAMPLING (1 in N)
+    OverloadController(std::vector<ThreadSafeQueue<PacketJob>*> fp_queues,
+                       OverloadPolicy policy,
+                       uint32_t sample_rate = 16,
+                       uint32_t interval_ms = 10);
+    ~OverloadController();
+
+    // Start/stop the sampling thread
+    void start();
+    void stop();
+
+    // Where FORWARD/DROP send packets that bypass the FPs (call before start)
+    void setOutputCallback(PacketOutputCallback callback) { output_callback_ = std::move(callback); }
+
+    // Attach a flight recorder (call before start); level changes are traced
+    void setFlightRecorder(FlightRecorder* recorder) { recorder_ = recorder; }
+
+    OverloadLevel level() const {
+        return static_cast<OverloadLevel>(level_.load(std::memory_order_relaxed));
+    }
+
+    OverloadPolicy getPolicy() const { return policy_; }
+
+    // ========== LB side ==========
+
+    // May a packet of this flow go to an FP? (hash = symmetric flow hash)
+    bool admit(size_t hash) const {
+        return level() < OverloadLevel::SAMPLING ||
+               (hash >> 16) % sample_rate_ == 0;
+    }
+
+    // Packet cannot go to an FP: apply the policy
+    // Returns false under BLOCK (the caller should wait for the FP instead)
+    bool bypass(PacketJob& job);
+
+    // ========== FP side ==========
+
+    // Should a new flow be inspected at the current level?
+    bool shouldInspect(const FiveTuple& tuple) const {
+        OverloadLevel current = level();
+        if (current == OverloadLevel::NORMAL) return true;
+        if (current == OverloadLevel::SHED_LOW_PRIORITY) return isHighPriority(tuple);
+        return false;
+    }
+
+    // A new flow was not inspected
+    void recordShedFlow() { shed_flows_.fetch_add(1, std::memory_order_relaxed); }
+
+    // Time a packet waited in this FP's queue (FP thread only)
+    void recordQueueDelay(int fp_id, uint64_t ticks) {
+        std::atomic<uint64_t>& slot = delays_[fp_id]->max_ticks;
+        if (ticks > slot.load(std::memory_order_relaxed)) {
+            slot.store(ticks, std::memory_order_relaxed);
+        }
+    }
+
+    // Flows whose names drive domain/app rules (HTTP, TLS, DNS)
+    static bool isHighPriority(const FiveTuple& tuple) {
+        uint16_t port = tuple.dst_port;
+        return port == 443 || port == 80 || port == 53 || tuple.src_port == 53;
+    }
+
+    // Take one sample and update the level (called by the thread)
+    void evaluate();
+
+    struct Stats {
+        OverloadLevel level;
+        uint64_t escalations;          // Level raised
+        uint64_t recoveries;           // Level lowered
+        uint64_t level_ms[static_cast<int>(OverloadLevel::LEVEL_COUNT)];
+        uint64_t shed_flows;           // New flows not inspected
+        uint64_t bypass_forwarded;     // Uninspected packets forwarded
+        uint64_t bypass_dropped;       // Uninspected packets dropped
+        double max_occupancy_pct;
+        uint64_t max_delay_us;
+    };
+    Stats getStats() const;
+
+private:
+    struct alignas(64) DelaySlot {
+        std::atomic<uint64_t> max_ticks{0};
+    };
+
+    std::vector<ThreadSafeQueue<PacketJob>*> fp_queues_;
+    std::vector<std::unique_ptr<DelaySlot>> delays_;
+    OverloadPolicy policy_;
+    uint32_t sample_rate_;
+    uint32_t interval_ms_;
+
+    PacketOutputCallback output_callback_;
+    FlightRecorder* recorder_ = nullptr;
+
+    std::atomic<uint8_t> level_{0};
+    uint32_t calm_intervals_ = 0;      // Sampling thread only
+
+    std::atomic<uint64_t> escalations_{0};
+    std::atomic<uint64_t> recoveries_{0};
+    std::atomic<uint64_t> level_ms_[static_cast<int>(OverloadLevel::LEVEL_COUNT)] = {};
+    std::atomic<uint64_t> shed_flows_{0};
+    std::atomic<uint64_t> bypass_forwarded_{0};
+    std::atomic<uint64_t> bypass_dropped_{0};
+    std::atomic<uint64_t> max_occupancy_permille_{0};
+    std::atomic<uint64_t> max_delay_us_{0};
+
+    // Sampling thread
+    std::thread thread_;
+    std::mutex wake_mutex_;
+    std::condition_variable wake_cv_;
+    bool stopping_ = false;
+    bool running_ = false;
+
+    void run();
+};
+
+} // namespace DPI
+
+#endif // OVERLOAD_CONTROLLER_H
@@ -0,0 +1,62 @@
+#ifndef PACKET_POOL_H
+#define PACKET_POOL_H
+
+#include "spsc_ring.h"
+#include <cstdint>
+#include <cstddef>
+#include <vector>
+#include <atomic>
+#include <memory>
+
+namespace DPI {
+
+// ============================================================================
+// Packet Buffer Pool - recycled frame buffers, moved end to end
+// ============================================================================
+//
+// The reader used to read each frame into its own buffer and then copy it
+// into the PacketJob, and the output callback copied the job again into
+// the output queue. Now a frame is read straight into a pooled buffer that
+// becomes the job's data and is moved (never copied) through
+// LB -> FP -> output:
+//
+//   reader   acquire() -> read frame into it -> job.data
+//   output   writes the packet, then release()s the buffer
+//
+// Buffers come back over an SPSC ring (output thread -> reader thread), so
+// neither side takes a lock. Packets cut short by the output mode are
+// shortened in place and recycled like the rest. Dropped packets free their
+// buffers instead; the reader then allocates a new one, which is the only
+// cost of a miss.
+// ============================================================================
+class PacketBufferPool {
+public:
+    // capacity: buffers held for reuse (0 = no pooling, allocate every frame)
+    explicit PacketBufferPool(size_t capacity = 8192);
+
+    // Reader thread only: an empty buffer, recycled if one is available
+    std::vector<uint8_t> acquire();
+
+    // Output thread only: hand a written packet's buffer back
+    void release(std::vector<uint8_t>&& buffer);
+
+    bool isEnabled() const { return ring_ != nullptr; }
+
+    struct Stats {
+        uint64_t recycled;          // acquire() served from the pool
+        uint64_t allocated;         // acquire() with nothing to reuse
+        uint64_t discarded;         // release() with the pool full
+    };
+    Stats getStats() const;
+
+private:
+    std::unique_ptr<SpscRing<std::vector<uint8_t>>> ring_;
+
+    std::atomic<uint64_t> recycled_{0};
+    std::atomic<uint64_t> allocated_{0};
+    std::atomic<uint64_t> discarded_{0};
+};
+
+} // namespace DPI
+
+#endif // PACKET_POOL_H
@@ -0,0 +1,122 @@
+#ifndef PERF_COUNTERS_H
+#define PERF_COUNTERS_H
+
+#include <cstdint>
+#include <atomic>
+#include <string>
+
+namespace DPI {
+
+// ============================================================================
+// Hardware Performance Counters (Linux perf_event_open)
+// ============================================================================
+//
+// Each pipeline thread (reader, LB, FP, output) may own one counter group.
+// The group is opened from inside the thread it measures and counts user
+// space only, so time spent blocked in the kernel waiting on a queue does
+// not pollute the numbers.
+//
+// Group members (read atomically with PERF_FORMAT_GROUP):
+//   - CPU cycles           (group leader)
+//   - Instructions retired
+//   - L1D read misses
+//   - Last-level cache misses
+//   - Branch misses
+//
+// Sampling happens at stage boundaries: every PERF_SAMPLE_INTERVAL packets
+// and when the thread leaves its loop. When counters are disabled nothing is
+// opened and the per-packet cost is a single predictable branch.
+//
+// On non-Linux platforms (or when perf is not permitted) open() fails and
+// the engine keeps running without counters.
+// ============================================================================
+
+// Counter slots in a group
+enum class PerfCounter {
+    CYCLES = 0,
+    INSTRUCTIONS,
+    L1D_MISSES,
+    LLC_MISSES,
+    BRANCH_MISSES,
+    COUNT  // Keep this last for counting
+};
+
+constexpr int NUM_PERF_COUNTERS = static_cast<int>(PerfCounter::COUNT);
+
+// Packets between two counter reads
+constexpr uint64_t PERF_SAMPLE_INTERVAL = 4096;
+
+// Snapshot of a group (or sum of several groups)
+struct PerfSample {
+    uint64_t values[NUM_PERF_COUNTERS] = {0, 0, 0, 0, 0};
+    uint64_t packets = 0;
+    bool valid = false;  // At least one group contributed
+
+    uint64_t get(PerfCounter c) const { return values[static_cast<int>(c)]; }
+
+    // Per-packet value (0 if no packets)
+    double perPacket(PerfCounter c) const {
+        return packets > 0 ? static_cast<double>(get(c)) / packets : 0.0;
+    }
+
+    // Instructions per cycle
+    double ipc() const {
+        uint64_t cycles = get(PerfCounter::CYCLES);
+        return cycles > 0 ? static_cast<double>(get(PerfCounter::INSTRUCTIONS)) / cycles : 0.0;
+    }
+
+    PerfSample& operator+=(const PerfSample& other);
+};
+
+class PerfCounterGroup {
+public:
+    PerfCounterGroup();
+    ~PerfCounterGroup();
+
+    // Non-copyable (owns file descriptors)
+    PerfCounterGroup(const PerfCounterGroup&) = delete;
+    PerfCounterGroup& operator=(const PerfCounterGroup&) = delete;
+
+    // Open and enable the group for the calling thread
+    // Returns false if perf is unavailable (counters stay disabled)
+    bool open();
+
+    // Close all descriptors (last sample is kept for reporting)
+    void close();
+
+    bool isOpen() const { return leader_fd_ >= 0; }
+
+    // Read the counters and publish them together with the packet count
+    // Must be called from the thread that opened the group
+    void sample(uint64_t packets);
+
+    // Sample every PERF_SAMPLE_INTERVAL packets (cheap when closed)
+    void maybeSample(uint64_t packets) {
+        if (leader_fd_ >= 0 && (packets % PERF_SAMPLE_INTERVAL) == 0) {
+            sample(packets);
+        }
+    }
+
+    // Latest published values (safe from any thread)
+    PerfSample snapshot() const;
+
+private:
+    int leader_fd_ = -1;
+    int fds_[NUM_PERF_COUNTERS];
+
+    // Position of each counter in the group read buffer (-1 = not opened)
+    int slot_[NUM_PERF_COUNTERS];
+    int num_open_ = 0;
+
+    // Published results
+    std::atomic<uint64_t> values_[NUM_PERF_COUNTERS];
+    std::atomic<uint64_t> packets_{0};
+    std::atomic<bool> valid_{false};
+};
+
+// Format one stage row for the statistics report
+std::string formatPerfRow(const std::string& stage, const PerfSample& sample);
+
+} // namespace DPI
+
+#endif // PERF_COUNTERS_H
@@ -0,0 +1,66 @@
+#ifndef PORT_TABLE_H
+#define PORT_TABLE_H
+
+#include "types.h"
+#include <cstdint>
+#include <cstddef>
+
+namespace DPI {
+
+// ============================================================================
+// Port Hint Table - what usually runs on a port, one indexed load per lookup
+// ============================================================================
+//
+// Port fallbacks used to be `dst_port == 80 / 443 / 53` chains repeated in
+// every classifier. The table holds one entry per port for each transport:
+//
+//   apps[0][port]   TCP
+//   apps[1][port]   UDP
+//
+// An entry is the AppType to guess when nothing better is known (and, for
+// DNS, where the query extractor runs). DEFAULT_PORT_HINTS is built at
+// compile time; the signature database can add entries on top of a copy
+// (see SignatureEngine, `port=` lines).
+// ============================================================================
+
+static_assert(static_cast<int>(AppType::APP_COUNT) <= 256, "AppType must fit a port table entry");
+
+// Transport slot in per-protocol port tables (TCP = 0, UDP = 1)
+constexpr size_t portTableSlot(uint8_t protocol) {
+    return protocol == 17 ? 1 : 0;
+}
+
+struct PortHintTable {
+    uint8_t apps[2][65536] = {};
+
+    // Guess for a port (UNKNOWN for protocols without ports)
+    constexpr AppType lookup(uint8_t protocol, uint16_t port) const {
+        if (protocol != 6 && protocol != 17) return AppType::UNKNOWN;
+        return static_cast<AppType>(apps[portTableSlot(protocol)][port]);
+    }
+
+    // Guess for a flow's server port
+    constexpr AppType lookup(const FiveTuple& tuple) const {
+        return lookup(tuple.protocol, tuple.dst_port);
+    }
+
+    // protocol: 6 = TCP, 17 = UDP, 0 = both
+    constexpr void set(uint8_t protocol, uint16_t port, AppType app) {
+        if (protocol != 17) apps[0][port] = static_cast<uint8_t>(app);
+        if (protocol != 6) apps[1][port] = static_cast<uint8_t>(app);
+    }
+};
+
+constexpr PortHintTable makeDefaultPortHints() {
+    PortHintTable table{};
+    table.set(0, 80, AppType::HTTP);
+    table.set(0, 443, AppType::HTTPS);
+    table.set(0, 53, AppType::DNS);
+    return table;
+}
+
+inline constexpr PortHintTable DEFAULT_PORT_HINTS = makeDefaultPortHints();
+
+} // namespace DPI
+
+#endif // PORT_TABLE_H
@@ -0,0 +1,88 @@
+#ifndef RESPONSE_SYNTHESIZER_H
+#define RESPONSE_SYNTHESIZER_H
+
+#include "types.h"
+#include <cstdint>
+#include <string>
+#include <vector>
+#include <atomic>
+
+namespace DPI {
+
+// ============================================================================
+// Response Synthesizer - tells the endpoints of a blocked flow to give up
+// ============================================================================
+//
+// Silently dropping a blocked TCP flow makes the client retransmit until it
+// times out, and a dropped DNS query is retried against every resolver.
+// When a packet is dropped by a rule the FP asks for responses instead:
+//
+//   TCP  RST|ACK to the sender (as if from the peer), and RST to the peer
+//        once the connection is established (as if from the sender)
+//   DNS  for a query: NXDOMAIN, or an A record pointing at the sinkhole
+//
+// Responses are built from prebuilt Ethernet/IPv4 templates whose checksums
+// are computed once; per response only the changed 16-bit words are patched
+// and the checksums adjusted for them (RFC 1624). They are written to the
+// output capture next to the forwarded traffic.
+//
+// Each flow gets at most max_per_second responses per second of capture
+// time, so a client hammering a blocked flow cannot turn the engine into a
+// packet generator.
+// ============================================================================
+
+class ResponseSynthesizer {
+public:
+    // sinkhole: IPv4 address for A answers to blocked queries ("" = NXDOMAIN)
+    // max_per_second: responses per flow per second (a RST pair counts once)
+    explicit ResponseSynthesizer(const std::string& sinkhole = "",
+                                 uint32_t max_per_second = 2);
+
+    // Append the responses for a dropped packet to out; returns how many.
+    // FP thread only for a given conn (the rate limit lives in it).
+    size_t respond(const PacketJob& job, Connection* conn, std::vector<PacketJob>& out);
+
+    // The sinkhole address was given and is valid
+    bool hasSinkhole() const { return has_sinkhole_; }
+
+    // Parse dotted-quad IPv4 into network byte order bytes
+    static bool parseIPv4(const std::string& text, uint8_t addr[4]);
+
+    struct Stats {
+        uint64_t tcp_resets;           // RST packets built
+        uint64_t dns_answers;          // NXDOMAIN / sinkhole answers built
+        uint64_t rate_limited;         // Dropped packets not answered (limit)
+        uint64_t unsupported;          // Not Ethernet/IPv4, not a DNS query, ...
+    };
+    Stats getStats() const;
+
+private:
+    static constexpr size_t TCP_TEMPLATE_SIZE = 54;    // Ethernet + IPv4 + TCP
+    static constexpr size_t DNS_TEMPLATE_SIZE = 54;    // Ethernet + IPv4 + UDP + DNS header
+
+    uint8_t tcp_template_[TCP_TEMPLATE_SIZE];
+    uint8_t dns_template_[DNS_TEMPLATE_SIZE];
+
+    uint8_t sinkhole_[4] = {};
+    bool has_sinkhole_ = false;
+    uint32_t max_per_second_;
+
+    std::atomic<uint64_t> tcp_resets_{0};
+    std::atomic<uint64_t> dns_answers_{0};
+    std::atomic<uint64_t> rate_limited_{0};
+    std::atomic<uint64_t> unsupported_{0};
+
+    // Rate limit: true if the flow may be answered now
+    bool admit(const PacketJob& job, Connection* conn);
+
+    // to_sender: reply to whoever sent the dropped packet (else continue it)
+    void buildReset(const PacketJob& job, bool to_sender, uint32_t seq, uint32_t ack,
+                    uint8_t flags, std::vector<PacketJob>& out);
+    bool buildDNSAnswer(const PacketJob& job, std::vector<PacketJob>& out);
+
+    void buildTemplates();
+};
+
+} // namespace DPI
+
+#endif // RESPONSE_SYNTHESIZER_H
@@ -2,14 +2,15 @@
 #define RULE_MANAGER_H
 
 #include "types.h"
+#include "port_table.h"
 #include <string>
 #include <unordered_set>
 #include <unordered_map>
-#include <shared_mutex>
-#include <mutex>
+#include "lock_profiler.h"
 #include <optional>
 #include <vector>
 #include <fstream>
+#include <atomic>
 
 namespace DPI {
 
@@ -21,9 +22,15 @@ namespace DPI {
 // 1. IP-based: Block specific source IPs
 // 2. App-based: Block specific applications (detected via SNI)
 // 3. Domain-based: Block specific domains
-// 4. Port-based: Block specific destination ports
+// 4. Port-based: Block specific destination ports (per transport)
 //
-// Rules are thread-safe for concurrent access from FP threads
+// Rules are thread-safe for concurrent access from FP threads. Port rules
+// are a bitmap per transport (one bit per port), so the per-packet check
+// is a single relaxed load instead of a locked set lookup.
+//
+// Every rule carries its ID ("domain:*.facebook.com"), interned when the
+// rule is added: shouldBlock hands out a pointer to it, so blocking a flow
+// on an FP thread copies no strings.
 // ============================================================================
 
 class RuleManager {
@@ -72,19 +79,22 @@ public:
     // Check if domain matches any block rule
     bool isDomainBlocked(const std::string& domain) const;
     
+    // The block rule (exact domain or pattern) a domain matches, if any
+    std::optional<std::string> matchDomainRule(const std::string& domain) const;
+    
     // Get list of blocked domains
     std::vector<std::string> getBlockedDomains() const;
     
     // ========== Port Blocking ==========
     
-    // Block a specific destination port
-    void blockPort(uint16_t port);
+    // Block a specific destination port (protocol: 6 = TCP, 17 = UDP, 0 = both)
+    void blockPort(uint16_t port, uint8_t protocol = 0);
     
     // Unblock a port
-    void unblockPort(uint16_t port);
+    void unblockPort(uint16_t port, uint8_t protocol = 0);
     
-    // Check if port is blocked
-    bool isPortBlocked(uint16_t port) const;
+    // Check if port is blocked (protocol 0: for either transport)
+    bool isPortBlocked(uint16_t port, uint8_t protocol = 0) const;
     
     // ========== Combined Check ==========
     
@@ -92,12 +102,16 @@ public:
     // Returns the reason if blocked, nullopt if allowed
     struct BlockReason {
         enum Type { IP, APP, DOMAIN, PORT } type;
-        std::string detail;
+        
+        // Stable rule identifier, e.g. "domain:*.facebook.com" (interned:
+        // valid for the RuleManager's lifetime)
+        const std::string* rule_id;
     };
     
     std::optional<BlockReason> shouldBlock(
         uint32_t src_ip,
         uint16_t dst_port,
+        uint8_t protocol,
         AppType app,
         const std::string& domain) const;
     
@@ -122,21 +136,46 @@ public:
     };
     
     RuleStats getStats() const;
+    
+    // Approximate bytes held by all rule sets (memory accounting)
+    size_t memoryBytes() const;
 
 private:
     // Thread-safe containers with read-write locks
-    mutable std::shared_mutex ip_mutex_;
-    std::unordered_set<uint32_t> blocked_ips_;
+    // Each rule maps to its interned ID
+    mutable ProfiledSharedMutex ip_mutex_{"RuleManager::ip"};
+    std::unordered_map<uint32_t, const std::string*> blocked_ips_;
+    
+    mutable ProfiledSharedMutex app_mutex_{"RuleManager::app"};
+    std::unordered_map<AppType, const std::string*> blocked_apps_;
+    
+    mutable ProfiledSharedMutex domain_mutex_{"RuleManager::domain"};
+    std::unordered_map<std::string, const std::string*> blocked_domains_;
+    std::vector<std::pair<std::string, const std::string*>> domain_patterns_;  // For wildcard matching
+    
+    // Blocked ports: [portTableSlot(protocol)][port / 64], bit port % 64
+    static constexpr size_t PORT_BITMAP_WORDS = 65536 / 64;
+    std::atomic<uint64_t> blocked_ports_[2][PORT_BITMAP_WORDS] = {};
+    
+    // IDs of the blocked ports (read only when the bitmap matched)
+    mutable ProfiledSharedMutex port_mutex_{"RuleManager::port"};
+    std::unordered_map<uint16_t, const std::string*> port_rule_ids_;
+    
+    // Rule IDs handed out so far (never erased: flows and queued packets
+    // may still point at the ID of a rule that was removed)
+    mutable ProfiledMutex rule_id_mutex_{"RuleManager::rule_id"};
+    std::unordered_set<std::string> rule_ids_;
+    
+    const std::string* internRuleId(const std::string& id);
     
-    mutable std::shared_mutex app_mutex_;
-    std::unordered_set<AppType> blocked_apps_;
+    // Refresh a port's ID after its bitmap bits changed
+    void updatePortRuleId(uint16_t port);
     
-    mutable std::shared_mutex domain_mutex_;
-    std::unordered_set<std::string> blocked_domains_;
-    std::vector<std::string> domain_patterns_;  // For wildcard matching
+    // Domain rule a domain matches (exact or pattern), nullptr if none
+    const std::string* matchDomainRuleId(const std::string& domain) const;
     
-    mutable std::shared_mutex port_mutex_;
-    std::unordered_set<uint16_t> blocked_ports_;
+    // Port rule as written to rule files: "443", "443/tcp" or "443/udp"
+    std::string portRuleString(uint16_t port) const;
     
     // Helper: Convert IP string to uint32
     static uint32_t parseIP(const std::string& ip);
@@ -144,7 +183,7 @@ private:
     // Helper: Convert uint32 to IP string
     static std::string ipToString(uint32_t ip);
     
-    // Helper: Check if domain matches pattern (supports wildcards)
+    // Helper: Check if domain matches pattern (supports wildcards, ignores case)
     static bool domainMatchesPattern(const std::string& domain, const std::string& pattern);
 };
 
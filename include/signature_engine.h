@@ -0,0 +1,180 @@
+#ifndef SIGNATURE_ENGINE_H
+#define SIGNATURE_ENGINE_H
+
+#include "types.h"
+#include "port_table.h"
+#include <cstdint>
+#include <string>
+#include <vector>
+#include <memory>
+#include <limits>
+#include <atomic>
+
+namespace DPI {
+
+// ============================================================================
+// Payload Signature Engine - Multi-pattern matching for non-TLS protocols
+// ============================================================================
+//
+// TLS SNI, HTTP Host and DNS cover the web, but SSH, BitTorrent, WireGuard,
+// OpenVPN, RTP, ... would all stay UNKNOWN. Those protocols announce
+// themselves with fixed bytes near the start of the payload.
+//
+// All signature patterns are compiled into ONE Aho-Corasick automaton:
+//   - Bytes used by any pattern get their own equivalence class, every other
+//     byte shares class 0, so the transition table is states x classes
+//     (a few KB) instead of states x 256.
+//   - Transitions are fully resolved at compile time (DFA) and store the
+//     pre-multiplied row of the target state, so matching is one table load
+//     and one add per payload byte. The top bit flags states that emit.
+//   - Scanning stops at the furthest byte any signature can end on (anchored
+//     signatures usually bound this to a couple of dozen bytes).
+//   - When a state emits a pattern, its predicates are checked:
+//       offset=N      pattern must start exactly at byte N
+//       depth=N       pattern must end within the first N bytes
+//       minlen/maxlen/len   payload length bounds
+//       mask=O:M:V    (payload[O] & M) == V
+//
+// Only the first SIGNATURE_SCAN_BYTES bytes of the first
+// SIGNATURE_MAX_PACKETS payload packets of a flow are scanned. Signatures
+// are matched in file order: the earliest matching line wins.
+//
+// Signature file format (one per line, '#' starts a comment):
+//
+//   <App> <tcp|udp|any> <pattern> [option ...]
+//
+//   pattern: "text" (supports \xHH, \\, \") or |hex bytes| e.g. |01 00 00 00|
+//
+//   SSH        tcp  "SSH-"                      offset=0
+//   WireGuard  udp  |01 00 00 00|               offset=0 len=148
+//
+// A line whose pattern is port=N or port=N-M adds a port hint instead: the
+// guess for flows to those ports when no payload stage names them (applied
+// in file order on top of DEFAULT_PORT_HINTS):
+//
+//   SSH        tcp  port=22
+//   HTTPS      tcp  port=8443
+// ============================================================================
+
+// Bytes of each payload fed to the automaton
+constexpr size_t SIGNATURE_SCAN_BYTES = 64;
+
+// Payload packets per flow scanned before giving up
+constexpr uint8_t SIGNATURE_MAX_PACKETS = 3;
+
+struct PayloadSignature {
+    AppType app = AppType::UNKNOWN;
+    uint8_t protocol = 0;                  // 0 = any, 6 = TCP, 17 = UDP
+    std::vector<uint8_t> pattern;
+    int32_t offset = -1;                   // Exact start offset (-1 = anywhere)
+    uint32_t depth = 0;                    // Pattern end limit (0 = scan window)
+    uint32_t min_len = 0;
+    uint32_t max_len = std::numeric_limits<uint32_t>::max();
+    bool has_mask = false;
+    uint16_t mask_offset = 0;
+    uint8_t mask = 0;
+    uint8_t mask_value = 0;
+};
+
+struct PortHint {
+    AppType app = AppType::UNKNOWN;
+    uint8_t protocol = 0;                  // 0 = both, 6 = TCP, 17 = UDP
+    uint16_t first_port = 0;
+    uint16_t last_port = 0;
+};
+
+// ============================================================================
+// Compiled, immutable signature set (shared by all FPs)
+// ============================================================================
+class SignatureSet {
+public:
+    // Build the automaton; returns nullptr (with error set) on failure
+    static std::shared_ptr<const SignatureSet> compile(
+        std::vector<PayloadSignature> signatures, std::string& error,
+        const std::vector<PortHint>& port_hints = {});
+
+    // Match a payload; returns UNKNOWN if nothing matched
+    AppType match(const uint8_t* payload, size_t length, uint8_t protocol) const;
+
+    size_t size() const { return signatures_.size(); }
+    size_t numStates() const { return out_begin_.size() - 1; }
+    size_t scanLimit() const { return scan_limit_; }
+    size_t numClasses() const { return num_classes_; }
+    size_t numPortHints() const { return num_port_hints_; }
+    
+    // Port fallbacks: the defaults plus this set's port= lines
+    const PortHintTable& portHints() const { return port_hints_; }
+
+    // Approximate memory used by the automaton tables
+    size_t memoryBytes() const;
+
+private:
+    SignatureSet() = default;
+
+    std::vector<PayloadSignature> signatures_;
+
+    // Byte -> equivalence class (up to 257 classes: 0 plus every byte value)
+    uint16_t byte_class_[256] = {};
+    uint16_t num_classes_ = 1;
+
+    // DFA transitions: next_[state * num_classes_ + class] =
+    //   (target_state * num_classes_) | (target emits ? EMIT_FLAG : 0)
+    static constexpr uint32_t EMIT_FLAG = 0x80000000u;
+    std::vector<uint32_t> next_;
+
+    // Furthest payload byte any signature can end on
+    size_t scan_limit_ = SIGNATURE_SCAN_BYTES;
+
+    // Patterns ending in each state: out_ids_[out_begin_[s] .. out_begin_[s+1])
+    std::vector<uint32_t> out_begin_;
+    std::vector<uint16_t> out_ids_;
+
+    PortHintTable port_hints_ = DEFAULT_PORT_HINTS;
+    size_t num_port_hints_ = 0;
+
+    bool accept(const PayloadSignature& sig, size_t end, const uint8_t* payload,
+                size_t length, uint8_t protocol) const;
+};
+
+// ============================================================================
+// Signature Engine - runtime-reloadable holder of the current set
+// ============================================================================
+class SignatureEngine {
+public:
+    // Starts with the built-in signature set
+    SignatureEngine();
+
+    // Replace the current set (FPs pick it up on their next lookup)
+    bool loadFromFile(const std::string& filename);
+    bool loadFromString(const std::string& text, const std::string& source);
+
+    // Restore the built-in signatures
+    void loadDefaults();
+
+    // Current compiled set (never null)
+    std::shared_ptr<const SignatureSet> get() const;
+
+    // Bumped on every successful load (readers cache get() until it changes)
+    uint64_t version() const { return version_.load(std::memory_order_acquire); }
+
+    // Convenience: match against the current set
+    AppType match(const uint8_t* payload, size_t length, uint8_t protocol) const {
+        return get()->match(payload, length, protocol);
+    }
+
+    // Parse signature text into signatures (errors are reported per line)
+    static bool parse(const std::string& text, const std::string& source,
+                      std::vector<PayloadSignature>& out,
+                      std::vector<PortHint>* port_hints = nullptr);
+
+    // Built-in signature text
+    static const char* defaultSignatures();
+
+private:
+    std::shared_ptr<const SignatureSet> set_;
+    std::atomic<uint64_t> version_{0};
+};
+
+} // namespace DPI
+
+#endif // SIGNATURE_ENGINE_H
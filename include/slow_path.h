@@ -0,0 +1,143 @@
+#ifndef SLOW_PATH_H
+#define SLOW_PATH_H
+
+#include "types.h"
+#include "sni_extractor.h"
+#include "thread_safe_queue.h"
+#include "spsc_ring.h"
+#include "latency_histogram.h"
+#include <cstdint>
+#include <string>
+#include <vector>
+#include <memory>
+#include <thread>
+#include <atomic>
+
+namespace DPI {
+
+// ============================================================================
+// Slow Path - worker pool for inspection work too expensive for an FP
+// ============================================================================
+//
+// A certificate walk or a QUIC Initial scan costs far more than forwarding
+// a packet. Done inline it stalls every other flow on the same FP, so the
+// FP hands a copy of the bytes to the slow path and keeps forwarding:
+//
+//   FP --submit()--> bounded request queue --> worker 0..N-1
+//                                                  |
+//   FP <--drain()--- SPSC mailbox [worker][fp] <---+
+//
+// While a request is outstanding the flow is marked PacketAction::INSPECT;
+// its packets are forwarded with whatever classification it has so far,
+// and the result refines it when the FP drains its mailboxes. Results for
+// flows that were blocked, closed or evicted in the meantime are dropped.
+//
+// submit() never blocks: when the request queue is full it returns false
+// and the FP does the work inline, so the slow path can only ever make an
+// FP faster. Each mailbox has exactly one producer (its worker) and one
+// consumer (its FP); a worker whose mailbox is full waits for the FP.
+// ============================================================================
+
+enum class SlowPathTask : uint8_t {
+    CERTIFICATE,      // Leaf certificate DER -> subject CN / SAN names
+    QUIC_INITIAL      // QUIC Initial datagram -> Client Hello SNI
+};
+
+struct SlowPathRequest {
+    SlowPathTask task = SlowPathTask::CERTIFICATE;
+    int fp_id = 0;
+    FiveTuple tuple{};              // Connection key (the flow as opened)
+    uint64_t submit_ticks = 0;
+    std::vector<uint8_t> data;      // Private copy of the bytes to inspect
+};
+
+struct SlowPathResult {
+    SlowPathTask task = SlowPathTask::CERTIFICATE;
+    FiveTuple tuple{};
+    uint64_t submit_ticks = 0;
+    AppType app = AppType::UNKNOWN; // UNKNOWN = nothing found
+    std::string name;               // SNI / certificate name
+};
+
+// Pick the certificate name that maps to the most specific application
+// (SAN names first when the CN is generic); UNKNOWN if there is none
+AppType selectCertificateName(const TLSServerInfo& info, std::string& name);
+
+class SlowPathPool {
+public:
+    // num_workers: worker threads
+    // num_fps: one mailbox per (worker, FP) pair
+    // queue_capacity: outstanding requests before submit() refuses
+    SlowPathPool(int num_workers, int num_fps,
+                 size_t queue_capacity = 1024, size_t mailbox_capacity = 1024);
+    ~SlowPathPool();
+
+    void start();
+    void stop();
+
+    // FP side: hand off a request; false = saturated, do it inline
+    bool submit(SlowPathRequest&& request);
+
+    // FP side: apply every finished result for this FP (FP thread only)
+    template<typename Fn>
+    size_t drain(int fp_id, Fn&& apply) {
+        size_t drained = 0;
+        SlowPathResult result;
+        for (int w = 0; w < num_workers_; w++) {
+            SpscRing<SlowPathResult>& mailbox = *mailboxes_[w * num_fps_ + fp_id];
+            while (mailbox.tryPop(result)) {
+                apply(result);
+                drained++;
+            }
+        }
+        return drained;
+    }
+
+    // FP side: a result was applied to a live flow / found its flow gone
+    void recordApplied(const SlowPathResult& result);
+    void recordStale() { stale_.fetch_add(1, std::memory_order_relaxed); }
+
+    // Run one request on the calling thread
+    static SlowPathResult execute(const SlowPathRequest& request);
+
+    int getNumWorkers() const { return num_workers_; }
+
+    struct Stats {
+        uint64_t submitted;
+        uint64_t rejected;            // Queue full, done inline by the FP
+        uint64_t completed;
+        uint64_t applied;
+        uint64_t stale;               // Flow gone or no longer pending
+        uint64_t max_queue_depth;
+        double avg_queue_depth;       // Sampled at each submit
+        uint64_t latency_p50_ns;      // Submit -> applied by the FP
+        uint64_t latency_p99_ns;
+        uint64_t latency_max_ns;
+    };
+    Stats getStats() const;
+
+private:
+    int num_workers_;
+    int num_fps_;
+
+    ThreadSafeQueue<SlowPathRequest> requests_;
+    std::vector<std::unique_ptr<SpscRing<SlowPathResult>>> mailboxes_;
+
+    std::vector<std::thread> workers_;
+    std::atomic<bool> running_{false};
+
+    std::atomic<uint64_t> submitted_{0};
+    std::atomic<uint64_t> rejected_{0};
+    std::atomic<uint64_t> completed_{0};
+    std::atomic<uint64_t> applied_{0};
+    std::atomic<uint64_t> stale_{0};
+    std::atomic<uint64_t> max_queue_depth_{0};
+    std::atomic<uint64_t> queue_depth_sum_{0};
+    LatencyHistogram latency_;
+
+    void workerLoop(int worker_id);
+};
+
+} // namespace DPI
+
+#endif // SLOW_PATH_H
@@ -4,6 +4,7 @@
 #include <string>
 #include <cstdint>
 #include <optional>
+#include <string_view>
 #include <vector>
 
 namespace DPI {
@@ -43,11 +44,35 @@ namespace DPI {
 //
 // ============================================================================
 
+// ============================================================================
+// Name views - extracted names without allocating
+// ============================================================================
+//
+// The *View variants return a std::string_view instead of a std::string:
+//
+//   - into the payload, when the name is already lowercase (the usual case)
+//   - into the caller's scratch buffer, when it had to be lowercased or
+//     (DNS) assembled from labels
+//
+// A view lives until the packet or the scratch buffer is reused, so callers
+// copy it only once the flow is classified. Names longer than a DNS name
+// can be are rejected. The std::string variants wrap the views.
+// ============================================================================
+
+// Longest name in text form (RFC 1035: 255 octets on the wire)
+constexpr size_t MAX_HOSTNAME_LENGTH = 253;
+
+struct HostnameScratch {
+    char data[MAX_HOSTNAME_LENGTH];
+};
+
 class SNIExtractor {
 public:
     // Extract SNI from a TLS Client Hello packet
     // payload should point to the start of TCP payload (after TCP header)
     static std::optional<std::string> extract(const uint8_t* payload, size_t length);
+    static std::optional<std::string_view> extractView(const uint8_t* payload, size_t length,
+                                                       HostnameScratch& scratch);
     
     // Check if this looks like a TLS Client Hello
     static bool isTLSClientHello(const uint8_t* payload, size_t length);
@@ -68,6 +93,82 @@ private:
     static uint32_t readUint24BE(const uint8_t* data);
 };
 
+// ============================================================================
+// TLS Server Extractor - Parses the server-to-client handshake
+// ============================================================================
+//
+// When the Client Hello has no SNI (or was missed), the server side still
+// names the service:
+//
+//   ServerHello (handshake type 0x02)
+//     - selected ALPN protocol (extension 0x0010, TLS <= 1.2)
+//     - supported_versions (0x002b) = 0x0304 means TLS 1.3: everything
+//       after the ServerHello is encrypted, so there is no certificate
+//
+//   Certificate (handshake type 0x0b, TLS <= 1.2)
+//     - 3-byte list length, then 3-byte length + DER for each certificate
+//     - only the first (leaf) certificate is parsed:
+//
+//       Certificate ::= SEQUENCE {
+//         tbsCertificate SEQUENCE {
+//           [0] version, serialNumber, signature, issuer, validity,
+//           subject Name,                       -> CN (OID 2.5.4.3)
+//           subjectPublicKeyInfo,
+//           [3] extensions SEQUENCE OF Extension -> subjectAltName
+//         } ...                                     (OID 2.5.29.17)
+//       }                                           dNSName = [2] IA5String
+//
+// The DER walker never allocates: names are returned as string_views into
+// the packet and only copied when the flow is classified. Truncated
+// elements are walked as far as the segment goes, so names that fit in the
+// first segment are still found. Handshake records that continue into the
+// next segment are skipped via `record_skip` (kept per flow by the caller).
+// With parse_certificate = false the leaf is only located (certificate_der),
+// so the caller can walk it later - or on another thread.
+// ============================================================================
+
+// SAN DNS names reported per certificate
+constexpr size_t TLS_MAX_SAN_NAMES = 8;
+
+// Server payload packets parsed per flow before giving up
+constexpr uint8_t TLS_SERVER_MAX_PACKETS = 3;
+
+struct TLSServerInfo {
+    bool server_hello = false;       // ServerHello seen in this segment
+    bool tls13 = false;              // Negotiated TLS 1.3 (certificate encrypted)
+    bool certificate = false;        // Leaf certificate found
+    const uint8_t* certificate_der = nullptr;  // Leaf DER in the payload (may be truncated)
+    size_t certificate_length = 0;
+    std::string_view alpn;           // Selected ALPN protocol
+    std::string_view common_name;    // Subject CN of the leaf certificate
+    std::string_view dns_names[TLS_MAX_SAN_NAMES];
+    size_t num_dns_names = 0;
+};
+
+class TLSServerExtractor {
+public:
+    // Parse one server-to-client TCP payload
+    // record_skip: bytes of a TLS record carried over from the previous
+    //              segment (in), and into the next segment (out)
+    // parse_certificate: walk the leaf certificate, or only locate it
+    // Returns true if a ServerHello or certificate was found
+    static bool parse(const uint8_t* payload, size_t length,
+                      uint32_t& record_skip, TLSServerInfo& info,
+                      bool parse_certificate = true);
+
+    // Parse a DER certificate (may be truncated) for subject CN and SAN names
+    static bool parseCertificate(const uint8_t* der, size_t length, TLSServerInfo& info);
+
+private:
+    static constexpr uint8_t CONTENT_TYPE_HANDSHAKE = 0x16;
+    static constexpr uint8_t HANDSHAKE_SERVER_HELLO = 0x02;
+    static constexpr uint8_t HANDSHAKE_CERTIFICATE = 0x0b;
+    static constexpr uint16_t EXTENSION_ALPN = 0x0010;
+    static constexpr uint16_t EXTENSION_SUPPORTED_VERSIONS = 0x002b;
+
+    static void parseServerHello(const uint8_t* body, size_t length, TLSServerInfo& info);
+};
+
 // ============================================================================
 // QUIC SNI Extractor - For QUIC/HTTP3 traffic
 // ============================================================================
@@ -76,6 +177,8 @@ public:
     // QUIC Initial packets also contain TLS Client Hello (in CRYPTO frames)
     // This is more complex as QUIC has its own framing
     static std::optional<std::string> extract(const uint8_t* payload, size_t length);
+    static std::optional<std::string_view> extractView(const uint8_t* payload, size_t length,
+                                                       HostnameScratch& scratch);
     
     // Check if this looks like a QUIC Initial packet
     static bool isQUICInitial(const uint8_t* payload, size_t length);
@@ -86,8 +189,10 @@ public:
 // ============================================================================
 class HTTPHostExtractor {
 public:
-    // Extract Host header from HTTP request
+    // Extract Host header from HTTP request (without a port)
     static std::optional<std::string> extract(const uint8_t* payload, size_t length);
+    static std::optional<std::string_view> extractView(const uint8_t* payload, size_t length,
+                                                       HostnameScratch& scratch);
     
     // Check if this looks like an HTTP request
     static bool isHTTPRequest(const uint8_t* payload, size_t length);
@@ -98,8 +203,10 @@ public:
 // ============================================================================
 class DNSExtractor {
 public:
-    // Extract queried domain from DNS request
+    // Extract queried domain from DNS request (labels joined into scratch)
     static std::optional<std::string> extractQuery(const uint8_t* payload, size_t length);
+    static std::optional<std::string_view> extractQueryView(const uint8_t* payload, size_t length,
+                                                            HostnameScratch& scratch);
     
     // Check if this is a DNS query (not response)
     static bool isDNSQuery(const uint8_t* payload, size_t length);
@@ -1,106 +1,190 @@
 #ifndef THREAD_SAFE_QUEUE_H
 #define THREAD_SAFE_QUEUE_H
 
-#include <queue>
-#include <mutex>
-#include <condition_variable>
+#include "lock_profiler.h"
+#include <vector>
 #include <optional>
 #include <chrono>
 
 namespace DPI {
 
+// Bytes an item holds while queued (overload for items owning heap data)
+template<typename T>
+size_t queueItemBytes(const T&) { return sizeof(T); }
+
 // ============================================================================
 // Thread-safe queue for passing packets between threads
 // Used for: Reader -> LB -> FP communication
+//
+// Bounded by item count and, optionally, by bytes (setMaxBytes): a queue
+// of jumbo packets then fills up long before one of small ACKs would.
+//
+// Items live in a ring of max_size slots allocated up front, so push and
+// pop never touch the heap (a std::deque allocates a block every few
+// hundred items).
 // ============================================================================
 template<typename T>
 class ThreadSafeQueue {
 public:
-    ThreadSafeQueue(size_t max_size = 10000) : max_size_(max_size) {}
+    // name: how the queue's lock shows up in the lock profile
+    ThreadSafeQueue(size_t max_size = 10000, const char* name = "ThreadSafeQueue")
+        : mutex_(name), slots_(max_size > 0 ? max_size : 1), max_size_(slots_.size()) {}
+    
+    // Byte bound on top of the item bound (0 = none; call before use).
+    // One item is always admitted so an oversized item cannot wedge the queue.
+    void setMaxBytes(size_t max_bytes) {
+        std::lock_guard<ProfiledMutex> lock(mutex_);
+        max_bytes_ = max_bytes;
+    }
     
     // Push item to queue (blocks if full)
     void push(T item) {
-        std::unique_lock<std::mutex> lock(mutex_);
-        not_full_.wait(lock, [this] { return queue_.size() < max_size_ || shutdown_; });
+        ProfiledMutex::Lock lock(mutex_);
+        not_full_.wait(lock, [this] { return hasRoom() || shutdown_; });
         
         if (shutdown_) return;
         
-        queue_.push(std::move(item));
+        pushBack(std::move(item));
         not_empty_.notify_one();
     }
     
     // Try to push without blocking
     bool tryPush(T item) {
-        std::lock_guard<std::mutex> lock(mutex_);
-        if (queue_.size() >= max_size_ || shutdown_) {
+        std::lock_guard<ProfiledMutex> lock(mutex_);
+        if (!hasRoom() || shutdown_) {
             return false;
         }
-        queue_.push(std::move(item));
+        pushBack(std::move(item));
         not_empty_.notify_one();
         return true;
     }
     
     // Pop item from queue (blocks if empty)
     std::optional<T> pop() {
-        std::unique_lock<std::mutex> lock(mutex_);
-        not_empty_.wait(lock, [this] { return !queue_.empty() || shutdown_; });
+        ProfiledMutex::Lock lock(mutex_);
+        not_empty_.wait(lock, [this] { return count_ > 0 || shutdown_; });
         
-        if (queue_.empty()) return std::nullopt;
+        if (count_ == 0) return std::nullopt;
         
-        T item = std::move(queue_.front());
-        queue_.pop();
-        not_full_.notify_one();
-        return item;
+        return takeFront();
     }
     
     // Pop with timeout
     std::optional<T> popWithTimeout(std::chrono::milliseconds timeout) {
-        std::unique_lock<std::mutex> lock(mutex_);
+        ProfiledMutex::Lock lock(mutex_);
         
-        if (!not_empty_.wait_for(lock, timeout, [this] { return !queue_.empty() || shutdown_; })) {
+        if (!not_empty_.wait_for(lock, timeout, [this] { return count_ > 0 || shutdown_; })) {
             return std::nullopt;  // Timeout
         }
         
-        if (queue_.empty()) return std::nullopt;
+        if (count_ == 0) return std::nullopt;
         
-        T item = std::move(queue_.front());
-        queue_.pop();
-        not_full_.notify_one();
-        return item;
+        return takeFront();
     }
-    
+
+    // Pop up to max items under one lock (waits up to timeout for the first).
+    // out is cleared and refilled; reserve it once so bursts don't allocate.
+    size_t popBurst(std::vector<T>& out, size_t max, std::chrono::milliseconds timeout) {
+        out.clear();
+        ProfiledMutex::Lock lock(mutex_);
+
+        if (!not_empty_.wait_for(lock, timeout, [this] { return count_ > 0 || shutdown_; })) {
+            return 0;  // Timeout
+        }
+
+        while (count_ > 0 && out.size() < max) {
+            out.push_back(popFront());
+        }
+
+        // Several slots may have opened up
+        if (out.size() > 1) {
+            not_full_.notify_all();
+        } else if (!out.empty()) {
+            not_full_.notify_one();
+        }
+        return out.size();
+    }
+
     // Check if empty
     bool empty() const {
-        std::lock_guard<std::mutex> lock(mutex_);
-        return queue_.empty();
+        std::lock_guard<ProfiledMutex> lock(mutex_);
+        return count_ == 0;
     }
     
     // Get current size
     size_t size() const {
-        std::lock_guard<std::mutex> lock(mutex_);
-        return queue_.size();
+        std::lock_guard<ProfiledMutex> lock(mutex_);
+        return count_;
+    }
+    
+    // Check if a push would block
+    bool isFull() const {
+        std::lock_guard<ProfiledMutex> lock(mutex_);
+        return !hasRoom();
+    }
+    
+    // Bytes held by queued items (see queueItemBytes)
+    size_t bytes() const {
+        std::lock_guard<ProfiledMutex> lock(mutex_);
+        return bytes_;
     }
     
+    // Get maximum size
+    size_t capacity() const { return max_size_; }
+    
     // Signal shutdown (wake up all waiting threads)
     void shutdown() {
-        std::lock_guard<std::mutex> lock(mutex_);
+        std::lock_guard<ProfiledMutex> lock(mutex_);
         shutdown_ = true;
         not_empty_.notify_all();
         not_full_.notify_all();
     }
     
     bool isShutdown() const {
-        std::lock_guard<std::mutex> lock(mutex_);
+        std::lock_guard<ProfiledMutex> lock(mutex_);
         return shutdown_;
     }
 
 private:
-    std::queue<T> queue_;
-    mutable std::mutex mutex_;
-    std::condition_variable not_empty_;
-    std::condition_variable not_full_;
+    mutable ProfiledMutex mutex_;
+    ProfiledMutex::Condition not_empty_;
+    ProfiledMutex::Condition not_full_;
+    std::vector<T> slots_;     // Ring storage; live items are [head_, head_ + count_)
     size_t max_size_;
+    size_t head_ = 0;
+    size_t count_ = 0;
+    size_t max_bytes_ = 0;
+    size_t bytes_ = 0;
     bool shutdown_ = false;
+    
+    bool hasRoom() const {
+        return count_ < max_size_ &&
+               (max_bytes_ == 0 || bytes_ < max_bytes_ || count_ == 0);
+    }
+    
+    // Ring bookkeeping (lock held, room / an item checked by the caller)
+    void pushBack(T&& item) {
+        bytes_ += queueItemBytes(item);
+        size_t tail = head_ + count_;
+        if (tail >= max_size_) tail -= max_size_;
+        slots_[tail] = std::move(item);
+        count_++;
+    }
+    
+    T popFront() {
+        T item = std::move(slots_[head_]);
+        if (++head_ == max_size_) head_ = 0;
+        count_--;
+        bytes_ -= queueItemBytes(item);
+        return item;
+    }
+    
+    // Pop bookkeeping (lock held)
+    T takeFront() {
+        T item = popFront();
+        not_full_.notify_one();
+        return item;
+    }
 };
 
 } // namespace DPI
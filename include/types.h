@@ -2,12 +2,15 @@
 #define DPI_TYPES_H
 
 #include <cstdint>
+#include <cstring>
 #include <string>
+#include <string_view>
 #include <functional>
 #include <chrono>
 #include <vector>
 #include <atomic>
 #include <optional>
+#include <algorithm>
 
 namespace DPI {
 
@@ -51,6 +54,16 @@ struct FiveTupleHash {
     }
 };
 
+// Direction-independent hash: both directions of a flow hash the same,
+// so the LBs deliver client and server packets to the same FP
+struct SymmetricTupleHash {
+    size_t operator()(const FiveTuple& tuple) const {
+        bool swap = tuple.src_ip > tuple.dst_ip ||
+                    (tuple.src_ip == tuple.dst_ip && tuple.src_port > tuple.dst_port);
+        return FiveTupleHash{}(swap ? tuple.reverse() : tuple);
+    }
+};
+
 // ============================================================================
 // Application Classification
 // ============================================================================
@@ -61,6 +74,12 @@ enum class AppType {
     DNS,
     TLS,
     QUIC,
+    // Non-TLS protocols (detected via payload signatures)
+    SSH,
+    BITTORRENT,
+    WIREGUARD,
+    OPENVPN,
+    RTP,
     // Specific applications (detected via SNI)
     GOOGLE,
     FACEBOOK,
@@ -84,7 +103,7 @@ enum class AppType {
 };
 
 std::string appTypeToString(AppType type);
-AppType sniToAppType(const std::string& sni);
+AppType sniToAppType(std::string_view sni);
 
 // ============================================================================
 // Connection State
@@ -97,6 +116,31 @@ enum class ConnectionState {
     CLOSED
 };
 
+// ============================================================================
+// TCP State (both directions, as a middlebox sees them)
+// ============================================================================
+enum class TcpState : uint8_t {
+    NONE,           // Not TCP, or no packet tracked yet
+    SYN_SENT,       // Initiator's SYN seen
+    SYN_RECEIVED,   // Responder's SYN-ACK seen
+    ESTABLISHED,    // Handshake done, or picked up midstream
+    FIN_WAIT,       // One side has sent a FIN
+    CLOSING,        // Both sides have sent a FIN
+    TIME_WAIT,      // Both FINs acknowledged
+    CLOSED          // Ended by a valid RST
+};
+
+// Per-direction sequence tracking; index 0 = initiator, 1 = responder
+struct TcpTracking {
+    TcpState state = TcpState::NONE;
+    bool midstream = false;         // First packet seen was not a SYN
+    uint8_t fin_sent = 0;           // Bit per direction
+    uint8_t fin_acked = 0;          // Bit per direction: its FIN was ACKed
+    uint8_t seq_known = 0;          // Bit per direction: next_seq is valid
+    uint32_t next_seq[2] = {0, 0};  // Highest sequence number sent + 1
+    uint32_t fin_seq[2] = {0, 0};   // Sequence number just past each FIN
+};
+
 // ============================================================================
 // Packet Action (what to do with the packet)
 // ============================================================================
@@ -104,7 +148,77 @@ enum class PacketAction {
     FORWARD,    // Send to internet
     DROP,       // Block/drop the packet
     INSPECT,    // Needs further inspection
-    LOG_ONLY    // Forward but log
+    LOG_ONLY,   // Forward but log
+    INJECT      // Generated by the engine (e.g. TCP RST for a blocked flow)
+};
+
+// ============================================================================
+// Early-flow feature record (see flow_classifier.h)
+// ============================================================================
+
+// Payload packets observed per flow before the flow model is evaluated
+constexpr uint8_t FLOW_FEATURE_PACKETS = 8;
+
+struct FlowFeatureState {
+    uint16_t sizes[FLOW_FEATURE_PACKETS] = {};
+    uint32_t iats_us[FLOW_FEATURE_PACKETS] = {};   // iats_us[0] is unused
+    uint64_t last_ts_us = 0;
+    uint8_t count = 0;
+    uint8_t inbound_mask = 0;                      // Bit i set = packet i was inbound
+    bool evaluated = false;
+
+    // Record one payload packet; returns true when the last needed packet arrives
+    bool observe(size_t payload_size, bool is_outbound, uint32_t ts_sec, uint32_t ts_usec) {
+        if (count >= FLOW_FEATURE_PACKETS) return false;
+
+        uint64_t ts_us = static_cast<uint64_t>(ts_sec) * 1000000 + ts_usec;
+        if (count > 0) {
+            uint64_t delta = ts_us > last_ts_us ? ts_us - last_ts_us : 0;
+            iats_us[count] = static_cast<uint32_t>(std::min<uint64_t>(delta, UINT32_MAX));
+        }
+        last_ts_us = ts_us;
+
+        sizes[count] = static_cast<uint16_t>(std::min<size_t>(payload_size, UINT16_MAX));
+        if (!is_outbound) inbound_mask |= static_cast<uint8_t>(1u << count);
+        count++;
+
+        return count == FLOW_FEATURE_PACKETS;
+    }
+};
+
+// ============================================================================
+// Server name of a flow (SNI, Host or DNS name), stored inline
+// ============================================================================
+// A DNS name has at most 253 characters, so every real name fits and a flow
+// entry never allocates for it; anything longer is cut at MAX_LENGTH.
+class FlowName {
+public:
+    static constexpr size_t MAX_LENGTH = 255;
+
+    FlowName() = default;
+    FlowName(std::string_view name) { assign(name); }
+
+    FlowName& operator=(std::string_view name) {
+        assign(name);
+        return *this;
+    }
+
+    void assign(std::string_view name) {
+        size_ = static_cast<uint8_t>(std::min(name.size(), MAX_LENGTH));
+        std::memmove(data_, name.data(), size_);  // name may view this one
+    }
+
+    void clear() { size_ = 0; }
+    bool empty() const { return size_ == 0; }
+    size_t size() const { return size_; }
+
+    std::string_view view() const { return std::string_view(data_, size_); }
+    operator std::string_view() const { return view(); }
+    std::string str() const { return std::string(view()); }
+
+private:
+    uint8_t size_ = 0;
+    char data_[MAX_LENGTH];
 };
 
 // ============================================================================
@@ -114,7 +228,10 @@ struct Connection {
     FiveTuple tuple;
     ConnectionState state = ConnectionState::NEW;
     AppType app_type = AppType::UNKNOWN;
-    std::string sni;  // Server Name Indication (if detected)
+    FlowName sni;     // Server Name Indication (if detected)
+    bool classification_provisional = false;  // Port/ALPN guess, may be refined
+    bool hint_applied = false;                // app/sni pre-set from the hint cache
+    bool hint_only = false;                   // app/sni so far come from the hint alone
     
     uint64_t packets_in = 0;
     uint64_t packets_out = 0;
@@ -127,9 +244,30 @@ struct Connection {
     PacketAction action = PacketAction::FORWARD;
     
     // For TCP state tracking
-    bool syn_seen = false;
-    bool syn_ack_seen = false;
-    bool fin_seen = false;
+    TcpTracking tcp;
+    
+    // Payload packets already scanned by the signature engine
+    uint8_t signature_packets = 0;
+    
+    // Early-flow statistics for the flow feature classifier
+    FlowFeatureState features;
+    
+    // Server-side TLS handshake parsing (ServerHello / Certificate)
+    uint8_t tls_server_packets = 0;
+    uint32_t tls_record_skip = 0;
+    
+    // Opened while overloaded: classified by hint/port only, never inspected
+    bool inspection_shed = false;
+    
+    // Rule that blocked the flow (interned by the RuleManager; null = none)
+    const std::string* block_rule = nullptr;
+    
+    // Responses synthesized for the blocked flow (rate limit window)
+    uint32_t response_window_sec = 0;
+    uint32_t responses_in_window = 0;
+    
+    // Bytes charged to the memory accountant for this entry
+    uint32_t memory_charge = 0;
 };
 
 // ============================================================================
@@ -145,13 +283,50 @@ struct PacketJob {
     size_t payload_offset = 0;
     size_t payload_length = 0;
     uint8_t tcp_flags = 0;
+    uint32_t tcp_seq = 0;
+    uint32_t tcp_ack = 0;
     const uint8_t* payload_data = nullptr;
     
     // Timestamps
     uint32_t ts_sec;
     uint32_t ts_usec;
+    
+    // When the LB queued the packet for its FP (FlightRecorder ticks)
+    uint64_t enqueue_ticks = 0;
+    
+    // When the reader queued the packet (FlightRecorder ticks; 0 = not measured)
+    uint64_t ingress_ticks = 0;
+    
+    // Length on the wire (data may hold less: capture snaplen, output modes)
+    uint32_t orig_len = 0;
+    
+    // Set by the FP: the flow has an application (output modes)
+    bool flow_classified = false;
+    
+    // Set by the FP: the flow's application when this packet was handled
+    AppType app_type = AppType::UNKNOWN;
+    
+    // Why the packet was dropped (interned rule ID, e.g. "app:YouTube");
+    // null if forwarded. Only the drop sink turns it into text.
+    const std::string* verdict = nullptr;
 };
 
+// Queue accounting counts the packet bytes, not just the job (see ThreadSafeQueue)
+inline size_t queueItemBytes(const PacketJob& job) {
+    return sizeof(PacketJob) + job.data.capacity();
+}
+
+// Callback type for packet output (forwarding). The callback may take the
+// job's data (zero-copy hand-off to the output); the caller must not read
+// the packet bytes afterwards, only its metadata.
+using PacketOutputCallback = std::function<void(PacketJob&, PacketAction)>;
+
+// Callback type for the ingress stage: parses a framed packet in place and
+// returns whether to dispatch it. On false the callback has dealt with the
+// packet (discarded it, or sent it to the output). lb_id names the calling
+// LB, so the stage can keep per-thread state.
+using PacketIngressCallback = std::function<bool(PacketJob&, int lb_id)>;
+
 // ============================================================================
 // Statistics - uses regular uint64_t, protected by mutex externally
 // ============================================================================
@@ -163,6 +338,7 @@ struct DPIStats {
     std::atomic<uint64_t> tcp_packets{0};
     std::atomic<uint64_t> udp_packets{0};
     std::atomic<uint64_t> other_packets{0};
+    std::atomic<uint64_t> filtered_packets{0};   // Rejected by the capture filter
     std::atomic<uint64_t> active_connections{0};
     
     // Non-copyable due to atomics
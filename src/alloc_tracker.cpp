@@ -0,0 +1,315 @@
+#include "alloc_tracker.h"
+#include <atomic>
+#include <cstdlib>
+#include <cstring>
+#include <new>
+#include <string>
+#include <vector>
+#include <algorithm>
+#include <sstream>
+#include <iomanip>
+
+#ifdef DPI_ALLOC_CHECK
+#if defined(__linux__) || defined(__APPLE__)
+#include <dlfcn.h>
+#include <cxxabi.h>
+#define DPI_ALLOC_SYMBOLIZE 1
+#endif
+#endif
+
+namespace DPI {
+
+namespace {
+
+std::atomic<bool> g_enabled{false};
+std::atomic<uint64_t> g_warmup{0};
+
+#ifdef DPI_ALLOC_CHECK
+
+struct Site {
+    void* caller = nullptr;
+    uint64_t count = 0;
+    uint64_t bytes = 0;
+};
+
+// One per attached thread, written only by that thread
+struct ThreadSlot {
+    char name[24] = {};
+    bool checked = false;
+    bool steady = false;
+    uint64_t packets = 0;
+    uint64_t steady_packets = 0;
+    uint64_t warmup_allocs = 0;
+    uint64_t steady_allocs = 0;
+    uint64_t steady_bytes = 0;
+    uint64_t steady_frees = 0;
+    uint64_t unattributed = 0;              // Site table full
+    Site sites[ALLOC_MAX_SITES];
+};
+
+ThreadSlot g_slots[ALLOC_MAX_THREADS];
+std::atomic<size_t> g_num_slots{0};
+
+thread_local ThreadSlot* t_slot = nullptr;
+
+// "symbol+0x1a (module)" or "module+0x1234" without symbols
+std::string describeCaller(void* caller) {
+    std::ostringstream out;
+#ifdef DPI_ALLOC_SYMBOLIZE
+    Dl_info info;
+    if (dladdr(caller, &info) && info.dli_fname) {
+        const char* module = std::strrchr(info.dli_fname, '/');
+        module = module ? module + 1 : info.dli_fname;
+        if (info.dli_sname) {
+            int status = 0;
+            char* demangled = abi::__cxa_demangle(info.dli_sname, nullptr, nullptr, &status);
+            out << (status == 0 && demangled ? demangled : info.dli_sname) << "+0x" << std::hex
+                << (static_cast<char*>(caller) - static_cast<char*>(info.dli_saddr))
+                << std::dec << " (" << module << ")";
+            std::free(demangled);
+        } else {
+            out << module << "+0x" << std::hex
+                << (static_cast<char*>(caller) - static_cast<char*>(info.dli_fbase));
+        }
+        return out.str();
+    }
+#endif
+    out << caller;
+    return out.str();
+}
+
+#endif // DPI_ALLOC_CHECK
+
+} // anonymous namespace
+
+void AllocTracker::enable(uint64_t warmup_packets) {
+    g_warmup.store(warmup_packets, std::memory_order_relaxed);
+    g_enabled.store(true, std::memory_order_release);
+}
+
+#ifdef DPI_ALLOC_CHECK
+
+void AllocTracker::attachThread(const char* name, bool checked) {
+    if (!g_enabled.load(std::memory_order_acquire) || t_slot) return;
+
+    size_t index = g_num_slots.fetch_add(1, std::memory_order_relaxed);
+    if (index >= ALLOC_MAX_THREADS) return;
+
+    ThreadSlot& slot = g_slots[index];
+    std::strncpy(slot.name, name, sizeof(slot.name) - 1);
+    slot.checked = checked;
+    t_slot = &slot;
+}
+
+void AllocTracker::notePacket() {
+    ThreadSlot* slot = t_slot;
+    if (!slot) return;
+
+    // Allocations from the next packet on count as steady state
+    if (++slot->packets > g_warmup.load(std::memory_order_relaxed)) {
+        slot->steady = true;
+        slot->steady_packets++;
+    }
+}
+
+void AllocTracker::recordAllocation(void* caller, size_t size) {
+    ThreadSlot* slot = t_slot;
+    if (!slot || !g_enabled.load(std::memory_order_relaxed)) return;
+
+    if (!slot->steady) {
+        slot->warmup_allocs++;
+        return;
+    }
+    slot->steady_allocs++;
+    slot->steady_bytes += size;
+
+    // Open addressing on the return address
+    size_t index = (reinterpret_cast<uintptr_t>(caller) >> 2) * 0x9E3779B97F4A7C15ULL >> 56;
+    for (size_t probe = 0; probe < ALLOC_MAX_SITES; probe++) {
+        Site& site = slot->sites[(index + probe) % ALLOC_MAX_SITES];
+        if (site.caller == caller || site.caller == nullptr) {
+            site.caller = caller;
+            site.count++;
+            site.bytes += size;
+            return;
+        }
+    }
+    slot->unattributed++;
+}
+
+void AllocTracker::recordFree() {
+    ThreadSlot* slot = t_slot;
+    if (slot && slot->steady && g_enabled.load(std::memory_order_relaxed)) {
+        slot->steady_frees++;
+    }
+}
+
+bool AllocTracker::report(std::ostream& out) {
+    // Reporting allocates; stop counting first
+    g_enabled.store(false, std::memory_order_release);
+    size_t num_slots = std::min(g_num_slots.load(), ALLOC_MAX_THREADS);
+
+    out << "\n╔══════════════════════════════════════════════════════════════╗\n";
+    out << "║                  ALLOCATION CHECK                             ║\n";
+    out << "╠══════════════════════════════════════════════════════════════╣\n";
+    out << "║ Thread     Steady Pkts     Allocs   Allocs/Pkt        Bytes   ║\n";
+
+    bool clean = true;
+    uint64_t checked_packets = 0;
+    std::vector<Site> merged;
+
+    for (size_t i = 0; i < num_slots; i++) {
+        const ThreadSlot& slot = g_slots[i];
+        double per_packet = slot.steady_packets
+                                ? static_cast<double>(slot.steady_allocs) / slot.steady_packets : 0.0;
+
+        std::ostringstream row;
+        row << std::left << std::setw(8) << slot.name << (slot.checked ? " " : "*") << std::right
+            << std::setw(13) << slot.steady_packets << std::setw(11) << slot.steady_allocs
+            << std::setw(13) << std::fixed << std::setprecision(3) << per_packet
+            << std::setw(13) << slot.steady_bytes;
+        out << "║ " << std::left << std::setw(62) << row.str() << std::right << "║\n";
+
+        if (!slot.checked) continue;
+        checked_packets += slot.steady_packets;
+        if (slot.steady_allocs > 0) clean = false;
+
+        for (const Site& site : slot.sites) {
+            if (!site.caller) continue;
+            auto it = std::find_if(merged.begin(), merged.end(),
+                                   [&](const Site& s) { return s.caller == site.caller; });
+            if (it == merged.end()) {
+                merged.push_back(site);
+            } else {
+                it->count += site.count;
+                it->bytes += site.bytes;
+            }
+        }
+    }
+
+    out << "╠══════════════════════════════════════════════════════════════╣\n";
+    out << "║ Warm-up: " << std::left << std::setw(12) << g_warmup.load() << std::right
+        << " packets per thread  (* = not checked)   ║\n";
+    out << "║ Result:  " << std::left << std::setw(53)
+        << (clean ? "PASS - no steady-state allocations in LB/FP threads" : "FAIL")
+        << std::right << "║\n";
+    out << "╚══════════════════════════════════════════════════════════════╝\n";
+
+    if (!merged.empty()) {
+        std::sort(merged.begin(), merged.end(),
+                  [](const Site& a, const Site& b) { return a.count > b.count; });
+        out << "\n[AllocCheck] Steady-state allocation sites in LB/FP threads:\n";
+        for (size_t i = 0; i < merged.size() && i < 20; i++) {
+            double per_packet = checked_packets
+                                    ? static_cast<double>(merged[i].count) / checked_packets : 0.0;
+            out << "  " << std::setw(10) << merged[i].count << " allocs  "
+                << std::fixed << std::setprecision(4) << std::setw(8) << per_packet << "/pkt  "
+                << std::setw(10) << merged[i].bytes << " B  " << describeCaller(merged[i].caller) << "\n";
+        }
+    }
+    return clean;
+}
+
+#else
+
+bool AllocTracker::report(std::ostream& out) {
+    out << "[AllocCheck] Not compiled in (rebuild with -DDPI_ALLOC_CHECK)\n";
+    return false;
+}
+
+#endif // DPI_ALLOC_CHECK
+
+} // namespace DPI
+
+// ============================================================================
+// Allocator interposition (instrumented builds only)
+// ============================================================================
+//
+// operator new records its own caller, so it goes to the raw allocator
+// directly instead of through the interposed malloc (which would only ever
+// see operator new as the call site).
+
+#ifdef DPI_ALLOC_CHECK
+
+#if defined(__GLIBC__)
+extern "C" {
+void* __libc_malloc(size_t size);
+void* __libc_calloc(size_t count, size_t size);
+void* __libc_realloc(void* ptr, size_t size);
+void __libc_free(void* ptr);
+}
+#define DPI_RAW_MALLOC(n) __libc_malloc(n)
+#define DPI_RAW_FREE(p) __libc_free(p)
+
+extern "C" void* malloc(size_t size) {
+    void* ptr = __libc_malloc(size);
+    DPI::AllocTracker::recordAllocation(__builtin_return_address(0), size);
+    return ptr;
+}
+
+extern "C" void* calloc(size_t count, size_t size) {
+    void* ptr = __libc_calloc(count, size);
+    DPI::AllocTracker::recordAllocation(__builtin_return_address(0), count * size);
+    return ptr;
+}
+
+extern "C" void* realloc(void* ptr, size_t size) {
+    void* result = __libc_realloc(ptr, size);
+    if (size > 0) {
+        DPI::AllocTracker::recordAllocation(__builtin_return_address(0), size);
+    }
+    return result;
+}
+
+extern "C" void free(void* ptr) {
+    if (ptr) DPI::AllocTracker::recordFree();
+    __libc_free(ptr);
+}
+#else
+#define DPI_RAW_MALLOC(n) std::malloc(n)
+#define DPI_RAW_FREE(p) std::free(p)
+#endif
+
+namespace {
+
+inline void* trackedNew(std::size_t size, void* caller) {
+    void* ptr = DPI_RAW_MALLOC(size ? size : 1);
+    if (ptr) DPI::AllocTracker::recordAllocation(caller, size);
+    return ptr;
+}
+
+inline void trackedDelete(void* ptr) {
+    if (ptr) DPI::AllocTracker::recordFree();
+    DPI_RAW_FREE(ptr);
+}
+
+} // anonymous namespace
+
+void* operator new(std::size_t size) {
+    void* ptr = trackedNew(size, __builtin_return_address(0));
+    if (!ptr) throw std::bad_alloc();
+    return ptr;
+}
+
+void* operator new[](std::size_t size) {
+    void* ptr = trackedNew(size, __builtin_return_address(0));
+    if (!ptr) throw std::bad_alloc();
+    return ptr;
+}
+
+void* operator new(std::size_t size, const std::nothrow_t&) noexcept {
+    return trackedNew(size, __builtin_return_address(0));
+}
+
+void* operator new[](std::size_t size, const std::nothrow_t&) noexcept {
+    return trackedNew(size, __builtin_return_address(0));
+}
+
+void operator delete(void* ptr) noexcept { trackedDelete(ptr); }
+void operator delete[](void* ptr) noexcept { trackedDelete(ptr); }
+void operator delete(void* ptr, std::size_t) noexcept { trackedDelete(ptr); }
+void operator delete[](void* ptr, std::size_t) noexcept { trackedDelete(ptr); }
+void operator delete(void* ptr, const std::nothrow_t&) noexcept { trackedDelete(ptr); }
+void operator delete[](void* ptr, const std::nothrow_t&) noexcept { trackedDelete(ptr); }
+
+#endif // DPI_ALLOC_CHECK
@@ -0,0 +1,84 @@
+#include "app_timeseries.h"
+#include <algorithm>
+#include <numeric>
+
+namespace DPI {
+
+void AppTimeSeries::advance(uint64_t bucket, uint64_t current) {
+    // Reset every slot from the old head to the new one; after a gap longer
+    // than the ring (or on the first packet) that is the whole ring
+    uint64_t oldest = bucket >= TIMESERIES_BUCKETS ? bucket - TIMESERIES_BUCKETS + 1 : 0;
+    uint64_t from = current == NO_BUCKET ? oldest : std::max(current + 1, oldest);
+
+    for (uint64_t b = from; b <= bucket; b++) {
+        Slot& slot = slots_[b % TIMESERIES_BUCKETS];
+        slot.epoch.store(NO_BUCKET, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_release);
+        for (size_t app = 0; app < TIMESERIES_APPS; app++) {
+            slot.bytes[app].store(0, std::memory_order_relaxed);
+            slot.packets[app].store(0, std::memory_order_relaxed);
+        }
+        slot.epoch.store(b, std::memory_order_release);
+    }
+    current_.store(bucket, std::memory_order_release);
+}
+
+AppTimeSeriesSnapshot AppTimeSeries::merge(const std::vector<const AppTimeSeries*>& series) {
+    AppTimeSeriesSnapshot snapshot;
+
+    // The window ends at the newest bucket any FP has reached
+    uint64_t newest = NO_BUCKET;
+    for (const AppTimeSeries* s : series) {
+        if (!s || !s->isEnabled()) continue;
+        snapshot.bucket_seconds = s->bucket_seconds_;
+        snapshot.late_packets += s->late_.load(std::memory_order_relaxed);
+
+        uint64_t current = s->current_.load(std::memory_order_acquire);
+        if (current != NO_BUCKET && (newest == NO_BUCKET || current > newest)) {
+            newest = current;
+        }
+    }
+    if (newest == NO_BUCKET) return snapshot;
+
+    uint64_t oldest = newest >= TIMESERIES_BUCKETS ? newest - TIMESERIES_BUCKETS + 1 : 0;
+    snapshot.buckets.resize(newest - oldest + 1);
+    for (size_t i = 0; i < snapshot.buckets.size(); i++) {
+        snapshot.buckets[i].start_sec = (oldest + i) * snapshot.bucket_seconds;
+    }
+
+    for (const AppTimeSeries* s : series) {
+        if (!s || !s->isEnabled()) continue;
+
+        for (uint64_t b = oldest; b <= newest; b++) {
+            const Slot& slot = s->slots_[b % TIMESERIES_BUCKETS];
+            if (slot.epoch.load(std::memory_order_acquire) != b) continue;
+
+            AppTimeBucket copy;
+            for (size_t app = 0; app < TIMESERIES_APPS; app++) {
+                copy.bytes[app] = slot.bytes[app].load(std::memory_order_relaxed);
+                copy.packets[app] = slot.packets[app].load(std::memory_order_relaxed);
+            }
+
+            // Reused while we read it: the bucket has left this FP's window
+            std::atomic_thread_fence(std::memory_order_acquire);
+            if (slot.epoch.load(std::memory_order_relaxed) != b) continue;
+
+            AppTimeBucket& merged = snapshot.buckets[b - oldest];
+            for (size_t app = 0; app < TIMESERIES_APPS; app++) {
+                merged.bytes[app] += copy.bytes[app];
+                merged.packets[app] += copy.packets[app];
+            }
+        }
+    }
+
+    // Start at the first bucket with traffic (short runs fill few buckets)
+    auto first = std::find_if(snapshot.buckets.begin(), snapshot.buckets.end(),
+                              [](const AppTimeBucket& bucket) {
+                                  return std::accumulate(bucket.packets.begin(),
+                                                         bucket.packets.end(), uint64_t{0}) > 0;
+                              });
+    snapshot.buckets.erase(snapshot.buckets.begin(), first);
+    return snapshot;
+}
+
+} // namespace DPI
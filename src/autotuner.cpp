@@ -0,0 +1,526 @@
+#include "autotuner.h"
+#include "pcap_reader.h"
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <iomanip>
+#include <cstring>
+#include <cstdio>
+#include <random>
+#include <thread>
+#include <filesystem>
+
+namespace DPI {
+
+namespace {
+
+// Candidate values per phase
+const size_t BURST_SIZES[] = {1, 8, 32, 64};
+const size_t QUEUE_SIZES[] = {256, 1024, 4096, 16384};
+const int LB_COUNTS[] = {1, 2, 4};
+const int FP_COUNTS[] = {1, 2, 3, 4, 6, 8, 12, 16};
+
+// Throughputs this close count as equal (lower latency decides)
+constexpr double MPPS_TIE = 0.05;
+
+unsigned coreCount() {
+    unsigned cores = std::thread::hardware_concurrency();
+    return cores > 0 ? cores : 4;
+}
+
+void put16(uint8_t* p, uint16_t v) {
+    p[0] = v >> 8;
+    p[1] = v & 0xFF;
+}
+
+void put32(uint8_t* p, uint32_t v) {
+    put16(p, v >> 16);
+    put16(p + 2, v & 0xFFFF);
+}
+
+// Ethernet + IPv4 + TCP/UDP frame; the IP checksum is filled in, L4 left 0
+std::vector<uint8_t> buildFrame(uint32_t src_ip, uint32_t dst_ip, uint8_t protocol,
+                                uint16_t src_port, uint16_t dst_port,
+                                uint8_t tcp_flags, uint32_t seq, uint32_t ack,
+                                const uint8_t* payload, size_t payload_length) {
+    size_t l4_length = protocol == 6 ? 20 : 8;
+    std::vector<uint8_t> frame(14 + 20 + l4_length + payload_length, 0);
+
+    // Locally administered MACs, EtherType IPv4
+    frame[0] = 0x02;
+    frame[5] = 0x01;
+    frame[6] = 0x02;
+    frame[11] = 0x02;
+    put16(&frame[12], 0x0800);
+
+    uint8_t* ip = &frame[14];
+    ip[0] = 0x45;
+    put16(ip + 2, static_cast<uint16_t>(20 + l4_length + payload_length));
+    put16(ip + 6, 0x4000);
+    ip[8] = 64;
+    ip[9] = protocol;
+    put32(ip + 12, src_ip);
+    put32(ip + 16, dst_ip);
+
+    uint32_t sum = 0;
+    for (int i = 0; i < 20; i += 2) sum += (ip[i] << 8) | ip[i + 1];
+    while (sum >> 16) sum = (sum & 0xFFFF) + (sum >> 16);
+    put16(ip + 10, static_cast<uint16_t>(~sum));
+
+    uint8_t* l4 = ip + 20;
+    put16(l4, src_port);
+    put16(l4 + 2, dst_port);
+    if (protocol == 6) {
+        put32(l4 + 4, seq);
+        put32(l4 + 8, ack);
+        l4[12] = 0x50;
+        l4[13] = tcp_flags;
+        put16(l4 + 14, 65535);
+    } else {
+        put16(l4 + 4, static_cast<uint16_t>(8 + payload_length));
+    }
+
+    if (payload_length > 0) {
+        std::memcpy(l4 + l4_length, payload, payload_length);
+    }
+    return frame;
+}
+
+// TLS ClientHello record with an SNI and a supported_versions extension
+std::vector<uint8_t> buildClientHello(const std::string& sni, std::mt19937& rng) {
+    std::vector<uint8_t> body = {0x03, 0x03};
+    for (int i = 0; i < 32; i++) body.push_back(static_cast<uint8_t>(rng()));
+    body.push_back(0);                                      // Session ID
+    body.insert(body.end(), {0x00, 0x04, 0x13, 0x01, 0x13, 0x02});  // Cipher suites
+    body.insert(body.end(), {0x01, 0x00});                  // Compression
+
+    std::vector<uint8_t> ext;
+    uint16_t name_len = static_cast<uint16_t>(sni.size());
+    ext.insert(ext.end(), {0x00, 0x00});                    // server_name
+    ext.push_back((name_len + 5) >> 8);
+    ext.push_back((name_len + 5) & 0xFF);
+    ext.push_back((name_len + 3) >> 8);
+    ext.push_back((name_len + 3) & 0xFF);
+    ext.push_back(0);                                       // host_name
+    ext.push_back(name_len >> 8);
+    ext.push_back(name_len & 0xFF);
+    ext.insert(ext.end(), sni.begin(), sni.end());
+    ext.insert(ext.end(), {0x00, 0x2b, 0x00, 0x03, 0x02, 0x03, 0x04});  // supported_versions
+
+    body.push_back(static_cast<uint8_t>(ext.size() >> 8));
+    body.push_back(static_cast<uint8_t>(ext.size() & 0xFF));
+    body.insert(body.end(), ext.begin(), ext.end());
+
+    std::vector<uint8_t> record = {0x16, 0x03, 0x01, 0, 0, 0x01, 0, 0, 0};
+    put16(&record[3], static_cast<uint16_t>(body.size() + 4));
+    record[6] = static_cast<uint8_t>(body.size() >> 16);
+    put16(&record[7], static_cast<uint16_t>(body.size() & 0xFFFF));
+    record.insert(record.end(), body.begin(), body.end());
+    return record;
+}
+
+// DNS A query for name; as_response adds one answer
+std::vector<uint8_t> buildDns(const std::string& name, uint16_t id, bool as_response) {
+    std::vector<uint8_t> msg(12, 0);
+    put16(&msg[0], id);
+    put16(&msg[2], as_response ? 0x8180 : 0x0100);
+    put16(&msg[4], 1);
+    put16(&msg[6], as_response ? 1 : 0);
+
+    size_t start = 0;
+    while (start <= name.size()) {
+        size_t dot = name.find('.', start);
+        if (dot == std::string::npos) dot = name.size();
+        msg.push_back(static_cast<uint8_t>(dot - start));
+        msg.insert(msg.end(), name.begin() + start, name.begin() + dot);
+        start = dot + 1;
+    }
+    msg.insert(msg.end(), {0x00, 0x00, 0x01, 0x00, 0x01});
+
+    if (as_response) {
+        msg.insert(msg.end(), {0xC0, 0x0C, 0x00, 0x01, 0x00, 0x01,
+                               0x00, 0x00, 0x01, 0x2C, 0x00, 0x04, 93, 184, 216, 34});
+    }
+    return msg;
+}
+
+// Packets of one synthetic flow, in order
+std::vector<std::vector<uint8_t>> buildFlow(uint32_t flow, std::mt19937& rng,
+                                            const std::vector<uint8_t>& bulk) {
+    static const char* DOMAINS[] = {
+        "www.google.com", "www.youtube.com", "www.facebook.com", "www.netflix.com",
+        "github.com", "zoom.us", "open.spotify.com", "discord.com",
+        "api.example.net", "cdn.example.org",
+    };
+    const std::string domain = DOMAINS[flow % (sizeof(DOMAINS) / sizeof(DOMAINS[0]))];
+
+    uint32_t client = 0x0A000000 | (flow & 0xFFFFFF);
+    uint16_t client_port = static_cast<uint16_t>(1024 + flow % 60000);
+    std::vector<std::vector<uint8_t>> packets;
+
+    // One flow in five is a DNS lookup
+    if (flow % 5 == 4) {
+        uint32_t resolver = 0x08080808;
+        uint16_t id = static_cast<uint16_t>(flow);
+        auto query = buildDns(domain, id, false);
+        auto answer = buildDns(domain, id, true);
+        packets.push_back(buildFrame(client, resolver, 17, client_port, 53, 0, 0, 0,
+                                     query.data(), query.size()));
+        packets.push_back(buildFrame(resolver, client, 17, 53, client_port, 0, 0, 0,
+                                     answer.data(), answer.size()));
+        return packets;
+    }
+
+    // TLS: handshake, ClientHello, server data, ACK, FIN
+    uint32_t server = 0x5DB80000 | (flow % 4096);
+    uint32_t cseq = 1000, sseq = 5000;
+    auto hello = buildClientHello(domain, rng);
+
+    packets.push_back(buildFrame(client, server, 6, client_port, 443, 0x02, cseq, 0, nullptr, 0));
+    packets.push_back(buildFrame(server, client, 6, 443, client_port, 0x12, sseq, cseq + 1, nullptr, 0));
+    cseq++;
+    sseq++;
+    packets.push_back(buildFrame(client, server, 6, client_port, 443, 0x10, cseq, sseq, nullptr, 0));
+    packets.push_back(buildFrame(client, server, 6, client_port, 443, 0x18, cseq, sseq,
+                                 hello.data(), hello.size()));
+    cseq += static_cast<uint32_t>(hello.size());
+
+    for (int i = 0; i < 4; i++) {
+        packets.push_back(buildFrame(server, client, 6, 443, client_port, 0x10, sseq, cseq,
+                                     bulk.data(), bulk.size()));
+        sseq += static_cast<uint32_t>(bulk.size());
+    }
+    packets.push_back(buildFrame(client, server, 6, client_port, 443, 0x10, cseq, sseq, nullptr, 0));
+    packets.push_back(buildFrame(client, server, 6, client_port, 443, 0x11, cseq, sseq, nullptr, 0));
+    return packets;
+}
+
+void writeGlobalHeader(std::ofstream& out, uint32_t network) {
+    PacketAnalyzer::PcapGlobalHeader header = {0xa1b2c3d4, 2, 4, 0, 0, 65535, network};
+    out.write(reinterpret_cast<const char*>(&header), sizeof(header));
+}
+
+void writePacket(std::ofstream& out, const PacketAnalyzer::PcapPacketHeader& header,
+                 const uint8_t* data) {
+    out.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    out.write(reinterpret_cast<const char*>(data), header.incl_len);
+}
+
+std::string describe(const TuningCandidate& c) {
+    std::ostringstream ss;
+    ss << c.num_load_balancers << "x" << std::left << std::setw(3) << c.fps_per_lb
+       << std::right << " burst " << std::setw(3) << c.burst_size
+       << "  queue " << std::setw(6) << c.queue_size;
+    return ss.str();
+}
+
+} // anonymous namespace
+
+// ============================================================================
+// Autotuner Implementation
+// ============================================================================
+
+Autotuner::Autotuner(const DPIEngine::Config& base) : base_(base) {
+    std::random_device rd;
+    auto dir = std::filesystem::temp_directory_path();
+    std::string tag = "dpi_autotune_" + std::to_string(rd());
+    sample_path_ = (dir / (tag + "_sample.pcap")).string();
+    output_path_ = (dir / (tag + "_out.pcap")).string();
+    drops_path_ = (dir / (tag + "_drops.pcapng")).string();
+}
+
+Autotuner::~Autotuner() {
+    std::remove(sample_path_.c_str());
+    std::remove(output_path_.c_str());
+    std::remove(drops_path_.c_str());
+}
+
+void Autotuner::setRules(const std::string& rules_file,
+                         const std::vector<std::string>& block_ips,
+                         const std::vector<std::string>& block_apps,
+                         const std::vector<std::string>& block_domains) {
+    rules_file_ = rules_file;
+    block_ips_ = block_ips;
+    block_apps_ = block_apps;
+    block_domains_ = block_domains;
+}
+
+bool Autotuner::sampleCapture(const std::string& input_file, size_t max_packets) {
+    PacketAnalyzer::PcapReader reader;
+    if (!reader.open(input_file)) {
+        std::cerr << "[Autotune] Cannot open " << input_file << "\n";
+        return false;
+    }
+
+    std::ofstream out(sample_path_, std::ios::binary);
+    if (!out.is_open()) {
+        std::cerr << "[Autotune] Cannot write " << sample_path_ << "\n";
+        return false;
+    }
+    writeGlobalHeader(out, reader.getGlobalHeader().network);
+
+    PacketAnalyzer::RawPacket raw;
+    sample_packets_ = 0;
+    while (sample_packets_ < max_packets && reader.readNextPacket(raw)) {
+        writePacket(out, raw.header, raw.data.data());
+        sample_packets_++;
+    }
+
+    std::cout << "[Autotune] Calibrating on the first " << sample_packets_ << " packets of "
+              << input_file << "\n";
+    return sample_packets_ > 0 && out.good();
+}
+
+bool Autotuner::generateSynthetic(size_t packets) {
+    uint32_t flows = 0;
+    if (!writeSynthetic(sample_path_, packets, &flows)) return false;
+    sample_packets_ = packets;
+
+    std::cout << "[Autotune] Calibrating on " << sample_packets_ << " synthetic packets ("
+              << flows << " flows)\n";
+    return true;
+}
+
+bool Autotuner::writeSynthetic(const std::string& path, size_t packets, uint32_t* flows) {
+    std::ofstream out(path, std::ios::binary);
+    if (!out.is_open()) {
+        std::cerr << "[Autotune] Cannot write " << path << "\n";
+        return false;
+    }
+    writeGlobalHeader(out, 1);
+
+    std::mt19937 rng(7);
+    std::vector<uint8_t> bulk(1200);
+    for (auto& b : bulk) b = static_cast<uint8_t>(rng());
+
+    // Flows are interleaved in groups, like concurrent connections on a link
+    constexpr uint32_t CONCURRENT_FLOWS = 64;
+    PacketAnalyzer::PcapPacketHeader header = {1700000000, 0, 0, 0};
+    uint32_t next_flow = 0;
+    size_t written = 0;
+
+    while (written < packets) {
+        std::vector<std::vector<std::vector<uint8_t>>> group;
+        for (uint32_t i = 0; i < CONCURRENT_FLOWS; i++) {
+            group.push_back(buildFlow(next_flow++, rng, bulk));
+        }
+
+        for (size_t step = 0; written < packets; step++) {
+            bool any = false;
+            for (const auto& flow : group) {
+                if (step >= flow.size() || written >= packets) continue;
+                header.incl_len = header.orig_len = static_cast<uint32_t>(flow[step].size());
+                writePacket(out, header, flow[step].data());
+                written++;
+                any = true;
+
+                if (++header.ts_usec == 1000000) {
+                    header.ts_usec = 0;
+                    header.ts_sec++;
+                }
+            }
+            if (!any) break;
+        }
+    }
+
+    if (flows) *flows = next_flow;
+    return out.good();
+}
+
+DPIEngine::Config Autotuner::run() {
+    results_.clear();
+    unsigned cores = coreCount();
+    std::cout << "[Autotune] " << cores << " cores; one pass per candidate\n";
+
+    // Start from the given settings
+    best_ = {base_.num_load_balancers, base_.fps_per_lb, base_.burst_size, base_.queue_size};
+    best_ = measure(best_);
+
+    // Phase 1: LB x FP layouts that fit the machine (the reader and output
+    // threads need cores too, but small machines still get a few to try)
+    std::vector<TuningCandidate> candidates;
+    int budget = static_cast<int>(std::max(cores, 4u));
+    for (int lbs : LB_COUNTS) {
+        for (int fps : FP_COUNTS) {
+            if (lbs > fps || lbs * fps > budget) continue;
+            if (lbs == best_.num_load_balancers && fps == best_.fps_per_lb) continue;
+            candidates.push_back({lbs, fps, best_.burst_size, best_.queue_size});
+        }
+    }
+    sweep("topology", candidates);
+
+    // Phase 2: burst size on the best layout
+    candidates.clear();
+    for (size_t burst : BURST_SIZES) {
+        if (burst == best_.burst_size) continue;
+        candidates.push_back({best_.num_load_balancers, best_.fps_per_lb, burst, best_.queue_size});
+    }
+    sweep("burst", candidates);
+
+    // Phase 3: queue depth
+    candidates.clear();
+    for (size_t depth : QUEUE_SIZES) {
+        if (depth == best_.queue_size) continue;
+        candidates.push_back({best_.num_load_balancers, best_.fps_per_lb, best_.burst_size, depth});
+    }
+    sweep("queue", candidates);
+
+    std::cout << "[Autotune] Best: " << describe(best_) << "  " << std::fixed
+              << std::setprecision(2) << best_.mpps << " Mpps, p99 "
+              << best_.latency_p99_ns / 1000 << " us\n";
+
+    DPIEngine::Config tuned = base_;
+    apply(best_, tuned);
+    return tuned;
+}
+
+void Autotuner::sweep(const char* phase, const std::vector<TuningCandidate>& candidates) {
+    for (const auto& candidate : candidates) {
+        TuningCandidate measured = measure(candidate);
+        if (measured.ok && better(measured, best_)) {
+            best_ = measured;
+        }
+    }
+    std::cout << "[Autotune] After " << phase << ": " << describe(best_) << "\n";
+}
+
+TuningCandidate Autotuner::measure(TuningCandidate candidate) {
+    DPIEngine::Config config = base_;
+    apply(candidate, config);
+    config.measure_latency = true;
+    config.alloc_check_warmup = 0;
+    config.verbose = false;
+
+    // Calibration runs write nothing anyone keeps (but still pay for writing it)
+    if (!config.drop_capture_file.empty()) {
+        config.drop_capture_file = drops_path_;
+    }
+
+    // The engine reports to std::cout; keep the passes quiet
+    std::streambuf* saved = std::cout.rdbuf(nullptr);
+    DPIEngine::RunMetrics metrics = {};
+    {
+        // Same rules as the real run (see main_dpi.cpp)
+        DPIEngine engine(config);
+        candidate.ok = engine.initialize();
+        if (candidate.ok) {
+            if (!rules_file_.empty()) engine.loadRules(rules_file_);
+            for (const auto& ip : block_ips_) engine.blockIP(ip);
+            for (const auto& app : block_apps_) engine.blockApp(app);
+            for (const auto& domain : block_domains_) engine.blockDomain(domain);
+
+            candidate.ok = engine.processFile(sample_path_, output_path_);
+        }
+        metrics = engine.getRunMetrics();
+    }
+    std::cout.rdbuf(saved);
+
+    candidate.ok = candidate.ok && metrics.packets > 0 && metrics.seconds > 0;
+    candidate.mpps = metrics.mpps;
+    candidate.latency_p99_ns = metrics.latency_p99_ns;
+    results_.push_back(candidate);
+
+    std::cout << "[Autotune]   " << describe(candidate);
+    if (candidate.ok) {
+        std::cout << std::fixed << std::setprecision(2) << std::setw(8) << candidate.mpps
+                  << " Mpps  p99 " << std::setw(8) << candidate.latency_p99_ns / 1000 << " us\n";
+    } else {
+        std::cout << "  failed\n";
+    }
+    return candidate;
+}
+
+bool Autotuner::better(const TuningCandidate& a, const TuningCandidate& b) {
+    if (!b.ok) return a.ok;
+    if (a.mpps > b.mpps * (1.0 + MPPS_TIE)) return true;
+    if (a.mpps < b.mpps * (1.0 - MPPS_TIE)) return false;
+    return a.latency_p99_ns < b.latency_p99_ns;
+}
+
+void Autotuner::apply(const TuningCandidate& candidate, DPIEngine::Config& config) {
+    config.num_load_balancers = candidate.num_load_balancers;
+    config.fps_per_lb = candidate.fps_per_lb;
+    config.burst_size = candidate.burst_size;
+    config.queue_size = candidate.queue_size;
+}
+
+bool Autotuner::save(const std::string& path, const DPIEngine::Config& config,
+                     const TuningCandidate& measured, const std::string& source) {
+    std::ofstream out(path);
+    if (!out.is_open()) {
+        std::cerr << "[Autotune] Cannot write " << path << "\n";
+        return false;
+    }
+
+    out << "# DPI engine tuning (written by --autotune; load with --tuning)\n";
+    out << "# Calibrated on " << source << ": " << std::fixed << std::setprecision(2)
+        << measured.mpps << " Mpps, p99 " << measured.latency_p99_ns / 1000 << " us\n";
+    out << "cores = " << coreCount() << "\n";
+    out << "lbs = " << config.num_load_balancers << "\n";
+    out << "fps_per_lb = " << config.fps_per_lb << "\n";
+    out << "burst = " << config.burst_size << "\n";
+    out << "queue_size = " << config.queue_size << "\n";
+
+    std::cout << "[Autotune] Wrote " << path << "\n";
+    return out.good();
+}
+
+bool Autotuner::load(const std::string& path, DPIEngine::Config& config) {
+    std::ifstream in(path);
+    if (!in.is_open()) {
+        std::cerr << "[Autotune] Cannot open tuning file: " << path << "\n";
+        return false;
+    }
+
+    DPIEngine::Config tuned = config;
+    unsigned tuned_cores = 0;
+    std::string line;
+    int line_number = 0;
+
+    while (std::getline(in, line)) {
+        line_number++;
+        size_t hash = line.find('#');
+        if (hash != std::string::npos) line.erase(hash);
+
+        size_t eq = line.find('=');
+        std::istringstream key_stream(line.substr(0, eq));
+        std::string key;
+        if (!(key_stream >> key)) continue;  // Blank or comment
+
+        long long value = -1;
+        if (eq != std::string::npos) {
+            std::istringstream value_stream(line.substr(eq + 1));
+            value_stream >> value;
+        }
+        if (value <= 0) {
+            std::cerr << "[Autotune] " << path << ":" << line_number << ": bad value for " << key << "\n";
+            return false;
+        }
+
+        if (key == "lbs") {
+            tuned.num_load_balancers = static_cast<int>(value);
+        } else if (key == "fps_per_lb") {
+            tuned.fps_per_lb = static_cast<int>(value);
+        } else if (key == "burst") {
+            tuned.burst_size = static_cast<size_t>(value);
+        } else if (key == "queue_size") {
+            tuned.queue_size = static_cast<size_t>(value);
+        } else if (key == "cores") {
+            tuned_cores = static_cast<unsigned>(value);
+        } else {
+            std::cerr << "[Autotune] " << path << ":" << line_number << ": unknown key " << key << "\n";
+        }
+    }
+
+    config = tuned;
+    std::cout << "[Autotune] Loaded " << path << ": " << config.num_load_balancers << " LBs x "
+              << config.fps_per_lb << " FPs, burst " << config.burst_size << ", queue "
+              << config.queue_size << "\n";
+    if (tuned_cores != 0 && tuned_cores != coreCount()) {
+        std::cout << "[Autotune] Note: tuned on " << tuned_cores << " cores, this machine has "
+                  << coreCount() << " (re-run --autotune)\n";
+    }
+    return true;
+}
+
+} // namespace DPI
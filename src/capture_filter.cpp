@@ -0,0 +1,404 @@
+#include "capture_filter.h"
+#include <sstream>
+#include <iostream>
+#include <utility>
+
+namespace DPI {
+
+// ============================================================================
+// Compiler - recursive descent straight to jump code
+// ============================================================================
+//
+// Each parse function emits its instructions and returns the branches that
+// still need a target ("exits"). Operands are emitted in source order, so
+// "a and b" patches a's true exits to the first instruction of b, and
+// "a or b" patches a's false exits; "not" just swaps the two lists.
+
+class CaptureFilter::Compiler {
+public:
+    Compiler(const std::string& expression, std::vector<Instruction>& program)
+        : program_(program) {
+        tokenize(expression);
+    }
+
+    bool run(std::string& error) {
+        Exits exits;
+        bool ok = parseOr(exits);
+        if (ok && pos_ < tokens_.size()) {
+            ok = fail("unexpected '" + tokens_[pos_] + "'");
+        }
+        if (ok && program_.size() >= ACCEPT) {
+            ok = fail("expression too long");
+        }
+        if (!ok) {
+            error = error_;
+            return false;
+        }
+
+        patch(exits.on_true, ACCEPT);
+        patch(exits.on_false, REJECT);
+        return true;
+    }
+
+private:
+    // Unresolved branches: instruction index * 2 + (0 = true, 1 = false)
+    struct Exits {
+        std::vector<uint32_t> on_true;
+        std::vector<uint32_t> on_false;
+    };
+
+    enum Direction { DIR_EITHER, DIR_SRC, DIR_DST };
+
+    std::vector<Instruction>& program_;
+    std::vector<std::string> tokens_;
+    size_t pos_ = 0;
+    std::string error_;
+
+    void tokenize(const std::string& expression) {
+        std::string current;
+        auto flush = [&]() {
+            if (!current.empty()) tokens_.push_back(std::move(current));
+            current.clear();
+        };
+        for (char c : expression) {
+            if (c == ' ' || c == '\t' || c == '\n') {
+                flush();
+            } else if (c == '(' || c == ')' || (c == '!' && current.empty())) {
+                flush();
+                tokens_.push_back(std::string(1, c));
+            } else {
+                current += c;
+            }
+        }
+        flush();
+    }
+
+    bool fail(const std::string& message) {
+        if (error_.empty()) error_ = message;
+        return false;
+    }
+
+    const std::string& peek() const {
+        static const std::string end;
+        return pos_ < tokens_.size() ? tokens_[pos_] : end;
+    }
+
+    bool accept(const char* word) {
+        if (peek() == word) {
+            pos_++;
+            return true;
+        }
+        return false;
+    }
+
+    bool next(std::string& token, const char* what) {
+        if (pos_ >= tokens_.size()) return fail(std::string("expected ") + what);
+        token = tokens_[pos_++];
+        return true;
+    }
+
+    uint32_t pc() const { return static_cast<uint32_t>(program_.size()); }
+
+    void patch(const std::vector<uint32_t>& branches, uint32_t target) {
+        for (uint32_t branch : branches) {
+            Instruction& in = program_[branch / 2];
+            if (branch % 2 == 0) {
+                in.jump_true = static_cast<uint16_t>(target);
+            } else {
+                in.jump_false = static_cast<uint16_t>(target);
+            }
+        }
+    }
+
+    static void append(std::vector<uint32_t>& to, const std::vector<uint32_t>& from) {
+        to.insert(to.end(), from.begin(), from.end());
+    }
+
+    // ========== Expressions ==========
+
+    bool parseOr(Exits& out) {
+        if (!parseAnd(out)) return false;
+        while (accept("or") || accept("||")) {
+            patch(out.on_false, pc());
+            Exits rhs;
+            if (!parseAnd(rhs)) return false;
+            append(out.on_true, rhs.on_true);
+            out.on_false = std::move(rhs.on_false);
+        }
+        return true;
+    }
+
+    bool parseAnd(Exits& out) {
+        if (!parseUnary(out)) return false;
+        while (accept("and") || accept("&&")) {
+            patch(out.on_true, pc());
+            Exits rhs;
+            if (!parseUnary(rhs)) return false;
+            append(out.on_false, rhs.on_false);
+            out.on_true = std::move(rhs.on_true);
+        }
+        return true;
+    }
+
+    bool parseUnary(Exits& out) {
+        if (accept("not") || accept("!")) {
+            if (!parseUnary(out)) return false;
+            std::swap(out.on_true, out.on_false);
+            return true;
+        }
+        if (accept("(")) {
+            if (!parseOr(out)) return false;
+            return accept(")") || fail("expected ')'");
+        }
+        return parsePrimitive(out);
+    }
+
+    // ========== Primitives ==========
+
+    bool parsePrimitive(Exits& out) {
+        const std::string& word = peek();
+        if (word.empty()) return fail("expected a filter primitive");
+
+        // Protocol, optionally qualifying what follows ("tcp port 443")
+        uint32_t proto = 0;
+        bool is_ip = word == "ip";
+        if (word == "tcp") proto = 6;
+        else if (word == "udp") proto = 17;
+        else if (word == "icmp") proto = 1;
+
+        if (proto != 0 || is_ip) {
+            pos_++;
+            if (is_ip) {
+                emit(FIELD_IP_PROTO, OP_RANGE, 0, 0xFF, out);
+            } else {
+                emit(FIELD_IP_PROTO, OP_EQUAL, proto, 0xFFFFFFFF, out);
+            }
+
+            const std::string& qualified = peek();
+            if (qualified == "src" || qualified == "dst" || qualified == "host" ||
+                qualified == "net" || qualified == "port" || qualified == "portrange") {
+                patch(out.on_true, pc());
+                Exits rhs;
+                if (!parseQualified(rhs)) return false;
+                append(out.on_false, rhs.on_false);
+                out.on_true = std::move(rhs.on_true);
+            }
+            return true;
+        }
+
+        uint32_t value = 0;
+        std::string token;
+        if (accept("proto")) {
+            if (!next(token, "protocol number") || !parseNumber(token, 0xFF, value)) {
+                return fail("invalid protocol number");
+            }
+            emit(FIELD_IP_PROTO, OP_EQUAL, value, 0xFFFFFFFF, out);
+            return true;
+        }
+        if (accept("less")) {
+            if (!next(token, "length") || !parseNumber(token, 0xFFFFFFFF, value)) {
+                return fail("invalid length");
+            }
+            emit(FIELD_LENGTH, OP_RANGE, 0, value, out);
+            return true;
+        }
+        if (accept("greater")) {
+            if (!next(token, "length") || !parseNumber(token, 0xFFFFFFFF, value)) {
+                return fail("invalid length");
+            }
+            emit(FIELD_LENGTH, OP_RANGE, value, 0xFFFFFFFF, out);
+            return true;
+        }
+
+        return parseQualified(out);
+    }
+
+    // [src|dst] host|net|port|portrange <value>
+    bool parseQualified(Exits& out) {
+        Direction dir = DIR_EITHER;
+        if (accept("src")) dir = DIR_SRC;
+        else if (accept("dst")) dir = DIR_DST;
+
+        std::string kind;
+        std::string value;
+        if (!next(kind, "host, net, port or portrange")) {
+            return false;
+        }
+        if (kind != "host" && kind != "net" && kind != "port" && kind != "portrange") {
+            return fail("unknown primitive '" + kind + "'");
+        }
+        if (!next(value, "a value")) {
+            return false;
+        }
+
+        if (kind == "host") {
+            uint32_t addr = 0;
+            uint32_t prefix = 0;
+            if (!parseAddress(value, addr, prefix) || prefix != 32) {
+                return fail("invalid host address '" + value + "'");
+            }
+            emitDirected(dir, FIELD_SRC_IP, FIELD_DST_IP, OP_EQUAL, addr, 0xFFFFFFFF, out);
+            return true;
+        }
+
+        if (kind == "net") {
+            uint32_t addr = 0;
+            uint32_t prefix = 0;
+            size_t slash = value.find('/');
+            bool ok = parseAddress(value.substr(0, slash), addr, prefix);
+            if (ok && slash != std::string::npos) {
+                ok = parseNumber(value.substr(slash + 1), 32, prefix);
+            }
+            if (!ok) return fail("invalid network '" + value + "'");
+
+            uint32_t mask = prefix == 0 ? 0 : 0xFFFFFFFFu << (32 - prefix);
+            emitDirected(dir, FIELD_SRC_IP, FIELD_DST_IP, OP_EQUAL, addr & mask, mask, out);
+            return true;
+        }
+
+        if (kind == "port") {
+            uint32_t port = 0;
+            if (!parseNumber(value, 0xFFFF, port)) return fail("invalid port '" + value + "'");
+            emitDirected(dir, FIELD_SRC_PORT, FIELD_DST_PORT, OP_EQUAL, port, 0xFFFFFFFF, out);
+            return true;
+        }
+
+        // portrange
+        size_t dash = value.find('-');
+        uint32_t first = 0;
+        uint32_t last = 0;
+        if (dash == std::string::npos ||
+            !parseNumber(value.substr(0, dash), 0xFFFF, first) ||
+            !parseNumber(value.substr(dash + 1), 0xFFFF, last) || first > last) {
+            return fail("invalid port range '" + value + "'");
+        }
+        emitDirected(dir, FIELD_SRC_PORT, FIELD_DST_PORT, OP_RANGE, first, last, out);
+        return true;
+    }
+
+    // ========== Code generation ==========
+
+    void emit(Field field, Op op, uint32_t a, uint32_t b, Exits& out) {
+        uint32_t index = pc();
+        program_.push_back(Instruction{field, op, REJECT, REJECT, a, b});
+        out.on_true.push_back(index * 2);
+        out.on_false.push_back(index * 2 + 1);
+    }
+
+    // Without a direction the source test falls through to the destination test
+    void emitDirected(Direction dir, Field src, Field dst, Op op,
+                      uint32_t a, uint32_t b, Exits& out) {
+        if (dir != DIR_EITHER) {
+            emit(dir == DIR_SRC ? src : dst, op, a, b, out);
+            return;
+        }
+
+        Exits first;
+        emit(src, op, a, b, first);
+        patch(first.on_false, pc());
+        emit(dst, op, a, b, out);
+        append(out.on_true, first.on_true);
+    }
+
+    // ========== Values ==========
+
+    static bool parseNumber(const std::string& token, uint32_t max, uint32_t& value) {
+        if (token.empty() || token.size() > 10) return false;
+        uint64_t result = 0;
+        for (char c : token) {
+            if (c < '0' || c > '9') return false;
+            result = result * 10 + static_cast<uint64_t>(c - '0');
+        }
+        if (result > max) return false;
+        value = static_cast<uint32_t>(result);
+        return true;
+    }
+
+    // Dotted address, possibly partial ("10.1" = 10.1.0.0, prefix 16)
+    static bool parseAddress(const std::string& token, uint32_t& addr, uint32_t& prefix) {
+        std::istringstream in(token);
+        std::string octet;
+        uint32_t result = 0;
+        uint32_t count = 0;
+        while (std::getline(in, octet, '.')) {
+            uint32_t value = 0;
+            if (count == 4 || !parseNumber(octet, 0xFF, value)) return false;
+            result = (result << 8) | value;
+            count++;
+        }
+        if (count == 0) return false;
+
+        addr = count == 4 ? result : result << (8 * (4 - count));
+        prefix = 8 * count;
+        return true;
+    }
+};
+
+// ============================================================================
+// CaptureFilter
+// ============================================================================
+
+bool CaptureFilter::compile(const std::string& expression, std::string& error) {
+    std::vector<Instruction> program;
+    Compiler compiler(expression, program);
+    if (!compiler.run(error)) {
+        return false;
+    }
+
+    program_ = std::move(program);
+    expression_ = expression;
+    std::cout << "[CaptureFilter] \"" << expression_ << "\" compiled to "
+              << program_.size() << " instructions\n";
+    return true;
+}
+
+bool CaptureFilter::matches(const uint8_t* frame, size_t length) const {
+    if (program_.empty()) {
+        return true;
+    }
+
+    // Decode the fields once; tests on fields that are not present fail
+    uint32_t fields[FIELD_COUNT] = {};
+    uint32_t present = 1u << FIELD_LENGTH;
+    fields[FIELD_LENGTH] = static_cast<uint32_t>(length);
+
+    if (length >= 34 && frame[12] == 0x08 && frame[13] == 0x00 && (frame[14] >> 4) == 4) {
+        const uint8_t* ip = frame + 14;
+        size_t ip_header_len = (ip[0] & 0x0F) * 4;
+        uint8_t proto = ip[9];
+
+        fields[FIELD_IP_PROTO] = proto;
+        fields[FIELD_SRC_IP] = (uint32_t(ip[12]) << 24) | (uint32_t(ip[13]) << 16) |
+                               (uint32_t(ip[14]) << 8) | ip[15];
+        fields[FIELD_DST_IP] = (uint32_t(ip[16]) << 24) | (uint32_t(ip[17]) << 16) |
+                               (uint32_t(ip[18]) << 8) | ip[19];
+        present |= (1u << FIELD_IP_PROTO) | (1u << FIELD_SRC_IP) | (1u << FIELD_DST_IP);
+
+        // Ports only in the first fragment of a TCP/UDP datagram
+        bool first_fragment = ((ip[6] & 0x1F) | ip[7]) == 0;
+        if ((proto == 6 || proto == 17) && first_fragment && ip_header_len >= 20 &&
+            14 + ip_header_len + 4 <= length) {
+            const uint8_t* l4 = ip + ip_header_len;
+            fields[FIELD_SRC_PORT] = (uint32_t(l4[0]) << 8) | l4[1];
+            fields[FIELD_DST_PORT] = (uint32_t(l4[2]) << 8) | l4[3];
+            present |= (1u << FIELD_SRC_PORT) | (1u << FIELD_DST_PORT);
+        }
+    }
+
+    // Jumps only go forward, so this always ends at ACCEPT or REJECT
+    size_t pc = 0;
+    const size_t size = program_.size();
+    while (pc < size) {
+        const Instruction& in = program_[pc];
+        bool taken = false;
+        if (present & (1u << in.field)) {
+            uint32_t value = fields[in.field];
+            taken = in.op == OP_EQUAL ? (value & in.b) == in.a
+                                      : (value >= in.a && value <= in.b);
+        }
+        pc = taken ? in.jump_true : in.jump_false;
+    }
+    return pc == ACCEPT;
+}
+
+} // namespace DPI
@@ -1,4 +1,5 @@
 #include "connection_tracker.h"
+#include "flight_recorder.h"
 #include <algorithm>
 #include <sstream>
 #include <iomanip>
@@ -11,49 +12,127 @@ namespace DPI {
 // ============================================================================
 
 ConnectionTracker::ConnectionTracker(int fp_id, size_t max_connections)
-    : fp_id_(fp_id), max_connections_(max_connections) {
+    : fp_id_(fp_id), max_connections_(std::max<size_t>(max_connections, 1)) {
+    // Reserved only: slab pages are touched as the table first fills
+    slab_.reserve(max_connections_);
+    live_.reserve(max_connections_);
+    free_slots_.reserve(max_connections_);
+    
+    // At most half full, so probe chains stay short
+    size_t buckets = 1;
+    while (buckets < 2 * max_connections_) buckets <<= 1;
+    index_.assign(buckets, EMPTY_SLOT);
+    index_mask_ = buckets - 1;
 }
 
 Connection* ConnectionTracker::getOrCreateConnection(const FiveTuple& tuple) {
-    auto it = connections_.find(tuple);
+    uint32_t slot = findSlot(tuple);
     
-    if (it != connections_.end()) {
-        return &it->second;
+    if (slot != EMPTY_SLOT) {
+        return &slab_[slot];
+    }
+    
+    // Memory pressure reported since the last new flow: make room first
+    if (pressure_request_.load(std::memory_order_relaxed) != 0) {
+        relievePressure();
     }
     
     // Check if we need to evict old connections
-    if (connections_.size() >= max_connections_) {
+    if (active_ >= max_connections_) {
         evictOldest();
     }
     
     // Create new connection
-    Connection conn;
-    conn.tuple = tuple;
-    conn.state = ConnectionState::NEW;
-    conn.first_seen = std::chrono::steady_clock::now();
-    conn.last_seen = conn.first_seen;
+    Connection* conn = insert(tuple);
+    conn->state = ConnectionState::NEW;
+    conn->first_seen = std::chrono::steady_clock::now();
+    conn->last_seen = conn->first_seen;
     
-    auto result = connections_.emplace(tuple, std::move(conn));
     total_seen_++;
+    recharge(conn);
     
-    return &result.first->second;
+    return conn;
 }
 
 Connection* ConnectionTracker::getConnection(const FiveTuple& tuple) {
-    auto it = connections_.find(tuple);
-    if (it != connections_.end()) {
-        return &it->second;
+    uint32_t slot = findSlot(tuple);
+    if (slot != EMPTY_SLOT) {
+        return &slab_[slot];
     }
     
     // Try reverse tuple (for bidirectional matching)
-    auto rev = connections_.find(tuple.reverse());
-    if (rev != connections_.end()) {
-        return &rev->second;
+    slot = findSlot(tuple.reverse());
+    if (slot != EMPTY_SLOT) {
+        return &slab_[slot];
     }
     
     return nullptr;
 }
 
+// ============================================================================
+// Slab and index
+// ============================================================================
+
+size_t ConnectionTracker::bucketOf(const FiveTuple& tuple) const {
+    // FiveTupleHash keeps the low bits of nearby addresses close together;
+    // mix so linear probing does not cluster
+    uint64_t h = FiveTupleHash{}(tuple) * 0x9E3779B97F4A7C15ULL;
+    return static_cast<size_t>(h ^ (h >> 32)) & index_mask_;
+}
+
+uint32_t ConnectionTracker::findSlot(const FiveTuple& tuple) const {
+    for (size_t b = bucketOf(tuple); ; b = (b + 1) & index_mask_) {
+        uint32_t slot = index_[b];
+        if (slot == EMPTY_SLOT || slab_[slot].tuple == tuple) {
+            return slot;
+        }
+    }
+}
+
+Connection* ConnectionTracker::insert(const FiveTuple& tuple) {
+    uint32_t slot;
+    if (!free_slots_.empty()) {
+        slot = free_slots_.back();
+        free_slots_.pop_back();
+    } else {
+        // Within the reserved capacity: constructs in place, never reallocates
+        slot = static_cast<uint32_t>(slab_.size());
+        slab_.emplace_back();
+        live_.push_back(0);
+    }
+    
+    slab_[slot].tuple = tuple;
+    live_[slot] = 1;
+    active_++;
+    
+    size_t b = bucketOf(tuple);
+    while (index_[b] != EMPTY_SLOT) b = (b + 1) & index_mask_;
+    index_[b] = slot;
+    return &slab_[slot];
+}
+
+void ConnectionTracker::erase(uint32_t slot) {
+    size_t hole = bucketOf(slab_[slot].tuple);
+    while (index_[hole] != slot) hole = (hole + 1) & index_mask_;
+    
+    // Backward-shift deletion: pull later entries of the probe chain into
+    // the hole unless that would put them before their home bucket
+    for (size_t j = (hole + 1) & index_mask_; index_[j] != EMPTY_SLOT; j = (j + 1) & index_mask_) {
+        size_t home = bucketOf(slab_[index_[j]].tuple);
+        if (((j - home) & index_mask_) >= ((j - hole) & index_mask_)) {
+            index_[hole] = index_[j];
+            hole = j;
+        }
+    }
+    index_[hole] = EMPTY_SLOT;
+    
+    slab_[slot] = Connection{};
+    
+    live_[slot] = 0;
+    free_slots_.push_back(slot);
+    active_--;
+}
+
 void ConnectionTracker::updateConnection(Connection* conn, size_t packet_size, bool is_outbound) {
     if (!conn) return;
     
@@ -68,97 +147,272 @@ void ConnectionTracker::updateConnection(Connection* conn, size_t packet_size, b
     }
 }
 
-void ConnectionTracker::classifyConnection(Connection* conn, AppType app, const std::string& sni) {
+void ConnectionTracker::classifyConnection(Connection* conn, AppType app, std::string_view sni) {
     if (!conn) return;
     
     if (conn->state != ConnectionState::CLASSIFIED) {
         conn->app_type = app;
         conn->sni = sni;
         conn->state = ConnectionState::CLASSIFIED;
+        conn->hint_only = false;
         classified_count_++;
+        recharge(conn);
     }
 }
 
+void ConnectionTracker::refineClassification(Connection* conn, AppType app, std::string_view sni) {
+    if (!conn) return;
+    
+    if (conn->state != ConnectionState::CLASSIFIED) {
+        classifyConnection(conn, app, sni);
+    } else if (conn->classification_provisional) {
+        conn->app_type = app;
+        conn->sni = sni;
+        conn->hint_only = false;
+        recharge(conn);
+    }
+    conn->classification_provisional = false;
+}
+
 void ConnectionTracker::blockConnection(Connection* conn) {
     if (!conn) return;
     
     conn->state = ConnectionState::BLOCKED;
     conn->action = PacketAction::DROP;
     blocked_count_++;
+    recharge(conn);
 }
 
 void ConnectionTracker::closeConnection(const FiveTuple& tuple) {
-    auto it = connections_.find(tuple);
-    if (it != connections_.end()) {
-        it->second.state = ConnectionState::CLOSED;
+    uint32_t slot = findSlot(tuple);
+    if (slot != EMPTY_SLOT) {
+        slab_[slot].state = ConnectionState::CLOSED;
+    }
+}
+
+void ConnectionTracker::removeConnection(Connection* conn) {
+    if (!conn) return;
+    
+    uint32_t slot = findSlot(conn->tuple);
+    if (slot != EMPTY_SLOT) {
+        if (conn->tcp.state >= TcpState::FIN_WAIT) {
+            closed_reclaimed_++;
+        }
+        release(slab_[slot]);
+        erase(slot);
     }
 }
 
 size_t ConnectionTracker::cleanupStale(std::chrono::seconds timeout) {
+    size_t removed = removeStale(timeout, EVICT_REASON_TIMEOUT);
+    flushCharge();
+    return removed;
+}
+
+size_t ConnectionTracker::removeStale(std::chrono::seconds timeout, uint32_t reason) {
     auto now = std::chrono::steady_clock::now();
     size_t removed = 0;
     
-    for (auto it = connections_.begin(); it != connections_.end(); ) {
-        auto age = std::chrono::duration_cast<std::chrono::seconds>(
-            now - it->second.last_seen);
+    for (uint32_t slot = 0; slot < slab_.size(); slot++) {
+        if (!live_[slot]) continue;
+        const Connection& conn = slab_[slot];
         
-        if (age > timeout || it->second.state == ConnectionState::CLOSED) {
-            it = connections_.erase(it);
+        if (now - conn.last_seen > stateTimeout(conn, timeout) ||
+            conn.state == ConnectionState::CLOSED) {
+            if (conn.tcp.state >= TcpState::FIN_WAIT) {
+                closed_reclaimed_++;
+            }
+            release(conn);
+            erase(slot);
             removed++;
-        } else {
-            ++it;
         }
     }
     
+    if (removed > 0) {
+        FlightRecorder::record(TraceEvent::FLOW_EVICTED, reason,
+                               static_cast<uint32_t>(removed));
+    }
+    
     return removed;
 }
 
+std::chrono::seconds ConnectionTracker::stateTimeout(const Connection& conn,
+                                                    std::chrono::seconds idle_timeout) {
+    switch (conn.tcp.state) {
+        case TcpState::SYN_SENT:
+        case TcpState::SYN_RECEIVED: return std::min(idle_timeout, TCP_HANDSHAKE_TIMEOUT);
+        case TcpState::FIN_WAIT:     return std::min(idle_timeout, TCP_HALF_CLOSED_TIMEOUT);
+        case TcpState::CLOSING:      return std::min(idle_timeout, TCP_CLOSING_TIMEOUT);
+        case TcpState::TIME_WAIT:    return std::min(idle_timeout, TCP_TIME_WAIT_TIMEOUT);
+        case TcpState::CLOSED:       return std::min(idle_timeout, TCP_RESET_TIMEOUT);
+        default:                     return idle_timeout;
+    }
+}
+
 std::vector<Connection> ConnectionTracker::getAllConnections() const {
     std::vector<Connection> result;
-    result.reserve(connections_.size());
+    result.reserve(active_);
     
-    for (const auto& pair : connections_) {
-        result.push_back(pair.second);
+    for (size_t slot = 0; slot < slab_.size(); slot++) {
+        if (live_[slot]) result.push_back(slab_[slot]);
     }
     
     return result;
 }
 
 size_t ConnectionTracker::getActiveCount() const {
-    return connections_.size();
+    return active_;
 }
 
 ConnectionTracker::TrackerStats ConnectionTracker::getStats() const {
     TrackerStats stats;
-    stats.active_connections = connections_.size();
+    stats.active_connections = active_;
     stats.total_connections_seen = total_seen_;
     stats.classified_connections = classified_count_;
     stats.blocked_connections = blocked_count_;
+    stats.pressure_evictions = pressure_evictions_;
+    stats.closed_reclaimed = closed_reclaimed_;
+    stats.retired_connections = retired_count_;
     return stats;
 }
 
 void ConnectionTracker::clear() {
-    connections_.clear();
+    for (uint32_t slot = 0; slot < slab_.size(); slot++) {
+        if (!live_[slot]) continue;
+        release(slab_[slot]);
+        erase(slot);
+    }
+    flushCharge();
+    retired_apps_ = {};
+    retired_count_ = 0;
 }
 
 void ConnectionTracker::forEach(std::function<void(const Connection&)> callback) const {
-    for (const auto& pair : connections_) {
-        callback(pair.second);
+    for (size_t slot = 0; slot < slab_.size(); slot++) {
+        if (live_[slot]) callback(slab_[slot]);
     }
 }
 
 void ConnectionTracker::evictOldest() {
-    if (connections_.empty()) return;
+    if (active_ == 0) return;
     
     // Find oldest connection
-    auto oldest = connections_.begin();
-    for (auto it = connections_.begin(); it != connections_.end(); ++it) {
-        if (it->second.last_seen < oldest->second.last_seen) {
-            oldest = it;
+    uint32_t oldest = EMPTY_SLOT;
+    for (uint32_t slot = 0; slot < slab_.size(); slot++) {
+        if (live_[slot] && (oldest == EMPTY_SLOT || slab_[slot].last_seen < slab_[oldest].last_seen)) {
+            oldest = slot;
         }
     }
     
-    connections_.erase(oldest);
+    release(slab_[oldest]);
+    erase(oldest);
+    FlightRecorder::record(TraceEvent::FLOW_EVICTED, EVICT_REASON_TABLE_FULL, 1);
+}
+
+size_t ConnectionTracker::evictLeastRecent(size_t count) {
+    if (active_ == 0 || count == 0) return 0;
+    count = std::min(count, active_);
+    
+    // Cutoff = count-th oldest last_seen
+    std::vector<std::chrono::steady_clock::time_point> seen;
+    seen.reserve(active_);
+    for (size_t slot = 0; slot < slab_.size(); slot++) {
+        if (live_[slot]) seen.push_back(slab_[slot].last_seen);
+    }
+    std::nth_element(seen.begin(), seen.begin() + (count - 1), seen.end());
+    auto cutoff = seen[count - 1];
+    
+    size_t removed = 0;
+    for (uint32_t slot = 0; slot < slab_.size() && removed < count; slot++) {
+        if (live_[slot] && slab_[slot].last_seen <= cutoff) {
+            release(slab_[slot]);
+            erase(slot);
+            removed++;
+        }
+    }
+    
+    FlightRecorder::record(TraceEvent::FLOW_EVICTED, EVICT_REASON_MEMORY,
+                           static_cast<uint32_t>(removed));
+    return removed;
+}
+
+// ============================================================================
+// Memory accounting
+// ============================================================================
+
+void ConnectionTracker::setMemoryAccountant(MemoryAccountant* memory) {
+    memory_ = memory;
+    if (!memory_) return;
+    
+    // Runs on whichever FP crossed the threshold: only leave a note, and
+    // never lower one this tracker has not acted on yet
+    memory_->addPressureCallback(MemoryComponent::FLOW_TABLES, [this](MemoryPressure level) {
+        uint8_t wanted = static_cast<uint8_t>(level);
+        uint8_t current = pressure_request_.load(std::memory_order_relaxed);
+        while (wanted > current &&
+               !pressure_request_.compare_exchange_weak(current, wanted, std::memory_order_relaxed)) {
+        }
+    });
+}
+
+void ConnectionTracker::relievePressure() {
+    auto level = static_cast<MemoryPressure>(
+        pressure_request_.exchange(0, std::memory_order_relaxed));
+    
+    size_t removed = 0;
+    if (level == MemoryPressure::CRITICAL) {
+        // Over budget: drop the least recent eighth of this table
+        removed = evictLeastRecent(active_ / 8 + 1);
+    } else if (level == MemoryPressure::ELEVATED) {
+        // Getting close: flows idle for a while go now instead of at the timeout
+        removed = removeStale(MEMORY_PRESSURE_IDLE_TIMEOUT, EVICT_REASON_MEMORY);
+    }
+    pressure_evictions_ += removed;
+    flushCharge();
+    
+    // Still over budget (no new transition will come): go again next flow
+    if (removed > 0 && memory_->pressure(MemoryComponent::FLOW_TABLES) == MemoryPressure::CRITICAL) {
+        uint8_t expected = 0;
+        pressure_request_.compare_exchange_strong(expected,
+                                                  static_cast<uint8_t>(MemoryPressure::CRITICAL),
+                                                  std::memory_order_relaxed);
+    }
+}
+
+size_t ConnectionTracker::entryBytes(const Connection& /*conn*/) {
+    // Slab entry, its live flag and free-list slot, and two index buckets
+    // (names are inline and rule IDs interned: nothing else per entry)
+    return sizeof(Connection) + 1 + 3 * sizeof(uint32_t);
+}
+
+void ConnectionTracker::recharge(Connection* conn) {
+    if (!memory_) return;
+    
+    uint32_t bytes = static_cast<uint32_t>(entryBytes(*conn));
+    pending_charge_ += static_cast<int64_t>(bytes) - conn->memory_charge;
+    conn->memory_charge = bytes;
+    
+    if (pending_charge_ >= MEMORY_CHARGE_BATCH || pending_charge_ <= -MEMORY_CHARGE_BATCH) {
+        flushCharge();
+    }
+}
+
+void ConnectionTracker::release(const Connection& conn) {
+    retired_apps_[static_cast<size_t>(conn.app_type)]++;
+    retired_count_++;
+    
+    if (!memory_) return;
+    pending_charge_ -= conn.memory_charge;
+    
+    if (pending_charge_ <= -MEMORY_CHARGE_BATCH) {
+        flushCharge();
+    }
+}
+
+void ConnectionTracker::flushCharge() {
+    if (!memory_ || pending_charge_ == 0) return;
+    memory_->charge(MemoryComponent::FLOW_TABLES, pending_charge_);
+    pending_charge_ = 0;
 }
 
 // ============================================================================
@@ -170,14 +424,14 @@ GlobalConnectionTable::GlobalConnectionTable(size_t num_fps) {
 }
 
 void GlobalConnectionTable::registerTracker(int fp_id, ConnectionTracker* tracker) {
-    std::unique_lock<std::shared_mutex> lock(mutex_);
+    std::unique_lock<ProfiledSharedMutex> lock(mutex_);
     if (fp_id < static_cast<int>(trackers_.size())) {
         trackers_[fp_id] = tracker;
     }
 }
 
 GlobalConnectionTable::GlobalStats GlobalConnectionTable::getGlobalStats() const {
-    std::shared_lock<std::shared_mutex> lock(mutex_);
+    std::shared_lock<ProfiledSharedMutex> lock(mutex_);
     
     GlobalStats stats;
     stats.total_active_connections = 0;
@@ -196,7 +450,7 @@ GlobalConnectionTable::GlobalStats GlobalConnectionTable::getGlobalStats() const
         tracker->forEach([&](const Connection& conn) {
             stats.app_distribution[conn.app_type]++;
             if (!conn.sni.empty()) {
-                domain_counts[conn.sni]++;
+                domain_counts[conn.sni.str()]++;
             }
         });
     }
@@ -4,6 +4,8 @@
 #include <iomanip>
 #include <chrono>
 #include <cstring>
+#include <algorithm>
+#include <array>
 
 namespace DPI {
 
@@ -11,8 +13,24 @@ namespace DPI {
 // DPIEngine Implementation
 // ============================================================================
 
+bool parseOutputMode(const std::string& name, OutputMode& mode) {
+    if (name == "full") {
+        mode = OutputMode::FULL;
+    } else if (name == "headers") {
+        mode = OutputMode::HEADERS;
+    } else if (name == "unclassified-payload") {
+        mode = OutputMode::UNCLASSIFIED_PAYLOAD;
+    } else {
+        return false;
+    }
+    return true;
+}
+
 DPIEngine::DPIEngine(const Config& config)
-    : config_(config), output_queue_(10000) {
+    : config_(config), output_queue_(config.queue_size, "Output queue"),
+      buffer_pool_(config.packet_pool_buffers),
+      recorder_(config.trace_events_per_thread, config.trace_stall_us),
+      sampler_(config.flow_sample_rate) {
     
     std::cout << "\n";
     std::cout << "╔══════════════════════════════════════════════════════════════╗\n";
@@ -31,6 +49,29 @@ DPIEngine::~DPIEngine() {
 }
 
 bool DPIEngine::initialize() {
+    // The calling thread drives rule changes, so it gets the control ring
+    recorder_.attachThread("Control");
+    if (recorder_.isEnabled()) {
+        FlightRecorder::installSignalHandler();
+    }
+    
+    // SIGUSR1 prints the lock contention table (-DDPI_LOCK_PROFILE builds)
+    LockProfiler::installSignalHandler();
+    
+    // Count allocations per thread (instrumented builds)
+    if (config_.alloc_check_warmup > 0) {
+        AllocTracker::enable(config_.alloc_check_warmup);
+    }
+    
+    // Compile the capture filter (a bad expression is a configuration error)
+    if (!config_.capture_filter.empty()) {
+        std::string error;
+        if (!capture_filter_.compile(config_.capture_filter, error)) {
+            std::cerr << "[DPIEngine] Invalid capture filter: " << error << "\n";
+            return false;
+        }
+    }
+    
     // Create rule manager
     rule_manager_ = std::make_unique<RuleManager>();
     
@@ -39,22 +80,128 @@ bool DPIEngine::initialize() {
         rule_manager_->loadRules(config_.rules_file);
     }
     
+    // Create signature engine (built-in set unless a file is given)
+    signature_engine_ = std::make_unique<SignatureEngine>();
+    if (!config_.signatures_file.empty()) {
+        signature_engine_->loadFromFile(config_.signatures_file);
+    }
+    
+    // Create flow classifier (inactive until a model is loaded)
+    flow_classifier_ = std::make_unique<FlowClassifier>();
+    if (!config_.flow_model_file.empty()) {
+        flow_classifier_->loadFromFile(config_.flow_model_file);
+    }
+    
     // Create output callback
-    auto output_cb = [this](const PacketJob& job, PacketAction action) {
+    auto output_cb = [this](PacketJob& job, PacketAction action) {
         handleOutput(job, action);
     };
     
     // Create FP manager (creates FP threads and their queues)
     int total_fps = config_.num_load_balancers * config_.fps_per_lb;
-    fp_manager_ = std::make_unique<FPManager>(total_fps, rule_manager_.get(), output_cb);
+    fp_manager_ = std::make_unique<FPManager>(total_fps, rule_manager_.get(),
+                                              signature_engine_.get(),
+                                              flow_classifier_.get(), output_cb,
+                                              config_.queue_size);
     
     // Create LB manager (creates LB threads, connects to FP queues)
     lb_manager_ = std::make_unique<LBManager>(
         config_.num_load_balancers,
         config_.fps_per_lb,
-        fp_manager_->getQueuePtrs()
+        fp_manager_->getQueuePtrs(),
+        config_.queue_size
     );
     
+    // The LBs parse what the reader framed
+    ingest_counters_ = std::make_unique<IngestCounters[]>(config_.num_load_balancers);
+    lb_manager_->setIngressCallback([this](PacketJob& job, int lb_id) {
+        return ingestPacket(job, ingest_counters_[lb_id]);
+    });
+    
+    fp_manager_->setTimeSeriesBucket(config_.timeseries_bucket_seconds);
+    fp_manager_->setEmbryonicTable(config_.embryonic_entries,
+                                   std::chrono::seconds(config_.embryonic_timeout_sec));
+    
+    // Packets each thread takes from its queue per lock
+    fp_manager_->setBurstSize(config_.burst_size);
+    lb_manager_->setBurstSize(config_.burst_size);
+    
+    // Hardware counters are opened by each thread when it starts
+    fp_manager_->enablePerfCounters(config_.perf_counters);
+    lb_manager_->enablePerfCounters(config_.perf_counters);
+    
+    fp_manager_->setFlightRecorder(&recorder_);
+    fp_manager_->setProfile(config_.fast_path_profile);
+    lb_manager_->setFlightRecorder(&recorder_);
+    
+    // Create hint cache (one write buffer per FP)
+    if (config_.hint_cache) {
+        hint_cache_ = std::make_unique<HintCache>(total_fps, config_.hint_cache_entries,
+                                                  config_.hint_merge_ms);
+        fp_manager_->setHintCache(hint_cache_.get());
+    }
+    
+    // Create slow-path workers (one result mailbox per worker per FP)
+    if (config_.slow_path_workers > 0) {
+        slow_path_ = std::make_unique<SlowPathPool>(config_.slow_path_workers, total_fps,
+                                                    config_.slow_path_queue);
+        fp_manager_->setSlowPath(slow_path_.get());
+    }
+    
+    // Create response synthesizer for blocked flows
+    if (config_.block_responses) {
+        responder_ = std::make_unique<ResponseSynthesizer>(config_.dns_sinkhole,
+                                                           config_.block_response_rate);
+        fp_manager_->setResponseSynthesizer(responder_.get());
+    }
+    
+    // Create overload controller (watches the FP queues)
+    if (config_.overload_control) {
+        overload_ = std::make_unique<OverloadController>(fp_manager_->getQueuePtrs(),
+                                                         config_.overload_policy,
+                                                         config_.overload_sample_rate);
+        overload_->setOutputCallback(output_cb);
+        overload_->setFlightRecorder(&recorder_);
+        fp_manager_->setOverloadController(overload_.get());
+        lb_manager_->setOverloadController(overload_.get());
+    }
+    
+    // Memory accounting: flow tables charge themselves, the rest is measured
+    memory_.setBudget(MemoryComponent::FLOW_TABLES, config_.flow_memory_budget);
+    memory_.setBudget(MemoryComponent::PACKET_QUEUES, config_.queue_memory_budget);
+    memory_.addPressureCallback(MemoryComponent::FLOW_TABLES, [this](MemoryPressure level) {
+        std::cout << "[Memory] Flow tables " << memoryPressureToString(level) << " ("
+                  << memory_.usage(MemoryComponent::FLOW_TABLES) / 1024 << " KB of "
+                  << config_.flow_memory_budget / 1024 << " KB)\n";
+    });
+    fp_manager_->setMemoryAccountant(&memory_);
+    
+    std::vector<ThreadSafeQueue<PacketJob>*> queues = fp_manager_->getQueuePtrs();
+    for (int i = 0; i < lb_manager_->getNumLBs(); i++) {
+        queues.push_back(&lb_manager_->getLB(i).getInputQueue());
+    }
+    queues.push_back(&output_queue_);
+    if (config_.queue_memory_budget > 0) {
+        for (auto* queue : queues) {
+            queue->setMaxBytes(config_.queue_memory_budget / queues.size());
+        }
+    }
+    memory_.setProbe(MemoryComponent::PACKET_QUEUES, [queues]() {
+        size_t bytes = 0;
+        for (auto* queue : queues) {
+            bytes += queue->bytes();
+        }
+        return bytes;
+    });
+    memory_.setProbe(MemoryComponent::RULE_SETS, [this]() {
+        return rule_manager_->memoryBytes();
+    });
+    if (hint_cache_) {
+        memory_.setProbe(MemoryComponent::HINT_CACHE, [this]() {
+            return hint_cache_->getStats().snapshot_bytes;
+        });
+    }
+    
     // Create global connection table
     global_conn_table_ = std::make_unique<GlobalConnectionTable>(total_fps);
     for (int i = 0; i < total_fps; i++) {
@@ -74,9 +221,29 @@ void DPIEngine::start() {
     // Start output thread
     output_thread_ = std::thread(&DPIEngine::outputThreadFunc, this);
     
+    // Start the audit writer (idle priority)
+    if (drop_sink_) {
+        drop_sink_->start();
+    }
+    
+    // Start hint merger
+    if (hint_cache_) {
+        hint_cache_->start();
+    }
+    
+    // Start slow-path workers before the FPs that feed them
+    if (slow_path_) {
+        slow_path_->start();
+    }
+    
     // Start FP threads
     fp_manager_->startAll();
     
+    // Start overload sampling before traffic arrives
+    if (overload_) {
+        overload_->start();
+    }
+    
     // Start LB threads
     lb_manager_->startAll();
     
@@ -91,6 +258,13 @@ void DPIEngine::stop() {
     // Stop LB threads first (they feed FPs)
     if (lb_manager_) {
         lb_manager_->stopAll();
+        
+        // Their counts are final now
+        IngestTotals ingested = ingestTotals();
+        stats_.total_packets = ingested.packets;
+        stats_.total_bytes = ingested.bytes;
+        stats_.tcp_packets = ingested.tcp_packets;
+        stats_.udp_packets = ingested.udp_packets;
     }
     
     // Stop FP threads
@@ -98,12 +272,32 @@ void DPIEngine::stop() {
         fp_manager_->stopAll();
     }
     
+    // Stop overload sampling (nothing left to shed)
+    if (overload_) {
+        overload_->stop();
+    }
+    
+    // Stop slow-path workers (after the FPs, which may still submit)
+    if (slow_path_) {
+        slow_path_->stop();
+    }
+    
+    // Stop hint merger (after the FPs, so their last results are merged)
+    if (hint_cache_) {
+        hint_cache_->stop();
+    }
+    
     // Stop output thread
     output_queue_.shutdown();
     if (output_thread_.joinable()) {
         output_thread_.join();
     }
     
+    // Flush the audit capture
+    if (drop_sink_) {
+        drop_sink_->stop();
+    }
+    
     std::cout << "[DPIEngine] All threads stopped\n";
 }
 
@@ -140,6 +334,14 @@ bool DPIEngine::processFile(const std::string& input_file,
         return false;
     }
     
+    // Open the audit capture for dropped packets
+    if (!config_.drop_capture_file.empty()) {
+        drop_sink_ = std::make_unique<DropSink>(config_.drop_capture_queue);
+        if (!drop_sink_->open(config_.drop_capture_file)) {
+            drop_sink_.reset();
+        }
+    }
+    
     // Start processing threads
     start();
     
@@ -162,7 +364,24 @@ bool DPIEngine::processFile(const std::string& input_file,
     
     // Print final report
     std::cout << generateReport();
-    std::cout << fp_manager_->generateClassificationReport();
+    std::cout << fp_manager_->generateClassificationReport(&sampler_);
+    std::cout << generateTimeSeriesReport();
+    
+    if (!config_.timeseries_file.empty()) {
+        if (exportTimeSeries(config_.timeseries_file)) {
+            std::cout << "[DPIEngine] Time series written to " << config_.timeseries_file << "\n";
+        } else {
+            std::cerr << "[DPIEngine] Cannot write time series to " << config_.timeseries_file << "\n";
+        }
+    }
+    
+    if (config_.alloc_check_warmup > 0) {
+        alloc_check_passed_ = AllocTracker::report(std::cout);
+    }
+    
+    if (LockProfiler::isCompiledIn()) {
+        LockProfiler::report(std::cout);
+    }
     
     return true;
 }
@@ -170,6 +389,9 @@ bool DPIEngine::processFile(const std::string& input_file,
 void DPIEngine::readerThreadFunc(const std::string& input_file) {
     PacketAnalyzer::PcapReader reader;
     
+    recorder_.attachThread("Reader");
+    AllocTracker::attachThread("Reader", false);
+    
     if (!reader.open(input_file)) {
         std::cerr << "[Reader] Error: Cannot open input file\n";
         return;
@@ -179,141 +401,277 @@ void DPIEngine::readerThreadFunc(const std::string& input_file) {
     writeOutputHeader(reader.getGlobalHeader());
     
     PacketAnalyzer::RawPacket raw;
-    PacketAnalyzer::ParsedPacket parsed;
     uint32_t packet_id = 0;
     
     std::cout << "[Reader] Starting packet processing...\n";
     
+    if (config_.perf_counters && !reader_perf_.open()) {
+        std::cerr << "[Reader] Hardware counters unavailable\n";
+    }
+    
+    // Each frame is read into a pooled buffer that the job then takes over
+    raw.data = buffer_pool_.acquire();
+    run_start_ticks_ = FlightRecorder::now();
+    
+    // The reader only frames packets; the LBs parse them (see ingestPacket)
     while (reader.readNextPacket(raw)) {
-        // Parse the packet
-        if (!PacketAnalyzer::PacketParser::parse(raw, parsed)) {
-            continue;  // Skip unparseable packets
-        }
+        AllocTracker::notePacket();
         
-        // Only process IP packets with TCP/UDP
-        if (!parsed.has_ip || (!parsed.has_tcp && !parsed.has_udp)) {
+        // Filtered packets are skipped before any parsing
+        if (!capture_filter_.matches(raw.data.data(), raw.data.size())) {
+            stats_.filtered_packets++;
             continue;
         }
         
-        // Create packet job
-        PacketJob job = createPacketJob(raw, parsed, packet_id++);
-        
-        // Update global stats
-        stats_.total_packets++;
-        stats_.total_bytes += raw.data.size();
-        
-        if (parsed.has_tcp) {
-            stats_.tcp_packets++;
-        } else if (parsed.has_udp) {
-            stats_.udp_packets++;
+        PacketJob job;
+        job.packet_id = packet_id++;
+        job.ts_sec = raw.header.ts_sec;
+        job.ts_usec = raw.header.ts_usec;
+        job.orig_len = raw.header.orig_len;
+        job.data = std::move(raw.data);
+        raw.data = buffer_pool_.acquire();
+        if (config_.measure_latency) {
+            job.ingress_ticks = FlightRecorder::now();
         }
         
-        // Send to appropriate LB based on hash
-        LoadBalancer& lb = lb_manager_->getLBForPacket(job.tuple);
+        // Steer by the frame's address pair, so a flow stays on one LB
+        LoadBalancer& lb = lb_manager_->getLBForFrame(job.data.data(), job.data.size());
+        if (lb.getInputQueue().isFull()) {
+            FlightRecorder::record(TraceEvent::QUEUE_FULL, lb.getId(),
+                                   static_cast<uint32_t>(lb.getInputQueue().size()));
+        }
         lb.getInputQueue().push(std::move(job));
+        
+        reader_perf_.maybeSample(packet_id);
     }
     
+    reader_perf_.sample(packet_id);
+    reader_perf_.close();
+    
     std::cout << "[Reader] Finished reading " << packet_id << " packets\n";
     reader.close();
+    FlightRecorder::detachThread();
 }
 
-PacketJob DPIEngine::createPacketJob(const PacketAnalyzer::RawPacket& raw,
-                                      const PacketAnalyzer::ParsedPacket& parsed,
-                                      uint32_t packet_id) {
-    PacketJob job;
-    job.packet_id = packet_id;
-    job.ts_sec = raw.header.ts_sec;
-    job.ts_usec = raw.header.ts_usec;
-    
-    // Set five-tuple - parse IP addresses from string back to uint32
-    auto parseIP = [](const std::string& ip) -> uint32_t {
-        uint32_t result = 0;
-        int octet = 0;
-        int shift = 0;
-        for (char c : ip) {
-            if (c == '.') {
-                result |= (octet << shift);
-                shift += 8;
-                octet = 0;
-            } else if (c >= '0' && c <= '9') {
-                octet = octet * 10 + (c - '0');
-            }
-        }
-        result |= (octet << shift);
-        return result;
-    };
+bool DPIEngine::ingestPacket(PacketJob& job, IngestCounters& counters) {
+    // Only process IP packets with TCP/UDP
+    if (!decodeFrame(job)) {
+        return false;
+    }
     
-    job.tuple.src_ip = parseIP(parsed.src_ip);
-    job.tuple.dst_ip = parseIP(parsed.dest_ip);
-    job.tuple.src_port = parsed.src_port;
-    job.tuple.dst_port = parsed.dest_port;
-    job.tuple.protocol = parsed.protocol;
+    // Update this LB's stats (exact, sampled or not)
+    counters.packets++;
+    counters.bytes += job.data.size();
     
-    // TCP flags
-    job.tcp_flags = parsed.tcp_flags;
+    if (job.tuple.protocol == 6) {
+        counters.tcp_packets++;
+    } else {
+        counters.udp_packets++;
+    }
     
-    // Copy packet data
-    job.data = raw.data;
+    // Unsampled flows go straight to the output, uninspected
+    if (sampler_.isEnabled() && !sampler_.isSampled(SymmetricTupleHash{}(job.tuple))) {
+        sampler_.recordSkipped(job.data.size());
+        handleOutput(job, PacketAction::FORWARD);
+        return false;
+    }
     
-    // Calculate offsets
-    job.eth_offset = 0;
-    job.ip_offset = 14;  // Ethernet header is 14 bytes
+    return true;
+}
+
+bool DPIEngine::decodeFrame(PacketJob& job) {
+    // Same acceptance as PacketParser::parse + the IP/TCP/UDP check, read in
+    // place (no address strings, so the LBs stay allocation-free)
+    const uint8_t* data = job.data.data();
+    size_t len = job.data.size();
     
-    // IP header length
-    if (job.data.size() > 14) {
-        uint8_t ip_ihl = job.data[14] & 0x0F;
-        size_t ip_header_len = ip_ihl * 4;
-        job.transport_offset = 14 + ip_header_len;
-        
-        // Transport header length
-        if (parsed.has_tcp && job.data.size() > job.transport_offset) {
-            uint8_t tcp_data_offset = (job.data[job.transport_offset + 12] >> 4) & 0x0F;
-            size_t tcp_header_len = tcp_data_offset * 4;
-            job.payload_offset = job.transport_offset + tcp_header_len;
-        } else if (parsed.has_udp) {
-            job.payload_offset = job.transport_offset + 8;  // UDP header is 8 bytes
-        }
-        
-        if (job.payload_offset < job.data.size()) {
-            job.payload_length = job.data.size() - job.payload_offset;
-            job.payload_data = job.data.data() + job.payload_offset;
-        }
+    // Ethernet (14 bytes), IPv4 only
+    constexpr size_t ETH_HEADER_LEN = 14;
+    if (len < ETH_HEADER_LEN || data[12] != 0x08 || data[13] != 0x00) {
+        return false;
+    }
+    
+    // IPv4 header
+    const uint8_t* ip = data + ETH_HEADER_LEN;
+    size_t ip_header_len = (ip[0] & 0x0F) * 4;
+    if (len < ETH_HEADER_LEN + 20 || (ip[0] >> 4) != 4 ||
+        ip_header_len < 20 || len < ETH_HEADER_LEN + ip_header_len) {
+        return false;
+    }
+    
+    uint8_t protocol = ip[9];
+    size_t transport_offset = ETH_HEADER_LEN + ip_header_len;
+    const uint8_t* l4 = data + transport_offset;
+    size_t payload_offset;
+    
+    if (protocol == 6) {
+        if (len < transport_offset + 20) return false;
+        size_t tcp_header_len = ((l4[12] >> 4) & 0x0F) * 4;
+        if (tcp_header_len < 20 || len < transport_offset + tcp_header_len) return false;
+        job.tcp_flags = l4[13];
+        job.tcp_seq = (static_cast<uint32_t>(l4[4]) << 24) | (l4[5] << 16) | (l4[6] << 8) | l4[7];
+        job.tcp_ack = (static_cast<uint32_t>(l4[8]) << 24) | (l4[9] << 16) | (l4[10] << 8) | l4[11];
+        payload_offset = transport_offset + tcp_header_len;
+    } else if (protocol == 17) {
+        if (len < transport_offset + 8) return false;
+        job.tcp_flags = 0;
+        payload_offset = transport_offset + 8;  // UDP header is 8 bytes
+    } else {
+        return false;
+    }
+    
+    // Addresses keep wire byte order (first octet in the low byte)
+    auto address = [](const uint8_t* p) -> uint32_t {
+        return p[0] | (p[1] << 8) | (p[2] << 16) | (static_cast<uint32_t>(p[3]) << 24);
+    };
+    job.tuple.src_ip = address(ip + 12);
+    job.tuple.dst_ip = address(ip + 16);
+    job.tuple.src_port = static_cast<uint16_t>((l4[0] << 8) | l4[1]);
+    job.tuple.dst_port = static_cast<uint16_t>((l4[2] << 8) | l4[3]);
+    job.tuple.protocol = protocol;
+    
+    job.eth_offset = 0;
+    job.ip_offset = ETH_HEADER_LEN;
+    job.transport_offset = transport_offset;
+    job.payload_offset = payload_offset;
+    if (payload_offset < len) {
+        job.payload_length = len - payload_offset;
+        job.payload_data = data + payload_offset;
+    } else {
+        job.payload_length = 0;
+        job.payload_data = nullptr;
     }
     
-    return job;
+    return true;
 }
 
 void DPIEngine::outputThreadFunc() {
+    if (config_.perf_counters && !output_perf_.open()) {
+        std::cerr << "[Output] Hardware counters unavailable\n";
+    }
+    
+    recorder_.attachThread("Output");
+    AllocTracker::attachThread("Output", false);
+    
+    uint64_t written = 0;
+    std::vector<PacketJob> burst;
+    burst.reserve(config_.burst_size);
+    auto next_memory_sample = std::chrono::steady_clock::now();
+    
     while (running_ || !output_queue_.empty()) {
-        auto job_opt = output_queue_.popWithTimeout(std::chrono::milliseconds(100));
+        output_queue_.popBurst(burst, config_.burst_size, std::chrono::milliseconds(100));
         
-        if (job_opt) {
-            writeOutputPacket(*job_opt);
+        // SIGUSR2 requests are serviced here, off the signal handler
+        if (FlightRecorder::consumeDumpRequest()) {
+            dumpTrace(config_.trace_file);
+        }
+        if (LockProfiler::consumeReportRequest()) {
+            LockProfiler::report(std::cout);
+        }
+        
+        // Peaks of the measured components (queues, rules, hints)
+        auto now = std::chrono::steady_clock::now();
+        if (now >= next_memory_sample) {
+            memory_.sampleProbes();
+            next_memory_sample = now + MEMORY_SAMPLE_INTERVAL;
+        }
+        
+        for (PacketJob& job : burst) {
+            AllocTracker::notePacket();
+            writeOutputPacket(job);
+            buffer_pool_.release(std::move(job.data));
+            written++;
+            output_perf_.maybeSample(written);
+            
+            if (job.ingress_ticks != 0) {
+                pipeline_latency_.record(
+                    FlightRecorder::ticksToNs(FlightRecorder::now() - job.ingress_ticks));
+            }
+        }
+        if (!burst.empty()) {
+            packets_written_.store(written, std::memory_order_relaxed);
+            last_output_ticks_.store(FlightRecorder::now(), std::memory_order_relaxed);
         }
     }
+    
+    output_perf_.sample(written);
+    output_perf_.close();
+    FlightRecorder::detachThread();
 }
 
-void DPIEngine::handleOutput(const PacketJob& job, PacketAction action) {
+void DPIEngine::handleOutput(PacketJob& job, PacketAction action) {
     if (action == PacketAction::DROP) {
         stats_.dropped_packets++;
+        
+        // Never waits: a full audit queue loses the record, not the packet
+        if (drop_sink_) {
+            drop_sink_->submit(std::move(job));
+        }
         return;
     }
     
-    stats_.forwarded_packets++;
-    output_queue_.push(job);
+    // Synthesized responses are written but were never received
+    if (action != PacketAction::INJECT) {
+        stats_.forwarded_packets++;
+    }
+    
+    // Packets move to the output; a cut one is shortened in place (resize
+    // down keeps the pooled buffer, nothing is copied)
+    size_t length = captureLength(job);
+    if (length < job.data.size()) {
+        if (job.orig_len == 0) {
+            job.orig_len = static_cast<uint32_t>(job.data.size());
+        }
+        job.data.resize(length);
+    }
+    output_queue_.push(std::move(job));
+}
+
+size_t DPIEngine::captureLength(const PacketJob& job) const {
+    size_t length = job.data.size();
+    
+    // Headers end where the payload starts (0 = offsets unknown, keep all)
+    size_t headers = job.payload_offset > 0 ? std::min(job.payload_offset, length) : length;
+    
+    switch (config_.output_mode) {
+        case OutputMode::HEADERS:
+            length = headers;
+            break;
+        case OutputMode::UNCLASSIFIED_PAYLOAD:
+            if (job.flow_classified) length = headers;
+            break;
+        default:
+            break;
+    }
+    
+    if (config_.snaplen > 0 && length > config_.snaplen) {
+        length = config_.snaplen;
+    }
+    return length;
 }
 
 bool DPIEngine::writeOutputHeader(const PacketAnalyzer::PcapGlobalHeader& header) {
-    std::lock_guard<std::mutex> lock(output_mutex_);
+    std::lock_guard<ProfiledMutex> lock(output_mutex_);
     
     if (!output_file_.is_open()) return false;
     
-    output_file_.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    // Advertise the cap so readers know packets may be cut short
+    PacketAnalyzer::PcapGlobalHeader out_header = header;
+    if (config_.snaplen > 0 && config_.snaplen < out_header.snaplen) {
+        out_header.snaplen = config_.snaplen;
+    }
+    
+    output_file_.write(reinterpret_cast<const char*>(&out_header), sizeof(out_header));
+    
+    // Same link type for the audit capture (dropped packets are kept whole)
+    if (drop_sink_) {
+        drop_sink_->writeInterface(static_cast<uint16_t>(header.network), header.snaplen);
+    }
     return output_file_.good();
 }
 
 void DPIEngine::writeOutputPacket(const PacketJob& job) {
-    std::lock_guard<std::mutex> lock(output_mutex_);
+    std::lock_guard<ProfiledMutex> lock(output_mutex_);
     
     if (!output_file_.is_open()) return;
     
@@ -322,8 +680,9 @@ void DPIEngine::writeOutputPacket(const PacketJob& job) {
     pkt_header.ts_sec = job.ts_sec;
     pkt_header.ts_usec = job.ts_usec;
     pkt_header.incl_len = job.data.size();
-    pkt_header.orig_len = job.data.size();
+    pkt_header.orig_len = std::max<uint32_t>(job.orig_len, job.data.size());
     
+    // Straight from the packet buffer
     output_file_.write(reinterpret_cast<const char*>(&pkt_header), sizeof(pkt_header));
     output_file_.write(reinterpret_cast<const char*>(job.data.data()), job.data.size());
 }
@@ -401,30 +760,62 @@ bool DPIEngine::saveRules(const std::string& filename) {
     return false;
 }
 
+bool DPIEngine::loadSignatures(const std::string& filename) {
+    if (signature_engine_) {
+        return signature_engine_->loadFromFile(filename);
+    }
+    return false;
+}
+
+bool DPIEngine::loadFlowModel(const std::string& filename) {
+    if (flow_classifier_) {
+        return flow_classifier_->loadFromFile(filename);
+    }
+    return false;
+}
+
 // ============================================================================
 // Reporting
 // ============================================================================
 
+DPIEngine::IngestTotals DPIEngine::ingestTotals() const {
+    IngestTotals totals = {0, 0, 0, 0};
+    if (!ingest_counters_) return totals;
+    
+    for (int i = 0; i < config_.num_load_balancers; i++) {
+        const IngestCounters& counters = ingest_counters_[i];
+        totals.packets += counters.packets.load(std::memory_order_relaxed);
+        totals.bytes += counters.bytes.load(std::memory_order_relaxed);
+        totals.tcp_packets += counters.tcp_packets.load(std::memory_order_relaxed);
+        totals.udp_packets += counters.udp_packets.load(std::memory_order_relaxed);
+    }
+    return totals;
+}
+
 std::string DPIEngine::generateReport() const {
     std::ostringstream ss;
+    IngestTotals ingested = ingestTotals();
     
     ss << "\n╔══════════════════════════════════════════════════════════════╗\n";
     ss << "║                    DPI ENGINE STATISTICS                      ║\n";
     ss << "╠══════════════════════════════════════════════════════════════╣\n";
     
     ss << "║ PACKET STATISTICS                                             ║\n";
-    ss << "║   Total Packets:      " << std::setw(12) << stats_.total_packets.load() << "                        ║\n";
-    ss << "║   Total Bytes:        " << std::setw(12) << stats_.total_bytes.load() << "                        ║\n";
-    ss << "║   TCP Packets:        " << std::setw(12) << stats_.tcp_packets.load() << "                        ║\n";
-    ss << "║   UDP Packets:        " << std::setw(12) << stats_.udp_packets.load() << "                        ║\n";
+    ss << "║   Total Packets:      " << std::setw(12) << ingested.packets << "                        ║\n";
+    ss << "║   Total Bytes:        " << std::setw(12) << ingested.bytes << "                        ║\n";
+    ss << "║   TCP Packets:        " << std::setw(12) << ingested.tcp_packets << "                        ║\n";
+    ss << "║   UDP Packets:        " << std::setw(12) << ingested.udp_packets << "                        ║\n";
+    if (capture_filter_.isEnabled()) {
+        ss << "║   Filtered Out:       " << std::setw(12) << stats_.filtered_packets.load() << "                        ║\n";
+    }
     
     ss << "╠══════════════════════════════════════════════════════════════╣\n";
     ss << "║ FILTERING STATISTICS                                          ║\n";
     ss << "║   Forwarded:          " << std::setw(12) << stats_.forwarded_packets.load() << "                        ║\n";
     ss << "║   Dropped/Blocked:    " << std::setw(12) << stats_.dropped_packets.load() << "                        ║\n";
     
-    if (stats_.total_packets > 0) {
-        double drop_rate = 100.0 * stats_.dropped_packets.load() / stats_.total_packets.load();
+    if (ingested.packets > 0) {
+        double drop_rate = 100.0 * stats_.dropped_packets.load() / ingested.packets;
         ss << "║   Drop Rate:          " << std::setw(11) << std::fixed << std::setprecision(2) << drop_rate << "%                        ║\n";
     }
     
@@ -444,6 +835,155 @@ std::string DPIEngine::generateReport() const {
         ss << "║   FP Forwarded:       " << std::setw(12) << fp_stats.total_forwarded << "                        ║\n";
         ss << "║   FP Dropped:         " << std::setw(12) << fp_stats.total_dropped << "                        ║\n";
         ss << "║   Active Connections: " << std::setw(12) << fp_stats.total_connections << "                        ║\n";
+        
+        const auto& embryonic = fp_stats.embryonic;
+        if (embryonic.admitted > 0 || embryonic.stray_resets > 0) {
+            ss << "╠══════════════════════════════════════════════════════════════╣\n";
+            ss << "║ EMBRYONIC FLOWS (TCP handshake admission)                     ║\n";
+            ss << "║   Admitted:           " << std::setw(12) << embryonic.admitted << "                        ║\n";
+            ss << "║   Promoted:           " << std::setw(12) << embryonic.promoted << "                        ║\n";
+            ss << "║   Expired / Reset:    " << std::setw(12) << embryonic.expired << " / " << std::setw(8) << std::left << embryonic.reset << std::right << "             ║\n";
+            ss << "║   Overflowed:         " << std::setw(12) << embryonic.overflowed << "                        ║\n";
+            ss << "║   Stray RSTs:         " << std::setw(12) << embryonic.stray_resets << "                        ║\n";
+            ss << "║   Still Handshaking:  " << std::setw(12) << embryonic.held << "                        ║\n";
+        }
+        
+        const auto& tcp = fp_stats.tcp;
+        if (tcp.midstream + tcp.fin_closes + tcp.resets + tcp.invalid_resets > 0) {
+            ss << "╠══════════════════════════════════════════════════════════════╣\n";
+            ss << "║ TCP STATE                                                     ║\n";
+            ss << "║   Closed by FIN:      " << std::setw(12) << tcp.fin_closes << "                        ║\n";
+            ss << "║   Reset / Invalid:    " << std::setw(12) << tcp.resets << " / " << std::setw(8) << std::left << tcp.invalid_resets << std::right << "             ║\n";
+            ss << "║   Reclaimed:          " << std::setw(12) << tcp.reclaimed << "                        ║\n";
+            ss << "║   Midstream Pickups:  " << std::setw(12) << tcp.midstream << "                        ║\n";
+        }
+    }
+    
+    if (hint_cache_ && fp_manager_) {
+        auto hint_stats = hint_cache_->getStats();
+        auto fp_stats = fp_manager_->getAggregatedStats();
+        ss << "╠══════════════════════════════════════════════════════════════╣\n";
+        ss << "║ CLASSIFICATION HINTS                                          ║\n";
+        ss << "║   Endpoints Cached:   " << std::setw(12) << hint_stats.entries << "                        ║\n";
+        ss << "║   Updates Merged:     " << std::setw(12) << hint_stats.updates << "                        ║\n";
+        ss << "║   Updates Dropped:    " << std::setw(12) << hint_stats.dropped_updates << "                        ║\n";
+        ss << "║   Endpoints Aged Out: " << std::setw(12) << hint_stats.expired << "                        ║\n";
+        ss << "║   Flows Pre-classified:" << std::setw(11) << fp_stats.total_hint_hits << "                        ║\n";
+        ss << "║   Hints Confirmed:    " << std::setw(12) << fp_stats.total_hint_confirmed << "                        ║\n";
+        ss << "║   Hints Wrong:        " << std::setw(12) << fp_stats.total_hint_mismatched << "                        ║\n";
+    }
+    
+    if (slow_path_) {
+        auto sp_stats = slow_path_->getStats();
+        ss << "╠══════════════════════════════════════════════════════════════╣\n";
+        ss << "║ SLOW PATH (" << std::setw(2) << slow_path_->getNumWorkers() << " workers)                                       ║\n";
+        ss << "║   Offloaded:          " << std::setw(12) << sp_stats.submitted - sp_stats.rejected << "                        ║\n";
+        ss << "║   Done Inline (full): " << std::setw(12) << sp_stats.rejected << "                        ║\n";
+        ss << "║   Applied / Stale:    " << std::setw(12) << sp_stats.applied << " / " << std::setw(8) << std::left << sp_stats.stale << std::right << "             ║\n";
+        ss << "║   Queue Depth avg/max:" << std::setw(12) << std::fixed << std::setprecision(1) << sp_stats.avg_queue_depth
+           << " / " << std::setw(8) << std::left << sp_stats.max_queue_depth << std::right << "             ║\n";
+        ss << "║   Latency p50/p99 us: " << std::setw(12) << sp_stats.latency_p50_ns / 1000
+           << " / " << std::setw(8) << std::left << sp_stats.latency_p99_ns / 1000 << std::right << "             ║\n";
+    }
+    
+    if (buffer_pool_.isEnabled()) {
+        auto pool_stats = buffer_pool_.getStats();
+        ss << "╠══════════════════════════════════════════════════════════════╣\n";
+        ss << "║ PACKET BUFFERS                                                ║\n";
+        ss << "║   Recycled:           " << std::setw(12) << pool_stats.recycled << "                        ║\n";
+        ss << "║   Allocated:          " << std::setw(12) << pool_stats.allocated << "                        ║\n";
+        ss << "║   Discarded:          " << std::setw(12) << pool_stats.discarded << "                        ║\n";
+    }
+    
+    if (drop_sink_) {
+        auto drop_stats = drop_sink_->getStats();
+        ss << "╠══════════════════════════════════════════════════════════════╣\n";
+        ss << "║ DROP CAPTURE                                                  ║\n";
+        ss << "║   Packets Recorded:   " << std::setw(12) << drop_stats.written << "                        ║\n";
+        ss << "║   Packets Lost:       " << std::setw(12) << drop_stats.lost << "                        ║\n";
+        ss << "║   Bytes Written:      " << std::setw(12) << drop_stats.bytes << "                        ║\n";
+    }
+    
+    {
+        auto mb = [](size_t bytes) {
+            std::ostringstream out;
+            out << std::fixed << std::setprecision(1) << bytes / (1024.0 * 1024.0);
+            return out.str();
+        };
+        ss << "╠══════════════════════════════════════════════════════════════╣\n";
+        ss << "║ MEMORY (MB)                used      budget         peak      ║\n";
+        for (int i = 0; i < static_cast<int>(MemoryComponent::COMPONENT_COUNT); i++) {
+            auto component = static_cast<MemoryComponent>(i);
+            auto mem_stats = memory_.getStats(component);
+            std::ostringstream row;
+            row << std::left << std::setw(16) << (std::string(memoryComponentToString(component)) + ":")
+                << std::right << std::setw(13) << mb(mem_stats.usage) << " / " << std::setw(9)
+                << (mem_stats.budget ? mb(mem_stats.budget) : "-") << std::setw(13) << mb(mem_stats.peak);
+            ss << "║   " << std::setw(56) << std::left << row.str() << std::right << "║\n";
+        }
+        auto flow_mem = memory_.getStats(MemoryComponent::FLOW_TABLES);
+        if (flow_mem.budget > 0) {
+            ss << "║   Flow Pressure:      " << std::setw(12) << memoryPressureToString(flow_mem.pressure) << "                        ║\n";
+            ss << "║   Pressure Events:    " << std::setw(12) << flow_mem.pressure_events << "                        ║\n";
+            ss << "║   Early Evictions:    " << std::setw(12) << fp_manager_->getAggregatedStats().total_pressure_evictions << "                        ║\n";
+        }
+    }
+    
+    if (responder_) {
+        auto resp_stats = responder_->getStats();
+        ss << "╠══════════════════════════════════════════════════════════════╣\n";
+        ss << "║ BLOCK RESPONSES (DNS: " << std::setw(8) << std::left
+           << (responder_->hasSinkhole() ? "sinkhole" : "NXDOMAIN") << std::right << ")                               ║\n";
+        ss << "║   TCP Resets Sent:    " << std::setw(12) << resp_stats.tcp_resets << "                        ║\n";
+        ss << "║   DNS Answers Sent:   " << std::setw(12) << resp_stats.dns_answers << "                        ║\n";
+        ss << "║   Rate Limited:       " << std::setw(12) << resp_stats.rate_limited << "                        ║\n";
+        ss << "║   Not Answerable:     " << std::setw(12) << resp_stats.unsupported << "                        ║\n";
+    }
+    
+    if (sampler_.isEnabled()) {
+        uint64_t total_packets = ingested.packets;
+        uint64_t skipped = sampler_.getSkippedPackets();
+        ss << "╠══════════════════════════════════════════════════════════════╣\n";
+        std::string title = "FLOW SAMPLING (1 in " + std::to_string(sampler_.getRate()) +
+                            " flows inspected)";
+        ss << "║ " << std::setw(61) << std::left << title << std::right << "║\n";
+        ss << "║   Packets Inspected:  " << std::setw(12) << total_packets - skipped << "                        ║\n";
+        ss << "║   Packets Skipped:    " << std::setw(12) << skipped << "                        ║\n";
+        ss << "║   Bytes Skipped:      " << std::setw(12) << sampler_.getSkippedBytes() << "                        ║\n";
+    }
+    
+    if (overload_) {
+        auto ov_stats = overload_->getStats();
+        ss << "╠══════════════════════════════════════════════════════════════╣\n";
+        ss << "║ OVERLOAD CONTROL (policy: " << std::setw(7) << std::left
+           << overloadPolicyToString(overload_->getPolicy()) << std::right << ")                           ║\n";
+        ss << "║   Escalations:        " << std::setw(12) << ov_stats.escalations << "                        ║\n";
+        ss << "║   Recoveries:         " << std::setw(12) << ov_stats.recoveries << "                        ║\n";
+        for (int i = 0; i < static_cast<int>(OverloadLevel::LEVEL_COUNT); i++) {
+            ss << "║   " << std::setw(19) << std::left
+               << overloadLevelToString(static_cast<OverloadLevel>(i)) << std::right
+               << std::setw(12) << ov_stats.level_ms[i] << " ms                      ║\n";
+        }
+        ss << "║   Flows Not Inspected:" << std::setw(12) << ov_stats.shed_flows << "                        ║\n";
+        ss << "║   Bypass Forwarded:   " << std::setw(12) << ov_stats.bypass_forwarded << "                        ║\n";
+        ss << "║   Bypass Dropped:     " << std::setw(12) << ov_stats.bypass_dropped << "                        ║\n";
+        ss << "║   Max Queue / Delay:  " << std::setw(11) << std::fixed << std::setprecision(1)
+           << ov_stats.max_occupancy_pct << "% / " << std::setw(8) << std::left
+           << ov_stats.max_delay_us << std::right << " us          ║\n";
+    }
+    
+    if (config_.perf_counters) {
+        ss << "╠══════════════════════════════════════════════════════════════╣\n";
+        ss << "║ HARDWARE COUNTERS (per packet)                                ║\n";
+        ss << "║ Stage    cyc/pkt  ins/pkt   IPC  L1D/pkt  LLC/pkt  BrM/pkt   ║\n";
+        ss << formatPerfRow("Reader", reader_perf_.snapshot());
+        if (lb_manager_) {
+            ss << formatPerfRow("LB", lb_manager_->getPerfSample());
+        }
+        if (fp_manager_) {
+            ss << formatPerfRow("FP", fp_manager_->getPerfSample());
+        }
+        ss << formatPerfRow("Output", output_perf_.snapshot());
     }
     
     if (rule_manager_) {
@@ -463,18 +1003,141 @@ std::string DPIEngine::generateReport() const {
 
 std::string DPIEngine::generateClassificationReport() const {
     if (fp_manager_) {
-        return fp_manager_->generateClassificationReport();
+        return fp_manager_->generateClassificationReport(&sampler_);
     }
     return "";
 }
 
+AppTimeSeriesSnapshot DPIEngine::getAppTimeSeries() const {
+    return fp_manager_ ? fp_manager_->getAppTimeSeries() : AppTimeSeriesSnapshot{};
+}
+
+std::string DPIEngine::generateTimeSeriesReport() const {
+    AppTimeSeriesSnapshot series = getAppTimeSeries();
+    if (series.buckets.empty()) return "";
+    
+    // Busiest apps first
+    std::array<uint64_t, TIMESERIES_APPS> totals{};
+    for (const AppTimeBucket& bucket : series.buckets) {
+        for (size_t app = 0; app < TIMESERIES_APPS; app++) {
+            totals[app] += bucket.bytes[app];
+        }
+    }
+    std::vector<size_t> apps;
+    for (size_t app = 0; app < TIMESERIES_APPS; app++) {
+        if (totals[app] > 0) apps.push_back(app);
+    }
+    std::sort(apps.begin(), apps.end(), [&](size_t a, size_t b) { return totals[a] > totals[b]; });
+    if (apps.size() > 10) apps.resize(10);
+    
+    auto row = [](std::ostringstream& ss, const std::string& text) {
+        ss << "║ " << std::left << std::setw(62) << text << std::right << "║\n";
+    };
+    
+    // One column per bucket, or the busiest bucket of each run of them,
+    // scaled to the app's own peak
+    constexpr size_t SPARK_WIDTH = 32;
+    static const char LEVELS[] = " .:-=+*#";
+    size_t num_buckets = series.buckets.size();
+    size_t columns = std::min(num_buckets, SPARK_WIDTH);
+    
+    std::ostringstream ss;
+    ss << "\n╔══════════════════════════════════════════════════════════════╗\n";
+    ss << "║                APPLICATION BANDWIDTH OVER TIME                ║\n";
+    ss << "╠══════════════════════════════════════════════════════════════╣\n";
+    {
+        std::ostringstream line;
+        line << num_buckets << " buckets of " << series.bucket_seconds << " s from t="
+             << series.buckets.front().start_sec << " (Mbit/s)";
+        row(ss, line.str());
+    }
+    {
+        std::ostringstream line;
+        line << std::left << std::setw(12) << "App" << std::right << std::setw(8) << "Avg"
+             << std::setw(8) << "Peak" << "  " << "Oldest -> newest";
+        row(ss, line.str());
+    }
+    
+    for (size_t app : apps) {
+        uint64_t peak_bytes = 0;
+        for (const AppTimeBucket& bucket : series.buckets) {
+            peak_bytes = std::max(peak_bytes, bucket.bytes[app]);
+        }
+        
+        std::string spark(columns, ' ');
+        for (size_t c = 0; c < columns; c++) {
+            uint64_t value = 0;
+            for (size_t b = c * num_buckets / columns; b < (c + 1) * num_buckets / columns; b++) {
+                value = std::max(value, series.buckets[b].bytes[app]);
+            }
+            if (value > 0) {
+                spark[c] = LEVELS[1 + value * (sizeof(LEVELS) - 3) / peak_bytes];
+            }
+        }
+        
+        std::ostringstream line;
+        line << std::left << std::setw(12) << appTypeToString(static_cast<AppType>(app)).substr(0, 11)
+             << std::right << std::fixed << std::setprecision(3)
+             << std::setw(8) << series.mbps(totals[app]) / num_buckets
+             << std::setw(8) << series.mbps(peak_bytes) << "  " << spark;
+        row(ss, line.str());
+    }
+    
+    if (series.late_packets > 0) {
+        ss << "╠══════════════════════════════════════════════════════════════╣\n";
+        row(ss, "Late packets (older than the window): " + std::to_string(series.late_packets));
+    }
+    ss << "╚══════════════════════════════════════════════════════════════╝\n";
+    
+    return ss.str();
+}
+
+bool DPIEngine::exportTimeSeries(const std::string& path) const {
+    std::ofstream out(path);
+    if (!out) return false;
+    
+    AppTimeSeriesSnapshot series = getAppTimeSeries();
+    out << "time,app,packets,bytes,mbps\n";
+    out << std::fixed << std::setprecision(3);
+    for (const AppTimeBucket& bucket : series.buckets) {
+        for (size_t app = 0; app < TIMESERIES_APPS; app++) {
+            if (bucket.packets[app] == 0) continue;
+            out << bucket.start_sec << "," << appTypeToString(static_cast<AppType>(app)) << ","
+                << bucket.packets[app] << "," << bucket.bytes[app] << ","
+                << series.mbps(bucket.bytes[app]) << "\n";
+        }
+    }
+    return static_cast<bool>(out);
+}
+
 const DPIStats& DPIEngine::getStats() const {
     return stats_;
 }
 
+bool DPIEngine::dumpTrace(const std::string& path) const {
+    if (!recorder_.isEnabled()) return false;
+    return recorder_.dumpChromeTrace(path);
+}
+
+DPIEngine::RunMetrics DPIEngine::getRunMetrics() const {
+    RunMetrics metrics = {};
+    metrics.packets = packets_written_.load();
+    
+    uint64_t end = last_output_ticks_.load();
+    if (run_start_ticks_ != 0 && end > run_start_ticks_) {
+        metrics.seconds = FlightRecorder::ticksToNs(end - run_start_ticks_) / 1e9;
+        metrics.mpps = metrics.packets / metrics.seconds / 1e6;
+    }
+    
+    metrics.latency_p50_ns = std::min(pipeline_latency_.percentileNs(50), pipeline_latency_.maxNs());
+    metrics.latency_p99_ns = std::min(pipeline_latency_.percentileNs(99), pipeline_latency_.maxNs());
+    metrics.latency_max_ns = pipeline_latency_.maxNs();
+    return metrics;
+}
+
 void DPIEngine::printStatus() const {
     std::cout << "\n--- Live Status ---\n";
-    std::cout << "Packets: " << stats_.total_packets.load()
+    std::cout << "Packets: " << ingestTotals().packets
               << " | Forwarded: " << stats_.forwarded_packets.load()
               << " | Dropped: " << stats_.dropped_packets.load() << "\n";
     
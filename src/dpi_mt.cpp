@@ -21,6 +21,8 @@
 #include "packet_parser.h"
 #include "sni_extractor.h"
 #include "types.h"
+#include "port_table.h"
+#include "lock_profiler.h"
 
 using namespace PacketAnalyzer;
 using namespace DPI;
@@ -31,10 +33,11 @@ using namespace DPI;
 template<typename T>
 class TSQueue {
 public:
-    TSQueue(size_t max_size = 10000) : max_size_(max_size), shutdown_(false) {}
+    TSQueue(size_t max_size = 10000, const char* name = "TSQueue")
+        : mutex_(name), max_size_(max_size), shutdown_(false) {}
     
     void push(T item) {
-        std::unique_lock<std::mutex> lock(mutex_);
+        ProfiledMutex::Lock lock(mutex_);
         not_full_.wait(lock, [this] { return queue_.size() < max_size_ || shutdown_; });
         if (shutdown_) return;
         queue_.push(std::move(item));
@@ -42,7 +45,7 @@ public:
     }
     
     std::optional<T> pop(int timeout_ms = 100) {
-        std::unique_lock<std::mutex> lock(mutex_);
+        ProfiledMutex::Lock lock(mutex_);
         if (!not_empty_.wait_for(lock, std::chrono::milliseconds(timeout_ms),
                                   [this] { return !queue_.empty() || shutdown_; })) {
             return std::nullopt;
@@ -55,14 +58,14 @@ public:
     }
     
     void shutdown() {
-        std::lock_guard<std::mutex> lock(mutex_);
+        std::lock_guard<ProfiledMutex> lock(mutex_);
         shutdown_ = true;
         not_empty_.notify_all();
         not_full_.notify_all();
     }
     
     size_t size() const {
-        std::lock_guard<std::mutex> lock(mutex_);
+        std::lock_guard<ProfiledMutex> lock(mutex_);
         return queue_.size();
     }
     
@@ -70,9 +73,9 @@ public:
 
 private:
     std::queue<T> queue_;
-    mutable std::mutex mutex_;
-    std::condition_variable not_empty_;
-    std::condition_variable not_full_;
+    mutable ProfiledMutex mutex_;
+    ProfiledMutex::Condition not_empty_;
+    ProfiledMutex::Condition not_full_;
     size_t max_size_;
     std::atomic<bool> shutdown_;
 };
@@ -110,13 +113,13 @@ struct FlowEntry {
 class Rules {
 public:
     void blockIP(const std::string& ip) {
-        std::lock_guard<std::mutex> lock(mutex_);
+        std::lock_guard<ProfiledMutex> lock(mutex_);
         blocked_ips_.insert(parseIP(ip));
         std::cout << "[Rules] Blocked IP: " << ip << "\n";
     }
     
     void blockApp(const std::string& app) {
-        std::lock_guard<std::mutex> lock(mutex_);
+        std::lock_guard<ProfiledMutex> lock(mutex_);
         for (int i = 0; i < static_cast<int>(AppType::APP_COUNT); i++) {
             if (appTypeToString(static_cast<AppType>(i)) == app) {
                 blocked_apps_.insert(static_cast<AppType>(i));
@@ -128,13 +131,13 @@ public:
     }
     
     void blockDomain(const std::string& domain) {
-        std::lock_guard<std::mutex> lock(mutex_);
+        std::lock_guard<ProfiledMutex> lock(mutex_);
         blocked_domains_.push_back(domain);
         std::cout << "[Rules] Blocked domain: " << domain << "\n";
     }
     
     bool isBlocked(uint32_t src_ip, AppType app, const std::string& sni) const {
-        std::lock_guard<std::mutex> lock(mutex_);
+        std::lock_guard<ProfiledMutex> lock(mutex_);
         if (blocked_ips_.count(src_ip)) return true;
         if (blocked_apps_.count(app)) return true;
         for (const auto& dom : blocked_domains_) {
@@ -154,7 +157,7 @@ private:
         return result | (octet << shift);
     }
     
-    mutable std::mutex mutex_;
+    mutable ProfiledMutex mutex_{"Rules"};
     std::unordered_set<uint32_t> blocked_ips_;
     std::unordered_set<AppType> blocked_apps_;
     std::vector<std::string> blocked_domains_;
@@ -172,12 +175,12 @@ struct Stats {
     std::atomic<uint64_t> udp_packets{0};
     
     // Per-app stats (protected by mutex)
-    std::mutex app_mutex;
+    ProfiledMutex app_mutex{"Stats::app"};
     std::unordered_map<AppType, uint64_t> app_counts;
     std::unordered_map<std::string, AppType> detected_snis;
     
     void recordApp(AppType app, const std::string& sni) {
-        std::lock_guard<std::mutex> lock(app_mutex);
+        std::lock_guard<ProfiledMutex> lock(app_mutex);
         app_counts[app]++;
         if (!sni.empty()) {
             detected_snis[sni] = app;
@@ -213,7 +216,7 @@ private:
     Rules* rules_;
     Stats* stats_;
     TSQueue<Packet>* output_queue_;
-    TSQueue<Packet> input_queue_;
+    TSQueue<Packet> input_queue_{10000, "FP queue"};
     std::unordered_map<FiveTuple, FlowEntry, FiveTupleHash> flows_;
     
     std::atomic<bool> running_{false};
@@ -260,8 +263,10 @@ private:
     }
     
     void classifyFlow(Packet& pkt, FlowEntry& flow) {
+        AppType port_app = DEFAULT_PORT_HINTS.lookup(pkt.tuple);
+        
         // Try SNI extraction for HTTPS
-        if (pkt.tuple.dst_port == 443 && pkt.payload_length > 5) {
+        if (port_app == AppType::HTTPS && pkt.payload_length > 5) {
             const uint8_t* payload = pkt.data.data() + pkt.payload_offset;
             auto sni = SNIExtractor::extract(payload, pkt.payload_length);
             if (sni) {
@@ -273,7 +278,7 @@ private:
         }
         
         // Try HTTP Host extraction
-        if (pkt.tuple.dst_port == 80 && pkt.payload_length > 10) {
+        if (port_app == AppType::HTTP && pkt.payload_length > 10) {
             const uint8_t* payload = pkt.data.data() + pkt.payload_offset;
             auto host = HTTPHostExtractor::extract(payload, pkt.payload_length);
             if (host) {
@@ -285,17 +290,16 @@ private:
         }
         
         // DNS
-        if (pkt.tuple.dst_port == 53 || pkt.tuple.src_port == 53) {
+        if (port_app == AppType::DNS ||
+            DEFAULT_PORT_HINTS.lookup(pkt.tuple.protocol, pkt.tuple.src_port) == AppType::DNS) {
             flow.app_type = AppType::DNS;
             flow.classified = true;
             return;
         }
         
         // Port-based fallback (but don't mark as classified - might get SNI later)
-        if (pkt.tuple.dst_port == 443) {
-            flow.app_type = AppType::HTTPS;
-        } else if (pkt.tuple.dst_port == 80) {
-            flow.app_type = AppType::HTTP;
+        if (port_app != AppType::UNKNOWN) {
+            flow.app_type = port_app;
         }
     }
 };
@@ -327,7 +331,7 @@ private:
     int id_;
     std::vector<FastPath*> fps_;
     size_t num_fps_;
-    TSQueue<Packet> input_queue_;
+    TSQueue<Packet> input_queue_{10000, "LB queue"};
     
     std::atomic<bool> running_{false};
     std::thread thread_;
@@ -406,6 +410,9 @@ public:
         const auto& hdr = reader.getGlobalHeader();
         output.write(reinterpret_cast<const char*>(&hdr), sizeof(hdr));
         
+        // SIGUSR1 prints lock contention (-DDPI_LOCK_PROFILE builds)
+        LockProfiler::installSignalHandler();
+        
         // Start all threads
         for (auto& fp : fps_) fp->start();
         for (auto& lb : lbs_) lb->start();
@@ -415,6 +422,9 @@ public:
         std::thread output_thread([&]() {
             while (output_running || output_queue_.size() > 0) {
                 auto pkt_opt = output_queue_.pop(50);
+                if (LockProfiler::consumeReportRequest()) {
+                    LockProfiler::report(std::cout);
+                }
                 if (!pkt_opt) continue;
                 
                 PcapPacketHeader phdr;
@@ -513,6 +523,9 @@ public:
         
         // Print report
         printReport();
+        if (LockProfiler::isCompiledIn()) {
+            LockProfiler::report(std::cout);
+        }
         
         return true;
     }
@@ -521,7 +534,7 @@ private:
     Config config_;
     Rules rules_;
     Stats stats_;
-    TSQueue<Packet> output_queue_;
+    TSQueue<Packet> output_queue_{10000, "Output queue"};
     std::vector<std::unique_ptr<FastPath>> fps_;
     std::vector<std::unique_ptr<LoadBalancer>> lbs_;
     
@@ -553,7 +566,7 @@ private:
         std::cout << "║                   APPLICATION BREAKDOWN                       ║\n";
         std::cout << "╠══════════════════════════════════════════════════════════════╣\n";
         
-        std::lock_guard<std::mutex> lock(stats_.app_mutex);
+        std::lock_guard<ProfiledMutex> lock(stats_.app_mutex);
         
         std::vector<std::pair<AppType, uint64_t>> sorted_apps(
             stats_.app_counts.begin(), stats_.app_counts.end());
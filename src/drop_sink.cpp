@@ -0,0 +1,185 @@
+#include "drop_sink.h"
+#include <iostream>
+#include <cstring>
+
+#ifdef __linux__
+#include <pthread.h>
+#include <sched.h>
+#endif
+
+namespace DPI {
+
+// pcapng block types and option codes
+namespace {
+constexpr uint32_t BLOCK_SECTION_HEADER = 0x0A0D0D0A;
+constexpr uint32_t BLOCK_INTERFACE_DESCRIPTION = 0x00000001;
+constexpr uint32_t BLOCK_ENHANCED_PACKET = 0x00000006;
+constexpr uint32_t BYTE_ORDER_MAGIC = 0x1A2B3C4D;
+constexpr uint16_t OPT_END = 0;
+constexpr uint16_t OPT_COMMENT = 1;
+constexpr uint16_t OPT_SHB_USERAPPL = 4;
+
+void put16(std::vector<uint8_t>& out, uint16_t value) {
+    uint8_t bytes[2];
+    std::memcpy(bytes, &value, 2);
+    out.insert(out.end(), bytes, bytes + 2);
+}
+
+void put32(std::vector<uint8_t>& out, uint32_t value) {
+    uint8_t bytes[4];
+    std::memcpy(bytes, &value, 4);
+    out.insert(out.end(), bytes, bytes + 4);
+}
+
+// Bytes followed by zero padding to a 32-bit boundary
+void putPadded(std::vector<uint8_t>& out, const uint8_t* data, size_t length) {
+    out.insert(out.end(), data, data + length);
+    out.resize(out.size() + ((4 - length % 4) % 4), 0);
+}
+
+void putOption(std::vector<uint8_t>& out, uint16_t code, const std::string& value) {
+    put16(out, code);
+    put16(out, static_cast<uint16_t>(value.size()));
+    putPadded(out, reinterpret_cast<const uint8_t*>(value.data()), value.size());
+}
+} // namespace
+
+// ============================================================================
+// DropSink Implementation
+// ============================================================================
+
+DropSink::DropSink(size_t queue_capacity) : queue_(queue_capacity, "DropSink queue") {
+}
+
+DropSink::~DropSink() {
+    stop();
+}
+
+bool DropSink::open(const std::string& path) {
+    file_.open(path, std::ios::binary);
+    if (!file_.is_open()) {
+        std::cerr << "[DropSink] Error: Cannot open " << path << "\n";
+        return false;
+    }
+
+    // Section header: native byte order (readers use the magic), unknown length
+    std::vector<uint8_t> body;
+    put32(body, BYTE_ORDER_MAGIC);
+    put16(body, 1);
+    put16(body, 0);
+    put32(body, 0xFFFFFFFF);
+    put32(body, 0xFFFFFFFF);
+    putOption(body, OPT_SHB_USERAPPL, "DPI Engine drop capture");
+    putOption(body, OPT_END, "");
+    writeBlock(BLOCK_SECTION_HEADER, body);
+
+    std::cout << "[DropSink] Writing dropped packets to " << path << "\n";
+    return true;
+}
+
+void DropSink::writeInterface(uint16_t link_type, uint32_t snaplen) {
+    if (!file_.is_open()) return;
+
+    std::vector<uint8_t> body;
+    put16(body, link_type);
+    put16(body, 0);
+    put32(body, snaplen);
+    writeBlock(BLOCK_INTERFACE_DESCRIPTION, body);
+}
+
+void DropSink::start() {
+    if (running_) return;
+
+    running_ = true;
+    thread_ = std::thread(&DropSink::run, this);
+}
+
+void DropSink::stop() {
+    if (!running_) return;
+
+    running_ = false;
+    queue_.shutdown();
+
+    if (thread_.joinable()) {
+        thread_.join();
+    }
+    file_.close();
+}
+
+bool DropSink::submit(PacketJob&& job) {
+    Record record;
+    record.ts_sec = job.ts_sec;
+    record.ts_usec = job.ts_usec;
+    record.orig_len = std::max<uint32_t>(job.orig_len, job.data.size());
+    record.data = std::move(job.data);
+    record.tuple = job.tuple;
+    record.packet_id = job.packet_id;
+    record.verdict = job.verdict;
+
+    if (!queue_.tryPush(std::move(record))) {
+        lost_.fetch_add(1, std::memory_order_relaxed);
+        return false;
+    }
+    return true;
+}
+
+void DropSink::run() {
+#ifdef __linux__
+    // Audit output only gets CPU nobody else wants
+    sched_param param{};
+    pthread_setschedparam(pthread_self(), SCHED_IDLE, &param);
+#endif
+
+    // Drains the queue after shutdown, then returns
+    while (auto record = queue_.pop()) {
+        writeEnhancedPacket(*record);
+    }
+    file_.flush();
+}
+
+void DropSink::writeEnhancedPacket(const Record& record) {
+    if (!file_.is_open()) return;
+
+    // Default interface resolution is microseconds
+    uint64_t ts = static_cast<uint64_t>(record.ts_sec) * 1000000 + record.ts_usec;
+
+    // The rule text is only built here, on the writer thread
+    std::string comment = "rule=" + (record.verdict ? *record.verdict : std::string("unknown")) +
+                          " flow=" + record.tuple.toString() +
+                          " packet=" + std::to_string(record.packet_id);
+
+    std::vector<uint8_t> body;
+    body.reserve(32 + record.data.size() + comment.size());
+    put32(body, 0);                                   // Interface ID
+    put32(body, static_cast<uint32_t>(ts >> 32));
+    put32(body, static_cast<uint32_t>(ts));
+    put32(body, static_cast<uint32_t>(record.data.size()));
+    put32(body, record.orig_len);
+    putPadded(body, record.data.data(), record.data.size());
+    putOption(body, OPT_COMMENT, comment);
+    putOption(body, OPT_END, "");
+    writeBlock(BLOCK_ENHANCED_PACKET, body);
+
+    written_.fetch_add(1, std::memory_order_relaxed);
+}
+
+void DropSink::writeBlock(uint32_t type, const std::vector<uint8_t>& body) {
+    uint32_t total = static_cast<uint32_t>(body.size() + 12);
+
+    file_.write(reinterpret_cast<const char*>(&type), 4);
+    file_.write(reinterpret_cast<const char*>(&total), 4);
+    file_.write(reinterpret_cast<const char*>(body.data()), body.size());
+    file_.write(reinterpret_cast<const char*>(&total), 4);
+
+    bytes_.fetch_add(total, std::memory_order_relaxed);
+}
+
+DropSink::Stats DropSink::getStats() const {
+    Stats stats;
+    stats.written = written_.load();
+    stats.lost = lost_.load();
+    stats.bytes = bytes_.load();
+    return stats;
+}
+
+} // namespace DPI
@@ -0,0 +1,165 @@
+#include "embryonic_table.h"
+
+namespace DPI {
+
+namespace {
+
+constexpr uint8_t TCP_SYN = 0x02;
+constexpr uint8_t TCP_RST = 0x04;
+constexpr uint8_t TCP_ACK = 0x10;
+
+} // anonymous namespace
+
+void EmbryonicTable::configure(size_t entries, std::chrono::seconds timeout) {
+    timeout_ = timeout;
+    if (entries == 0) {
+        entries_.clear();
+        mask_ = 0;
+        return;
+    }
+
+    // Power of two, at least one probe window
+    size_t size = PROBE_WINDOW;
+    while (size < entries) size <<= 1;
+    entries_.assign(size, EmbryonicFlow{});
+    mask_ = size - 1;
+}
+
+void EmbryonicTable::release(EmbryonicFlow& entry, std::atomic<uint64_t>& reason) {
+    entry.used = false;
+    reason++;
+    held_--;
+}
+
+EmbryonicTable::Verdict EmbryonicTable::track(const FiveTuple& tuple, uint8_t tcp_flags,
+                                              size_t payload_length, size_t packet_size,
+                                              EmbryonicFlow& flow) {
+    if (entries_.empty()) return Verdict::NOT_EMBRYONIC;
+
+    auto now = std::chrono::steady_clock::now();
+
+    // Remix: this FP only sees hashes with the same value mod num_fps
+    uint64_t base = SymmetricTupleHash{}(tuple);
+    base ^= base >> 33;
+    base *= 0xff51afd7ed558ccdULL;
+    base ^= base >> 33;
+
+    // Both directions probe the same slots; drop timed-out entries on the way
+    EmbryonicFlow* found = nullptr;
+    EmbryonicFlow* empty_slot = nullptr;
+    EmbryonicFlow* oldest = nullptr;
+    for (size_t probe = 0; probe < PROBE_WINDOW; probe++) {
+        EmbryonicFlow& entry = entries_[(base + probe) & mask_];
+        if (entry.used && now - entry.last_seen > timeout_) {
+            release(entry, expired_);
+        }
+        if (!entry.used) {
+            if (!empty_slot) empty_slot = &entry;
+            continue;
+        }
+        if (entry.tuple == tuple || entry.tuple == tuple.reverse()) {
+            found = &entry;
+            break;
+        }
+        if (!oldest || entry.last_seen < oldest->last_seen) {
+            oldest = &entry;
+        }
+    }
+
+    bool syn = (tcp_flags & TCP_SYN) != 0;
+    bool ack = (tcp_flags & TCP_ACK) != 0;
+
+    if (!found) {
+        // Nothing to reset: keep backscatter out of both tables
+        if (tcp_flags & TCP_RST) {
+            stray_resets_++;
+            return Verdict::IGNORED;
+        }
+
+        // Only a bare SYN or SYN-ACK opens an embryonic flow
+        if (!syn || payload_length > 0) {
+            return Verdict::NOT_EMBRYONIC;
+        }
+
+        EmbryonicFlow* slot = empty_slot;
+        if (!slot) {
+            slot = oldest;
+            release(*slot, overflowed_);
+        }
+        *slot = EmbryonicFlow{};
+        slot->first_seen = now;
+        slot->last_seen = now;
+        if (ack) {
+            // The SYN-ACK comes from the server: store the flow as the client opened it
+            slot->tuple = tuple.reverse();
+            slot->packets_in = 1;
+            slot->bytes_in = static_cast<uint32_t>(packet_size);
+            slot->syn_ack_seen = true;
+        } else {
+            slot->tuple = tuple;
+            slot->packets_out = 1;
+            slot->bytes_out = static_cast<uint32_t>(packet_size);
+        }
+        slot->used = true;
+        admitted_++;
+        held_++;
+        return Verdict::HELD;
+    }
+
+    EmbryonicFlow& entry = *found;
+    bool is_outbound = entry.tuple == tuple;
+    entry.last_seen = now;
+    if (is_outbound) {
+        entry.packets_out++;
+        entry.bytes_out += static_cast<uint32_t>(packet_size);
+    } else {
+        entry.packets_in++;
+        entry.bytes_in += static_cast<uint32_t>(packet_size);
+    }
+
+    if (tcp_flags & TCP_RST) {
+        release(entry, reset_);
+        return Verdict::HELD;
+    }
+
+    // SYN retransmits and the server's SYN-ACK keep the flow here
+    if (payload_length == 0 && syn) {
+        if (is_outbound && !ack) {
+            return Verdict::HELD;
+        }
+        if (!is_outbound && ack) {
+            entry.syn_ack_seen = true;
+            return Verdict::HELD;
+        }
+    }
+
+    flow = entry;
+    release(entry, promoted_);
+    return Verdict::PROMOTED;
+}
+
+size_t EmbryonicTable::expireStale() {
+    auto now = std::chrono::steady_clock::now();
+    size_t removed = 0;
+    for (EmbryonicFlow& entry : entries_) {
+        if (entry.used && now - entry.last_seen > timeout_) {
+            release(entry, expired_);
+            removed++;
+        }
+    }
+    return removed;
+}
+
+EmbryonicTable::Stats EmbryonicTable::getStats() const {
+    Stats stats;
+    stats.admitted = admitted_.load();
+    stats.promoted = promoted_.load();
+    stats.expired = expired_.load();
+    stats.reset = reset_.load();
+    stats.overflowed = overflowed_.load();
+    stats.stray_resets = stray_resets_.load();
+    stats.held = held_.load();
+    return stats;
+}
+
+} // namespace DPI
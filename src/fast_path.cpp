@@ -1,22 +1,51 @@
 #include "fast_path.h"
 #include <iostream>
 #include <sstream>
+#include <cstdio>
 #include <iomanip>
 
 namespace DPI {
 
+const char* fastPathProfileToString(FastPathProfile profile) {
+    switch (profile) {
+        case FastPathProfile::FULL_DPI: return "full";
+        case FastPathProfile::SNI_ONLY: return "sni";
+        case FastPathProfile::L4_ONLY:  return "l4";
+        default:                        return "unknown";
+    }
+}
+
+bool parseFastPathProfile(const std::string& name, FastPathProfile& profile) {
+    if (name == "full") {
+        profile = FastPathProfile::FULL_DPI;
+    } else if (name == "sni") {
+        profile = FastPathProfile::SNI_ONLY;
+    } else if (name == "l4") {
+        profile = FastPathProfile::L4_ONLY;
+    } else {
+        return false;
+    }
+    return true;
+}
+
 // ============================================================================
 // FastPathProcessor Implementation
 // ============================================================================
 
 FastPathProcessor::FastPathProcessor(int fp_id,
                                      RuleManager* rule_manager,
-                                     PacketOutputCallback output_callback)
+                                     SignatureEngine* signatures,
+                                     FlowClassifier* flow_classifier,
+                                     PacketOutputCallback output_callback,
+                                     size_t queue_size)
     : fp_id_(fp_id),
-      input_queue_(10000),
+      input_queue_(queue_size, "FP input queue"),
       conn_tracker_(fp_id),
       rule_manager_(rule_manager),
+      signatures_(signatures),
+      flow_classifier_(flow_classifier),
       output_callback_(std::move(output_callback)) {
+    rule_domain_.reserve(FlowName::MAX_LENGTH);
 }
 
 FastPathProcessor::~FastPathProcessor() {
@@ -29,7 +58,7 @@ void FastPathProcessor::start() {
     running_ = true;
     thread_ = std::thread(&FastPathProcessor::run, this);
     
-    std::cout << "[FP" << fp_id_ << "] Started\n";
+    std::cout << "[FP" << fp_id_ << "] Started (profile " << fastPathProfileToString(profile_) << ")\n";
 }
 
 void FastPathProcessor::stop() {
@@ -47,100 +76,397 @@ void FastPathProcessor::stop() {
 }
 
 void FastPathProcessor::run() {
+    if (recorder_) {
+        recorder_->attachThread("FP" + std::to_string(fp_id_));
+    }
+    AllocTracker::attachThread(("FP" + std::to_string(fp_id_)).c_str(), true);
+    
+    if (perf_enabled_ && !perf_.open()) {
+        std::cerr << "[FP" << fp_id_ << "] Hardware counters unavailable\n";
+    }
+    
+    uint64_t processed = 0;
+    
+    // Pick the pipeline once; each has only its profile's stages compiled in
+    switch (profile_) {
+        case FastPathProfile::SNI_ONLY:
+            runLoop<profileStages(FastPathProfile::SNI_ONLY)>(processed);
+            break;
+        case FastPathProfile::L4_ONLY:
+            runLoop<profileStages(FastPathProfile::L4_ONLY)>(processed);
+            break;
+        default:
+            runLoop<profileStages(FastPathProfile::FULL_DPI)>(processed);
+            break;
+    }
+    
+    perf_.sample(processed);
+    perf_.close();
+    FlightRecorder::detachThread();
+}
+
+template<uint32_t Stages>
+void FastPathProcessor::runLoop(uint64_t& processed) {
+    burst_.reserve(burst_size_);
+    next_sweep_ = std::chrono::steady_clock::now() + FLOW_SWEEP_INTERVAL;
+    
     while (running_) {
-        // Get packet from input queue
-        auto job_opt = input_queue_.popWithTimeout(std::chrono::milliseconds(100));
+        // Results from the slow path first, so waiting flows see them sooner
+        drainSlowPath();
         
-        if (!job_opt) {
+        // Get packets from input queue
+        if (input_queue_.popBurst(burst_, burst_size_, std::chrono::milliseconds(100)) == 0) {
             // Periodically cleanup stale connections
             conn_tracker_.cleanupStale(std::chrono::seconds(300));
+            embryonic_.expireStale();
             continue;
         }
         
-        packets_processed_++;
-        
-        // Process the packet
-        PacketAction action = processPacket(*job_opt);
-        
-        // Call output callback
-        if (output_callback_) {
-            output_callback_(*job_opt, action);
+        // A busy FP never idles: closed flows must still go within seconds
+        auto now = std::chrono::steady_clock::now();
+        if (now >= next_sweep_) {
+            conn_tracker_.cleanupStale(std::chrono::seconds(300));
+            embryonic_.expireStale();
+            next_sweep_ = now + FLOW_SWEEP_INTERVAL;
         }
         
-        // Update stats
-        if (action == PacketAction::DROP) {
-            packets_dropped_++;
-        } else {
-            packets_forwarded_++;
+        for (PacketJob& job : burst_) {
+            packets_processed_++;
+            processed++;
+            AllocTracker::notePacket();
+            
+            // Process the packet
+            uint64_t work_start = FlightRecorder::now();
+            if (overload_ && job.enqueue_ticks != 0) {
+                overload_->recordQueueDelay(fp_id_, work_start - job.enqueue_ticks);
+            }
+            PacketAction action = processPacket<Stages>(job);
+            
+            // Per-app traffic over time (before the output takes the data)
+            if (time_series_.isEnabled()) {
+                time_series_.record(job.ts_sec, job.app_type,
+                                    job.orig_len ? job.orig_len : static_cast<uint32_t>(job.data.size()));
+            }
+            
+            // Call output callback
+            if (output_callback_) {
+                output_callback_(job, action);
+                
+                // RST / DNS answers for a blocked flow follow the dropped packet
+                for (PacketJob& response : responses_) {
+                    output_callback_(response, PacketAction::INJECT);
+                }
+            }
+            responses_.clear();
+            FlightRecorder::recordIfStall(work_start, job.packet_id);
+            
+            // Update stats
+            if (action == PacketAction::DROP) {
+                packets_dropped_++;
+            } else {
+                packets_forwarded_++;
+            }
+            
+            perf_.maybeSample(processed);
         }
     }
 }
 
+template<uint32_t Stages>
 PacketAction FastPathProcessor::processPacket(PacketJob& job) {
-    // Get or create connection
-    Connection* conn = conn_tracker_.getOrCreateConnection(job.tuple);
+    // Find the flow in either direction, or create it for the initiator
+    bool created = false;
+    Connection* conn = lookupFlow(job, created);
     if (!conn) {
-        // Should not happen, but handle gracefully
+        // Still handshaking (or should not happen): nothing to inspect yet
         return PacketAction::FORWARD;
     }
     
-    // Update connection stats
-    bool is_outbound = true;  // In this model, all packets from user are outbound
+    // First packet (usually the SYN): start from what this server ran last time
+    if (created) {
+        applyHint(conn);
+        
+        // Overloaded: settle for the hint or the port instead of inspecting
+        if (overload_ && !overload_->shouldInspect(conn->tuple)) {
+            conn->inspection_shed = true;
+            overload_->recordShedFlow();
+            classifyWithoutPayload(conn);
+        }
+    }
+    
+    // Update connection stats (outbound = from the side that opened the flow)
+    bool is_outbound = conn->tuple == job.tuple;
     conn_tracker_.updateConnection(conn, job.data.size(), is_outbound);
     
     // Update TCP state if applicable
     if (job.tuple.protocol == 6) {  // TCP
-        updateTCPState(conn, job.tcp_flags);
+        updateTCPState(conn, job, is_outbound);
     }
     
     // If connection is already blocked, drop immediately
     if (conn->state == ConnectionState::BLOCKED) {
-        return PacketAction::DROP;
+        return dropPacket(job, conn);
     }
     
-    // If connection not yet classified, try to inspect payload
-    if (conn->state != ConnectionState::CLASSIFIED && job.payload_length > 0) {
-        inspectPayload(job, conn);
+    // Flows opened while overloaded keep their hint/port verdict
+    if (conn->inspection_shed) {
+        job.flow_classified = conn->app_type != AppType::UNKNOWN;
+        job.app_type = conn->app_type;
+        PacketAction action = checkRules(conn);
+        return action == PacketAction::DROP ? dropPacket(job, conn) : action;
     }
     
+    if constexpr ((Stages & InspectStage::PAYLOAD) == 0) {
+        // No payload stages: the hint or the port is all there is
+        if (conn->state != ConnectionState::CLASSIFIED) {
+            classifyWithoutPayload(conn);
+        }
+    } else if (conn->state != ConnectionState::CLASSIFIED && job.payload_length > 0) {
+        // If connection not yet classified, try to inspect payload
+        inspectPayload<Stages>(job, conn);
+        
+        if (conn->state == ConnectionState::CLASSIFIED) {
+            FlightRecorder::record(TraceEvent::CLASSIFIED,
+                                   static_cast<uint32_t>(conn->app_type), job.packet_id);
+            publishHint(conn);
+        }
+    } else if (conn->classification_provisional && job.payload_length > 0) {
+        // A port-based guess can still be refined by the server's certificate
+        // or the flow model
+        bool refined = false;
+        if constexpr ((Stages & InspectStage::TLS_SERVER) != 0) {
+            refined = tryParseServerHandshake(job, conn);
+        }
+        if constexpr ((Stages & InspectStage::FLOW_MODEL) != 0) {
+            refined = refined || tryClassifyFlowFeatures(job, conn);
+        }
+        if (refined) {
+            publishHint(conn);
+        }
+    }
+    
+    // Output modes keep payload only for flows we could not name
+    job.flow_classified = conn->app_type != AppType::UNKNOWN;
+    job.app_type = conn->app_type;
+    
     // Check rules (even for classified connections, as rules might change)
-    return checkRules(job, conn);
+    PacketAction action = checkRules(conn);
+    return action == PacketAction::DROP ? dropPacket(job, conn) : action;
+}
+
+PacketAction FastPathProcessor::dropPacket(PacketJob& job, Connection* conn) {
+    job.verdict = conn->block_rule;
+    job.app_type = conn->app_type;
+    
+    // Tell the endpoints to stop instead of letting them retransmit
+    if (responder_) {
+        responder_->respond(job, conn, responses_);
+    }
+    return PacketAction::DROP;
+}
+
+Connection* FastPathProcessor::lookupFlow(const PacketJob& job, bool& created) {
+    constexpr uint8_t SYN = 0x02;
+    constexpr uint8_t ACK = 0x10;
+    bool tcp = job.tuple.protocol == 6;
+    bool bare_syn = tcp && (job.tcp_flags & (SYN | ACK)) == SYN && job.payload_length == 0;
+    bool syn_ack = tcp && (job.tcp_flags & (SYN | ACK)) == (SYN | ACK);
+    
+    Connection* conn = conn_tracker_.getConnection(job.tuple);
+    if (conn) {
+        // A new SYN on the ports of a closed flow starts a new connection
+        if (!bare_syn || conn->tcp.state < TcpState::TIME_WAIT) return conn;
+        conn_tracker_.removeConnection(conn);
+    }
+    
+    // A bare SYN (or SYN-ACK) waits in the embryonic table until the handshake
+    // completes, unless the IP/port rules drop it right away (the block and
+    // any RST need the Connection now); a stray RST creates nothing
+    
+    EmbryonicFlow flow;
+    EmbryonicTable::Verdict verdict = EmbryonicTable::Verdict::NOT_EMBRYONIC;
+    if (tcp && embryonic_.isEnabled() &&
+        !(bare_syn && blockedAtOpen(job.tuple)) &&
+        !(syn_ack && blockedAtOpen(job.tuple.reverse()))) {
+        verdict = embryonic_.track(job.tuple, job.tcp_flags, job.payload_length,
+                                   job.data.size(), flow);
+        if (verdict == EmbryonicTable::Verdict::HELD ||
+            verdict == EmbryonicTable::Verdict::IGNORED) return nullptr;
+    }
+    
+    if (verdict == EmbryonicTable::Verdict::PROMOTED) {
+        // Open it as the initiator did, with the handshake so far
+        conn = conn_tracker_.getOrCreateConnection(flow.tuple);
+        if (conn) {
+            conn->first_seen = flow.first_seen;
+            conn->packets_out += flow.packets_out;
+            conn->packets_in += flow.packets_in;
+            conn->bytes_out += flow.bytes_out;
+            conn->bytes_in += flow.bytes_in;
+            conn->tcp.state = flow.syn_ack_seen ? TcpState::SYN_RECEIVED : TcpState::SYN_SENT;
+        }
+    } else if (syn_ack) {
+        // An unmatched SYN-ACK always comes from the responder
+        conn = conn_tracker_.getOrCreateConnection(job.tuple.reverse());
+    } else if (tcp && !(job.tcp_flags & SYN) &&
+               job.tuple.src_port < 1024 && job.tuple.dst_port >= 1024) {
+        // Picked up midstream from the server's side: the client opened it
+        conn = conn_tracker_.getOrCreateConnection(job.tuple.reverse());
+    } else {
+        conn = conn_tracker_.getOrCreateConnection(job.tuple);
+    }
+    created = conn != nullptr;
+    return conn;
+}
+
+bool FastPathProcessor::blockedAtOpen(const FiveTuple& tuple) {
+    if (!rule_manager_) return false;
+    
+    // Nothing is classified yet (a hint would not count, see checkRules)
+    static const std::string no_name;
+    return rule_manager_->shouldBlock(tuple.src_ip, tuple.dst_port, tuple.protocol,
+                                      AppType::UNKNOWN, no_name).has_value();
+}
+
+void FastPathProcessor::applyHint(Connection* conn) {
+    const EndpointHint* hint = hint_reader_.lookup(conn->tuple.dst_ip, conn->tuple.dst_port);
+    if (!hint || hint->confidence < HINT_MIN_CONFIDENCE) {
+        return;
+    }
+    
+    // Not CLASSIFIED: payload inspection still runs and overrides the hint
+    conn->app_type = hint->app;
+    conn->sni = hint_reader_.name(hint->sni_id);
+    conn->hint_applied = true;
+    conn->hint_only = true;
+    hint_hits_++;
+}
+
+void FastPathProcessor::publishHint(Connection* conn) {
+    if (!hint_cache_ || conn->classification_provisional ||
+        conn->app_type == AppType::UNKNOWN) {
+        return;
+    }
+    
+    const EndpointHint* hint = hint_reader_.lookup(conn->tuple.dst_ip, conn->tuple.dst_port);
+    bool agrees = hint && hint->app == conn->app_type;
+    
+    if (conn->hint_applied) {
+        if (agrees) {
+            hint_confirmed_++;
+        } else {
+            hint_mismatched_++;
+        }
+    }
+    
+    // Nothing new to tell the others
+    if (agrees && hint->confidence >= HINT_MAX_CONFIDENCE) {
+        return;
+    }
+    
+    hint_cache_->publish(fp_id_, conn->tuple.dst_ip, conn->tuple.dst_port,
+                         conn->app_type, conn->sni);
 }
 
+template<uint32_t Stages>
 void FastPathProcessor::inspectPayload(PacketJob& job, Connection* conn) {
     if (job.payload_length == 0 || job.payload_offset >= job.data.size()) {
         return;
     }
     
-    const uint8_t* payload = job.data.data() + job.payload_offset;
+    // Server side of a TLS handshake (certificate names, ALPN)
+    if constexpr ((Stages & InspectStage::TLS_SERVER) != 0) {
+        if (tryParseServerHandshake(job, conn)) {
+            return;
+        }
+    }
     
     // Try TLS SNI extraction first (most common for HTTPS)
-    if (tryExtractSNI(job, conn)) {
-        return;
+    if constexpr ((Stages & InspectStage::TLS_SNI) != 0) {
+        if (tryExtractSNI(job, conn)) {
+            return;
+        }
+    }
+    
+    // QUIC Initial (UDP 443), scanned on the slow path when available
+    if constexpr ((Stages & InspectStage::QUIC) != 0) {
+        if (tryExtractQUICSNI(job, conn)) {
+            return;
+        }
     }
     
     // Try HTTP Host header extraction
-    if (tryExtractHTTPHost(job, conn)) {
-        return;
+    if constexpr ((Stages & InspectStage::HTTP) != 0) {
+        if (tryExtractHTTPHost(job, conn)) {
+            return;
+        }
     }
     
     // Check for DNS (port 53)
-    if (job.tuple.dst_port == 53 || job.tuple.src_port == 53) {
-        auto domain = DNSExtractor::extractQuery(payload, job.payload_length);
-        if (domain) {
-            conn_tracker_.classifyConnection(conn, AppType::DNS, *domain);
+    if constexpr ((Stages & InspectStage::DNS) != 0) {
+        const PortHintTable& hints = portHints();
+        if (hints.lookup(job.tuple) == AppType::DNS ||
+            hints.lookup(job.tuple.protocol, job.tuple.src_port) == AppType::DNS) {
+            const uint8_t* payload = job.data.data() + job.payload_offset;
+            auto domain = DNSExtractor::extractQueryView(payload, job.payload_length, name_scratch_);
+            if (domain) {
+                conn_tracker_.classifyConnection(conn, AppType::DNS, *domain);
+                return;
+            }
+        }
+    }
+    
+    // Protocol signatures (SSH, BitTorrent, WireGuard, ...)
+    if constexpr ((Stages & InspectStage::SIGNATURES) != 0) {
+        if (tryMatchSignatures(job, conn)) {
+            return;
+        }
+    }
+    
+    if constexpr ((Stages & InspectStage::FLOW_MODEL) != 0) {
+        // Statistical classification from the first packets of the flow
+        if (tryClassifyFlowFeatures(job, conn)) {
             return;
         }
     }
     
-    // Basic port-based classification as fallback
-    if (job.tuple.dst_port == 80) {
-        conn_tracker_.classifyConnection(conn, AppType::HTTP, "");
-    } else if (job.tuple.dst_port == 443) {
-        conn_tracker_.classifyConnection(conn, AppType::HTTPS, "");
+    // Provisional: the flow model still sees the flow and may override it
+    // at packet N (short flows keep the port/hint verdict)
+    classifyWithoutPayload(conn);
+}
+
+void FastPathProcessor::classifyWithoutPayload(Connection* conn) {
+    // Basic port-based classification as fallback (an endpoint hint beats it)
+    if (conn->hint_applied) {
+        conn_tracker_.classifyConnection(conn, conn->app_type, conn->sni);
+        conn->classification_provisional = true;
+        conn->hint_only = true;
+        return;
+    }
+    
+    AppType app = portHints().lookup(conn->tuple);
+    if (app != AppType::UNKNOWN) {
+        conn_tracker_.classifyConnection(conn, app, "");
+        conn->classification_provisional = true;
     }
 }
 
+const SignatureSet& FastPathProcessor::signatureSet() {
+    uint64_t version = signatures_->version();
+    if (!signature_set_ || version != signature_version_) {
+        signature_set_ = signatures_->get();
+        signature_version_ = version;
+    }
+    return *signature_set_;
+}
+
+const PortHintTable& FastPathProcessor::portHints() {
+    if (!signatures_) {
+        return DEFAULT_PORT_HINTS;
+    }
+    return signatureSet().portHints();
+}
+
 bool FastPathProcessor::tryExtractSNI(const PacketJob& job, Connection* conn) {
     // Only for port 443 (HTTPS) or if it looks like TLS
     if (job.tuple.dst_port != 443 && job.payload_length < 50) {
@@ -152,12 +478,13 @@ bool FastPathProcessor::tryExtractSNI(const PacketJob& job, Connection* conn) {
     }
     
     const uint8_t* payload = job.data.data() + job.payload_offset;
-    auto sni = SNIExtractor::extract(payload, job.payload_length);
+    auto sni = SNIExtractor::extractView(payload, job.payload_length, name_scratch_);
     if (sni) {
         sni_extractions_++;
         
-        // Map SNI to app type
-        AppType app = sniToAppType(*sni);
+        // Map SNI to app type (the hint already did it if the name matches)
+        AppType app = (conn->hint_applied && *sni == conn->sni.view()) ? conn->app_type
+                                                                : sniToAppType(*sni);
         conn_tracker_.classifyConnection(conn, app, *sni);
         
         if (app != AppType::UNKNOWN && app != AppType::HTTPS) {
@@ -171,8 +498,8 @@ bool FastPathProcessor::tryExtractSNI(const PacketJob& job, Connection* conn) {
 }
 
 bool FastPathProcessor::tryExtractHTTPHost(const PacketJob& job, Connection* conn) {
-    // Only for port 80 (HTTP)
-    if (job.tuple.dst_port != 80) {
+    // Only for HTTP ports
+    if (portHints().lookup(job.tuple) != AppType::HTTP) {
         return false;
     }
     
@@ -181,7 +508,7 @@ bool FastPathProcessor::tryExtractHTTPHost(const PacketJob& job, Connection* con
     }
     
     const uint8_t* payload = job.data.data() + job.payload_offset;
-    auto host = HTTPHostExtractor::extract(payload, job.payload_length);
+    auto host = HTTPHostExtractor::extractView(payload, job.payload_length, name_scratch_);
     if (host) {
         AppType app = sniToAppType(*host);
         conn_tracker_.classifyConnection(conn, app, *host);
@@ -196,45 +523,265 @@ bool FastPathProcessor::tryExtractHTTPHost(const PacketJob& job, Connection* con
     return false;
 }
 
-PacketAction FastPathProcessor::checkRules(const PacketJob& job, Connection* conn) {
+bool FastPathProcessor::tryParseServerHandshake(const PacketJob& job, Connection* conn) {
+    // Server-to-client TCP segments only, first few per flow
+    if (job.tuple.protocol != 6 || conn->tuple == job.tuple ||
+        conn->tls_server_packets >= TLS_SERVER_MAX_PACKETS) {
+        return false;
+    }
+    conn->tls_server_packets++;
+    
+    // With a slow path, only locate the certificate here; a worker walks it
+    const uint8_t* payload = job.data.data() + job.payload_offset;
+    TLSServerInfo info;
+    if (!TLSServerExtractor::parse(payload, job.payload_length, conn->tls_record_skip, info,
+                                   slow_path_ == nullptr)) {
+        return false;
+    }
+    
+    if (info.certificate_der && !info.certificate &&
+        !offloadToSlowPath(SlowPathTask::CERTIFICATE, conn,
+                           info.certificate_der, info.certificate_length)) {
+        TLSServerExtractor::parseCertificate(info.certificate_der, info.certificate_length, info);
+    }
+    
+    // TLS 1.3 encrypts the certificate; nothing more to see
+    if (info.tls13 || info.certificate_der) {
+        conn->tls_server_packets = TLS_SERVER_MAX_PACKETS;
+    }
+    
+    std::string name;
+    AppType app = selectCertificateName(info, name);
+    
+    if (!name.empty()) {
+        certificate_extractions_++;
+        if (app != AppType::HTTPS) {
+            classification_hits_++;
+        }
+        conn_tracker_.refineClassification(conn, app, name);
+        return true;
+    }
+    
+    // ALPN only says what runs on top of TLS; keep it refinable
+    if (!info.alpn.empty() && conn->state != ConnectionState::CLASSIFIED) {
+        bool web = info.alpn == "h2" || info.alpn == "http/1.1";
+        conn_tracker_.classifyConnection(conn, web ? AppType::HTTPS : AppType::TLS, "");
+        conn->classification_provisional = true;
+        return true;
+    }
+    
+    return false;
+}
+
+bool FastPathProcessor::tryExtractQUICSNI(const PacketJob& job, Connection* conn) {
+    // Client datagrams to UDP 443, first two per flow
+    if (job.tuple.protocol != 17 || job.tuple.dst_port != 443 ||
+        !(conn->tuple == job.tuple) || conn->packets_out > 2 ||
+        conn->action == PacketAction::INSPECT) {
+        return false;
+    }
+    
+    const uint8_t* payload = job.data.data() + job.payload_offset;
+    if (!QUICSNIExtractor::isQUICInitial(payload, job.payload_length)) {
+        return false;
+    }
+    
+    // Result arrives later; meanwhile the flow gets the port fallback
+    if (offloadToSlowPath(SlowPathTask::QUIC_INITIAL, conn, payload, job.payload_length)) {
+        return false;
+    }
+    
+    auto sni = QUICSNIExtractor::extractView(payload, job.payload_length, name_scratch_);
+    if (!sni) {
+        return false;
+    }
+    
+    sni_extractions_++;
+    AppType app = sniToAppType(*sni);
+    if (app == AppType::HTTPS) {
+        app = AppType::QUIC;
+    } else {
+        classification_hits_++;
+    }
+    conn_tracker_.classifyConnection(conn, app, *sni);
+    return true;
+}
+
+bool FastPathProcessor::offloadToSlowPath(SlowPathTask task, Connection* conn,
+                                          const uint8_t* data, size_t length) {
+    // One outstanding request per flow
+    if (!slow_path_ || conn->action == PacketAction::INSPECT || length == 0) {
+        return false;
+    }
+    
+    SlowPathRequest request;
+    request.task = task;
+    request.fp_id = fp_id_;
+    request.tuple = conn->tuple;
+    request.data.assign(data, data + length);
+    
+    if (!slow_path_->submit(std::move(request))) {
+        return false;
+    }
+    
+    conn->action = PacketAction::INSPECT;
+    return true;
+}
+
+void FastPathProcessor::drainSlowPath() {
+    if (!slow_path_) return;
+    
+    slow_path_->drain(fp_id_, [this](const SlowPathResult& result) {
+        applySlowPathResult(result);
+    });
+}
+
+void FastPathProcessor::applySlowPathResult(const SlowPathResult& result) {
+    // The flow may have been blocked, closed or evicted while it waited
+    Connection* conn = conn_tracker_.getConnection(result.tuple);
+    if (!conn || conn->action != PacketAction::INSPECT) {
+        slow_path_->recordStale();
+        return;
+    }
+    
+    conn->action = PacketAction::FORWARD;
+    slow_path_->recordApplied(result);
+    
+    if (result.app == AppType::UNKNOWN) {
+        return;
+    }
+    
+    if (result.task == SlowPathTask::CERTIFICATE) {
+        certificate_extractions_++;
+    } else {
+        sni_extractions_++;
+    }
+    if (result.app != AppType::HTTPS && result.app != AppType::QUIC) {
+        classification_hits_++;
+    }
+    
+    conn_tracker_.refineClassification(conn, result.app, result.name);
+    FlightRecorder::record(TraceEvent::CLASSIFIED, static_cast<uint32_t>(conn->app_type), 0);
+    publishHint(conn);
+}
+
+bool FastPathProcessor::tryMatchSignatures(const PacketJob& job, Connection* conn) {
+    if (!signatures_ || conn->signature_packets >= SIGNATURE_MAX_PACKETS) {
+        return false;
+    }
+    conn->signature_packets++;
+    
+    const uint8_t* payload = job.data.data() + job.payload_offset;
+    AppType app = signatureSet().match(payload, job.payload_length, job.tuple.protocol);
+    if (app == AppType::UNKNOWN) {
+        return false;
+    }
+    
+    signature_matches_++;
+    classification_hits_++;
+    conn_tracker_.classifyConnection(conn, app, "");
+    return true;
+}
+
+const FlowModel* FastPathProcessor::flowModel() {
+    uint64_t version = flow_classifier_->version();
+    if (version != flow_model_version_) {
+        flow_model_ = flow_classifier_->get();
+        flow_model_version_ = version;
+    }
+    return flow_model_.get();
+}
+
+bool FastPathProcessor::tryClassifyFlowFeatures(const PacketJob& job, Connection* conn) {
+    if (!flow_classifier_ || conn->features.evaluated) {
+        return false;
+    }
+    
+    // Only collect while a model is loaded
+    const FlowModel* model = flowModel();
+    if (!model) {
+        return false;
+    }
+    
+    bool is_outbound = conn->tuple == job.tuple;
+    if (!conn->features.observe(job.payload_length, is_outbound, job.ts_sec, job.ts_usec)) {
+        return false;
+    }
+    
+    // Nth payload packet: evaluate exactly once
+    conn->features.evaluated = true;
+    flow_model_evaluations_++;
+    
+    float features[FLOW_FEATURE_COUNT];
+    extractFlowFeatures(conn->features, conn->tuple, features);
+    AppType app = model->predict(features);
+    if (app == AppType::UNKNOWN) {
+        return false;
+    }
+    
+    flow_model_matches_++;
+    classification_hits_++;
+    
+    // Replaces a provisional port/hint verdict
+    conn_tracker_.refineClassification(conn, app, "");
+    return true;
+}
+
+PacketAction FastPathProcessor::checkRules(Connection* conn) {
     if (!rule_manager_) {
         return PacketAction::FORWARD;
     }
     
-    // Parse source IP from tuple
-    uint32_t src_ip = job.tuple.src_ip;
+    // Rules apply to the flow as opened (client IP, server port), so both
+    // directions get the same verdict
+    uint32_t src_ip = conn->tuple.src_ip;
+    
+    // A hint is what other flows to this endpoint were: app and domain rules
+    // wait for this flow's own ClientHello, Host, certificate, ...
+    bool hinted = conn->hint_only;
+    rule_domain_.assign(hinted ? std::string_view() : conn->sni.view());
     
     // Check blocking rules
     auto block_reason = rule_manager_->shouldBlock(
         src_ip,
-        job.tuple.dst_port,
-        conn->app_type,
-        conn->sni
+        conn->tuple.dst_port,
+        conn->tuple.protocol,
+        hinted ? AppType::UNKNOWN : conn->app_type,
+        rule_domain_
     );
     
     if (block_reason) {
-        // Log the block
-        std::ostringstream ss;
-        ss << "[FP" << fp_id_ << "] BLOCKED packet: ";
+        // Log the block, formatted on the stack (no allocation on the FP thread)
+        char line[FlowName::MAX_LENGTH + 64];
+        int length = 0;
         
         switch (block_reason->type) {
             case RuleManager::BlockReason::IP:
-                ss << "IP " << block_reason->detail;
+                length = std::snprintf(line, sizeof(line), "[FP%d] BLOCKED packet: IP %u.%u.%u.%u\n",
+                                       fp_id_, src_ip & 0xFF, (src_ip >> 8) & 0xFF,
+                                       (src_ip >> 16) & 0xFF, (src_ip >> 24) & 0xFF);
                 break;
             case RuleManager::BlockReason::APP:
-                ss << "App " << block_reason->detail;
+                length = std::snprintf(line, sizeof(line), "[FP%d] BLOCKED packet: App %s\n",
+                                       fp_id_, appTypeToString(conn->app_type).c_str());
                 break;
             case RuleManager::BlockReason::DOMAIN:
-                ss << "Domain " << block_reason->detail;
+                length = std::snprintf(line, sizeof(line), "[FP%d] BLOCKED packet: Domain %.*s\n",
+                                       fp_id_, static_cast<int>(rule_domain_.size()), rule_domain_.data());
                 break;
             case RuleManager::BlockReason::PORT:
-                ss << "Port " << block_reason->detail;
+                length = std::snprintf(line, sizeof(line), "[FP%d] BLOCKED packet: Port %u\n",
+                                       fp_id_, static_cast<unsigned>(conn->tuple.dst_port));
                 break;
         }
         
-        std::cout << ss.str() << std::endl;
+        if (length > 0) {
+            std::cout.write(line, std::min<int>(length, sizeof(line) - 1));
+            std::cout.flush();
+        }
         
-        // Mark connection as blocked
+        // Mark connection as blocked (later packets carry the same verdict)
+        conn->block_rule = block_reason->rule_id;
         conn_tracker_.blockConnection(conn);
         
         return PacketAction::DROP;
@@ -243,36 +790,102 @@ PacketAction FastPathProcessor::checkRules(const PacketJob& job, Connection* con
     return PacketAction::FORWARD;
 }
 
-void FastPathProcessor::updateTCPState(Connection* conn, uint8_t tcp_flags) {
-    constexpr uint8_t SYN = 0x02;
-    constexpr uint8_t ACK = 0x10;
+namespace {
+
+// Serial number arithmetic (RFC 1982): a is at or after b
+inline bool seqAtOrAfter(uint32_t a, uint32_t b) {
+    return static_cast<int32_t>(a - b) >= 0;
+}
+
+// An RST this far from the expected sequence number is not believed (window
+// scaling is not parsed, so the bound is fixed rather than the peer's window)
+constexpr uint32_t TCP_RST_WINDOW = 1u << 20;
+
+} // anonymous namespace
+
+void FastPathProcessor::updateTCPState(Connection* conn, const PacketJob& job, bool is_outbound) {
     constexpr uint8_t FIN = 0x01;
+    constexpr uint8_t SYN = 0x02;
     constexpr uint8_t RST = 0x04;
+    constexpr uint8_t ACK = 0x10;
+    
+    TcpTracking& tcp = conn->tcp;
+    const uint8_t flags = job.tcp_flags;
+    const int dir = is_outbound ? 0 : 1;
+    const uint8_t dir_bit = static_cast<uint8_t>(1u << dir);
+    const uint8_t peer_bit = static_cast<uint8_t>(1u << (1 - dir));
     
-    if (tcp_flags & SYN) {
-        if (tcp_flags & ACK) {
-            conn->syn_ack_seen = true;
+    if (tcp.state == TcpState::CLOSED) return;
+    
+    // A valid RST ends the flow; one far outside the window is spoofed or stale
+    if (flags & RST) {
+        int32_t offset = static_cast<int32_t>(job.tcp_seq - tcp.next_seq[dir]);
+        if ((tcp.seq_known & dir_bit) &&
+            (offset > static_cast<int32_t>(TCP_RST_WINDOW) || offset < -static_cast<int32_t>(TCP_RST_WINDOW))) {
+            tcp_invalid_resets_++;
+            return;
+        }
+        tcp.state = TcpState::CLOSED;
+        tcp_resets_++;
+        return;
+    }
+    
+    // First packet this FP sees of the flow
+    if (tcp.state == TcpState::NONE) {
+        if ((flags & (SYN | ACK)) == SYN) {
+            tcp.state = TcpState::SYN_SENT;
+        } else if (flags & SYN) {
+            tcp.state = TcpState::SYN_RECEIVED;
         } else {
-            conn->syn_seen = true;
+            tcp.state = TcpState::ESTABLISHED;
+            tcp.midstream = true;
+            tcp_midstream_++;
         }
     }
     
-    if (conn->syn_seen && conn->syn_ack_seen && (tcp_flags & ACK)) {
-        if (conn->state == ConnectionState::NEW) {
-            conn->state = ConnectionState::ESTABLISHED;
+    // Track the next sequence number each side will send (SYN and FIN count one)
+    uint32_t end = job.tcp_seq + static_cast<uint32_t>(job.payload_length) +
+                   ((flags & SYN) ? 1 : 0) + ((flags & FIN) ? 1 : 0);
+    if (!(tcp.seq_known & dir_bit) || seqAtOrAfter(end, tcp.next_seq[dir])) {
+        tcp.next_seq[dir] = end;
+        tcp.seq_known |= dir_bit;
+    }
+    
+    // Handshake
+    if (tcp.state == TcpState::SYN_SENT && !is_outbound && (flags & (SYN | ACK)) == (SYN | ACK)) {
+        tcp.state = TcpState::SYN_RECEIVED;
+    } else if ((tcp.state == TcpState::SYN_SENT || tcp.state == TcpState::SYN_RECEIVED) &&
+               !(flags & SYN)) {
+        // The initiator's ACK, or data from a handshake we only half saw
+        if ((tcp.state == TcpState::SYN_RECEIVED && is_outbound && (flags & ACK)) ||
+            job.payload_length > 0) {
+            tcp.state = TcpState::ESTABLISHED;
         }
     }
     
-    if (tcp_flags & FIN) {
-        conn->fin_seen = true;
+    // Close: each side's FIN, and the other side acknowledging it
+    if (flags & FIN) {
+        tcp.fin_sent |= dir_bit;
+        tcp.fin_seq[dir] = end;
+    }
+    if ((flags & ACK) && (tcp.fin_sent & peer_bit) && !(tcp.fin_acked & peer_bit) &&
+        seqAtOrAfter(job.tcp_ack, tcp.fin_seq[1 - dir])) {
+        tcp.fin_acked |= peer_bit;
     }
     
-    if (tcp_flags & RST) {
-        conn->state = ConnectionState::CLOSED;
+    if (tcp.fin_acked == 0x3) {
+        if (tcp.state != TcpState::TIME_WAIT) {
+            tcp.state = TcpState::TIME_WAIT;
+            tcp_fin_closes_++;
+        }
+    } else if (tcp.fin_sent == 0x3) {
+        tcp.state = TcpState::CLOSING;
+    } else if (tcp.fin_sent != 0) {
+        tcp.state = TcpState::FIN_WAIT;
     }
     
-    if (conn->fin_seen && (tcp_flags & ACK)) {
-        conn->state = ConnectionState::CLOSED;
+    if (tcp.state >= TcpState::ESTABLISHED && conn->state == ConnectionState::NEW) {
+        conn->state = ConnectionState::ESTABLISHED;
     }
 }
 
@@ -282,8 +895,22 @@ FastPathProcessor::FPStats FastPathProcessor::getStats() const {
     stats.packets_forwarded = packets_forwarded_.load();
     stats.packets_dropped = packets_dropped_.load();
     stats.connections_tracked = conn_tracker_.getActiveCount();
+    stats.pressure_evictions = conn_tracker_.getStats().pressure_evictions;
     stats.sni_extractions = sni_extractions_.load();
     stats.classification_hits = classification_hits_.load();
+    stats.signature_matches = signature_matches_.load();
+    stats.certificate_extractions = certificate_extractions_.load();
+    stats.hint_hits = hint_hits_.load();
+    stats.hint_confirmed = hint_confirmed_.load();
+    stats.hint_mismatched = hint_mismatched_.load();
+    stats.flow_model_evaluations = flow_model_evaluations_.load();
+    stats.flow_model_matches = flow_model_matches_.load();
+    stats.embryonic = embryonic_.getStats();
+    stats.tcp.midstream = tcp_midstream_.load();
+    stats.tcp.fin_closes = tcp_fin_closes_.load();
+    stats.tcp.resets = tcp_resets_.load();
+    stats.tcp.invalid_resets = tcp_invalid_resets_.load();
+    stats.tcp.reclaimed = conn_tracker_.getStats().closed_reclaimed;
     return stats;
 }
 
@@ -293,11 +920,16 @@ FastPathProcessor::FPStats FastPathProcessor::getStats() const {
 
 FPManager::FPManager(int num_fps,
                      RuleManager* rule_manager,
-                     PacketOutputCallback output_callback) {
+                     SignatureEngine* signatures,
+                     FlowClassifier* flow_classifier,
+                     PacketOutputCallback output_callback,
+                     size_t queue_size) {
     
     // Create FP processors (each has its own input queue)
     for (int i = 0; i < num_fps; i++) {
-        auto fp = std::make_unique<FastPathProcessor>(i, rule_manager, output_callback);
+        auto fp = std::make_unique<FastPathProcessor>(i, rule_manager, signatures,
+                                                      flow_classifier, output_callback,
+                                                      queue_size);
         fps_.push_back(std::move(fp));
     }
     
@@ -321,8 +953,90 @@ void FPManager::stopAll() {
     }
 }
 
+void FPManager::enablePerfCounters(bool enable) {
+    for (auto& fp : fps_) {
+        fp->enablePerfCounters(enable);
+    }
+}
+
+void FPManager::setFlightRecorder(FlightRecorder* recorder) {
+    for (auto& fp : fps_) {
+        fp->setFlightRecorder(recorder);
+    }
+}
+
+void FPManager::setHintCache(HintCache* cache) {
+    for (auto& fp : fps_) {
+        fp->setHintCache(cache);
+    }
+}
+
+void FPManager::setSlowPath(SlowPathPool* slow_path) {
+    for (auto& fp : fps_) {
+        fp->setSlowPath(slow_path);
+    }
+}
+
+void FPManager::setOverloadController(OverloadController* overload) {
+    for (auto& fp : fps_) {
+        fp->setOverloadController(overload);
+    }
+}
+
+void FPManager::setResponseSynthesizer(ResponseSynthesizer* responder) {
+    for (auto& fp : fps_) {
+        fp->setResponseSynthesizer(responder);
+    }
+}
+
+void FPManager::setProfile(FastPathProfile profile) {
+    for (auto& fp : fps_) {
+        fp->setProfile(profile);
+    }
+}
+
+void FPManager::setBurstSize(size_t burst) {
+    for (auto& fp : fps_) {
+        fp->setBurstSize(burst);
+    }
+}
+
+void FPManager::setMemoryAccountant(MemoryAccountant* memory) {
+    for (auto& fp : fps_) {
+        fp->setMemoryAccountant(memory);
+    }
+}
+
+void FPManager::setEmbryonicTable(size_t entries, std::chrono::seconds timeout) {
+    for (auto& fp : fps_) {
+        fp->setEmbryonicTable(entries, timeout);
+    }
+}
+
+void FPManager::setTimeSeriesBucket(uint32_t seconds) {
+    for (auto& fp : fps_) {
+        fp->setTimeSeriesBucket(seconds);
+    }
+}
+
+AppTimeSeriesSnapshot FPManager::getAppTimeSeries() const {
+    std::vector<const AppTimeSeries*> series;
+    for (const auto& fp : fps_) {
+        series.push_back(&fp->getTimeSeries());
+    }
+    return AppTimeSeries::merge(series);
+}
+
+PerfSample FPManager::getPerfSample() const {
+    PerfSample total;
+    for (const auto& fp : fps_) {
+        total += fp->getPerfSample();
+    }
+    return total;
+}
+
 FPManager::AggregatedStats FPManager::getAggregatedStats() const {
-    AggregatedStats stats = {0, 0, 0, 0};
+    AggregatedStats stats = {};
     
     for (const auto& fp : fps_) {
         auto fp_stats = fp->getStats();
@@ -330,12 +1044,28 @@ FPManager::AggregatedStats FPManager::getAggregatedStats() const {
         stats.total_forwarded += fp_stats.packets_forwarded;
         stats.total_dropped += fp_stats.packets_dropped;
         stats.total_connections += fp_stats.connections_tracked;
+        stats.total_hint_hits += fp_stats.hint_hits;
+        stats.total_hint_confirmed += fp_stats.hint_confirmed;
+        stats.total_hint_mismatched += fp_stats.hint_mismatched;
+        stats.total_pressure_evictions += fp_stats.pressure_evictions;
+        stats.embryonic.admitted += fp_stats.embryonic.admitted;
+        stats.embryonic.promoted += fp_stats.embryonic.promoted;
+        stats.embryonic.expired += fp_stats.embryonic.expired;
+        stats.embryonic.reset += fp_stats.embryonic.reset;
+        stats.embryonic.overflowed += fp_stats.embryonic.overflowed;
+        stats.embryonic.stray_resets += fp_stats.embryonic.stray_resets;
+        stats.embryonic.held += fp_stats.embryonic.held;
+        stats.tcp.midstream += fp_stats.tcp.midstream;
+        stats.tcp.fin_closes += fp_stats.tcp.fin_closes;
+        stats.tcp.resets += fp_stats.tcp.resets;
+        stats.tcp.invalid_resets += fp_stats.tcp.invalid_resets;
+        stats.tcp.reclaimed += fp_stats.tcp.reclaimed;
     }
     
     return stats;
 }
 
-std::string FPManager::generateClassificationReport() const {
+std::string FPManager::generateClassificationReport(const FlowSampler* sampler) const {
     // Aggregate app distribution across all FPs
     std::unordered_map<AppType, size_t> app_counts;
     std::unordered_map<std::string, size_t> domain_counts;
@@ -343,6 +1073,18 @@ std::string FPManager::generateClassificationReport() const {
     size_t total_unknown = 0;
     
     for (const auto& fp : fps_) {
+        // Flows already reclaimed (closed, idle, evicted) still count
+        const auto& retired = fp->getConnectionTracker().getRetiredApps();
+        for (size_t app = 0; app < retired.size(); app++) {
+            if (retired[app] == 0) continue;
+            app_counts[static_cast<AppType>(app)] += retired[app];
+            if (static_cast<AppType>(app) == AppType::UNKNOWN) {
+                total_unknown += retired[app];
+            } else {
+                total_classified += retired[app];
+            }
+        }
+        
         fp->getConnectionTracker().forEach([&](const Connection& conn) {
             app_counts[conn.app_type]++;
             
@@ -353,7 +1095,7 @@ std::string FPManager::generateClassificationReport() const {
             }
             
             if (!conn.sni.empty()) {
-                domain_counts[conn.sni]++;
+                domain_counts[conn.sni.str()]++;
             }
         });
     }
@@ -368,6 +1110,17 @@ std::string FPManager::generateClassificationReport() const {
     double unknown_pct = total > 0 ? (100.0 * total_unknown / total) : 0;
     
     ss << "║ Total Connections:    " << std::setw(10) << total << "                           ║\n";
+    
+    // Sampled flows stand for rate x as many; show the estimate and its 95% bound
+    bool scaled = sampler && sampler->isEnabled();
+    if (scaled) {
+        auto estimate = sampler->estimateFlows(total);
+        ss << "║ Flow Sampling:        " << std::setw(10) << ("1/" + std::to_string(sampler->getRate()))
+           << " (counts below scaled)     ║\n";
+        ss << "║ Estimated Total:      " << std::setw(10) << static_cast<uint64_t>(estimate.value)
+           << " ±" << std::setw(8) << std::left << static_cast<uint64_t>(estimate.error)
+           << std::right << "                 ║\n";
+    }
     ss << "║ Classified:           " << std::setw(10) << total_classified 
        << " (" << std::fixed << std::setprecision(1) << classified_pct << "%)                  ║\n";
     ss << "║ Unidentified:         " << std::setw(10) << total_unknown
@@ -386,6 +1139,18 @@ std::string FPManager::generateClassificationReport() const {
     for (const auto& pair : sorted_apps) {
         double pct = total > 0 ? (100.0 * pair.second / total) : 0;
         
+        if (scaled) {
+            auto estimate = sampler->estimateFlows(pair.second);
+            std::string bar(static_cast<int>(pct / 10), '#');  // 10 chars max
+            
+            ss << "║ " << std::setw(15) << std::left << appTypeToString(pair.first)
+               << std::setw(8) << std::right << static_cast<uint64_t>(estimate.value)
+               << " ±" << std::setw(7) << std::left << static_cast<uint64_t>(estimate.error)
+               << std::right << " " << std::setw(5) << std::fixed << std::setprecision(1) << pct << "% "
+               << std::setw(11) << std::left << bar << std::right << "   ║\n";
+            continue;
+        }
+        
         // Create a simple bar graph
         int bar_len = static_cast<int>(pct / 5);  // 20 chars max
         std::string bar(bar_len, '#');
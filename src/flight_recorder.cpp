@@ -0,0 +1,239 @@
+#include "flight_recorder.h"
+#include "types.h"
+#include <algorithm>
+#include <chrono>
+#include <csignal>
+#include <fstream>
+#include <iostream>
+#include <thread>
+
+#if defined(__x86_64__) || defined(__i386__)
+#if defined(_MSC_VER)
+#include <intrin.h>
+#else
+#include <x86intrin.h>
+#endif
+#define DPI_TRACE_USE_TSC 1
+#endif
+
+namespace DPI {
+
+namespace {
+
+std::atomic<bool> g_dump_requested{false};
+
+uint64_t steadyNs() {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+// Nanoseconds per tick, measured once against steady_clock
+double nsPerTick() {
+#ifdef DPI_TRACE_USE_TSC
+    static const double factor = [] {
+        uint64_t ns0 = steadyNs();
+        uint64_t t0 = __rdtsc();
+        std::this_thread::sleep_for(std::chrono::milliseconds(5));
+        uint64_t ns1 = steadyNs();
+        uint64_t t1 = __rdtsc();
+        return t1 > t0 ? static_cast<double>(ns1 - ns0) / (t1 - t0) : 1.0;
+    }();
+    return factor;
+#else
+    return 1.0;
+#endif
+}
+
+#ifdef SIGUSR2
+void handleDumpSignal(int) {
+    g_dump_requested.store(true, std::memory_order_relaxed);
+}
+#endif
+
+uint64_t roundUpPow2(uint64_t v) {
+    uint64_t p = 1;
+    while (p < v) p <<= 1;
+    return p;
+}
+
+} // anonymous namespace
+
+const char* traceEventToString(TraceEvent type) {
+    switch (type) {
+        case TraceEvent::QUEUE_FULL:   return "queue_full";
+        case TraceEvent::FLOW_EVICTED: return "flow_evicted";
+        case TraceEvent::CLASSIFIED:   return "classified";
+        case TraceEvent::RULE_RELOAD:  return "rule_reload";
+        case TraceEvent::STALL:        return "stall";
+        case TraceEvent::OVERLOAD:     return "overload";
+        default:                       return "unknown";
+    }
+}
+
+// ============================================================================
+// TraceRing Implementation
+// ============================================================================
+
+TraceRing::TraceRing(const std::string& name, size_t capacity, uint64_t stall_ticks)
+    : name_(name),
+      slots_(new Slot[roundUpPow2(capacity)]),
+      mask_(roundUpPow2(capacity) - 1),
+      stall_ticks_(stall_ticks) {
+}
+
+std::vector<TraceRecord> TraceRing::snapshot() const {
+    std::vector<TraceRecord> result;
+
+    uint64_t capacity = mask_ + 1;
+    uint64_t head = head_.load(std::memory_order_acquire);
+    uint64_t begin = head > capacity ? head - capacity : 0;
+
+    result.reserve(head - begin);
+    for (uint64_t i = begin; i < head; i++) {
+        const Slot& slot = slots_[i & mask_];
+        uint64_t word = slot.word.load(std::memory_order_relaxed);
+
+        TraceRecord rec;
+        rec.ticks = slot.ticks.load(std::memory_order_relaxed);
+        rec.type = static_cast<TraceEvent>(word >> 56);
+        rec.arg0 = static_cast<uint32_t>((word >> 32) & 0xFFFFFF);
+        rec.arg1 = static_cast<uint32_t>(word);
+        result.push_back(rec);
+    }
+
+    // Drop anything the writer may have overwritten while we were copying
+    std::atomic_thread_fence(std::memory_order_acquire);
+    uint64_t head_after = head_.load(std::memory_order_relaxed);
+    if (head_after > capacity && head_after - capacity > begin) {
+        size_t overwritten = std::min<uint64_t>(head_after - capacity - begin, result.size());
+        result.erase(result.begin(), result.begin() + overwritten);
+    }
+
+    return result;
+}
+
+// ============================================================================
+// FlightRecorder Implementation
+// ============================================================================
+
+FlightRecorder::FlightRecorder(size_t events_per_thread, uint64_t stall_threshold_us)
+    : events_per_thread_(events_per_thread),
+      start_ticks_(now()) {
+    stall_ticks_ = static_cast<uint64_t>(stall_threshold_us * 1000.0 / nsPerTick());
+}
+
+uint64_t FlightRecorder::now() {
+#ifdef DPI_TRACE_USE_TSC
+    return __rdtsc();
+#else
+    return steadyNs();
+#endif
+}
+
+uint64_t FlightRecorder::ticksToNs(uint64_t ticks) {
+    return static_cast<uint64_t>(ticks * nsPerTick());
+}
+
+FlightRecorder::~FlightRecorder() {
+    // The control thread never detaches itself; its ring is about to go
+    std::lock_guard<std::mutex> lock(rings_mutex_);
+    for (const auto& ring : rings_) {
+        if (current_ == ring.get()) {
+            current_ = nullptr;
+            break;
+        }
+    }
+}
+
+void FlightRecorder::attachThread(const std::string& name) {
+    if (!isEnabled()) return;
+
+    auto ring = std::make_unique<TraceRing>(name, events_per_thread_, stall_ticks_);
+    current_ = ring.get();
+
+    std::lock_guard<std::mutex> lock(rings_mutex_);
+    rings_.push_back(std::move(ring));
+}
+
+bool FlightRecorder::dumpChromeTrace(const std::string& path) const {
+    std::ofstream out(path);
+    if (!out.is_open()) {
+        std::cerr << "[FlightRecorder] Cannot open trace file: " << path << "\n";
+        return false;
+    }
+
+    std::lock_guard<std::mutex> lock(rings_mutex_);
+
+    // Timestamps are microseconds since the recorder was created
+    auto toUs = [this](uint64_t ticks) {
+        uint64_t delta = ticks > start_ticks_ ? ticks - start_ticks_ : 0;
+        return static_cast<double>(ticksToNs(delta)) / 1000.0;
+    };
+
+    size_t total_events = 0;
+    out << "{\"traceEvents\":[\n";
+    bool first = true;
+
+    for (size_t tid = 0; tid < rings_.size(); tid++) {
+        const TraceRing& ring = *rings_[tid];
+
+        // Thread name metadata
+        out << (first ? "" : ",\n")
+            << "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":" << tid
+            << ",\"args\":{\"name\":\"" << ring.getName() << "\"}}";
+        first = false;
+
+        for (const auto& rec : ring.snapshot()) {
+            out << ",\n{\"name\":\"" << traceEventToString(rec.type)
+                << "\",\"pid\":1,\"tid\":" << tid
+                << ",\"ts\":" << std::fixed << toUs(rec.ticks);
+
+            switch (rec.type) {
+                case TraceEvent::STALL:
+                    out << ",\"ph\":\"X\",\"dur\":" << rec.arg1
+                        << ",\"args\":{\"id\":" << rec.arg0 << "}}";
+                    break;
+                case TraceEvent::QUEUE_FULL:
+                    out << ",\"ph\":\"i\",\"s\":\"t\",\"args\":{\"queue\":" << rec.arg0
+                        << ",\"depth\":" << rec.arg1 << "}}";
+                    break;
+                case TraceEvent::FLOW_EVICTED:
+                    out << ",\"ph\":\"i\",\"s\":\"t\",\"args\":{\"reason\":\""
+                        << (rec.arg0 == EVICT_REASON_TIMEOUT ? "timeout" :
+                            rec.arg0 == EVICT_REASON_MEMORY ? "memory" : "table_full")
+                        << "\",\"count\":" << rec.arg1 << "}}";
+                    break;
+                case TraceEvent::CLASSIFIED:
+                    out << ",\"ph\":\"i\",\"s\":\"t\",\"args\":{\"app\":\""
+                        << appTypeToString(static_cast<AppType>(rec.arg0))
+                        << "\",\"packet\":" << rec.arg1 << "}}";
+                    break;
+                case TraceEvent::RULE_RELOAD:
+                    out << ",\"ph\":\"i\",\"s\":\"g\",\"args\":{\"rules\":" << rec.arg1 << "}}";
+                    break;
+                default:
+                    out << ",\"ph\":\"i\",\"s\":\"t\"}";
+                    break;
+            }
+            total_events++;
+        }
+    }
+
+    out << "\n],\"displayTimeUnit\":\"ns\"}\n";
+
+    std::cout << "[FlightRecorder] Wrote " << total_events << " events from "
+              << rings_.size() << " threads to " << path << "\n";
+    return out.good();
+}
+
+void FlightRecorder::installSignalHandler() {
+#ifdef SIGUSR2
+    std::signal(SIGUSR2, handleDumpSignal);
+#endif
+}
+
+bool FlightRecorder::consumeDumpRequest() {
+    return g_dump_requested.exchange(false, std::memory_order_relaxed);
+}
+
+} // namespace DPI
@@ -0,0 +1,292 @@
+#include "flow_classifier.h"
+#include <fstream>
+#include <sstream>
+#include <iostream>
+
+namespace DPI {
+
+namespace {
+
+// Guards the recursive tree parser against hostile model files
+constexpr size_t MAX_TREE_DEPTH = 64;
+
+struct ModelLine {
+    int line_no;
+    std::vector<std::string> tokens;
+};
+
+bool parseFeature(const std::string& name, int16_t& feature) {
+    for (uint16_t i = 0; i < FLOW_FEATURE_COUNT; i++) {
+        if (flowFeatureName(i) == name) {
+            feature = static_cast<int16_t>(i);
+            return true;
+        }
+    }
+    return false;
+}
+
+bool parseAppName(const std::string& name, AppType& app) {
+    for (int i = 0; i < static_cast<int>(AppType::APP_COUNT); i++) {
+        if (appTypeToString(static_cast<AppType>(i)) == name) {
+            app = static_cast<AppType>(i);
+            return true;
+        }
+    }
+    return false;
+}
+
+bool parseFloat(const std::string& s, float& value) {
+    try {
+        size_t used = 0;
+        value = std::stof(s, &used);
+        return used == s.size();
+    } catch (...) {
+        return false;
+    }
+}
+
+// Parse one subtree starting at lines[pos] into pre-order nodes
+bool parseSubtree(const std::vector<ModelLine>& lines, size_t& pos,
+                  std::vector<FlowModelNode>& nodes, size_t depth,
+                  size_t& max_depth, std::string& error) {
+    if (depth > MAX_TREE_DEPTH) {
+        error = "tree deeper than " + std::to_string(MAX_TREE_DEPTH);
+        return false;
+    }
+    if (pos >= lines.size() || lines[pos].tokens[0] == "tree") {
+        error = "incomplete tree";
+        return false;
+    }
+
+    const ModelLine& line = lines[pos++];
+    const auto& t = line.tokens;
+    std::string where = "line " + std::to_string(line.line_no) + ": ";
+    max_depth = std::max(max_depth, depth);
+
+    FlowModelNode node{};
+    if (t[0] == "leaf") {
+        AppType app = AppType::UNKNOWN;
+        node.value = 1.0f;
+        if (t.size() < 2 || t.size() > 3 || !parseAppName(t[1], app) ||
+            (t.size() == 3 && (!parseFloat(t[2], node.value) || node.value < 0))) {
+            error = where + "expected: leaf <App> [weight]";
+            return false;
+        }
+        node.feature = -1;
+        node.app = static_cast<uint16_t>(app);
+        nodes.push_back(node);
+        return true;
+    }
+
+    if (t[0] == "split") {
+        // split <feature> [<=] <threshold>
+        bool has_op = t.size() == 4 && t[2] == "<=";
+        if ((t.size() != 3 && !has_op) || !parseFeature(t[1], node.feature) ||
+            !parseFloat(t.back(), node.value)) {
+            error = where + "expected: split <feature> <= <threshold>";
+            return false;
+        }
+
+        size_t index = nodes.size();
+        nodes.push_back(node);
+
+        // Left child is the next node; patch the right index afterwards
+        if (!parseSubtree(lines, pos, nodes, depth + 1, max_depth, error)) return false;
+        nodes[index].right = static_cast<uint32_t>(nodes.size());
+        return parseSubtree(lines, pos, nodes, depth + 1, max_depth, error);
+    }
+
+    error = where + "unknown directive '" + t[0] + "'";
+    return false;
+}
+
+} // anonymous namespace
+
+// ============================================================================
+// Features
+// ============================================================================
+
+std::string flowFeatureName(uint16_t feature) {
+    if (feature < FEAT_IAT1) {
+        return "size" + std::to_string(feature - FEAT_SIZE0);
+    }
+    if (feature < FEAT_OUT_PACKETS) {
+        return "iat" + std::to_string(feature - FEAT_IAT1 + 1);
+    }
+    switch (feature) {
+        case FEAT_OUT_PACKETS: return "out_pkts";
+        case FEAT_IN_PACKETS:  return "in_pkts";
+        case FEAT_OUT_MEAN:    return "out_mean";
+        case FEAT_IN_MEAN:     return "in_mean";
+        case FEAT_MAX_SIZE:    return "max_size";
+        case FEAT_MIN_SIZE:    return "min_size";
+        case FEAT_PROTOCOL:    return "proto";
+        case FEAT_DST_PORT:    return "dport";
+        default:               return "?";
+    }
+}
+
+void extractFlowFeatures(const FlowFeatureState& state, const FiveTuple& tuple, float* out) {
+    float out_packets = 0, in_packets = 0;
+    float out_bytes = 0, in_bytes = 0;
+    float max_size = 0, min_size = state.count > 0 ? UINT16_MAX : 0;
+
+    for (int i = 0; i < FLOW_FEATURE_PACKETS; i++) {
+        float size = static_cast<float>(state.sizes[i]);
+        bool inbound = (state.inbound_mask >> i) & 1;
+
+        out[FEAT_SIZE0 + i] = inbound ? -size : size;
+        if (i > 0) {
+            out[FEAT_IAT1 + i - 1] = static_cast<float>(state.iats_us[i]);
+        }
+
+        if (i >= state.count) continue;
+        if (inbound) {
+            in_packets++;
+            in_bytes += size;
+        } else {
+            out_packets++;
+            out_bytes += size;
+        }
+        max_size = std::max(max_size, size);
+        min_size = std::min(min_size, size);
+    }
+
+    out[FEAT_OUT_PACKETS] = out_packets;
+    out[FEAT_IN_PACKETS] = in_packets;
+    out[FEAT_OUT_MEAN] = out_packets > 0 ? out_bytes / out_packets : 0;
+    out[FEAT_IN_MEAN] = in_packets > 0 ? in_bytes / in_packets : 0;
+    out[FEAT_MAX_SIZE] = max_size;
+    out[FEAT_MIN_SIZE] = min_size;
+    out[FEAT_PROTOCOL] = tuple.protocol;
+    out[FEAT_DST_PORT] = tuple.dst_port;
+}
+
+// ============================================================================
+// FlowModel Implementation
+// ============================================================================
+
+std::shared_ptr<const FlowModel> FlowModel::parse(const std::string& text, std::string& error) {
+    std::shared_ptr<FlowModel> model(new FlowModel());
+
+    // Tokenize non-empty lines
+    std::vector<ModelLine> lines;
+    std::istringstream stream(text);
+    std::string raw;
+    int line_no = 0;
+    while (std::getline(stream, raw)) {
+        line_no++;
+        auto hash = raw.find('#');
+        if (hash != std::string::npos) raw.erase(hash);
+
+        ModelLine line{line_no, {}};
+        std::istringstream words(raw);
+        std::string word;
+        while (words >> word) line.tokens.push_back(word);
+        if (!line.tokens.empty()) lines.push_back(std::move(line));
+    }
+
+    size_t pos = 0;
+    while (pos < lines.size()) {
+        const auto& t = lines[pos].tokens;
+        std::string where = "line " + std::to_string(lines[pos].line_no) + ": ";
+
+        if (t[0] == "min_confidence") {
+            if (t.size() != 2 || !parseFloat(t[1], model->min_confidence_) ||
+                model->min_confidence_ < 0 || model->min_confidence_ > 1) {
+                error = where + "expected: min_confidence <0..1>";
+                return nullptr;
+            }
+            pos++;
+        } else if (t[0] == "tree") {
+            pos++;
+            model->roots_.push_back(static_cast<uint32_t>(model->nodes_.size()));
+            if (!parseSubtree(lines, pos, model->nodes_, 1, model->max_depth_, error)) {
+                return nullptr;
+            }
+        } else {
+            error = where + "expected 'tree' or 'min_confidence', got '" + t[0] + "'";
+            return nullptr;
+        }
+    }
+
+    if (model->roots_.empty()) {
+        error = "model has no trees";
+        return nullptr;
+    }
+
+    return model;
+}
+
+AppType FlowModel::predict(const float* features, float* confidence) const {
+    float votes[static_cast<int>(AppType::APP_COUNT)] = {};
+    float total = 0;
+
+    const FlowModelNode* nodes = nodes_.data();
+    for (uint32_t root : roots_) {
+        uint32_t index = root;
+        while (nodes[index].feature >= 0) {
+            const FlowModelNode& node = nodes[index];
+            index = features[node.feature] <= node.value ? index + 1 : node.right;
+        }
+        votes[nodes[index].app] += nodes[index].value;
+        total += nodes[index].value;
+    }
+
+    int best = 0;
+    for (int i = 1; i < static_cast<int>(AppType::APP_COUNT); i++) {
+        if (votes[i] > votes[best]) best = i;
+    }
+
+    float share = total > 0 ? votes[best] / total : 0;
+    if (confidence) *confidence = share;
+
+    if (share < min_confidence_) {
+        return AppType::UNKNOWN;
+    }
+    return static_cast<AppType>(best);
+}
+
+size_t FlowModel::memoryBytes() const {
+    return nodes_.size() * sizeof(FlowModelNode) + roots_.size() * sizeof(uint32_t);
+}
+
+// ============================================================================
+// FlowClassifier Implementation
+// ============================================================================
+
+bool FlowClassifier::loadFromFile(const std::string& filename) {
+    std::ifstream file(filename);
+    if (!file.is_open()) {
+        std::cerr << "[FlowModel] Cannot open: " << filename << "\n";
+        return false;
+    }
+
+    std::stringstream buffer;
+    buffer << file.rdbuf();
+    return loadFromString(buffer.str(), filename);
+}
+
+bool FlowClassifier::loadFromString(const std::string& text, const std::string& source) {
+    std::string error;
+    auto model = FlowModel::parse(text, error);
+    if (!model) {
+        // Keep the previous model on any error
+        std::cerr << "[FlowModel] " << source << ": " << error << "\n";
+        return false;
+    }
+
+    std::cout << "[FlowModel] Loaded " << model->numTrees() << " trees from " << source
+              << " (" << model->numNodes() << " nodes, depth " << model->maxDepth()
+              << ", " << model->memoryBytes() << " bytes)\n";
+
+    std::atomic_store(&model_, model);
+    version_.fetch_add(1, std::memory_order_release);
+    return true;
+}
+
+std::shared_ptr<const FlowModel> FlowClassifier::get() const {
+    return std::atomic_load(&model_);
+}
+
+} // namespace DPI
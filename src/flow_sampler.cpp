@@ -0,0 +1,16 @@
+#include "flow_sampler.h"
+#include <cmath>
+
+namespace DPI {
+
+FlowSampler::Estimate FlowSampler::estimateFlows(uint64_t sampled_flows) const {
+    double n = rate_;
+    double k = static_cast<double>(sampled_flows);
+
+    Estimate estimate;
+    estimate.value = n * k;
+    estimate.error = 1.96 * std::sqrt(n * (n - 1) * k);
+    return estimate;
+}
+
+} // namespace DPI
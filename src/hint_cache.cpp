@@ -0,0 +1,220 @@
+#include "hint_cache.h"
+#include <iostream>
+
+namespace DPI {
+
+// ============================================================================
+// HintSnapshot Implementation
+// ============================================================================
+
+HintSnapshot::HintSnapshot(const std::unordered_map<uint64_t, Source>& master) {
+    // At most half full keeps probe sequences short
+    size_t capacity = 16;
+    while (capacity < master.size() * 2) capacity <<= 1;
+
+    slots_.resize(capacity);
+    mask_ = capacity - 1;
+    size_ = master.size();
+
+    names_.emplace_back();
+    std::unordered_map<std::string, uint32_t> name_ids;
+
+    for (const auto& [key, source] : master) {
+        uint32_t sni_id = 0;
+        if (!source.sni.empty()) {
+            auto it = name_ids.find(source.sni);
+            if (it == name_ids.end()) {
+                it = name_ids.emplace(source.sni, static_cast<uint32_t>(names_.size())).first;
+                names_.push_back(source.sni);
+            }
+            sni_id = it->second;
+        }
+
+        size_t i = hash(key) & mask_;
+        while (slots_[i].key != 0) i = (i + 1) & mask_;
+        slots_[i].key = key;
+        slots_[i].hint.app = source.app;
+        slots_[i].hint.confidence = source.confidence;
+        slots_[i].hint.sni_id = sni_id;
+    }
+}
+
+size_t HintSnapshot::memoryBytes() const {
+    size_t bytes = slots_.size() * sizeof(Slot) + names_.size() * sizeof(std::string);
+    for (const auto& name : names_) {
+        bytes += name.capacity();
+    }
+    return bytes;
+}
+
+// ============================================================================
+// HintCache Implementation
+// ============================================================================
+
+HintCache::HintCache(int num_writers, size_t capacity, uint32_t merge_interval_ms)
+    : capacity_(capacity),
+      merge_interval_ms_(merge_interval_ms),
+      next_decay_(std::chrono::steady_clock::now() + HINT_DECAY_INTERVAL),
+      snapshot_(std::make_shared<const HintSnapshot>()) {
+    // Both sides of every swap hold a full buffer's capacity
+    merge_batch_.reserve(HINT_WRITE_BUFFER_SIZE);
+    for (int i = 0; i < num_writers; i++) {
+        buffers_.push_back(std::make_unique<WriteBuffer>());
+        buffers_.back()->pending.reserve(HINT_WRITE_BUFFER_SIZE);
+    }
+}
+
+HintCache::~HintCache() {
+    stop();
+}
+
+void HintCache::start() {
+    if (running_) return;
+
+    stopping_ = false;
+    running_ = true;
+    thread_ = std::thread(&HintCache::run, this);
+}
+
+void HintCache::stop() {
+    if (!running_) return;
+
+    {
+        std::lock_guard<std::mutex> lock(wake_mutex_);
+        stopping_ = true;
+    }
+    wake_cv_.notify_all();
+
+    if (thread_.joinable()) {
+        thread_.join();
+    }
+    running_ = false;
+
+    // Keep whatever arrived after the last periodic merge
+    merge();
+}
+
+void HintCache::run() {
+    std::unique_lock<std::mutex> lock(wake_mutex_);
+    while (!stopping_) {
+        wake_cv_.wait_for(lock, std::chrono::milliseconds(merge_interval_ms_));
+        if (stopping_) break;
+
+        lock.unlock();
+        merge();
+        lock.lock();
+    }
+}
+
+void HintCache::publish(int writer_id, uint32_t ip, uint16_t port,
+                        AppType app, std::string_view sni) {
+    WriteBuffer& buffer = *buffers_[writer_id];
+
+    std::lock_guard<ProfiledMutex> lock(buffer.mutex);
+    if (buffer.pending.size() >= HINT_WRITE_BUFFER_SIZE) {
+        dropped_updates_.fetch_add(1, std::memory_order_relaxed);
+        return;
+    }
+    buffer.pending.push_back({HintSnapshot::makeKey(ip, port), app, sni});
+}
+
+void HintCache::merge() {
+    std::lock_guard<ProfiledMutex> merge_lock(merge_mutex_);
+
+    size_t applied = 0;
+    std::vector<Update>& batch = merge_batch_;
+
+    for (auto& buffer : buffers_) {
+        {
+            // Swap out under the writer's lock, apply without it
+            std::lock_guard<ProfiledMutex> lock(buffer->mutex);
+            batch.swap(buffer->pending);
+        }
+        for (const auto& update : batch) {
+            apply(update);
+        }
+        applied += batch.size();
+        batch.clear();
+    }
+
+    // Age the entries (publishes a snapshot even without updates)
+    bool decayed = false;
+    auto now = std::chrono::steady_clock::now();
+    if (now >= next_decay_) {
+        decayed = decay();
+        next_decay_ = now + HINT_DECAY_INTERVAL;
+    }
+
+    if (applied == 0 && !decayed) return;
+
+    updates_.fetch_add(applied, std::memory_order_relaxed);
+    merges_.fetch_add(1, std::memory_order_relaxed);
+
+    std::atomic_store(&snapshot_, std::make_shared<const HintSnapshot>(master_));
+    version_.fetch_add(1, std::memory_order_release);
+}
+
+void HintCache::apply(const Update& update) {
+    auto it = master_.find(update.key);
+
+    if (it == master_.end()) {
+        if (master_.size() >= capacity_) {
+            // Make room by forgetting endpoints seen only once
+            for (auto e = master_.begin(); e != master_.end();) {
+                e = e->second.confidence <= 1 ? master_.erase(e) : std::next(e);
+            }
+            if (master_.size() >= capacity_) {
+                dropped_updates_.fetch_add(1, std::memory_order_relaxed);
+                return;
+            }
+        }
+        master_.emplace(update.key, HintSnapshot::Source{update.app, 1, update.sni.str()});
+        return;
+    }
+
+    HintSnapshot::Source& entry = it->second;
+    if (entry.app == update.app) {
+        if (entry.confidence < HINT_MAX_CONFIDENCE) entry.confidence++;
+
+        // Several names behind one endpoint: keep the app, forget the name
+        if (entry.sni != update.sni.view()) entry.sni.clear();
+    } else {
+        entry.confidence /= 2;
+        if (entry.confidence == 0) {
+            entry = {update.app, 1, update.sni.str()};
+        }
+    }
+}
+
+bool HintCache::decay() {
+    bool changed = !master_.empty();
+    for (auto it = master_.begin(); it != master_.end();) {
+        it->second.confidence /= 2;
+        if (it->second.confidence == 0) {
+            it = master_.erase(it);
+            expired_.fetch_add(1, std::memory_order_relaxed);
+        } else {
+            ++it;
+        }
+    }
+    return changed;
+}
+
+std::shared_ptr<const HintSnapshot> HintCache::snapshot() const {
+    return std::atomic_load(&snapshot_);
+}
+
+HintCache::Stats HintCache::getStats() const {
+    auto current = snapshot();
+
+    Stats stats;
+    stats.entries = current->size();
+    stats.updates = updates_.load();
+    stats.dropped_updates = dropped_updates_.load();
+    stats.merges = merges_.load();
+    stats.expired = expired_.load();
+    stats.snapshot_bytes = current->memoryBytes();
+    return stats;
+}
+
+} // namespace DPI
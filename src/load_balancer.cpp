@@ -1,6 +1,8 @@
 #include "load_balancer.h"
 #include <iostream>
 #include <chrono>
+#include <cstring>
+#include <algorithm>
 
 namespace DPI {
 
@@ -10,13 +12,14 @@ namespace DPI {
 
 LoadBalancer::LoadBalancer(int lb_id,
                            std::vector<ThreadSafeQueue<PacketJob>*> fp_queues,
-                           int fp_start_id)
+                           int fp_start_id,
+                           size_t queue_size)
     : lb_id_(lb_id),
       fp_start_id_(fp_start_id),
       num_fps_(fp_queues.size()),
-      input_queue_(10000),
+      input_queue_(queue_size, "LB input queue"),
       fp_queues_(std::move(fp_queues)),
-      per_fp_counts_(fp_queues.size()) {
+      per_fp_counts_(num_fps_) {
 }
 
 LoadBalancer::~LoadBalancer() {
@@ -47,38 +50,84 @@ void LoadBalancer::stop() {
 }
 
 void LoadBalancer::run() {
+    if (recorder_) {
+        recorder_->attachThread("LB" + std::to_string(lb_id_));
+    }
+    AllocTracker::attachThread(("LB" + std::to_string(lb_id_)).c_str(), true);
+    
+    if (perf_enabled_ && !perf_.open()) {
+        std::cerr << "[LB" << lb_id_ << "] Hardware counters unavailable\n";
+    }
+    
+    uint64_t received = 0;
+    burst_.reserve(burst_size_);
+    
     while (running_) {
-        // Get packet from input queue (with timeout to check running flag)
-        auto job_opt = input_queue_.popWithTimeout(std::chrono::milliseconds(100));
-        
-        if (!job_opt) {
+        // Get packets from input queue (with timeout to check running flag)
+        if (input_queue_.popBurst(burst_, burst_size_, std::chrono::milliseconds(100)) == 0) {
             continue;  // Timeout or shutdown
         }
         
-        packets_received_++;
-        
-        // Select target FP based on five-tuple hash
-        int fp_index = selectFP(job_opt->tuple);
-        
-        // Push to selected FP's queue
-        fp_queues_[fp_index]->push(std::move(*job_opt));
-        
-        packets_dispatched_++;
-        per_fp_counts_[fp_index]++;
+        for (PacketJob& job : burst_) {
+            packets_received_++;
+            received++;
+            AllocTracker::notePacket();
+            
+            // Parse the frame (the callback keeps what it doesn't dispatch)
+            if (ingress_ && !ingress_(job, lb_id_)) {
+                packets_not_ingested_++;
+                perf_.maybeSample(received);
+                continue;
+            }
+            
+            // Select target FP based on five-tuple hash
+            size_t flow_hash = SymmetricTupleHash{}(job.tuple);
+            int fp_index = selectFP(flow_hash);
+            ThreadSafeQueue<PacketJob>* fp_queue = fp_queues_[fp_index];
+            
+            // Overloaded: unsampled flows and full queues go to the policy
+            // (this LB is the queue's only producer, so !isFull() means push won't block)
+            if (overload_ && (!overload_->admit(flow_hash) || fp_queue->isFull()) &&
+                overload_->bypass(job)) {
+                packets_bypassed_++;
+                perf_.maybeSample(received);
+                continue;
+            }
+            
+            // Push to selected FP's queue (backpressure shows up as a stall)
+            if (fp_queue->isFull()) {
+                FlightRecorder::record(TraceEvent::QUEUE_FULL, fp_start_id_ + fp_index,
+                                       static_cast<uint32_t>(fp_queue->size()));
+            }
+            uint64_t push_start = FlightRecorder::now();
+            job.enqueue_ticks = push_start;
+            fp_queue->push(std::move(job));
+            FlightRecorder::recordIfStall(push_start, fp_start_id_ + fp_index);
+            
+            packets_dispatched_++;
+            per_fp_counts_[fp_index]++;
+            
+            perf_.maybeSample(received);
+        }
     }
+    
+    perf_.sample(received);
+    perf_.close();
+    FlightRecorder::detachThread();
 }
 
-int LoadBalancer::selectFP(const FiveTuple& tuple) {
-    // Hash the five-tuple and map to one of our FPs
-    FiveTupleHash hasher;
-    size_t hash = hasher(tuple);
-    return hash % num_fps_;
+int LoadBalancer::selectFP(size_t flow_hash) {
+    // Map the five-tuple hash to one of our FPs
+    // (symmetric, so replies land on the FP that tracks the flow)
+    return flow_hash % num_fps_;
 }
 
 LoadBalancer::LBStats LoadBalancer::getStats() const {
     LBStats stats;
     stats.packets_received = packets_received_.load();
     stats.packets_dispatched = packets_dispatched_.load();
+    stats.packets_bypassed = packets_bypassed_.load();
+    stats.packets_not_ingested = packets_not_ingested_.load();
     
     stats.per_fp_packets = per_fp_counts_;
     
@@ -90,7 +139,8 @@ LoadBalancer::LBStats LoadBalancer::getStats() const {
 // ============================================================================
 
 LBManager::LBManager(int num_lbs, int fps_per_lb,
-                     std::vector<ThreadSafeQueue<PacketJob>*> fp_queues)
+                     std::vector<ThreadSafeQueue<PacketJob>*> fp_queues,
+                     size_t queue_size)
     : fps_per_lb_(fps_per_lb) {
     
     // Create load balancers, each handling a subset of FPs
@@ -102,7 +152,8 @@ LBManager::LBManager(int num_lbs, int fps_per_lb,
             lb_fp_queues.push_back(fp_queues[fp_start + i]);
         }
         
-        lbs_.push_back(std::make_unique<LoadBalancer>(lb_id, lb_fp_queues, fp_start));
+        lbs_.push_back(std::make_unique<LoadBalancer>(lb_id, lb_fp_queues, fp_start,
+                                                      queue_size));
     }
     
     std::cout << "[LBManager] Created " << num_lbs << " load balancers, "
@@ -127,19 +178,74 @@ void LBManager::stopAll() {
 
 LoadBalancer& LBManager::getLBForPacket(const FiveTuple& tuple) {
     // First level of load balancing: select LB based on hash
-    FiveTupleHash hasher;
+    SymmetricTupleHash hasher;
     size_t hash = hasher(tuple);
     int lb_index = hash % lbs_.size();
     return *lbs_[lb_index];
 }
 
+LoadBalancer& LBManager::getLBForFrame(const uint8_t* data, size_t len) {
+    // Ethernet + IPv4: addresses at bytes 26-29 and 30-33. Ordered, so both
+    // directions of a flow pick the same LB.
+    if (lbs_.size() == 1 || len < 34 || data[12] != 0x08 || data[13] != 0x00) {
+        return *lbs_[0];
+    }
+    
+    uint32_t a, b;
+    std::memcpy(&a, data + 26, 4);
+    std::memcpy(&b, data + 30, 4);
+    uint64_t key = (static_cast<uint64_t>(std::min(a, b)) << 32) | std::max(a, b);
+    key *= 0x9E3779B97F4A7C15ULL;
+    return *lbs_[(key >> 32) % lbs_.size()];
+}
+
+void LBManager::enablePerfCounters(bool enable) {
+    for (auto& lb : lbs_) {
+        lb->enablePerfCounters(enable);
+    }
+}
+
+void LBManager::setFlightRecorder(FlightRecorder* recorder) {
+    for (auto& lb : lbs_) {
+        lb->setFlightRecorder(recorder);
+    }
+}
+
+void LBManager::setOverloadController(OverloadController* overload) {
+    for (auto& lb : lbs_) {
+        lb->setOverloadController(overload);
+    }
+}
+
+void LBManager::setBurstSize(size_t burst) {
+    for (auto& lb : lbs_) {
+        lb->setBurstSize(burst);
+    }
+}
+
+void LBManager::setIngressCallback(const PacketIngressCallback& callback) {
+    for (auto& lb : lbs_) {
+        lb->setIngressCallback(callback);
+    }
+}
+
+PerfSample LBManager::getPerfSample() const {
+    PerfSample total;
+    for (const auto& lb : lbs_) {
+        total += lb->getPerfSample();
+    }
+    return total;
+}
+
 LBManager::AggregatedStats LBManager::getAggregatedStats() const {
-    AggregatedStats stats = {0, 0};
+    AggregatedStats stats = {0, 0, 0, 0};
     
     for (const auto& lb : lbs_) {
         auto lb_stats = lb->getStats();
         stats.total_received += lb_stats.packets_received;
         stats.total_dispatched += lb_stats.packets_dispatched;
+        stats.total_bypassed += lb_stats.packets_bypassed;
+        stats.total_not_ingested += lb_stats.packets_not_ingested;
     }
     
     return stats;
@@ -0,0 +1,346 @@
+// Micro-benchmarks for per-packet inspection costs
+//
+// Usage: dpi_bench [name ...]     (no names = run everything)
+
+#include <iostream>
+#include <iomanip>
+#include <string>
+#include <vector>
+#include <random>
+#include <chrono>
+#include <functional>
+#include <cstring>
+#include <sstream>
+
+#include "signature_engine.h"
+#include "flow_classifier.h"
+#include "sni_extractor.h"
+#include "types.h"
+
+using namespace DPI;
+
+// =============================================================================
+// Harness
+// =============================================================================
+
+// Prevent the optimizer from discarding results
+static volatile uint64_t g_sink = 0;
+
+// Run fn(i) for `iterations` calls and print ns/op
+static void runBenchmark(const std::string& name, size_t iterations,
+                         const std::function<uint64_t(size_t)>& fn) {
+    // Warm-up
+    for (size_t i = 0; i < iterations / 10 + 1; i++) {
+        g_sink = g_sink + fn(i);
+    }
+
+    auto start = std::chrono::steady_clock::now();
+    uint64_t acc = 0;
+    for (size_t i = 0; i < iterations; i++) {
+        acc += fn(i);
+    }
+    auto end = std::chrono::steady_clock::now();
+    g_sink = g_sink + acc;
+
+    double ns = std::chrono::duration<double, std::nano>(end - start).count();
+    std::cout << "  " << std::setw(36) << std::left << name
+              << std::setw(10) << std::right << std::fixed << std::setprecision(1)
+              << (ns / iterations) << " ns/op"
+              << std::setw(12) << std::setprecision(2) << (iterations / ns * 1000.0)
+              << " Mops/s\n";
+}
+
+// Random payloads with realistic sizes
+static std::vector<std::vector<uint8_t>> makeRandomPayloads(size_t count, uint32_t seed) {
+    std::mt19937 rng(seed);
+    std::uniform_int_distribution<int> size_dist(40, 1400);
+    std::uniform_int_distribution<int> byte_dist(0, 255);
+
+    std::vector<std::vector<uint8_t>> payloads(count);
+    for (auto& p : payloads) {
+        p.resize(size_dist(rng));
+        for (auto& b : p) b = static_cast<uint8_t>(byte_dist(rng));
+    }
+    return payloads;
+}
+
+// =============================================================================
+// Benchmarks
+// =============================================================================
+
+static void benchSignatures() {
+    std::cout << "\n[signatures] Payload signature automaton\n";
+
+    SignatureEngine engine;
+    auto set = engine.get();
+
+    // Mostly non-matching traffic (worst case: full scan window)
+    auto random = makeRandomPayloads(1024, 42);
+
+    // Matching payloads for each protocol
+    std::vector<std::vector<uint8_t>> matching;
+    auto add = [&](const char* prefix, size_t prefix_len, size_t total) {
+        std::vector<uint8_t> p(total, 0x41);
+        std::memcpy(p.data(), prefix, prefix_len);
+        matching.push_back(std::move(p));
+    };
+    add("SSH-2.0-OpenSSH_9.6\r\n", 21, 40);
+    add("\x13" "BitTorrent protocol", 20, 68);
+    add("\x01\x00\x00\x00", 4, 148);
+    add("d1:ad2:id20:", 12, 120);
+
+    runBenchmark("match/random-payload (udp)", 2000000, [&](size_t i) {
+        const auto& p = random[i & 1023];
+        return static_cast<uint64_t>(set->match(p.data(), p.size(), 17));
+    });
+
+    runBenchmark("match/random-payload (tcp)", 2000000, [&](size_t i) {
+        const auto& p = random[i & 1023];
+        return static_cast<uint64_t>(set->match(p.data(), p.size(), 6));
+    });
+
+    runBenchmark("match/known-protocol", 2000000, [&](size_t i) {
+        const auto& p = matching[i % matching.size()];
+        return static_cast<uint64_t>(set->match(p.data(), p.size(), (i & 1) ? 6 : 17));
+    });
+
+    std::cout << "  automaton: " << set->size() << " signatures, "
+              << set->numStates() << " states, " << set->numClasses()
+              << " byte classes, " << set->memoryBytes() << " bytes\n";
+}
+
+// Random full decision tree of the given depth, in model-file syntax
+static void appendRandomTree(std::ostringstream& out, std::mt19937& rng, int depth) {
+    if (depth == 0) {
+        const char* apps[] = {"Unknown", "Zoom", "WireGuard", "OpenVPN", "Netflix"};
+        out << "leaf " << apps[rng() % 5] << "\n";
+        return;
+    }
+    uint16_t feature = static_cast<uint16_t>(rng() % FLOW_FEATURE_COUNT);
+    out << "split " << flowFeatureName(feature) << " <= "
+        << static_cast<int>(rng() % 1500) - 200 << "\n";
+    appendRandomTree(out, rng, depth - 1);
+    appendRandomTree(out, rng, depth - 1);
+}
+
+static void benchFlowModel() {
+    std::cout << "\n[flowmodel] Flow feature extraction + decision forest\n";
+
+    constexpr int TREES = 16;
+    constexpr int DEPTH = 8;
+
+    std::mt19937 rng(7);
+    std::ostringstream text;
+    text << "min_confidence 0.4\n";
+    for (int t = 0; t < TREES; t++) {
+        text << "tree\n";
+        appendRandomTree(text, rng, DEPTH);
+    }
+
+    FlowClassifier classifier;
+    if (!classifier.loadFromString(text.str(), "<random forest>")) return;
+    auto model = classifier.get();
+
+    // Random early-flow packet trains
+    struct Train {
+        FiveTuple tuple;
+        uint16_t sizes[FLOW_FEATURE_PACKETS];
+        bool outbound[FLOW_FEATURE_PACKETS];
+        uint32_t gaps_us[FLOW_FEATURE_PACKETS];
+    };
+    std::vector<Train> trains(1024);
+    for (auto& t : trains) {
+        t.tuple = {static_cast<uint32_t>(rng()), static_cast<uint32_t>(rng()),
+                   static_cast<uint16_t>(rng()), 443,
+                   static_cast<uint8_t>((rng() & 1) ? 6 : 17)};
+        for (int i = 0; i < FLOW_FEATURE_PACKETS; i++) {
+            t.sizes[i] = static_cast<uint16_t>(rng() % 1400);
+            t.outbound[i] = rng() & 1;
+            t.gaps_us[i] = rng() % 100000;
+        }
+    }
+
+    runBenchmark("observe/per-packet", 4000000, [&](size_t i) {
+        const auto& t = trains[(i / FLOW_FEATURE_PACKETS) & 1023];
+        static FlowFeatureState state;
+        int k = i % FLOW_FEATURE_PACKETS;
+        if (k == 0) state = FlowFeatureState();
+        return static_cast<uint64_t>(state.observe(t.sizes[k], t.outbound[k], 0, t.gaps_us[k]));
+    });
+
+    runBenchmark("extract+predict/per-flow", 1000000, [&](size_t i) {
+        const auto& t = trains[i & 1023];
+        FlowFeatureState state;
+        uint32_t ts = 0;
+        for (int k = 0; k < FLOW_FEATURE_PACKETS; k++) {
+            ts += t.gaps_us[k];
+            state.observe(t.sizes[k], t.outbound[k], 0, ts);
+        }
+        float features[FLOW_FEATURE_COUNT];
+        extractFlowFeatures(state, t.tuple, features);
+        return static_cast<uint64_t>(model->predict(features));
+    });
+
+    std::cout << "  model: " << model->numTrees() << " trees, " << model->numNodes()
+              << " nodes, " << model->memoryBytes() << " bytes; per-flow state: "
+              << sizeof(FlowFeatureState) << " bytes\n";
+}
+
+// DER TLV with definite length
+static std::vector<uint8_t> der(uint8_t tag, const std::vector<uint8_t>& content) {
+    std::vector<uint8_t> out{tag};
+    size_t n = content.size();
+    if (n < 0x80) {
+        out.push_back(static_cast<uint8_t>(n));
+    } else if (n < 0x100) {
+        out.insert(out.end(), {0x81, static_cast<uint8_t>(n)});
+    } else {
+        out.insert(out.end(), {0x82, static_cast<uint8_t>(n >> 8), static_cast<uint8_t>(n)});
+    }
+    out.insert(out.end(), content.begin(), content.end());
+    return out;
+}
+
+static std::vector<uint8_t> concat(std::initializer_list<std::vector<uint8_t>> parts) {
+    std::vector<uint8_t> out;
+    for (const auto& p : parts) out.insert(out.end(), p.begin(), p.end());
+    return out;
+}
+
+static std::vector<uint8_t> derString(uint8_t tag, const std::string& s) {
+    return der(tag, std::vector<uint8_t>(s.begin(), s.end()));
+}
+
+// X.509 Name with C, O and CN attributes
+static std::vector<uint8_t> derName(const std::string& org, const std::string& cn) {
+    auto attribute = [](uint8_t oid_last, const std::string& value) {
+        return der(0x31, der(0x30, concat({der(0x06, {0x55, 0x04, oid_last}),
+                                           derString(0x0C, value)})));
+    };
+    return der(0x30, concat({attribute(0x06, "US"), attribute(0x0A, org), attribute(0x03, cn)}));
+}
+
+// Realistically sized leaf certificate (RSA-2048 key and signature)
+static std::vector<uint8_t> makeCertificate(const std::string& cn,
+                                            const std::vector<std::string>& san) {
+    std::vector<uint8_t> names;
+    for (const auto& n : san) {
+        auto name = derString(0x82, n);
+        names.insert(names.end(), name.begin(), name.end());
+    }
+
+    auto alg = der(0x30, concat({der(0x06, {0x2A, 0x86, 0x48, 0x86, 0xF7, 0x0D, 0x01, 0x01, 0x0B}),
+                                 der(0x05, {})}));
+    auto key = der(0x30, concat({der(0x30, concat({der(0x06, {0x2A, 0x86, 0x48, 0x86, 0xF7,
+                                                               0x0D, 0x01, 0x01, 0x01}),
+                                                   der(0x05, {})})),
+                                 der(0x03, std::vector<uint8_t>(271, 0x5A))}));
+    auto extensions = der(0xA3, der(0x30, concat({
+        der(0x30, concat({der(0x06, {0x55, 0x1D, 0x13}), der(0x01, {0xFF}),
+                          der(0x04, der(0x30, {}))})),
+        der(0x30, concat({der(0x06, {0x55, 0x1D, 0x11}), der(0x04, der(0x30, names))})),
+    })));
+
+    auto tbs = der(0x30, concat({
+        der(0xA0, der(0x02, {0x02})),
+        der(0x02, std::vector<uint8_t>(16, 0x11)),
+        alg,
+        derName("Example CA", "Example Issuing CA"),
+        der(0x30, concat({derString(0x17, "250101000000Z"), derString(0x17, "260101000000Z")})),
+        derName("Example Corp", cn),
+        key,
+        extensions,
+    }));
+    return der(0x30, concat({tbs, alg, der(0x03, std::vector<uint8_t>(257, 0x33))}));
+}
+
+static void benchCertificate() {
+    std::cout << "\n[certificate] TLS server handshake / DER walker\n";
+
+    auto cert = makeCertificate("www.example.com",
+                                {"www.example.com", "example.com", "static.example.com",
+                                 "api.example.com", "cdn.example.net", "*.example.org"});
+
+    // ServerHello (TLS 1.2, ALPN h2) + Certificate in one handshake record
+    std::vector<uint8_t> hello(34, 0x42);
+    hello[0] = 0x03; hello[1] = 0x03;
+    hello.insert(hello.end(), {0x00, 0xC0, 0x2F, 0x00,               // no session, suite, no comp
+                               0x00, 0x09, 0x00, 0x10, 0x00, 0x05,   // extensions: ALPN
+                               0x00, 0x03, 0x02, 'h', '2'});
+    auto handshake = [](uint8_t type, const std::vector<uint8_t>& body) {
+        size_t n = body.size();
+        std::vector<uint8_t> out{type, static_cast<uint8_t>(n >> 16),
+                                 static_cast<uint8_t>(n >> 8), static_cast<uint8_t>(n)};
+        out.insert(out.end(), body.begin(), body.end());
+        return out;
+    };
+    size_t cl = cert.size();
+    std::vector<uint8_t> cert_msg{static_cast<uint8_t>((cl + 3) >> 16),
+                                  static_cast<uint8_t>((cl + 3) >> 8),
+                                  static_cast<uint8_t>(cl + 3),
+                                  static_cast<uint8_t>(cl >> 16), static_cast<uint8_t>(cl >> 8),
+                                  static_cast<uint8_t>(cl)};
+    cert_msg.insert(cert_msg.end(), cert.begin(), cert.end());
+
+    auto messages = concat({handshake(0x02, hello), handshake(0x0B, cert_msg)});
+    std::vector<uint8_t> record{0x16, 0x03, 0x03, static_cast<uint8_t>(messages.size() >> 8),
+                                static_cast<uint8_t>(messages.size())};
+    record.insert(record.end(), messages.begin(), messages.end());
+
+    // First MSS-sized segment only (SAN list cut off)
+    size_t segment = std::min<size_t>(record.size(), 1000);
+
+    runBenchmark("certificate/DER walk", 2000000, [&](size_t) {
+        TLSServerInfo info;
+        TLSServerExtractor::parseCertificate(cert.data(), cert.size(), info);
+        return static_cast<uint64_t>(info.num_dns_names + info.common_name.size());
+    });
+
+    runBenchmark("server-flight/full record", 2000000, [&](size_t) {
+        TLSServerInfo info;
+        uint32_t skip = 0;
+        TLSServerExtractor::parse(record.data(), record.size(), skip, info);
+        return static_cast<uint64_t>(info.num_dns_names + info.alpn.size());
+    });
+
+    runBenchmark("server-flight/first segment", 2000000, [&](size_t) {
+        TLSServerInfo info;
+        uint32_t skip = 0;
+        TLSServerExtractor::parse(record.data(), segment, skip, info);
+        return static_cast<uint64_t>(info.num_dns_names + info.common_name.size() + skip);
+    });
+
+    TLSServerInfo info;
+    uint32_t skip = 0;
+    TLSServerExtractor::parse(record.data(), record.size(), skip, info);
+    std::cout << "  certificate: " << cert.size() << " bytes, CN=" << info.common_name
+              << ", " << info.num_dns_names << " SAN names, ALPN=" << info.alpn << "\n";
+}
+
+// =============================================================================
+// Main
+// =============================================================================
+
+int main(int argc, char* argv[]) {
+    struct Entry {
+        const char* name;
+        void (*fn)();
+    };
+    const Entry benchmarks[] = {
+        {"signatures", benchSignatures},
+        {"flowmodel", benchFlowModel},
+        {"certificate", benchCertificate},
+    };
+
+    std::cout << "DPI Engine micro-benchmarks\n";
+
+    for (const auto& b : benchmarks) {
+        bool selected = argc < 2;
+        for (int i = 1; i < argc; i++) {
+            if (argv[i] == std::string(b.name)) selected = true;
+        }
+        if (selected) b.fn();
+    }
+
+    return 0;
+}
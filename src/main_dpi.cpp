@@ -3,6 +3,7 @@
 #include <sstream>
 #include <vector>
 #include "dpi_engine.h"
+#include "autotuner.h"
 
 using namespace DPI;
 
@@ -24,8 +25,52 @@ Options:
   --block-app <app>      Block application (e.g., YouTube, Facebook)
   --block-domain <dom>   Block domain (supports wildcards: *.facebook.com)
   --rules <file>         Load blocking rules from file
+  --signatures <file>    Load payload signatures (default: built-in set)
+  --flow-model <file>    Decision forest for flows without SNI (first 8 packets)
+  --filter <expr>        Process only matching packets, tcpdump-style subset
+                         (e.g. "tcp port 443 and net 10.0.0.0/8")
+  --profile <p>          FP inspection pipeline: full (default) | sni (TLS/QUIC
+                         SNI only) | l4 (no payload inspection)
   --lbs <n>              Number of load balancer threads (default: 2)
   --fps <n>              FP threads per LB (default: 2)
+  --queue-size <n>       Packets per LB/FP/output queue (default: 10000)
+  --burst <n>            Packets a thread takes per queue lock (default: 1)
+  --tuning <file>        Load LB/FP counts, burst and queue size written by
+                         --autotune (options on the command line override it)
+  --autotune <file>      Calibrate those settings on a sample of the input,
+                         write them to <file>, then process with them
+  --autotune-synthetic   Calibrate on generated TLS/DNS traffic instead
+  --no-hints             Disable the shared per-server classification hints
+  --slow-path <n>        Workers for certificate/QUIC inspection (default: 2, 0 = inline)
+  --overload <policy>    Shed inspection when FPs fall behind; packets the FPs
+                         can't take are forwarded, dropped, or waited for
+                         (policy: forward | drop | block)
+  --overload-sample <n>  Flows inspected when shedding hardest: 1 in n (default: 16)
+  --snaplen <n>          Keep at most n bytes of each forwarded packet
+  --output-mode <mode>   full | headers (through L4) |
+                         unclassified-payload (payload only for unknown flows)
+  --drop-capture <file>  Write dropped packets to a pcapng file, each annotated
+                         with the rule that dropped it
+  --block-response       Answer blocked flows: TCP RST to both ends, NXDOMAIN
+                         for DNS queries (rate-limited per flow)
+  --dns-sinkhole <ip>    Answer blocked A queries with this address instead
+  --flow-memory <MB>     Flow table budget; idle and then oldest flows are
+                         evicted early as it fills (default: unlimited)
+  --queue-memory <MB>    Packet queue budget, split across all queues
+  --embryonic <n>        TCP flows per FP held until their handshake completes,
+                         so SYN floods can't evict real flows (default: 4096,
+                         0 = every SYN gets a flow table entry)
+  --buffer-pool <n>      Frame buffers recycled from output to reader
+                         (default: 8192, 0 = allocate per packet)
+  --sample <n>           Analytics only: inspect 1 in n flows, scale the report
+                         (unsampled flows are forwarded without rules)
+  --alloc-check <n>      Fail if an LB/FP thread allocates after its first n
+                         packets; report call sites (-DDPI_ALLOC_CHECK builds)
+  --timeseries-step <s>  Per-app bandwidth per s seconds of packet time
+                         (default: 1, 0 = off)
+  --timeseries <file>    Also write that time series as CSV
+  --perf                 Report per-stage hardware counters (Linux perf)
+  --trace <file>         Flight recorder dump file (written on SIGUSR2 and at exit)
   --verbose              Enable verbose output
 
 Examples:
@@ -37,15 +82,16 @@ Examples:
 Supported Apps for Blocking:
   Google, YouTube, Facebook, Instagram, Twitter/X, Netflix, Amazon,
   Microsoft, Apple, WhatsApp, Telegram, TikTok, Spotify, Zoom, Discord, GitHub
+  SSH, BitTorrent, WireGuard, OpenVPN, RTP (via payload signatures)
 
 Architecture:
   ┌─────────────┐
-  │ PCAP Reader │  Reads packets from input file
+  │ PCAP Reader │  Frames packets from input file
   └──────┬──────┘
-         │ hash(5-tuple) % num_lbs
+         │ hash(IP pair) % num_lbs
          ▼
   ┌──────┴──────┐
-  │ Load Balancer │  2 LB threads distribute to FPs
+  │ Load Balancer │  2 LB threads parse L2-L4, distribute to FPs
   │   LB0 │ LB1   │
   └──┬────┴────┬──┘
      │         │  hash(5-tuple) % fps_per_lb
@@ -90,6 +136,16 @@ int main(int argc, char* argv[]) {
     std::vector<std::string> block_apps;
     std::vector<std::string> block_domains;
     std::string rules_file;
+    bool dump_trace = false;
+    std::string autotune_file;
+    bool autotune_synthetic = false;
+    
+    // A tuning file sets the baseline; the options below override it
+    for (int i = 3; i + 1 < argc; i++) {
+        if (std::string(argv[i]) == "--tuning" && !Autotuner::load(argv[i + 1], config)) {
+            return 1;
+        }
+    }
     
     for (int i = 3; i < argc; i++) {
         std::string arg = argv[i];
@@ -102,10 +158,87 @@ int main(int argc, char* argv[]) {
             block_domains.push_back(argv[++i]);
         } else if (arg == "--rules" && i + 1 < argc) {
             rules_file = argv[++i];
+        } else if (arg == "--signatures" && i + 1 < argc) {
+            config.signatures_file = argv[++i];
+        } else if (arg == "--flow-model" && i + 1 < argc) {
+            config.flow_model_file = argv[++i];
         } else if (arg == "--lbs" && i + 1 < argc) {
             config.num_load_balancers = std::stoi(argv[++i]);
         } else if (arg == "--fps" && i + 1 < argc) {
             config.fps_per_lb = std::stoi(argv[++i]);
+        } else if (arg == "--queue-size" && i + 1 < argc) {
+            config.queue_size = std::stoul(argv[++i]);
+        } else if (arg == "--burst" && i + 1 < argc) {
+            config.burst_size = std::stoul(argv[++i]);
+        } else if (arg == "--tuning" && i + 1 < argc) {
+            i++;  // Applied before the other options
+        } else if (arg == "--autotune" && i + 1 < argc) {
+            autotune_file = argv[++i];
+        } else if (arg == "--autotune-synthetic") {
+            autotune_synthetic = true;
+        } else if (arg == "--trace" && i + 1 < argc) {
+            config.trace_file = argv[++i];
+            dump_trace = true;
+        } else if (arg == "--slow-path" && i + 1 < argc) {
+            config.slow_path_workers = std::stoi(argv[++i]);
+        } else if (arg == "--filter" && i + 1 < argc) {
+            config.capture_filter = argv[++i];
+        } else if (arg == "--profile" && i + 1 < argc) {
+            if (!parseFastPathProfile(argv[++i], config.fast_path_profile)) {
+                std::cerr << "Unknown profile: " << argv[i] << "\n";
+                return 1;
+            }
+        } else if (arg == "--overload" && i + 1 < argc) {
+            if (!parseOverloadPolicy(argv[++i], config.overload_policy)) {
+                std::cerr << "Unknown overload policy: " << argv[i] << "\n";
+                return 1;
+            }
+            config.overload_control = true;
+        } else if (arg == "--overload-sample" && i + 1 < argc) {
+            config.overload_sample_rate = std::stoi(argv[++i]);
+        } else if (arg == "--timeseries-step" && i + 1 < argc) {
+            config.timeseries_bucket_seconds = std::stoul(argv[++i]);
+        } else if (arg == "--timeseries" && i + 1 < argc) {
+            config.timeseries_file = argv[++i];
+        } else if (arg == "--snaplen" && i + 1 < argc) {
+            config.snaplen = std::stoul(argv[++i]);
+        } else if (arg == "--output-mode" && i + 1 < argc) {
+            if (!parseOutputMode(argv[++i], config.output_mode)) {
+                std::cerr << "Unknown output mode: " << argv[i] << "\n";
+                return 1;
+            }
+        } else if (arg == "--alloc-check" && i + 1 < argc) {
+            if (!AllocTracker::isCompiledIn()) {
+                std::cerr << "--alloc-check needs a build with -DDPI_ALLOC_CHECK\n";
+                return 1;
+            }
+            config.alloc_check_warmup = std::stoull(argv[++i]);
+        } else if (arg == "--buffer-pool" && i + 1 < argc) {
+            config.packet_pool_buffers = std::stoul(argv[++i]);
+        } else if (arg == "--drop-capture" && i + 1 < argc) {
+            config.drop_capture_file = argv[++i];
+        } else if (arg == "--block-response") {
+            config.block_responses = true;
+        } else if (arg == "--dns-sinkhole" && i + 1 < argc) {
+            uint8_t addr[4];
+            if (!ResponseSynthesizer::parseIPv4(argv[++i], addr)) {
+                std::cerr << "Invalid sinkhole address: " << argv[i] << "\n";
+                return 1;
+            }
+            config.dns_sinkhole = argv[i];
+            config.block_responses = true;
+        } else if (arg == "--embryonic" && i + 1 < argc) {
+            config.embryonic_entries = std::stoull(argv[++i]);
+        } else if (arg == "--flow-memory" && i + 1 < argc) {
+            config.flow_memory_budget = std::stoull(argv[++i]) * 1024 * 1024;
+        } else if (arg == "--queue-memory" && i + 1 < argc) {
+            config.queue_memory_budget = std::stoull(argv[++i]) * 1024 * 1024;
+        } else if (arg == "--sample" && i + 1 < argc) {
+            config.flow_sample_rate = std::stoi(argv[++i]);
+        } else if (arg == "--no-hints") {
+            config.hint_cache = false;
+        } else if (arg == "--perf") {
+            config.perf_counters = true;
         } else if (arg == "--verbose") {
             config.verbose = true;
         } else if (arg == "--help" || arg == "-h") {
@@ -114,6 +247,20 @@ int main(int argc, char* argv[]) {
         }
     }
     
+    // Measure the settings on this machine before the real run
+    if (!autotune_file.empty()) {
+        Autotuner tuner(config);
+        tuner.setRules(rules_file, block_ips, block_apps, block_domains);
+        bool sampled = autotune_synthetic ? tuner.generateSynthetic()
+                                          : tuner.sampleCapture(input_file);
+        if (!sampled) {
+            return 1;
+        }
+        config = tuner.run();
+        Autotuner::save(autotune_file, config, tuner.best(),
+                        autotune_synthetic ? "synthetic traffic" : input_file);
+    }
+    
     // Create DPI engine
     DPIEngine engine(config);
     
@@ -147,6 +294,15 @@ int main(int argc, char* argv[]) {
         return 1;
     }
     
+    if (dump_trace) {
+        engine.dumpTrace(config.trace_file);
+    }
+    
+    if (!engine.allocationCheckPassed()) {
+        std::cerr << "Allocation check failed: LB/FP threads allocated in steady state\n";
+        return 2;
+    }
+    
     std::cout << "\nProcessing complete!\n";
     std::cout << "Output written to: " << output_file << "\n";
     
@@ -11,6 +11,7 @@
 #include "packet_parser.h"
 #include "sni_extractor.h"
 #include "types.h"
+#include "port_table.h"
 
 using namespace PacketAnalyzer;
 using namespace DPI;
@@ -183,9 +184,11 @@ int main(int argc, char* argv[]) {
         flow.packets++;
         flow.bytes += raw.data.size();
         
+        AppType port_app = DEFAULT_PORT_HINTS.lookup(tuple);
+        
         // Try SNI extraction - even for flows already marked as generic HTTPS
         if ((flow.app_type == AppType::UNKNOWN || flow.app_type == AppType::HTTPS) && 
-            flow.sni.empty() && parsed.has_tcp && parsed.dest_port == 443) {
+            flow.sni.empty() && parsed.has_tcp && port_app == AppType::HTTPS) {
             
             size_t payload_offset = 14;
             uint8_t ip_ihl = raw.data[14] & 0x0F;
@@ -210,7 +213,7 @@ int main(int argc, char* argv[]) {
         
         // HTTP Host extraction
         if ((flow.app_type == AppType::UNKNOWN || flow.app_type == AppType::HTTP) &&
-            flow.sni.empty() && parsed.has_tcp && parsed.dest_port == 80) {
+            flow.sni.empty() && parsed.has_tcp && port_app == AppType::HTTP) {
             
             size_t payload_offset = 14;
             uint8_t ip_ihl = raw.data[14] & 0x0F;
@@ -232,15 +235,14 @@ int main(int argc, char* argv[]) {
         }
         
         // DNS classification
-        if (flow.app_type == AppType::UNKNOWN && 
-            (parsed.dest_port == 53 || parsed.src_port == 53)) {
+        if (flow.app_type == AppType::UNKNOWN &&
+            DEFAULT_PORT_HINTS.lookup(tuple.protocol, tuple.src_port) == AppType::DNS) {
             flow.app_type = AppType::DNS;
         }
         
         // Port-based fallback
         if (flow.app_type == AppType::UNKNOWN) {
-            if (parsed.dest_port == 443) flow.app_type = AppType::HTTPS;
-            else if (parsed.dest_port == 80) flow.app_type = AppType::HTTP;
+            flow.app_type = port_app;
         }
         
         // Check blocking rules
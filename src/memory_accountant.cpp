@@ -0,0 +1,128 @@
+#include "memory_accountant.h"
+
+namespace DPI {
+
+const char* memoryComponentToString(MemoryComponent component) {
+    switch (component) {
+        case MemoryComponent::FLOW_TABLES:   return "Flow Tables";
+        case MemoryComponent::PACKET_QUEUES: return "Packet Queues";
+        case MemoryComponent::RULE_SETS:     return "Rule Sets";
+        case MemoryComponent::HINT_CACHE:    return "Hint Cache";
+        default:                             return "Unknown";
+    }
+}
+
+const char* memoryPressureToString(MemoryPressure pressure) {
+    switch (pressure) {
+        case MemoryPressure::NORMAL:   return "normal";
+        case MemoryPressure::ELEVATED: return "elevated";
+        case MemoryPressure::CRITICAL: return "critical";
+        default:                       return "unknown";
+    }
+}
+
+// ============================================================================
+// MemoryAccountant Implementation
+// ============================================================================
+
+void MemoryAccountant::setBudget(MemoryComponent component, size_t bytes) {
+    slot(component).budget = bytes;
+}
+
+void MemoryAccountant::addPressureCallback(MemoryComponent component, PressureCallback callback) {
+    slot(component).callbacks.push_back(std::move(callback));
+}
+
+void MemoryAccountant::setProbe(MemoryComponent component, std::function<size_t()> probe) {
+    slot(component).probe = std::move(probe);
+}
+
+void MemoryAccountant::charge(MemoryComponent component, int64_t delta) {
+    Slot& s = slot(component);
+    int64_t now = s.charged.fetch_add(delta, std::memory_order_relaxed) + delta;
+    size_t usage = now > 0 ? static_cast<size_t>(now) : 0;
+
+    if (usage > s.peak.load(std::memory_order_relaxed)) {
+        s.peak.store(usage, std::memory_order_relaxed);
+    }
+    if (s.budget > 0) {
+        updatePressure(s, usage);
+    }
+}
+
+void MemoryAccountant::updatePressure(Slot& s, size_t usage) {
+    MemoryPressure level = MemoryPressure::NORMAL;
+    if (usage >= s.budget) {
+        level = MemoryPressure::CRITICAL;
+    } else if (usage * 100 >= s.budget * MEMORY_ELEVATED_PCT) {
+        level = MemoryPressure::ELEVATED;
+    }
+
+    // Step down only with some room to spare, so eviction does not flap
+    uint8_t current = s.pressure.load(std::memory_order_relaxed);
+    uint8_t next = static_cast<uint8_t>(level);
+    if (next < current) {
+        size_t threshold_pct = current == static_cast<uint8_t>(MemoryPressure::CRITICAL)
+                                   ? 100 : MEMORY_ELEVATED_PCT;
+        if (usage * 100 >= s.budget * (threshold_pct - MEMORY_HYSTERESIS_PCT)) {
+            return;
+        }
+    }
+
+    // Only the thread that wins the transition runs the callbacks
+    if (current == next ||
+        !s.pressure.compare_exchange_strong(current, next, std::memory_order_relaxed)) {
+        return;
+    }
+
+    if (next > current) {
+        s.pressure_events.fetch_add(1, std::memory_order_relaxed);
+    }
+    for (const auto& callback : s.callbacks) {
+        callback(level);
+    }
+}
+
+size_t MemoryAccountant::usage(MemoryComponent component) const {
+    const Slot& s = slot(component);
+    if (s.probe) {
+        size_t bytes = s.probe();
+        if (bytes > s.peak.load(std::memory_order_relaxed)) {
+            s.peak.store(bytes, std::memory_order_relaxed);
+        }
+        return bytes;
+    }
+
+    int64_t charged = s.charged.load(std::memory_order_relaxed);
+    return charged > 0 ? static_cast<size_t>(charged) : 0;
+}
+
+void MemoryAccountant::sampleProbes() const {
+    for (int i = 0; i < static_cast<int>(MemoryComponent::COMPONENT_COUNT); i++) {
+        if (slots_[i].probe) {
+            usage(static_cast<MemoryComponent>(i));
+        }
+    }
+}
+
+MemoryAccountant::ComponentStats MemoryAccountant::getStats(MemoryComponent component) const {
+    const Slot& s = slot(component);
+
+    ComponentStats stats;
+    stats.usage = usage(component);
+    stats.peak = s.peak.load();
+    stats.budget = s.budget;
+    stats.pressure = pressure(component);
+    stats.pressure_events = s.pressure_events.load();
+    return stats;
+}
+
+size_t MemoryAccountant::totalUsage() const {
+    size_t total = 0;
+    for (int i = 0; i < static_cast<int>(MemoryComponent::COMPONENT_COUNT); i++) {
+        total += usage(static_cast<MemoryComponent>(i));
+    }
+    return total;
+}
+
+} // namespace DPI
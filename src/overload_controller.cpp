@@ -0,0 +1,199 @@
+#include "overload_controller.h"
+#include <iostream>
+#include <algorithm>
+
+namespace DPI {
+
+namespace {
+
+// Verdict for packets dropped by the overload policy (see PacketJob::verdict)
+const std::string OVERLOAD_DROP_RULE = "overload:drop";
+
+} // anonymous namespace
+
+const char* overloadLevelToString(OverloadLevel level) {
+    switch (level) {
+        case OverloadLevel::NORMAL:            return "Normal";
+        case OverloadLevel::SHED_LOW_PRIORITY: return "Shed low-priority";
+        case OverloadLevel::VERDICT_ONLY:      return "Verdict only";
+        case OverloadLevel::SAMPLING:          return "Sampling";
+        default:                               return "Unknown";
+    }
+}
+
+const char* overloadPolicyToString(OverloadPolicy policy) {
+    switch (policy) {
+        case OverloadPolicy::BLOCK:   return "block";
+        case OverloadPolicy::FORWARD: return "forward";
+        case OverloadPolicy::DROP:    return "drop";
+        default:                      return "unknown";
+    }
+}
+
+bool parseOverloadPolicy(const std::string& name, OverloadPolicy& policy) {
+    if (name == "block") {
+        policy = OverloadPolicy::BLOCK;
+    } else if (name == "forward") {
+        policy = OverloadPolicy::FORWARD;
+    } else if (name == "drop") {
+        policy = OverloadPolicy::DROP;
+    } else {
+        return false;
+    }
+    return true;
+}
+
+// ============================================================================
+// OverloadController Implementation
+// ============================================================================
+
+OverloadController::OverloadController(std::vector<ThreadSafeQueue<PacketJob>*> fp_queues,
+                                       OverloadPolicy policy,
+                                       uint32_t sample_rate,
+                                       uint32_t interval_ms)
+    : fp_queues_(std::move(fp_queues)),
+      policy_(policy),
+      sample_rate_(std::max<uint32_t>(sample_rate, 1)),
+      interval_ms_(std::max<uint32_t>(interval_ms, 1)) {
+    for (size_t i = 0; i < fp_queues_.size(); i++) {
+        delays_.push_back(std::make_unique<DelaySlot>());
+    }
+}
+
+OverloadController::~OverloadController() {
+    stop();
+}
+
+void OverloadController::start() {
+    if (running_) return;
+
+    stopping_ = false;
+    running_ = true;
+    thread_ = std::thread(&OverloadController::run, this);
+
+    std::cout << "[Overload] Started (policy " << overloadPolicyToString(policy_)
+              << ", sampling 1/" << sample_rate_ << ")\n";
+}
+
+void OverloadController::stop() {
+    if (!running_) return;
+
+    {
+        std::lock_guard<std::mutex> lock(wake_mutex_);
+        stopping_ = true;
+    }
+    wake_cv_.notify_all();
+
+    if (thread_.joinable()) {
+        thread_.join();
+    }
+    running_ = false;
+}
+
+void OverloadController::run() {
+    if (recorder_) {
+        recorder_->attachThread("Overload");
+    }
+
+    std::unique_lock<std::mutex> lock(wake_mutex_);
+    while (!stopping_) {
+        wake_cv_.wait_for(lock, std::chrono::milliseconds(interval_ms_));
+        if (stopping_) break;
+
+        lock.unlock();
+        evaluate();
+        lock.lock();
+    }
+
+    FlightRecorder::detachThread();
+}
+
+bool OverloadController::bypass(PacketJob& job) {
+    switch (policy_) {
+        case OverloadPolicy::FORWARD:
+            bypass_forwarded_.fetch_add(1, std::memory_order_relaxed);
+            if (output_callback_) output_callback_(job, PacketAction::FORWARD);
+            return true;
+        case OverloadPolicy::DROP:
+            bypass_dropped_.fetch_add(1, std::memory_order_relaxed);
+            job.verdict = &OVERLOAD_DROP_RULE;
+            if (output_callback_) output_callback_(job, PacketAction::DROP);
+            return true;
+        default:
+            return false;
+    }
+}
+
+void OverloadController::evaluate() {
+    // Deepest FP queue
+    double occupancy = 0;
+    for (auto* queue : fp_queues_) {
+        occupancy = std::max(occupancy, 100.0 * queue->size() / queue->capacity());
+    }
+
+    // Longest wait since the last sample
+    uint64_t delay_ticks = 0;
+    for (auto& slot : delays_) {
+        delay_ticks = std::max(delay_ticks, slot->max_ticks.exchange(0, std::memory_order_relaxed));
+    }
+    uint64_t delay_us = FlightRecorder::ticksToNs(delay_ticks) / 1000;
+
+    uint64_t occupancy_permille = static_cast<uint64_t>(occupancy * 10);
+    if (occupancy_permille > max_occupancy_permille_.load(std::memory_order_relaxed)) {
+        max_occupancy_permille_.store(occupancy_permille, std::memory_order_relaxed);
+    }
+    if (delay_us > max_delay_us_.load(std::memory_order_relaxed)) {
+        max_delay_us_.store(delay_us, std::memory_order_relaxed);
+    }
+
+    // Highest level whose occupancy or delay threshold is crossed
+    uint8_t target = 0;
+    for (uint8_t i = 0; i < 3; i++) {
+        if (occupancy >= OVERLOAD_OCCUPANCY_PCT[i] || delay_us >= OVERLOAD_DELAY_US[i]) {
+            target = i + 1;
+        }
+    }
+
+    uint8_t current = level_.load(std::memory_order_relaxed);
+    level_ms_[current].fetch_add(interval_ms_, std::memory_order_relaxed);
+
+    uint8_t next = current;
+    if (target > current) {
+        next = target;
+        escalations_.fetch_add(1, std::memory_order_relaxed);
+    } else if (target < current && ++calm_intervals_ >= OVERLOAD_CALM_INTERVALS) {
+        next = current - 1;
+        recoveries_.fetch_add(1, std::memory_order_relaxed);
+    } else if (target == current) {
+        calm_intervals_ = 0;
+    }
+
+    if (next == current) return;
+
+    calm_intervals_ = 0;
+    level_.store(next, std::memory_order_relaxed);
+
+    FlightRecorder::record(TraceEvent::OVERLOAD, next, static_cast<uint32_t>(occupancy));
+    std::cout << "[Overload] " << overloadLevelToString(static_cast<OverloadLevel>(current))
+              << " -> " << overloadLevelToString(static_cast<OverloadLevel>(next))
+              << " (queue " << static_cast<int>(occupancy) << "%, delay "
+              << delay_us << " us)\n";
+}
+
+OverloadController::Stats OverloadController::getStats() const {
+    Stats stats;
+    stats.level = level();
+    stats.escalations = escalations_.load();
+    stats.recoveries = recoveries_.load();
+    for (int i = 0; i < static_cast<int>(OverloadLevel::LEVEL_COUNT); i++) {
+        stats.level_ms[i] = level_ms_[i].load();
+    }
+    stats.shed_flows = shed_flows_.load();
+    stats.bypass_forwarded = bypass_forwarded_.load();
+    stats.bypass_dropped = bypass_dropped_.load();
+    stats.max_occupancy_pct = max_occupancy_permille_.load() / 10.0;
+    stats.max_delay_us = max_delay_us_.load();
+    return stats;
+}
+
+} // namespace DPI
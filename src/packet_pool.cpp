@@ -0,0 +1,41 @@
+#include "packet_pool.h"
+
+namespace DPI {
+
+PacketBufferPool::PacketBufferPool(size_t capacity) {
+    if (capacity > 0) {
+        ring_ = std::make_unique<SpscRing<std::vector<uint8_t>>>(capacity);
+    }
+}
+
+std::vector<uint8_t> PacketBufferPool::acquire() {
+    std::vector<uint8_t> buffer;
+    if (ring_ && ring_->tryPop(buffer)) {
+        recycled_.fetch_add(1, std::memory_order_relaxed);
+        return buffer;
+    }
+    allocated_.fetch_add(1, std::memory_order_relaxed);
+    return buffer;
+}
+
+void PacketBufferPool::release(std::vector<uint8_t>&& buffer) {
+    // Nothing to reuse in a buffer that was moved out or never allocated
+    if (!ring_ || buffer.capacity() == 0) {
+        return;
+    }
+
+    buffer.clear();
+    if (!ring_->tryPush(std::move(buffer))) {
+        discarded_.fetch_add(1, std::memory_order_relaxed);
+    }
+}
+
+PacketBufferPool::Stats PacketBufferPool::getStats() const {
+    Stats stats;
+    stats.recycled = recycled_.load();
+    stats.allocated = allocated_.load();
+    stats.discarded = discarded_.load();
+    return stats;
+}
+
+} // namespace DPI
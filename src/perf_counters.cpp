@@ -0,0 +1,206 @@
+#include "perf_counters.h"
+#include <sstream>
+#include <iomanip>
+
+#ifdef __linux__
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#include <cstring>
+#endif
+
+namespace DPI {
+
+// ============================================================================
+// PerfSample
+// ============================================================================
+
+PerfSample& PerfSample::operator+=(const PerfSample& other) {
+    if (!other.valid) return *this;
+
+    for (int i = 0; i < NUM_PERF_COUNTERS; i++) {
+        values[i] += other.values[i];
+    }
+    packets += other.packets;
+    valid = true;
+    return *this;
+}
+
+// ============================================================================
+// PerfCounterGroup Implementation
+// ============================================================================
+
+PerfCounterGroup::PerfCounterGroup() {
+    for (int i = 0; i < NUM_PERF_COUNTERS; i++) {
+        fds_[i] = -1;
+        slot_[i] = -1;
+        values_[i].store(0, std::memory_order_relaxed);
+    }
+}
+
+PerfCounterGroup::~PerfCounterGroup() {
+    close();
+}
+
+#ifdef __linux__
+
+namespace {
+
+// Event type/config for each counter slot
+struct PerfEventSpec {
+    uint32_t type;
+    uint64_t config;
+};
+
+constexpr PerfEventSpec PERF_EVENT_SPECS[NUM_PERF_COUNTERS] = {
+    {PERF_TYPE_HARDWARE, PERF_COUNT_HW_CPU_CYCLES},
+    {PERF_TYPE_HARDWARE, PERF_COUNT_HW_INSTRUCTIONS},
+    {PERF_TYPE_HW_CACHE, PERF_COUNT_HW_CACHE_L1D |
+                         (PERF_COUNT_HW_CACHE_OP_READ << 8) |
+                         (PERF_COUNT_HW_CACHE_RESULT_MISS << 16)},
+    {PERF_TYPE_HARDWARE, PERF_COUNT_HW_CACHE_MISSES},
+    {PERF_TYPE_HARDWARE, PERF_COUNT_HW_BRANCH_MISSES},
+};
+
+int perfEventOpen(const PerfEventSpec& spec, int group_fd) {
+    perf_event_attr attr;
+    std::memset(&attr, 0, sizeof(attr));
+    attr.size = sizeof(attr);
+    attr.type = spec.type;
+    attr.config = spec.config;
+    attr.disabled = (group_fd == -1) ? 1 : 0;  // Leader starts disabled
+    attr.exclude_kernel = 1;
+    attr.exclude_hv = 1;
+    attr.read_format = PERF_FORMAT_GROUP |
+                       PERF_FORMAT_TOTAL_TIME_ENABLED |
+                       PERF_FORMAT_TOTAL_TIME_RUNNING;
+
+    // pid = 0, cpu = -1: measure the calling thread on any CPU
+    return static_cast<int>(syscall(SYS_perf_event_open, &attr, 0, -1, group_fd, 0));
+}
+
+} // anonymous namespace
+
+bool PerfCounterGroup::open() {
+    if (isOpen()) return true;
+
+    // Cycles is the group leader; without it there is nothing to normalize
+    leader_fd_ = perfEventOpen(PERF_EVENT_SPECS[0], -1);
+    if (leader_fd_ < 0) {
+        return false;
+    }
+    fds_[0] = leader_fd_;
+    slot_[0] = 0;
+    num_open_ = 1;
+
+    // Remaining members are best-effort (not every PMU exposes all events)
+    for (int i = 1; i < NUM_PERF_COUNTERS; i++) {
+        fds_[i] = perfEventOpen(PERF_EVENT_SPECS[i], leader_fd_);
+        if (fds_[i] >= 0) {
+            slot_[i] = num_open_++;
+        }
+    }
+
+    ioctl(leader_fd_, PERF_EVENT_IOC_RESET, PERF_IOC_FLAG_GROUP);
+    ioctl(leader_fd_, PERF_EVENT_IOC_ENABLE, PERF_IOC_FLAG_GROUP);
+    return true;
+}
+
+void PerfCounterGroup::close() {
+    if (leader_fd_ >= 0) {
+        ioctl(leader_fd_, PERF_EVENT_IOC_DISABLE, PERF_IOC_FLAG_GROUP);
+    }
+
+    // Members first, leader last
+    for (int i = NUM_PERF_COUNTERS - 1; i >= 0; i--) {
+        if (fds_[i] >= 0) {
+            ::close(fds_[i]);
+            fds_[i] = -1;
+        }
+        slot_[i] = -1;
+    }
+    leader_fd_ = -1;
+    num_open_ = 0;
+}
+
+void PerfCounterGroup::sample(uint64_t packets) {
+    if (leader_fd_ < 0) return;
+
+    // Layout: nr, time_enabled, time_running, value[nr]
+    uint64_t buf[3 + NUM_PERF_COUNTERS];
+    ssize_t n = ::read(leader_fd_, buf, sizeof(buf));
+    if (n < static_cast<ssize_t>(3 * sizeof(uint64_t))) return;
+
+    uint64_t nr = buf[0];
+    uint64_t time_enabled = buf[1];
+    uint64_t time_running = buf[2];
+
+    // Scale for multiplexing if the PMU was shared with other groups
+    double scale = 1.0;
+    if (time_running > 0 && time_running < time_enabled) {
+        scale = static_cast<double>(time_enabled) / time_running;
+    }
+
+    for (int i = 0; i < NUM_PERF_COUNTERS; i++) {
+        if (slot_[i] < 0 || static_cast<uint64_t>(slot_[i]) >= nr) continue;
+        uint64_t raw = buf[3 + slot_[i]];
+        values_[i].store(static_cast<uint64_t>(raw * scale), std::memory_order_relaxed);
+    }
+
+    packets_.store(packets, std::memory_order_relaxed);
+    valid_.store(true, std::memory_order_release);
+}
+
+#else  // !__linux__
+
+bool PerfCounterGroup::open() {
+    return false;
+}
+
+void PerfCounterGroup::close() {
+}
+
+void PerfCounterGroup::sample(uint64_t) {
+}
+
+#endif
+
+PerfSample PerfCounterGroup::snapshot() const {
+    PerfSample result;
+    result.valid = valid_.load(std::memory_order_acquire);
+    if (!result.valid) return result;
+
+    for (int i = 0; i < NUM_PERF_COUNTERS; i++) {
+        result.values[i] = values_[i].load(std::memory_order_relaxed);
+    }
+    result.packets = packets_.load(std::memory_order_relaxed);
+    return result;
+}
+
+// ============================================================================
+// Reporting
+// ============================================================================
+
+std::string formatPerfRow(const std::string& stage, const PerfSample& sample) {
+    std::ostringstream ss;
+    ss << "║ " << std::setw(7) << std::left << stage << std::right;
+
+    if (!sample.valid || sample.packets == 0) {
+        ss << std::setw(51) << "n/a" << "   ║\n";
+        return ss.str();
+    }
+
+    ss << std::fixed << std::setprecision(0)
+       << std::setw(9) << sample.perPacket(PerfCounter::CYCLES)
+       << std::setw(9) << sample.perPacket(PerfCounter::INSTRUCTIONS)
+       << std::setprecision(2)
+       << std::setw(6) << sample.ipc()
+       << std::setw(9) << sample.perPacket(PerfCounter::L1D_MISSES)
+       << std::setw(9) << sample.perPacket(PerfCounter::LLC_MISSES)
+       << std::setw(9) << sample.perPacket(PerfCounter::BRANCH_MISSES)
+       << "   ║\n";
+    return ss.str();
+}
+
+} // namespace DPI
@@ -0,0 +1,344 @@
+#include "response_synthesizer.h"
+#include "packet_parser.h"
+#include <cstring>
+
+namespace DPI {
+
+namespace {
+// Frame layout shared by both templates (Ethernet II + IPv4 without options)
+constexpr size_t ETH_DST = 0;
+constexpr size_t ETH_SRC = 6;
+constexpr size_t IP_TOTAL_LENGTH = 16;
+constexpr size_t IP_CHECKSUM = 24;
+constexpr size_t IP_SRC = 26;
+constexpr size_t IP_DST = 30;
+constexpr size_t L4_SRC_PORT = 34;
+constexpr size_t L4_DST_PORT = 36;
+constexpr size_t TCP_SEQ = 38;
+constexpr size_t TCP_ACK = 42;
+constexpr size_t TCP_FLAGS_WORD = 46;         // Data offset + flags
+constexpr size_t TCP_CHECKSUM = 50;
+constexpr size_t UDP_LENGTH = 38;
+constexpr size_t UDP_CHECKSUM = 40;
+constexpr size_t DNS_ID = 42;
+constexpr size_t DNS_FLAGS = 44;
+constexpr size_t DNS_ANCOUNT = 48;
+constexpr size_t NO_CHECKSUM = 0;             // Offset 0 is never a checksum
+
+uint16_t read16(const uint8_t* data) {
+    return static_cast<uint16_t>((data[0] << 8) | data[1]);
+}
+
+uint32_t read32(const uint8_t* data) {
+    return (static_cast<uint32_t>(data[0]) << 24) | (static_cast<uint32_t>(data[1]) << 16) |
+           (static_cast<uint32_t>(data[2]) << 8) | data[3];
+}
+
+void write16(uint8_t* data, uint16_t value) {
+    data[0] = static_cast<uint8_t>(value >> 8);
+    data[1] = static_cast<uint8_t>(value);
+}
+
+// One's complement sum of big-endian words (odd tail padded with zero)
+uint32_t onesSum(const uint8_t* data, size_t length, uint32_t sum = 0) {
+    for (size_t i = 0; i + 1 < length; i += 2) {
+        sum += read16(data + i);
+    }
+    if (length & 1) {
+        sum += static_cast<uint32_t>(data[length - 1]) << 8;
+    }
+    return sum;
+}
+
+uint16_t fold(uint32_t sum) {
+    while (sum >> 16) {
+        sum = (sum & 0xFFFF) + (sum >> 16);
+    }
+    return static_cast<uint16_t>(~sum);
+}
+
+// RFC 1624 eqn. 3: HC' = ~(~HC + ~m + m')
+uint16_t checksumAdjust(uint16_t checksum, uint16_t old_word, uint16_t new_word) {
+    uint32_t sum = static_cast<uint16_t>(~checksum);
+    sum += static_cast<uint16_t>(~old_word);
+    sum += new_word;
+    return fold(sum);
+}
+
+// Replace the word at offset and fix up to two checksums that cover it
+void patch16(uint8_t* frame, size_t offset, uint16_t value,
+             size_t checksum_a, size_t checksum_b = NO_CHECKSUM) {
+    uint16_t old_word = read16(frame + offset);
+    write16(frame + offset, value);
+
+    for (size_t checksum : {checksum_a, checksum_b}) {
+        if (checksum != NO_CHECKSUM) {
+            write16(frame + checksum, checksumAdjust(read16(frame + checksum), old_word, value));
+        }
+    }
+}
+
+void patch32(uint8_t* frame, size_t offset, uint32_t value,
+             size_t checksum_a, size_t checksum_b = NO_CHECKSUM) {
+    patch16(frame, offset, static_cast<uint16_t>(value >> 16), checksum_a, checksum_b);
+    patch16(frame, offset + 2, static_cast<uint16_t>(value), checksum_a, checksum_b);
+}
+
+// Addresses/ports of the reply; to_sender reverses the dropped packet's direction
+void patchEndpoints(uint8_t* frame, const uint8_t* packet, size_t transport_offset,
+                    bool to_sender, size_t l4_checksum) {
+    const uint8_t* ip = packet + 14;
+    const uint8_t* l4 = packet + transport_offset;
+
+    std::memcpy(frame + ETH_DST, packet + (to_sender ? ETH_SRC : ETH_DST), 6);
+    std::memcpy(frame + ETH_SRC, packet + (to_sender ? ETH_DST : ETH_SRC), 6);
+
+    patch32(frame, IP_SRC, read32(ip + (to_sender ? 16 : 12)), IP_CHECKSUM, l4_checksum);
+    patch32(frame, IP_DST, read32(ip + (to_sender ? 12 : 16)), IP_CHECKSUM, l4_checksum);
+    patch16(frame, L4_SRC_PORT, read16(l4 + (to_sender ? 2 : 0)), l4_checksum);
+    patch16(frame, L4_DST_PORT, read16(l4 + (to_sender ? 0 : 2)), l4_checksum);
+}
+
+PacketJob makeJob(const PacketJob& job, const uint8_t* frame, size_t length, bool to_sender) {
+    PacketJob reply;
+    reply.packet_id = job.packet_id;
+    reply.tuple = to_sender ? job.tuple.reverse() : job.tuple;
+    reply.data.assign(frame, frame + length);
+    reply.ip_offset = 14;
+    reply.transport_offset = L4_SRC_PORT;
+    reply.ts_sec = job.ts_sec;
+    reply.ts_usec = job.ts_usec;
+    reply.orig_len = static_cast<uint32_t>(length);
+    reply.flow_classified = true;
+    return reply;
+}
+} // namespace
+
+// ============================================================================
+// ResponseSynthesizer Implementation
+// ============================================================================
+
+ResponseSynthesizer::ResponseSynthesizer(const std::string& sinkhole, uint32_t max_per_second)
+    : max_per_second_(max_per_second) {
+    if (!sinkhole.empty()) {
+        has_sinkhole_ = parseIPv4(sinkhole, sinkhole_);
+    }
+    buildTemplates();
+}
+
+bool ResponseSynthesizer::parseIPv4(const std::string& text, uint8_t addr[4]) {
+    int octet = 0;
+    int digits = 0;
+    int index = 0;
+
+    for (char c : text) {
+        if (c >= '0' && c <= '9') {
+            octet = octet * 10 + (c - '0');
+            if (++digits > 3 || octet > 255) return false;
+        } else if (c == '.' && digits > 0 && index < 3) {
+            addr[index++] = static_cast<uint8_t>(octet);
+            octet = 0;
+            digits = 0;
+        } else {
+            return false;
+        }
+    }
+    if (digits == 0 || index != 3) return false;
+
+    addr[3] = static_cast<uint8_t>(octet);
+    return true;
+}
+
+void ResponseSynthesizer::buildTemplates() {
+    // Ethernet + IPv4 header shared by both (addresses zero until patched)
+    static const uint8_t ip_header[34] = {
+        0, 0, 0, 0, 0, 0,  0, 0, 0, 0, 0, 0,  0x08, 0x00,
+        0x45, 0x00, 0x00, 0x00,         // Version/IHL, TOS, total length
+        0x00, 0x00, 0x40, 0x00,         // ID, DF
+        0x40, 0x00, 0x00, 0x00,         // TTL 64, protocol, checksum
+        0, 0, 0, 0,  0, 0, 0, 0         // Source, destination
+    };
+
+    std::memcpy(tcp_template_, ip_header, sizeof(ip_header));
+    std::memset(tcp_template_ + 34, 0, TCP_TEMPLATE_SIZE - 34);
+    write16(tcp_template_ + IP_TOTAL_LENGTH, TCP_TEMPLATE_SIZE - 14);
+    tcp_template_[23] = 6;
+    tcp_template_[TCP_FLAGS_WORD] = 0x50;                  // 20-byte header, window 0
+    write16(tcp_template_ + IP_CHECKSUM, fold(onesSum(tcp_template_ + 14, 20)));
+
+    // TCP checksum: header + pseudo-header (zero addresses, protocol, length)
+    uint32_t tcp_sum = onesSum(tcp_template_ + 34, 20, 6 + 20);
+    write16(tcp_template_ + TCP_CHECKSUM, fold(tcp_sum));
+
+    // UDP + DNS header; lengths are patched per answer (question varies)
+    std::memcpy(dns_template_, ip_header, sizeof(ip_header));
+    std::memset(dns_template_ + 34, 0, DNS_TEMPLATE_SIZE - 34);
+    dns_template_[23] = 17;
+    write16(dns_template_ + 46, 1);                        // QDCOUNT
+    write16(dns_template_ + IP_CHECKSUM, fold(onesSum(dns_template_ + 14, 20)));
+
+    uint32_t udp_sum = onesSum(dns_template_ + 34, 20, 17);
+    write16(dns_template_ + UDP_CHECKSUM, fold(udp_sum));
+}
+
+size_t ResponseSynthesizer::respond(const PacketJob& job, Connection* conn,
+                                    std::vector<PacketJob>& out) {
+    using namespace PacketAnalyzer;
+
+    // Templates are Ethernet II + IPv4 only
+    const std::vector<uint8_t>& data = job.data;
+    if (job.ip_offset != 14 || data.size() < job.transport_offset + 8 ||
+        read16(data.data() + 12) != 0x0800) {
+        unsupported_.fetch_add(1, std::memory_order_relaxed);
+        return 0;
+    }
+
+    bool is_tcp = job.tuple.protocol == 6;
+    if (is_tcp) {
+        // Never answer a reset
+        if (job.tcp_flags & TCPFlags::RST) return 0;
+        if (data.size() < job.transport_offset + 20) {
+            unsupported_.fetch_add(1, std::memory_order_relaxed);
+            return 0;
+        }
+    } else if (job.tuple.protocol != 17 || job.tuple.dst_port != 53) {
+        unsupported_.fetch_add(1, std::memory_order_relaxed);
+        return 0;
+    }
+
+    if (!admit(job, conn)) {
+        rate_limited_.fetch_add(1, std::memory_order_relaxed);
+        return 0;
+    }
+
+    size_t before = out.size();
+    if (is_tcp) {
+        const uint8_t* tcp = data.data() + job.transport_offset;
+        uint32_t seq = read32(tcp + 4);
+        uint32_t ack = read32(tcp + 8);
+        uint32_t next_seq = seq + static_cast<uint32_t>(job.payload_length) +
+                            ((job.tcp_flags & TCPFlags::SYN) ? 1 : 0) +
+                            ((job.tcp_flags & TCPFlags::FIN) ? 1 : 0);
+        bool has_ack = job.tcp_flags & TCPFlags::ACK;
+
+        // Sender: acceptable because it acknowledges exactly what was sent
+        buildReset(job, true, has_ack ? ack : 0, next_seq, TCPFlags::RST | TCPFlags::ACK, out);
+
+        // Peer only knows about the flow once the handshake completed
+        if (has_ack) {
+            buildReset(job, false, next_seq, ack, TCPFlags::RST | TCPFlags::ACK, out);
+        }
+    } else if (!buildDNSAnswer(job, out)) {
+        unsupported_.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    return out.size() - before;
+}
+
+bool ResponseSynthesizer::admit(const PacketJob& job, Connection* conn) {
+    if (!conn) return true;
+
+    if (conn->response_window_sec != job.ts_sec) {
+        conn->response_window_sec = job.ts_sec;
+        conn->responses_in_window = 0;
+    }
+    if (conn->responses_in_window >= max_per_second_) {
+        return false;
+    }
+    conn->responses_in_window++;
+    return true;
+}
+
+void ResponseSynthesizer::buildReset(const PacketJob& job, bool to_sender, uint32_t seq,
+                                     uint32_t ack, uint8_t flags, std::vector<PacketJob>& out) {
+    uint8_t frame[TCP_TEMPLATE_SIZE];
+    std::memcpy(frame, tcp_template_, TCP_TEMPLATE_SIZE);
+
+    patchEndpoints(frame, job.data.data(), job.transport_offset, to_sender, TCP_CHECKSUM);
+    patch32(frame, TCP_SEQ, seq, TCP_CHECKSUM);
+    patch32(frame, TCP_ACK, ack, TCP_CHECKSUM);
+    patch16(frame, TCP_FLAGS_WORD, static_cast<uint16_t>(0x5000 | flags), TCP_CHECKSUM);
+
+    out.push_back(makeJob(job, frame, TCP_TEMPLATE_SIZE, to_sender));
+    out.back().tcp_flags = flags;
+    out.back().payload_offset = TCP_TEMPLATE_SIZE;
+    tcp_resets_.fetch_add(1, std::memory_order_relaxed);
+}
+
+bool ResponseSynthesizer::buildDNSAnswer(const PacketJob& job, std::vector<PacketJob>& out) {
+    if (job.payload_offset >= job.data.size() || job.payload_length < 12) {
+        return false;
+    }
+    const uint8_t* query = job.data.data() + job.payload_offset;
+    size_t length = std::min(job.payload_length, job.data.size() - job.payload_offset);
+
+    // A standard query with a question
+    uint16_t query_flags = read16(query + 2);
+    if ((query_flags & 0x8000) || ((query_flags >> 11) & 0x0F) != 0 || read16(query + 4) == 0) {
+        return false;
+    }
+
+    // Echo the first question: QNAME labels, then QTYPE and QCLASS
+    size_t pos = 12;
+    while (pos < length && query[pos] != 0) {
+        if (query[pos] & 0xC0) return false;               // No pointers in a question
+        pos += query[pos] + 1;
+    }
+    if (pos + 5 > length) return false;
+    size_t question_length = pos + 5 - 12;
+    uint16_t qtype = read16(query + pos + 1);
+
+    bool sinkhole = has_sinkhole_ && qtype == 1;           // A record
+    static const uint8_t answer_header[] = {
+        0xC0, 0x0C,                 // Name: pointer to the question
+        0x00, 0x01, 0x00, 0x01,     // Type A, class IN
+        0x00, 0x00, 0x00, 0x3C,     // TTL 60
+        0x00, 0x04                  // RDLENGTH
+    };
+    size_t answer_length = sinkhole ? sizeof(answer_header) + 4 : 0;
+
+    std::vector<uint8_t> frame(dns_template_, dns_template_ + DNS_TEMPLATE_SIZE);
+    uint8_t* f = frame.data();
+    patchEndpoints(f, job.data.data(), job.transport_offset, true, UDP_CHECKSUM);
+
+    uint16_t udp_length = static_cast<uint16_t>(8 + 12 + question_length + answer_length);
+    patch16(f, IP_TOTAL_LENGTH, static_cast<uint16_t>(20 + udp_length), IP_CHECKSUM);
+    patch16(f, UDP_LENGTH, udp_length, UDP_CHECKSUM);
+    write16(f + UDP_CHECKSUM, checksumAdjust(read16(f + UDP_CHECKSUM), 0, udp_length));  // Pseudo-header
+
+    // Response, same opcode, RD echoed, RA set; NXDOMAIN unless sinkholed
+    uint16_t flags = static_cast<uint16_t>(0x8080 | (query_flags & 0x0100) | (sinkhole ? 0 : 3));
+    patch16(f, DNS_ID, read16(query), UDP_CHECKSUM);
+    patch16(f, DNS_FLAGS, flags, UDP_CHECKSUM);
+    if (sinkhole) {
+        patch16(f, DNS_ANCOUNT, 1, UDP_CHECKSUM);
+    }
+
+    // The variable part is summed once, as words replacing zeros
+    frame.insert(frame.end(), query + 12, query + 12 + question_length);
+    if (sinkhole) {
+        frame.insert(frame.end(), answer_header, answer_header + sizeof(answer_header));
+        frame.insert(frame.end(), sinkhole_, sinkhole_ + 4);
+    }
+    f = frame.data();
+    uint32_t sum = static_cast<uint16_t>(~read16(f + UDP_CHECKSUM));
+    uint16_t checksum = fold(onesSum(f + DNS_TEMPLATE_SIZE, frame.size() - DNS_TEMPLATE_SIZE, sum));
+    write16(f + UDP_CHECKSUM, checksum == 0 ? 0xFFFF : checksum);
+
+    out.push_back(makeJob(job, f, frame.size(), true));
+    out.back().payload_offset = DNS_ID;
+    out.back().payload_length = frame.size() - DNS_ID;
+    dns_answers_.fetch_add(1, std::memory_order_relaxed);
+    return true;
+}
+
+ResponseSynthesizer::Stats ResponseSynthesizer::getStats() const {
+    Stats stats;
+    stats.tcp_resets = tcp_resets_.load();
+    stats.dns_answers = dns_answers_.load();
+    stats.rate_limited = rate_limited_.load();
+    stats.unsupported = unsupported_.load();
+    return stats;
+}
+
+} // namespace DPI
@@ -1,7 +1,10 @@
 #include "rule_manager.h"
+#include "flight_recorder.h"
 #include <sstream>
 #include <iostream>
 #include <algorithm>
+#include <cctype>
+#include <string_view>
 #include <mutex>
 
 namespace DPI {
@@ -39,8 +42,8 @@ std::string RuleManager::ipToString(uint32_t ip) {
 }
 
 void RuleManager::blockIP(uint32_t ip) {
-    std::unique_lock<std::shared_mutex> lock(ip_mutex_);
-    blocked_ips_.insert(ip);
+    std::unique_lock<ProfiledSharedMutex> lock(ip_mutex_);
+    blocked_ips_[ip] = internRuleId("ip:" + ipToString(ip));
     std::cout << "[RuleManager] Blocked IP: " << ipToString(ip) << std::endl;
 }
 
@@ -49,7 +52,7 @@ void RuleManager::blockIP(const std::string& ip) {
 }
 
 void RuleManager::unblockIP(uint32_t ip) {
-    std::unique_lock<std::shared_mutex> lock(ip_mutex_);
+    std::unique_lock<ProfiledSharedMutex> lock(ip_mutex_);
     blocked_ips_.erase(ip);
     std::cout << "[RuleManager] Unblocked IP: " << ipToString(ip) << std::endl;
 }
@@ -59,15 +62,15 @@ void RuleManager::unblockIP(const std::string& ip) {
 }
 
 bool RuleManager::isIPBlocked(uint32_t ip) const {
-    std::shared_lock<std::shared_mutex> lock(ip_mutex_);
+    std::shared_lock<ProfiledSharedMutex> lock(ip_mutex_);
     return blocked_ips_.count(ip) > 0;
 }
 
 std::vector<std::string> RuleManager::getBlockedIPs() const {
-    std::shared_lock<std::shared_mutex> lock(ip_mutex_);
+    std::shared_lock<ProfiledSharedMutex> lock(ip_mutex_);
     std::vector<std::string> result;
-    for (uint32_t ip : blocked_ips_) {
-        result.push_back(ipToString(ip));
+    for (const auto& entry : blocked_ips_) {
+        result.push_back(ipToString(entry.first));
     }
     return result;
 }
@@ -77,25 +80,29 @@ std::vector<std::string> RuleManager::getBlockedIPs() const {
 // ============================================================================
 
 void RuleManager::blockApp(AppType app) {
-    std::unique_lock<std::shared_mutex> lock(app_mutex_);
-    blocked_apps_.insert(app);
+    std::unique_lock<ProfiledSharedMutex> lock(app_mutex_);
+    blocked_apps_[app] = internRuleId("app:" + appTypeToString(app));
     std::cout << "[RuleManager] Blocked app: " << appTypeToString(app) << std::endl;
 }
 
 void RuleManager::unblockApp(AppType app) {
-    std::unique_lock<std::shared_mutex> lock(app_mutex_);
+    std::unique_lock<ProfiledSharedMutex> lock(app_mutex_);
     blocked_apps_.erase(app);
     std::cout << "[RuleManager] Unblocked app: " << appTypeToString(app) << std::endl;
 }
 
 bool RuleManager::isAppBlocked(AppType app) const {
-    std::shared_lock<std::shared_mutex> lock(app_mutex_);
+    std::shared_lock<ProfiledSharedMutex> lock(app_mutex_);
     return blocked_apps_.count(app) > 0;
 }
 
 std::vector<AppType> RuleManager::getBlockedApps() const {
-    std::shared_lock<std::shared_mutex> lock(app_mutex_);
-    return std::vector<AppType>(blocked_apps_.begin(), blocked_apps_.end());
+    std::shared_lock<ProfiledSharedMutex> lock(app_mutex_);
+    std::vector<AppType> result;
+    for (const auto& entry : blocked_apps_) {
+        result.push_back(entry.first);
+    }
+    return result;
 }
 
 // ============================================================================
@@ -103,22 +110,24 @@ std::vector<AppType> RuleManager::getBlockedApps() const {
 // ============================================================================
 
 void RuleManager::blockDomain(const std::string& domain) {
-    std::unique_lock<std::shared_mutex> lock(domain_mutex_);
+    std::unique_lock<ProfiledSharedMutex> lock(domain_mutex_);
     
+    const std::string* id = internRuleId("domain:" + domain);
     if (domain.find('*') != std::string::npos) {
-        domain_patterns_.push_back(domain);
+        domain_patterns_.emplace_back(domain, id);
     } else {
-        blocked_domains_.insert(domain);
+        blocked_domains_[domain] = id;
     }
     
     std::cout << "[RuleManager] Blocked domain: " << domain << std::endl;
 }
 
 void RuleManager::unblockDomain(const std::string& domain) {
-    std::unique_lock<std::shared_mutex> lock(domain_mutex_);
+    std::unique_lock<ProfiledSharedMutex> lock(domain_mutex_);
     
     if (domain.find('*') != std::string::npos) {
-        auto it = std::find(domain_patterns_.begin(), domain_patterns_.end(), domain);
+        auto it = std::find_if(domain_patterns_.begin(), domain_patterns_.end(),
+                               [&](const auto& pattern) { return pattern.first == domain; });
         if (it != domain_patterns_.end()) {
             domain_patterns_.erase(it);
         }
@@ -129,19 +138,31 @@ void RuleManager::unblockDomain(const std::string& domain) {
     std::cout << "[RuleManager] Unblocked domain: " << domain << std::endl;
 }
 
+namespace {
+
+// ASCII case-insensitive equality (domain names)
+bool equalsIgnoreCase(std::string_view a, std::string_view b) {
+    return a.size() == b.size() &&
+           std::equal(a.begin(), a.end(), b.begin(), [](unsigned char x, unsigned char y) {
+               return std::tolower(x) == std::tolower(y);
+           });
+}
+
+} // anonymous namespace
+
 bool RuleManager::domainMatchesPattern(const std::string& domain, const std::string& pattern) {
     // Handle *.example.com pattern
     if (pattern.size() >= 2 && pattern[0] == '*' && pattern[1] == '.') {
-        std::string suffix = pattern.substr(1);  // .example.com
+        std::string_view suffix = std::string_view(pattern).substr(1);  // .example.com
         
         // Check if domain ends with the pattern
         if (domain.size() >= suffix.size() &&
-            domain.compare(domain.size() - suffix.size(), suffix.size(), suffix) == 0) {
+            equalsIgnoreCase(std::string_view(domain).substr(domain.size() - suffix.size()), suffix)) {
             return true;
         }
         
         // Also match the bare domain (example.com matches *.example.com)
-        if (domain == pattern.substr(2)) {
+        if (equalsIgnoreCase(domain, suffix.substr(1))) {
             return true;
         }
     }
@@ -150,35 +171,44 @@ bool RuleManager::domainMatchesPattern(const std::string& domain, const std::str
 }
 
 bool RuleManager::isDomainBlocked(const std::string& domain) const {
-    std::shared_lock<std::shared_mutex> lock(domain_mutex_);
+    return matchDomainRuleId(domain) != nullptr;
+}
+
+std::optional<std::string> RuleManager::matchDomainRule(const std::string& domain) const {
+    // The ID is "domain:" followed by the rule as configured
+    const std::string* id = matchDomainRuleId(domain);
+    if (!id) return std::nullopt;
+    return id->substr(id->find(':') + 1);
+}
+
+const std::string* RuleManager::matchDomainRuleId(const std::string& domain) const {
+    std::shared_lock<ProfiledSharedMutex> lock(domain_mutex_);
     
     // Check exact match
-    if (blocked_domains_.count(domain) > 0) {
-        return true;
+    auto exact = blocked_domains_.find(domain);
+    if (exact != blocked_domains_.end()) {
+        return exact->second;
     }
     
-    // Check patterns
-    std::string lower_domain = domain;
-    std::transform(lower_domain.begin(), lower_domain.end(), lower_domain.begin(),
-                   [](unsigned char c) { return std::tolower(c); });
-    
+    // Check patterns (case-insensitive, without copies: runs for every named flow)
     for (const auto& pattern : domain_patterns_) {
-        std::string lower_pattern = pattern;
-        std::transform(lower_pattern.begin(), lower_pattern.end(), lower_pattern.begin(),
-                       [](unsigned char c) { return std::tolower(c); });
-        
-        if (domainMatchesPattern(lower_domain, lower_pattern)) {
-            return true;
+        if (domainMatchesPattern(domain, pattern.first)) {
+            return pattern.second;
         }
     }
     
-    return false;
+    return nullptr;
 }
 
 std::vector<std::string> RuleManager::getBlockedDomains() const {
-    std::shared_lock<std::shared_mutex> lock(domain_mutex_);
-    std::vector<std::string> result(blocked_domains_.begin(), blocked_domains_.end());
-    result.insert(result.end(), domain_patterns_.begin(), domain_patterns_.end());
+    std::shared_lock<ProfiledSharedMutex> lock(domain_mutex_);
+    std::vector<std::string> result;
+    for (const auto& entry : blocked_domains_) {
+        result.push_back(entry.first);
+    }
+    for (const auto& pattern : domain_patterns_) {
+        result.push_back(pattern.first);
+    }
     return result;
 }
 
@@ -186,20 +216,46 @@ std::vector<std::string> RuleManager::getBlockedDomains() const {
 // Port Blocking
 // ============================================================================
 
-void RuleManager::blockPort(uint16_t port) {
-    std::unique_lock<std::shared_mutex> lock(port_mutex_);
-    blocked_ports_.insert(port);
-    std::cout << "[RuleManager] Blocked port: " << port << std::endl;
+void RuleManager::blockPort(uint16_t port, uint8_t protocol) {
+    uint64_t bit = 1ULL << (port % 64);
+    if (protocol != 17) blocked_ports_[0][port / 64].fetch_or(bit, std::memory_order_relaxed);
+    if (protocol != 6) blocked_ports_[1][port / 64].fetch_or(bit, std::memory_order_relaxed);
+    updatePortRuleId(port);
+    std::cout << "[RuleManager] Blocked port: " << portRuleString(port) << std::endl;
+}
+
+void RuleManager::unblockPort(uint16_t port, uint8_t protocol) {
+    uint64_t mask = ~(1ULL << (port % 64));
+    if (protocol != 17) blocked_ports_[0][port / 64].fetch_and(mask, std::memory_order_relaxed);
+    if (protocol != 6) blocked_ports_[1][port / 64].fetch_and(mask, std::memory_order_relaxed);
+    updatePortRuleId(port);
+}
+
+void RuleManager::updatePortRuleId(uint16_t port) {
+    std::unique_lock<ProfiledSharedMutex> lock(port_mutex_);
+    if (isPortBlocked(port)) {
+        port_rule_ids_[port] = internRuleId("port:" + portRuleString(port));
+    } else {
+        port_rule_ids_.erase(port);
+    }
 }
 
-void RuleManager::unblockPort(uint16_t port) {
-    std::unique_lock<std::shared_mutex> lock(port_mutex_);
-    blocked_ports_.erase(port);
+bool RuleManager::isPortBlocked(uint16_t port, uint8_t protocol) const {
+    uint64_t bit = 1ULL << (port % 64);
+    if (protocol == 6 || protocol == 17) {
+        return (blocked_ports_[portTableSlot(protocol)][port / 64].load(std::memory_order_relaxed) & bit) != 0;
+    }
+    return ((blocked_ports_[0][port / 64].load(std::memory_order_relaxed) |
+             blocked_ports_[1][port / 64].load(std::memory_order_relaxed)) & bit) != 0;
 }
 
-bool RuleManager::isPortBlocked(uint16_t port) const {
-    std::shared_lock<std::shared_mutex> lock(port_mutex_);
-    return blocked_ports_.count(port) > 0;
+std::string RuleManager::portRuleString(uint16_t port) const {
+    bool tcp = isPortBlocked(port, 6);
+    bool udp = isPortBlocked(port, 17);
+    std::string rule = std::to_string(port);
+    if (tcp && !udp) rule += "/tcp";
+    if (udp && !tcp) rule += "/udp";
+    return rule;
 }
 
 // ============================================================================
@@ -209,32 +265,52 @@ bool RuleManager::isPortBlocked(uint16_t port) const {
 std::optional<RuleManager::BlockReason> RuleManager::shouldBlock(
     uint32_t src_ip,
     uint16_t dst_port,
+    uint8_t protocol,
     AppType app,
     const std::string& domain) const {
     
+    // Runs on FP threads: lookups only, the IDs were interned with the rules
+    
     // Check IP first (most specific)
-    if (isIPBlocked(src_ip)) {
-        return BlockReason{BlockReason::IP, ipToString(src_ip)};
+    {
+        std::shared_lock<ProfiledSharedMutex> lock(ip_mutex_);
+        auto it = blocked_ips_.find(src_ip);
+        if (it != blocked_ips_.end()) {
+            return BlockReason{BlockReason::IP, it->second};
+        }
     }
     
     // Check port
-    if (isPortBlocked(dst_port)) {
-        return BlockReason{BlockReason::PORT, std::to_string(dst_port)};
+    if (isPortBlocked(dst_port, protocol)) {
+        std::shared_lock<ProfiledSharedMutex> lock(port_mutex_);
+        auto it = port_rule_ids_.find(dst_port);
+        return BlockReason{BlockReason::PORT, it != port_rule_ids_.end() ? it->second : nullptr};
     }
     
     // Check app
-    if (isAppBlocked(app)) {
-        return BlockReason{BlockReason::APP, appTypeToString(app)};
+    {
+        std::shared_lock<ProfiledSharedMutex> lock(app_mutex_);
+        auto it = blocked_apps_.find(app);
+        if (it != blocked_apps_.end()) {
+            return BlockReason{BlockReason::APP, it->second};
+        }
     }
     
     // Check domain
-    if (!domain.empty() && isDomainBlocked(domain)) {
-        return BlockReason{BlockReason::DOMAIN, domain};
+    if (!domain.empty()) {
+        if (const std::string* id = matchDomainRuleId(domain)) {
+            return BlockReason{BlockReason::DOMAIN, id};
+        }
     }
     
     return std::nullopt;
 }
 
+const std::string* RuleManager::internRuleId(const std::string& id) {
+    std::lock_guard<ProfiledMutex> lock(rule_id_mutex_);
+    return &*rule_ids_.insert(id).first;
+}
+
 // ============================================================================
 // Persistence
 // ============================================================================
@@ -265,10 +341,9 @@ bool RuleManager::saveRules(const std::string& filename) const {
     
     // Save blocked ports
     file << "\n[BLOCKED_PORTS]\n";
-    {
-        std::shared_lock<std::shared_mutex> lock(port_mutex_);
-        for (uint16_t port : blocked_ports_) {
-            file << port << "\n";
+    for (uint32_t port = 0; port <= 0xFFFF; port++) {
+        if (isPortBlocked(static_cast<uint16_t>(port))) {
+            file << portRuleString(static_cast<uint16_t>(port)) << "\n";
         }
     }
     
@@ -310,32 +385,50 @@ bool RuleManager::loadRules(const std::string& filename) {
         } else if (current_section == "[BLOCKED_DOMAINS]") {
             blockDomain(line);
         } else if (current_section == "[BLOCKED_PORTS]") {
-            blockPort(static_cast<uint16_t>(std::stoi(line)));
+            // "443" (both transports), "443/tcp" or "443/udp"
+            uint8_t protocol = 0;
+            size_t slash = line.find('/');
+            if (slash != std::string::npos) {
+                std::string proto = line.substr(slash + 1);
+                if (proto == "tcp") protocol = 6;
+                else if (proto == "udp") protocol = 17;
+            }
+            blockPort(static_cast<uint16_t>(std::stoi(line.substr(0, slash))), protocol);
         }
     }
     
     file.close();
+    
+    RuleStats stats = getStats();
+    FlightRecorder::record(TraceEvent::RULE_RELOAD, 0, static_cast<uint32_t>(
+        stats.blocked_ips + stats.blocked_apps + stats.blocked_domains + stats.blocked_ports));
+    
     std::cout << "[RuleManager] Rules loaded from: " << filename << std::endl;
     return true;
 }
 
 void RuleManager::clearAll() {
     {
-        std::unique_lock<std::shared_mutex> lock(ip_mutex_);
+        std::unique_lock<ProfiledSharedMutex> lock(ip_mutex_);
         blocked_ips_.clear();
     }
     {
-        std::unique_lock<std::shared_mutex> lock(app_mutex_);
+        std::unique_lock<ProfiledSharedMutex> lock(app_mutex_);
         blocked_apps_.clear();
     }
     {
-        std::unique_lock<std::shared_mutex> lock(domain_mutex_);
+        std::unique_lock<ProfiledSharedMutex> lock(domain_mutex_);
         blocked_domains_.clear();
         domain_patterns_.clear();
     }
+    for (auto& bitmap : blocked_ports_) {
+        for (auto& word : bitmap) {
+            word.store(0, std::memory_order_relaxed);
+        }
+    }
     {
-        std::unique_lock<std::shared_mutex> lock(port_mutex_);
-        blocked_ports_.clear();
+        std::unique_lock<ProfiledSharedMutex> lock(port_mutex_);
+        port_rule_ids_.clear();
     }
     std::cout << "[RuleManager] All rules cleared" << std::endl;
 }
@@ -344,23 +437,62 @@ RuleManager::RuleStats RuleManager::getStats() const {
     RuleStats stats;
     
     {
-        std::shared_lock<std::shared_mutex> lock(ip_mutex_);
+        std::shared_lock<ProfiledSharedMutex> lock(ip_mutex_);
         stats.blocked_ips = blocked_ips_.size();
     }
     {
-        std::shared_lock<std::shared_mutex> lock(app_mutex_);
+        std::shared_lock<ProfiledSharedMutex> lock(app_mutex_);
         stats.blocked_apps = blocked_apps_.size();
     }
     {
-        std::shared_lock<std::shared_mutex> lock(domain_mutex_);
+        std::shared_lock<ProfiledSharedMutex> lock(domain_mutex_);
         stats.blocked_domains = blocked_domains_.size() + domain_patterns_.size();
     }
-    {
-        std::shared_lock<std::shared_mutex> lock(port_mutex_);
-        stats.blocked_ports = blocked_ports_.size();
+    stats.blocked_ports = 0;
+    for (size_t i = 0; i < PORT_BITMAP_WORDS; i++) {
+        uint64_t word = blocked_ports_[0][i].load(std::memory_order_relaxed) |
+                        blocked_ports_[1][i].load(std::memory_order_relaxed);
+        stats.blocked_ports += __builtin_popcountll(word);
     }
     
     return stats;
 }
 
+size_t RuleManager::memoryBytes() const {
+    // Hash node (value + next pointer) plus its bucket slot
+    constexpr size_t node_overhead = 2 * sizeof(void*);
+    size_t bytes = 0;
+    
+    {
+        std::shared_lock<ProfiledSharedMutex> lock(ip_mutex_);
+        bytes += blocked_ips_.size() * (sizeof(decltype(blocked_ips_)::value_type) + node_overhead);
+    }
+    {
+        std::shared_lock<ProfiledSharedMutex> lock(app_mutex_);
+        bytes += blocked_apps_.size() * (sizeof(decltype(blocked_apps_)::value_type) + node_overhead);
+    }
+    {
+        std::shared_lock<ProfiledSharedMutex> lock(domain_mutex_);
+        for (const auto& domain : blocked_domains_) {
+            bytes += sizeof(decltype(blocked_domains_)::value_type) + node_overhead + domain.first.capacity();
+        }
+        for (const auto& pattern : domain_patterns_) {
+            bytes += sizeof(pattern) + pattern.first.capacity();
+        }
+    }
+    {
+        std::shared_lock<ProfiledSharedMutex> lock(port_mutex_);
+        bytes += port_rule_ids_.size() * (sizeof(decltype(port_rule_ids_)::value_type) + node_overhead);
+    }
+    {
+        std::lock_guard<ProfiledMutex> lock(rule_id_mutex_);
+        for (const auto& id : rule_ids_) {
+            bytes += sizeof(std::string) + node_overhead + id.capacity();
+        }
+    }
+    bytes += sizeof(blocked_ports_);
+    
+    return bytes;
+}
+
 } // namespace DPI
@@ -0,0 +1,505 @@
+#include "signature_engine.h"
+#include <algorithm>
+#include <atomic>
+#include <cctype>
+#include <fstream>
+#include <iostream>
+#include <queue>
+#include <sstream>
+
+namespace DPI {
+
+// ============================================================================
+// Built-in Signatures
+// ============================================================================
+
+const char* SignatureEngine::defaultSignatures() {
+    return R"(# Remote access
+SSH         tcp  "SSH-"                      offset=0
+
+# Peer-to-peer (handshake and DHT queries/responses)
+BitTorrent  tcp  "\x13BitTorrent protocol"   offset=0
+BitTorrent  udp  "d1:ad2:id20:"              offset=0
+BitTorrent  udp  "d1:rd2:id20:"              offset=0
+
+# WireGuard message types have fixed sizes
+WireGuard   udp  |01 00 00 00|               offset=0 len=148
+WireGuard   udp  |02 00 00 00|               offset=0 len=92
+WireGuard   udp  |03 00 00 00|               offset=0 len=64
+WireGuard   udp  |04 00 00 00|               offset=0 minlen=32
+
+# OpenVPN P_CONTROL_HARD_RESET_CLIENT_V2 (TCP has a 2-byte length prefix)
+OpenVPN     udp  |38|                        offset=0 minlen=14 maxlen=128
+OpenVPN     tcp  |38|                        offset=2 minlen=16 maxlen=130 mask=0:0xff:0x00
+
+# RTP v2 without padding/extension/CSRCs: PCMU, PCMA or a dynamic type
+RTP         udp  |80 00|                     offset=0 minlen=12
+RTP         udp  |80 08|                     offset=0 minlen=12
+RTP         udp  |80|                        offset=0 minlen=12 mask=1:0x60:0x60
+)";
+}
+
+// ============================================================================
+// Parsing
+// ============================================================================
+
+namespace {
+
+// Split a line into tokens; "..." and |...| are kept as single tokens
+std::vector<std::string> tokenize(const std::string& line) {
+    std::vector<std::string> tokens;
+    size_t i = 0;
+
+    while (i < line.size()) {
+        if (std::isspace(static_cast<unsigned char>(line[i]))) {
+            i++;
+            continue;
+        }
+        if (line[i] == '#') break;
+
+        size_t start = i;
+        if (line[i] == '"' || line[i] == '|') {
+            char delim = line[i++];
+            while (i < line.size() && line[i] != delim) {
+                if (delim == '"' && line[i] == '\\' && i + 1 < line.size()) i++;
+                i++;
+            }
+            i++;  // Closing delimiter
+        } else {
+            while (i < line.size() && !std::isspace(static_cast<unsigned char>(line[i]))) i++;
+        }
+        tokens.push_back(line.substr(start, i - start));
+    }
+
+    return tokens;
+}
+
+int hexValue(char c) {
+    if (c >= '0' && c <= '9') return c - '0';
+    if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+    if (c >= 'A' && c <= 'F') return c - 'A' + 10;
+    return -1;
+}
+
+bool parsePattern(const std::string& token, std::vector<uint8_t>& out) {
+    out.clear();
+    if (token.size() < 2 || token.back() != token.front()) return false;
+
+    std::string body = token.substr(1, token.size() - 2);
+
+    if (token.front() == '|') {
+        // Hex bytes, whitespace ignored
+        int high = -1;
+        for (char c : body) {
+            if (std::isspace(static_cast<unsigned char>(c))) continue;
+            int v = hexValue(c);
+            if (v < 0) return false;
+            if (high < 0) {
+                high = v;
+            } else {
+                out.push_back(static_cast<uint8_t>((high << 4) | v));
+                high = -1;
+            }
+        }
+        return high < 0 && !out.empty();
+    }
+
+    // Quoted text with escapes
+    for (size_t i = 0; i < body.size(); i++) {
+        if (body[i] != '\\' || i + 1 >= body.size()) {
+            out.push_back(static_cast<uint8_t>(body[i]));
+            continue;
+        }
+        char e = body[++i];
+        if (e == 'x') {
+            if (i + 2 >= body.size()) return false;
+            int h = hexValue(body[i + 1]);
+            int l = hexValue(body[i + 2]);
+            if (h < 0 || l < 0) return false;
+            out.push_back(static_cast<uint8_t>((h << 4) | l));
+            i += 2;
+        } else {
+            out.push_back(static_cast<uint8_t>(e));
+        }
+    }
+    return !out.empty();
+}
+
+bool parseNumber(const std::string& s, uint32_t& value) {
+    try {
+        size_t used = 0;
+        unsigned long v = std::stoul(s, &used, 0);
+        if (used != s.size()) return false;
+        value = static_cast<uint32_t>(v);
+        return true;
+    } catch (...) {
+        return false;
+    }
+}
+
+bool parseAppName(const std::string& name, AppType& app) {
+    for (int i = 0; i < static_cast<int>(AppType::APP_COUNT); i++) {
+        if (appTypeToString(static_cast<AppType>(i)) == name) {
+            app = static_cast<AppType>(i);
+            return true;
+        }
+    }
+    return false;
+}
+
+bool parseOption(const std::string& token, PayloadSignature& sig) {
+    size_t eq = token.find('=');
+    if (eq == std::string::npos) return false;
+
+    std::string key = token.substr(0, eq);
+    std::string value = token.substr(eq + 1);
+    uint32_t n = 0;
+
+    if (key == "mask") {
+        // mask=OFFSET:MASK:VALUE
+        size_t c1 = value.find(':');
+        size_t c2 = value.find(':', c1 == std::string::npos ? c1 : c1 + 1);
+        uint32_t off, mask, val;
+        if (c1 == std::string::npos || c2 == std::string::npos ||
+            !parseNumber(value.substr(0, c1), off) ||
+            !parseNumber(value.substr(c1 + 1, c2 - c1 - 1), mask) ||
+            !parseNumber(value.substr(c2 + 1), val) ||
+            off > 0xFFFF || mask > 0xFF || val > 0xFF) {
+            return false;
+        }
+        sig.has_mask = true;
+        sig.mask_offset = static_cast<uint16_t>(off);
+        sig.mask = static_cast<uint8_t>(mask);
+        sig.mask_value = static_cast<uint8_t>(val);
+        return true;
+    }
+
+    if (!parseNumber(value, n)) return false;
+
+    if (key == "offset") {
+        sig.offset = static_cast<int32_t>(n);
+    } else if (key == "depth") {
+        sig.depth = n;
+    } else if (key == "minlen") {
+        sig.min_len = n;
+    } else if (key == "maxlen") {
+        sig.max_len = n;
+    } else if (key == "len") {
+        sig.min_len = n;
+        sig.max_len = n;
+    } else {
+        return false;
+    }
+    return true;
+}
+
+// port=N or port=N-M
+bool parsePortRange(const std::string& token, PortHint& hint) {
+    if (token.compare(0, 5, "port=") != 0) return false;
+
+    std::string value = token.substr(5);
+    size_t dash = value.find('-');
+    uint32_t first = 0;
+    uint32_t last = 0;
+    if (!parseNumber(value.substr(0, dash), first)) return false;
+    if (dash == std::string::npos) {
+        last = first;
+    } else if (!parseNumber(value.substr(dash + 1), last)) {
+        return false;
+    }
+    if (first > 0xFFFF || last > 0xFFFF || first > last) return false;
+
+    hint.first_port = static_cast<uint16_t>(first);
+    hint.last_port = static_cast<uint16_t>(last);
+    return true;
+}
+
+} // anonymous namespace
+
+bool SignatureEngine::parse(const std::string& text, const std::string& source,
+                            std::vector<PayloadSignature>& out,
+                            std::vector<PortHint>* port_hints) {
+    std::istringstream in(text);
+    std::string line;
+    int line_no = 0;
+    bool ok = true;
+
+    while (std::getline(in, line)) {
+        line_no++;
+        auto tokens = tokenize(line);
+        if (tokens.empty()) continue;
+
+        PayloadSignature sig;
+        bool line_ok = tokens.size() >= 3 && parseAppName(tokens[0], sig.app);
+
+        if (line_ok) {
+            if (tokens[1] == "tcp") sig.protocol = 6;
+            else if (tokens[1] == "udp") sig.protocol = 17;
+            else if (tokens[1] == "any") sig.protocol = 0;
+            else line_ok = false;
+        }
+
+        // Port hint line: "<App> <proto> port=N[-M]"
+        if (line_ok && port_hints && tokens.size() == 3 && tokens[2].compare(0, 5, "port=") == 0) {
+            PortHint hint;
+            hint.app = sig.app;
+            hint.protocol = sig.protocol;
+            if (parsePortRange(tokens[2], hint)) {
+                port_hints->push_back(hint);
+                continue;
+            }
+            line_ok = false;
+        }
+
+        line_ok = line_ok && parsePattern(tokens[2], sig.pattern);
+
+        for (size_t i = 3; line_ok && i < tokens.size(); i++) {
+            line_ok = parseOption(tokens[i], sig);
+        }
+
+        if (!line_ok) {
+            std::cerr << "[Signatures] " << source << ":" << line_no
+                      << ": invalid signature: " << line << "\n";
+            ok = false;
+            continue;
+        }
+
+        out.push_back(std::move(sig));
+    }
+
+    return ok;
+}
+
+// ============================================================================
+// SignatureSet - Aho-Corasick compilation
+// ============================================================================
+
+std::shared_ptr<const SignatureSet> SignatureSet::compile(
+    std::vector<PayloadSignature> signatures, std::string& error,
+    const std::vector<PortHint>& port_hints) {
+
+    if (signatures.size() > std::numeric_limits<uint16_t>::max()) {
+        error = "too many signatures";
+        return nullptr;
+    }
+
+    std::shared_ptr<SignatureSet> set(new SignatureSet());
+    set->signatures_ = std::move(signatures);
+
+    // Port hints override the defaults in file order
+    for (const auto& hint : port_hints) {
+        for (uint32_t port = hint.first_port; port <= hint.last_port; port++) {
+            set->port_hints_.set(hint.protocol, static_cast<uint16_t>(port), hint.app);
+        }
+    }
+    set->num_port_hints_ = port_hints.size();
+
+    // Byte classes: each byte used in a pattern gets its own class
+    bool used[256] = {};
+    for (const auto& sig : set->signatures_) {
+        for (uint8_t b : sig.pattern) used[b] = true;
+    }
+    set->num_classes_ = 1;
+    for (int b = 0; b < 256; b++) {
+        set->byte_class_[b] = used[b] ? static_cast<uint16_t>(set->num_classes_++) : 0;
+    }
+    const size_t nc = set->num_classes_;
+
+    // Trie (goto function) with -1 for missing edges
+    std::vector<std::vector<int32_t>> go(1, std::vector<int32_t>(nc, -1));
+    std::vector<std::vector<uint16_t>> outputs(1);
+
+    for (size_t id = 0; id < set->signatures_.size(); id++) {
+        int32_t state = 0;
+        for (uint8_t b : set->signatures_[id].pattern) {
+            uint16_t c = set->byte_class_[b];
+            if (go[state][c] < 0) {
+                go[state][c] = static_cast<int32_t>(go.size());
+                go.emplace_back(nc, -1);
+                outputs.emplace_back();
+            }
+            state = go[state][c];
+        }
+        outputs[state].push_back(static_cast<uint16_t>(id));
+    }
+
+    if (go.size() > std::numeric_limits<uint16_t>::max()) {
+        error = "automaton too large";
+        return nullptr;
+    }
+
+    // BFS: failure links, resolved transitions and merged outputs
+    const size_t num_states = go.size();
+    std::vector<int32_t> fail(num_states, 0);
+    set->next_.assign(num_states * nc, 0);  // Plain state ids until flattened
+
+    std::queue<int32_t> bfs;
+    for (size_t c = 0; c < nc; c++) {
+        int32_t s = go[0][c];
+        if (s >= 0) {
+            fail[s] = 0;
+            set->next_[c] = static_cast<uint32_t>(s);
+            bfs.push(s);
+        }
+    }
+
+    while (!bfs.empty()) {
+        int32_t s = bfs.front();
+        bfs.pop();
+
+        // Inherit matches from the failure state (already complete: BFS order)
+        const auto& inherited = outputs[fail[s]];
+        outputs[s].insert(outputs[s].end(), inherited.begin(), inherited.end());
+
+        for (size_t c = 0; c < nc; c++) {
+            int32_t t = go[s][c];
+            if (t >= 0) {
+                fail[t] = set->next_[fail[s] * nc + c];
+                set->next_[s * nc + c] = static_cast<uint32_t>(t);
+                bfs.push(t);
+            } else {
+                set->next_[s * nc + c] = set->next_[fail[s] * nc + c];
+            }
+        }
+    }
+
+    // Pre-multiply rows and flag emitting targets
+    for (auto& entry : set->next_) {
+        uint32_t target = entry;
+        entry = target * static_cast<uint32_t>(nc);
+        if (!outputs[target].empty()) entry |= EMIT_FLAG;
+    }
+    
+    // Bound the scan by the furthest possible pattern end
+    set->scan_limit_ = 0;
+    for (const auto& sig : set->signatures_) {
+        size_t end = SIGNATURE_SCAN_BYTES;
+        if (sig.offset >= 0) {
+            end = static_cast<size_t>(sig.offset) + sig.pattern.size();
+        } else if (sig.depth > 0) {
+            end = sig.depth;
+        }
+        set->scan_limit_ = std::max(set->scan_limit_, std::min(end, SIGNATURE_SCAN_BYTES));
+    }
+    
+    // Flatten outputs, lowest signature id first
+    set->out_begin_.reserve(num_states + 1);
+    for (auto& out : outputs) {
+        std::sort(out.begin(), out.end());
+        set->out_begin_.push_back(static_cast<uint32_t>(set->out_ids_.size()));
+        set->out_ids_.insert(set->out_ids_.end(), out.begin(), out.end());
+    }
+    set->out_begin_.push_back(static_cast<uint32_t>(set->out_ids_.size()));
+
+    return set;
+}
+
+bool SignatureSet::accept(const PayloadSignature& sig, size_t end, const uint8_t* payload,
+                          size_t length, uint8_t protocol) const {
+    if (sig.protocol != 0 && sig.protocol != protocol) return false;
+    if (length < sig.min_len || length > sig.max_len) return false;
+
+    size_t start = end - sig.pattern.size();
+    if (sig.offset >= 0 && start != static_cast<size_t>(sig.offset)) return false;
+    if (sig.depth > 0 && end > sig.depth) return false;
+
+    if (sig.has_mask) {
+        if (sig.mask_offset >= length) return false;
+        if ((payload[sig.mask_offset] & sig.mask) != sig.mask_value) return false;
+    }
+
+    return true;
+}
+
+AppType SignatureSet::match(const uint8_t* payload, size_t length, uint8_t protocol) const {
+    const size_t scan = std::min(length, scan_limit_);
+    const uint32_t* next = next_.data();
+
+    uint32_t best = std::numeric_limits<uint32_t>::max();
+    uint32_t row = 0;
+
+    for (size_t i = 0; i < scan; i++) {
+        uint32_t entry = next[row + byte_class_[payload[i]]];
+        row = entry & ~EMIT_FLAG;
+        if (!(entry & EMIT_FLAG)) continue;
+
+        uint32_t state = row / num_classes_;
+        for (uint32_t k = out_begin_[state]; k < out_begin_[state + 1]; k++) {
+            uint16_t id = out_ids_[k];
+            if (id >= best) break;  // Outputs are sorted; nothing better here
+            if (accept(signatures_[id], i + 1, payload, length, protocol)) {
+                best = id;
+                break;
+            }
+        }
+
+        // Signature 0 cannot be beaten
+        if (best == 0) break;
+    }
+
+    return best == std::numeric_limits<uint32_t>::max() ? AppType::UNKNOWN
+                                                        : signatures_[best].app;
+}
+
+size_t SignatureSet::memoryBytes() const {
+    return sizeof(*this) +
+           next_.size() * sizeof(uint32_t) +
+           out_begin_.size() * sizeof(uint32_t) +
+           out_ids_.size() * sizeof(uint16_t) +
+           signatures_.size() * sizeof(PayloadSignature);
+}
+
+// ============================================================================
+// SignatureEngine Implementation
+// ============================================================================
+
+SignatureEngine::SignatureEngine() {
+    loadDefaults();
+}
+
+void SignatureEngine::loadDefaults() {
+    loadFromString(defaultSignatures(), "<built-in>");
+}
+
+bool SignatureEngine::loadFromFile(const std::string& filename) {
+    std::ifstream file(filename);
+    if (!file.is_open()) {
+        std::cerr << "[Signatures] Cannot open: " << filename << "\n";
+        return false;
+    }
+
+    std::stringstream buffer;
+    buffer << file.rdbuf();
+    return loadFromString(buffer.str(), filename);
+}
+
+bool SignatureEngine::loadFromString(const std::string& text, const std::string& source) {
+    std::vector<PayloadSignature> signatures;
+    std::vector<PortHint> port_hints;
+    if (!parse(text, source, signatures, &port_hints)) {
+        // Keep the previous set on any syntax error
+        return false;
+    }
+
+    std::string error;
+    auto compiled = SignatureSet::compile(std::move(signatures), error, port_hints);
+    if (!compiled) {
+        std::cerr << "[Signatures] " << source << ": " << error << "\n";
+        return false;
+    }
+
+    std::cout << "[Signatures] Loaded " << compiled->size() << " signatures from " << source
+              << " (" << compiled->numStates() << " states, " << compiled->numClasses()
+              << " byte classes, " << compiled->numPortHints() << " port hints, "
+              << compiled->memoryBytes() << " bytes)\n";
+
+    std::atomic_store(&set_, compiled);
+    version_.fetch_add(1, std::memory_order_release);
+    return true;
+}
+
+std::shared_ptr<const SignatureSet> SignatureEngine::get() const {
+    return std::atomic_load(&set_);
+}
+
+} // namespace DPI
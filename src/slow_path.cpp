@@ -0,0 +1,169 @@
+#include "slow_path.h"
+#include "sni_extractor.h"
+#include "flight_recorder.h"
+#include <iostream>
+
+namespace DPI {
+
+// ============================================================================
+// Certificate name selection (shared by the slow path and the inline FP path)
+// ============================================================================
+
+AppType selectCertificateName(const TLSServerInfo& info, std::string& name) {
+    // Prefer a name that maps to a known application, then the subject CN
+    AppType app = AppType::UNKNOWN;
+    name.clear();
+
+    for (size_t i = 0; i <= info.num_dns_names; i++) {
+        std::string_view candidate = i == 0 ? info.common_name : info.dns_names[i - 1];
+        if (candidate.empty()) continue;
+
+        std::string candidate_name(candidate);
+        AppType candidate_app = sniToAppType(candidate_name);
+        if (name.empty() || (app == AppType::HTTPS && candidate_app != AppType::HTTPS)) {
+            name = std::move(candidate_name);
+            app = candidate_app;
+        }
+        if (app != AppType::HTTPS) break;
+    }
+
+    return app;
+}
+
+// ============================================================================
+// SlowPathPool Implementation
+// ============================================================================
+
+SlowPathPool::SlowPathPool(int num_workers, int num_fps,
+                           size_t queue_capacity, size_t mailbox_capacity)
+    : num_workers_(num_workers),
+      num_fps_(num_fps),
+      requests_(queue_capacity, "SlowPath queue") {
+    for (int i = 0; i < num_workers * num_fps; i++) {
+        mailboxes_.push_back(std::make_unique<SpscRing<SlowPathResult>>(mailbox_capacity));
+    }
+
+    std::cout << "[SlowPath] Created " << num_workers << " workers (queue "
+              << queue_capacity << ")\n";
+}
+
+SlowPathPool::~SlowPathPool() {
+    stop();
+}
+
+void SlowPathPool::start() {
+    if (running_) return;
+
+    running_ = true;
+    for (int i = 0; i < num_workers_; i++) {
+        workers_.emplace_back(&SlowPathPool::workerLoop, this, i);
+    }
+}
+
+void SlowPathPool::stop() {
+    if (!running_) return;
+
+    running_ = false;
+    requests_.shutdown();
+
+    for (auto& worker : workers_) {
+        if (worker.joinable()) {
+            worker.join();
+        }
+    }
+    workers_.clear();
+
+    std::cout << "[SlowPath] Stopped (completed " << completed_ << " requests)\n";
+}
+
+bool SlowPathPool::submit(SlowPathRequest&& request) {
+    submitted_.fetch_add(1, std::memory_order_relaxed);
+    request.submit_ticks = FlightRecorder::now();
+
+    if (!requests_.tryPush(std::move(request))) {
+        rejected_.fetch_add(1, std::memory_order_relaxed);
+        return false;
+    }
+
+    uint64_t depth = requests_.size();
+    queue_depth_sum_.fetch_add(depth, std::memory_order_relaxed);
+    uint64_t max = max_queue_depth_.load(std::memory_order_relaxed);
+    while (depth > max &&
+           !max_queue_depth_.compare_exchange_weak(max, depth, std::memory_order_relaxed)) {
+    }
+    return true;
+}
+
+void SlowPathPool::workerLoop(int worker_id) {
+    while (true) {
+        // Blocks until work arrives; empty after shutdown
+        auto request = requests_.pop();
+        if (!request) break;
+
+        SlowPathResult result = execute(*request);
+        completed_.fetch_add(1, std::memory_order_relaxed);
+
+        // Only this worker writes this mailbox; wait for the FP if it is full
+        SpscRing<SlowPathResult>& mailbox = *mailboxes_[worker_id * num_fps_ + request->fp_id];
+        while (!mailbox.tryPush(std::move(result))) {
+            if (!running_) break;
+            std::this_thread::yield();
+        }
+    }
+}
+
+SlowPathResult SlowPathPool::execute(const SlowPathRequest& request) {
+    SlowPathResult result;
+    result.task = request.task;
+    result.tuple = request.tuple;
+    result.submit_ticks = request.submit_ticks;
+
+    const uint8_t* data = request.data.data();
+    size_t length = request.data.size();
+
+    switch (request.task) {
+        case SlowPathTask::CERTIFICATE: {
+            TLSServerInfo info;
+            if (TLSServerExtractor::parseCertificate(data, length, info)) {
+                result.app = selectCertificateName(info, result.name);
+            }
+            break;
+        }
+        case SlowPathTask::QUIC_INITIAL: {
+            auto sni = QUICSNIExtractor::extract(data, length);
+            if (sni) {
+                AppType app = sniToAppType(*sni);
+                result.app = app == AppType::HTTPS ? AppType::QUIC : app;
+                result.name = std::move(*sni);
+            }
+            break;
+        }
+    }
+
+    return result;
+}
+
+void SlowPathPool::recordApplied(const SlowPathResult& result) {
+    applied_.fetch_add(1, std::memory_order_relaxed);
+    latency_.record(FlightRecorder::ticksToNs(FlightRecorder::now() - result.submit_ticks));
+}
+
+SlowPathPool::Stats SlowPathPool::getStats() const {
+    Stats stats;
+    stats.submitted = submitted_.load();
+    stats.rejected = rejected_.load();
+    stats.completed = completed_.load();
+    stats.applied = applied_.load();
+    stats.stale = stale_.load();
+    stats.max_queue_depth = max_queue_depth_.load();
+
+    uint64_t queued = stats.submitted - stats.rejected;
+    stats.avg_queue_depth = queued > 0 ? static_cast<double>(queue_depth_sum_.load()) / queued : 0;
+
+    stats.latency_p50_ns = latency_.percentileNs(50);
+    stats.latency_p99_ns = latency_.percentileNs(99);
+    stats.latency_max_ns = latency_.maxNs();
+    return stats;
+}
+
+} // namespace DPI
@@ -4,6 +4,38 @@
 
 namespace DPI {
 
+namespace {
+
+inline bool isUpper(char c) { return c >= 'A' && c <= 'Z'; }
+
+// View of a name, lowercased into scratch only if it has uppercase letters
+std::optional<std::string_view> normalizeName(const uint8_t* data, size_t length,
+                                              HostnameScratch& scratch) {
+    if (length == 0 || length > MAX_HOSTNAME_LENGTH) {
+        return std::nullopt;
+    }
+    
+    const char* name = reinterpret_cast<const char*>(data);
+    size_t i = 0;
+    while (i < length && !isUpper(name[i])) i++;
+    if (i == length) {
+        return std::string_view(name, length);
+    }
+    
+    std::memcpy(scratch.data, name, i);
+    for (; i < length; i++) {
+        scratch.data[i] = isUpper(name[i]) ? static_cast<char>(name[i] + ('a' - 'A')) : name[i];
+    }
+    return std::string_view(scratch.data, length);
+}
+
+std::optional<std::string> toString(std::optional<std::string_view> view) {
+    if (!view) return std::nullopt;
+    return std::string(*view);
+}
+
+} // anonymous namespace
+
 // ============================================================================
 // TLS SNI Extractor Implementation
 // ============================================================================
@@ -43,6 +75,12 @@ bool SNIExtractor::isTLSClientHello(const uint8_t* payload, size_t length) {
 }
 
 std::optional<std::string> SNIExtractor::extract(const uint8_t* payload, size_t length) {
+    HostnameScratch scratch;
+    return toString(extractView(payload, length, scratch));
+}
+
+std::optional<std::string_view> SNIExtractor::extractView(const uint8_t* payload, size_t length,
+                                                          HostnameScratch& scratch) {
     if (!isTLSClientHello(payload, length)) {
         return std::nullopt;
     }
@@ -115,9 +153,8 @@ std::optional<std::string> SNIExtractor::extract(const uint8_t* payload, size_t
             if (sni_type != SNI_TYPE_HOSTNAME) break;
             if (sni_length > extension_length - 5) break;
             
-            // Extract the hostname
-            std::string sni(reinterpret_cast<const char*>(payload + offset + 5), sni_length);
-            return sni;
+            // The hostname, as a view
+            return normalizeName(payload + offset + 5, sni_length, scratch);
         }
         
         offset += extension_length;
@@ -137,6 +174,292 @@ std::vector<std::pair<uint16_t, std::string>> SNIExtractor::extractExtensions(
     return extensions;
 }
 
+// ============================================================================
+// TLS Server Extractor Implementation
+// ============================================================================
+
+namespace {
+
+uint16_t be16(const uint8_t* data) {
+    return (static_cast<uint16_t>(data[0]) << 8) | data[1];
+}
+
+uint32_t be24(const uint8_t* data) {
+    return (static_cast<uint32_t>(data[0]) << 16) |
+           (static_cast<uint32_t>(data[1]) << 8) |
+           data[2];
+}
+
+// DER tags used in certificates
+constexpr uint8_t DER_INTEGER = 0x02;
+constexpr uint8_t DER_OCTET_STRING = 0x04;
+constexpr uint8_t DER_OID = 0x06;
+constexpr uint8_t DER_SEQUENCE = 0x30;
+constexpr uint8_t DER_SET = 0x31;
+constexpr uint8_t DER_CONTEXT_0 = 0xA0;     // [0] version
+constexpr uint8_t DER_CONTEXT_3 = 0xA3;     // [3] extensions
+constexpr uint8_t DER_SAN_DNS_NAME = 0x82;  // [2] IMPLICIT IA5String
+
+constexpr uint8_t OID_COMMON_NAME[] = {0x55, 0x04, 0x03};        // 2.5.4.3
+constexpr uint8_t OID_SUBJECT_ALT_NAME[] = {0x55, 0x1D, 0x11};   // 2.5.29.17
+
+// One TLV; length is what is available, which may be less than declared
+struct DERElement {
+    uint8_t tag = 0;
+    const uint8_t* data = nullptr;
+    size_t length = 0;
+    bool truncated = false;
+
+    bool isOID(const uint8_t* oid, size_t oid_length) const {
+        return tag == DER_OID && length == oid_length &&
+               std::memcmp(data, oid, oid_length) == 0;
+    }
+};
+
+// Forward-only TLV reader over a byte range (no allocation)
+class DERReader {
+public:
+    DERReader(const uint8_t* data, size_t length) : pos_(data), end_(data + length) {}
+    explicit DERReader(const DERElement& element)
+        : DERReader(element.data, element.length) {}
+
+    bool next(DERElement& out) {
+        if (end_ - pos_ < 2) return false;
+
+        uint8_t tag = pos_[0];
+        if ((tag & 0x1F) == 0x1F) return false;  // Multi-byte tags never appear in X.509
+
+        const uint8_t* p = pos_ + 2;
+        size_t length = pos_[1];
+        if (length & 0x80) {
+            size_t num_bytes = length & 0x7F;
+            if (num_bytes == 0 || num_bytes > 4 || static_cast<size_t>(end_ - p) < num_bytes) {
+                return false;
+            }
+            length = 0;
+            for (size_t i = 0; i < num_bytes; i++) {
+                length = (length << 8) | p[i];
+            }
+            p += num_bytes;
+        }
+
+        size_t available = end_ - p;
+        out.tag = tag;
+        out.data = p;
+        out.truncated = length > available;
+        out.length = std::min(length, available);
+        pos_ = p + out.length;
+        return true;
+    }
+
+private:
+    const uint8_t* pos_;
+    const uint8_t* end_;
+};
+
+std::string_view asStringView(const DERElement& element) {
+    return std::string_view(reinterpret_cast<const char*>(element.data), element.length);
+}
+
+// Name ::= SEQUENCE OF SET OF SEQUENCE { type OID, value ANY }
+void findCommonName(const DERElement& name, TLSServerInfo& info) {
+    DERReader rdns(name);
+    DERElement rdn;
+    while (rdns.next(rdn)) {
+        if (rdn.tag != DER_SET) continue;
+
+        DERReader attributes(rdn);
+        DERElement attribute;
+        while (attributes.next(attribute)) {
+            if (attribute.tag != DER_SEQUENCE) continue;
+
+            DERReader fields(attribute);
+            DERElement type, value;
+            if (fields.next(type) && type.isOID(OID_COMMON_NAME, sizeof(OID_COMMON_NAME)) &&
+                fields.next(value) && !value.truncated) {
+                info.common_name = asStringView(value);
+                return;
+            }
+        }
+    }
+}
+
+// Extension ::= SEQUENCE { extnID OID, critical BOOLEAN OPTIONAL, extnValue OCTET STRING }
+void findSubjectAltNames(const DERElement& extensions_tag, TLSServerInfo& info) {
+    DERReader outer(extensions_tag);
+    DERElement extensions;
+    if (!outer.next(extensions) || extensions.tag != DER_SEQUENCE) return;
+
+    DERReader list(extensions);
+    DERElement extension;
+    while (list.next(extension)) {
+        if (extension.tag != DER_SEQUENCE) continue;
+
+        DERReader fields(extension);
+        DERElement id, field;
+        if (!fields.next(id) || !id.isOID(OID_SUBJECT_ALT_NAME, sizeof(OID_SUBJECT_ALT_NAME))) {
+            continue;
+        }
+
+        // Skip the optional critical flag
+        while (fields.next(field) && field.tag != DER_OCTET_STRING) {}
+        if (field.tag != DER_OCTET_STRING) return;
+
+        DERReader value(field);
+        DERElement general_names, general_name;
+        if (!value.next(general_names) || general_names.tag != DER_SEQUENCE) return;
+
+        DERReader names(general_names);
+        while (names.next(general_name) && info.num_dns_names < TLS_MAX_SAN_NAMES) {
+            if (general_name.tag == DER_SAN_DNS_NAME && !general_name.truncated) {
+                info.dns_names[info.num_dns_names++] = asStringView(general_name);
+            }
+        }
+        return;
+    }
+}
+
+} // anonymous namespace
+
+bool TLSServerExtractor::parseCertificate(const uint8_t* der, size_t length,
+                                          TLSServerInfo& info) {
+    DERReader top(der, length);
+    DERElement certificate, tbs, element;
+
+    if (!top.next(certificate) || certificate.tag != DER_SEQUENCE) return false;
+
+    DERReader cert_fields(certificate);
+    if (!cert_fields.next(tbs) || tbs.tag != DER_SEQUENCE) return false;
+
+    DERReader fields(tbs);
+
+    // [0] version is optional (absent means v1)
+    if (!fields.next(element)) return false;
+    if (element.tag == DER_CONTEXT_0 && !fields.next(element)) return false;
+    if (element.tag != DER_INTEGER) return false;  // serialNumber
+
+    // signature, issuer, validity, subject
+    for (int i = 0; i < 4; i++) {
+        if (!fields.next(element) || element.tag != DER_SEQUENCE) return false;
+    }
+
+    info.certificate = true;
+    findCommonName(element, info);
+
+    // subjectPublicKeyInfo, then optional [1] [2] unique IDs and [3] extensions
+    while (fields.next(element)) {
+        if (element.tag == DER_CONTEXT_3) {
+            findSubjectAltNames(element, info);
+            break;
+        }
+    }
+
+    return true;
+}
+
+void TLSServerExtractor::parseServerHello(const uint8_t* body, size_t length,
+                                          TLSServerInfo& info) {
+    info.server_hello = true;
+
+    // Version (2) + Random (32)
+    size_t offset = 34;
+
+    // Session ID
+    if (offset >= length) return;
+    offset += 1 + body[offset];
+
+    // Cipher suite (2) + compression method (1)
+    offset += 3;
+
+    // Extensions
+    if (offset + 2 > length) return;
+    size_t extensions_end = std::min(length, offset + 2 + be16(body + offset));
+    offset += 2;
+
+    while (offset + 4 <= extensions_end) {
+        uint16_t extension_type = be16(body + offset);
+        uint16_t extension_length = be16(body + offset + 2);
+        offset += 4;
+
+        if (offset + extension_length > extensions_end) break;
+
+        if (extension_type == EXTENSION_ALPN && extension_length >= 3) {
+            // List length (2), protocol length (1), protocol
+            uint8_t protocol_length = body[offset + 2];
+            if (3u + protocol_length <= extension_length) {
+                info.alpn = std::string_view(
+                    reinterpret_cast<const char*>(body + offset + 3), protocol_length);
+            }
+        } else if (extension_type == EXTENSION_SUPPORTED_VERSIONS && extension_length == 2) {
+            info.tls13 = be16(body + offset) == 0x0304;
+        }
+
+        offset += extension_length;
+    }
+}
+
+bool TLSServerExtractor::parse(const uint8_t* payload, size_t length,
+                               uint32_t& record_skip, TLSServerInfo& info,
+                               bool parse_certificate) {
+    // Skip the tail of a record that started in an earlier segment
+    size_t offset = record_skip;
+    if (offset >= length) {
+        record_skip -= static_cast<uint32_t>(length);
+        return false;
+    }
+    record_skip = 0;
+
+    bool found = false;
+
+    while (offset + 5 <= length) {
+        // Record header: type (1), version (2), length (2)
+        uint8_t content_type = payload[offset];
+        uint16_t version = be16(payload + offset + 1);
+        if (content_type < 0x14 || content_type > 0x17 ||
+            version < 0x0300 || version > 0x0304) {
+            break;  // Not TLS, or we lost the record boundary
+        }
+
+        size_t body = offset + 5;
+        size_t record_end = body + be16(payload + offset + 3);
+        size_t available_end = std::min(record_end, length);
+
+        // Handshake messages inside this record
+        size_t pos = body;
+        while (content_type == CONTENT_TYPE_HANDSHAKE && pos + 4 <= available_end) {
+            uint8_t handshake_type = payload[pos];
+            uint32_t handshake_length = be24(payload + pos + 1);
+            const uint8_t* message = payload + pos + 4;
+            size_t message_length = std::min<size_t>(handshake_length, available_end - pos - 4);
+
+            if (handshake_type == HANDSHAKE_SERVER_HELLO) {
+                parseServerHello(message, message_length, info);
+                found = true;
+            } else if (handshake_type == HANDSHAKE_CERTIFICATE && message_length >= 6) {
+                // List length (3), then the leaf: length (3) + DER
+                size_t cert_length = std::min<size_t>(be24(message + 3), message_length - 6);
+                info.certificate_der = message + 6;
+                info.certificate_length = cert_length;
+                if (parse_certificate) {
+                    found |= parseCertificate(message + 6, cert_length, info);
+                } else {
+                    found |= cert_length > 0;
+                }
+            }
+
+            pos += 4 + handshake_length;
+        }
+
+        if (record_end > length) {
+            record_skip = static_cast<uint32_t>(record_end - length);
+            break;
+        }
+        offset = record_end;
+    }
+
+    return found;
+}
+
 // ============================================================================
 // HTTP Host Header Extractor Implementation
 // ============================================================================
@@ -157,6 +480,12 @@ bool HTTPHostExtractor::isHTTPRequest(const uint8_t* payload, size_t length) {
 }
 
 std::optional<std::string> HTTPHostExtractor::extract(const uint8_t* payload, size_t length) {
+    HostnameScratch scratch;
+    return toString(extractView(payload, length, scratch));
+}
+
+std::optional<std::string_view> HTTPHostExtractor::extractView(const uint8_t* payload, size_t length,
+                                                               HostnameScratch& scratch) {
     if (!isHTTPRequest(payload, length)) {
         return std::nullopt;
     }
@@ -179,22 +508,15 @@ std::optional<std::string> HTTPHostExtractor::extract(const uint8_t* payload, si
                 start++;
             }
             
-            // Find end of line
+            // Find end of line (or of the host, before a port)
             size_t end = start;
-            while (end < length && payload[end] != '\r' && payload[end] != '\n') {
+            while (end < length && payload[end] != '\r' && payload[end] != '\n' &&
+                   payload[end] != ':') {
                 end++;
             }
             
             if (end > start) {
-                std::string host(reinterpret_cast<const char*>(payload + start), end - start);
-                
-                // Remove port if present
-                size_t colon_pos = host.find(':');
-                if (colon_pos != std::string::npos) {
-                    host = host.substr(0, colon_pos);
-                }
-                
-                return host;
+                return normalizeName(payload + start, end - start, scratch);
             }
         }
     }
@@ -222,13 +544,19 @@ bool DNSExtractor::isDNSQuery(const uint8_t* payload, size_t length) {
 }
 
 std::optional<std::string> DNSExtractor::extractQuery(const uint8_t* payload, size_t length) {
+    HostnameScratch scratch;
+    return toString(extractQueryView(payload, length, scratch));
+}
+
+std::optional<std::string_view> DNSExtractor::extractQueryView(const uint8_t* payload, size_t length,
+                                                               HostnameScratch& scratch) {
     if (!isDNSQuery(payload, length)) {
         return std::nullopt;
     }
     
-    // DNS query starts at byte 12
+    // DNS query starts at byte 12; labels are joined (lowercased) into scratch
     size_t offset = 12;
-    std::string domain;
+    size_t domain_length = 0;
     
     while (offset < length) {
         uint8_t label_length = payload[offset];
@@ -246,14 +574,23 @@ std::optional<std::string> DNSExtractor::extractQuery(const uint8_t* payload, si
         offset++;
         if (offset + label_length > length) break;
         
-        if (!domain.empty()) {
-            domain += '.';
+        size_t separator = domain_length > 0 ? 1 : 0;
+        if (domain_length + separator + label_length > MAX_HOSTNAME_LENGTH) break;
+        
+        if (separator) {
+            scratch.data[domain_length++] = '.';
+        }
+        for (size_t i = 0; i < label_length; i++) {
+            char c = static_cast<char>(payload[offset + i]);
+            scratch.data[domain_length++] = isUpper(c) ? static_cast<char>(c + ('a' - 'A')) : c;
         }
-        domain += std::string(reinterpret_cast<const char*>(payload + offset), label_length);
         offset += label_length;
     }
     
-    return domain.empty() ? std::nullopt : std::optional<std::string>(domain);
+    if (domain_length == 0) {
+        return std::nullopt;
+    }
+    return std::string_view(scratch.data, domain_length);
 }
 
 // ============================================================================
@@ -278,6 +615,12 @@ bool QUICSNIExtractor::isQUICInitial(const uint8_t* payload, size_t length) {
 }
 
 std::optional<std::string> QUICSNIExtractor::extract(const uint8_t* payload, size_t length) {
+    HostnameScratch scratch;
+    return toString(extractView(payload, length, scratch));
+}
+
+std::optional<std::string_view> QUICSNIExtractor::extractView(const uint8_t* payload, size_t length,
+                                                              HostnameScratch& scratch) {
     // QUIC Initial packets contain the TLS Client Hello inside CRYPTO frames
     // This is complex to parse properly due to QUIC framing
     // For now, we'll do a simplified search for the SNI extension pattern
@@ -288,10 +631,11 @@ std::optional<std::string> QUICSNIExtractor::extract(const uint8_t* payload, siz
     
     // Search for TLS Client Hello pattern within the QUIC packet
     // Look for the handshake type byte followed by SNI extension
-    for (size_t i = 0; i + 50 < length; i++) {
+    // Start past the long header so the record header fits before i
+    for (size_t i = 5; i + 50 < length; i++) {
         if (payload[i] == 0x01) {  // Client Hello handshake type
             // Try to extract SNI starting from here
-            auto result = SNIExtractor::extract(payload + i - 5, length - i + 5);
+            auto result = SNIExtractor::extractView(payload + i - 5, length - i + 5, scratch);
             if (result) return result;
         }
     }
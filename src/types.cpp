@@ -35,6 +35,11 @@ std::string appTypeToString(AppType type) {
         case AppType::DNS:        return "DNS";
         case AppType::TLS:        return "TLS";
         case AppType::QUIC:       return "QUIC";
+        case AppType::SSH:        return "SSH";
+        case AppType::BITTORRENT: return "BitTorrent";
+        case AppType::WIREGUARD:  return "WireGuard";
+        case AppType::OPENVPN:    return "OpenVPN";
+        case AppType::RTP:        return "RTP";
         case AppType::GOOGLE:     return "Google";
         case AppType::FACEBOOK:   return "Facebook";
         case AppType::YOUTUBE:    return "YouTube";
@@ -57,13 +62,20 @@ std::string appTypeToString(AppType type) {
 }
 
 // Map SNI/domain to application type
-AppType sniToAppType(const std::string& sni) {
+AppType sniToAppType(std::string_view sni) {
     if (sni.empty()) return AppType::UNKNOWN;
     
-    // Convert to lowercase for matching
-    std::string lower_sni = sni;
-    std::transform(lower_sni.begin(), lower_sni.end(), lower_sni.begin(),
-                   [](unsigned char c) { return std::tolower(c); });
+    // Convert to lowercase for matching (on the stack for any DNS-sized name)
+    char buffer[256];
+    std::string heap;
+    char* lower = buffer;
+    if (sni.size() > sizeof(buffer)) {
+        heap.resize(sni.size());
+        lower = &heap[0];
+    }
+    std::transform(sni.begin(), sni.end(), lower,
+                   [](unsigned char c) { return static_cast<char>(std::tolower(c)); });
+    std::string_view lower_sni(lower, sni.size());
     
     // Check for known patterns
     // Google (including YouTube, which is owned by Google)
@@ -0,0 +1,84 @@
+// ============================================================================
+// Allocation check - the packet path must stay off the heap
+// ============================================================================
+//
+// Build with -DDPI_ALLOC_CHECK (the CMake target alloc_check does) and run:
+//
+//   alloc_check [packets]
+//
+// Writes the autotuner's synthetic traffic (TLS handshakes with SNI, bulk
+// data, DNS) to a temporary capture, runs the engine over it and exits
+// non-zero if any LB or FP thread allocated after the warm-up. A domain rule
+// and an app rule are loaded, so the block and drop paths are covered too.
+// ============================================================================
+
+#include <iostream>
+#include <string>
+#include <cstdio>
+#include <random>
+#include <filesystem>
+#include "dpi_engine.h"
+#include "autotuner.h"
+#include "alloc_tracker.h"
+
+using namespace DPI;
+
+namespace {
+
+constexpr size_t DEFAULT_PACKETS = 200000;
+constexpr uint64_t WARMUP_PACKETS = 2000;
+
+// Both match flows in the synthetic traffic
+const char* const BLOCKED_DOMAIN = "*.facebook.com";
+const char* const BLOCKED_APP = "YouTube";
+
+}  // anonymous namespace
+
+int main(int argc, char* argv[]) {
+    if (!AllocTracker::isCompiledIn()) {
+        std::cerr << "alloc_check needs a build with -DDPI_ALLOC_CHECK\n";
+        return 1;
+    }
+
+    size_t packets = argc > 1 ? std::stoull(argv[1]) : DEFAULT_PACKETS;
+
+    std::random_device rd;
+    auto dir = std::filesystem::temp_directory_path();
+    std::string tag = "dpi_alloc_check_" + std::to_string(rd());
+    std::string input = (dir / (tag + "_in.pcap")).string();
+    std::string output = (dir / (tag + "_out.pcap")).string();
+
+    if (!Autotuner::writeSynthetic(input, packets)) {
+        return 1;
+    }
+
+    DPIEngine::Config config;
+    config.alloc_check_warmup = WARMUP_PACKETS;
+
+    bool processed = false;
+    bool passed = false;
+    {
+        DPIEngine engine(config);
+        if (engine.initialize()) {
+            engine.blockDomain(BLOCKED_DOMAIN);
+            engine.blockApp(BLOCKED_APP);
+            processed = engine.processFile(input, output);
+            passed = engine.allocationCheckPassed();
+        }
+    }
+
+    std::remove(input.c_str());
+    std::remove(output.c_str());
+
+    if (!processed) {
+        std::cerr << "alloc_check: engine failed on the synthetic capture\n";
+        return 1;
+    }
+    if (!passed) {
+        std::cerr << "alloc_check: LB/FP threads allocated in steady state\n";
+        return 2;
+    }
+
+    std::cout << "alloc_check: " << packets << " packets, no steady-state allocations\n";
+    return 0;
+}